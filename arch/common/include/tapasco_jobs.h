@@ -53,6 +53,8 @@ struct tapasco_transfer {
 	tapasco_device_alloc_flag_t flags;
 	tapasco_copy_direction_flag_t dir_flags;
 	tapasco_handle_t handle;
+	/** 1, if buffer was allocated and uploaded before PE acquisition **/
+	int staged;
 };
 typedef struct tapasco_transfer tapasco_transfer_t;
 
@@ -253,6 +255,30 @@ void tapasco_jobs_set_slot(tapasco_jobs_t *jobs,
 		tapasco_job_id_t const j_id,
 		tapasco_slot_id_t const slot_id);
 
+/**
+ * Returns the time the job's PE was started (see tapasco_perfc_now).
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @return timestamp in ns.
+ **/
+unsigned long tapasco_jobs_get_started(tapasco_jobs_t const *jobs, tapasco_job_id_t const j_id);
+
+/**
+ * Records the time the job's PE was started.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @param t timestamp in ns.
+ **/
+void tapasco_jobs_set_started(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id, unsigned long const t);
+
+/**
+ * Returns the job id last assigned to the given slot.
+ * @param jobs jobs context.
+ * @param slot_id slot id.
+ * @return id of the job running on the slot.
+ **/
+tapasco_job_id_t tapasco_jobs_get_slot_job(tapasco_jobs_t const *jobs, tapasco_slot_id_t const slot_id);
+
 /**
  * Reserves a job id for preparation.
  * @param jobs jobs context.
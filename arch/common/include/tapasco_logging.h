@@ -19,9 +19,12 @@
 //! @file	tapasco_logging.h
 //! @brief	libtapasco logging functions.
 //!		Internal logging functions to produce debug output; levels are
-//!		bitfield that can be turned on/off individually, with the
-//!		exception of all-zeroes (critical error) and 1 (warning), which
-//!		are always activated.
+//!		bitfield that can be turned on/off individually at runtime via
+//!		LIBTAPASCO_LOGLEVEL, with the exception of errors and warnings,
+//!		which are always activated and written synchronously.
+//!		Enabled LOG/DEVLOG calls are recorded in binary form and
+//!		formatted by a background thread (see log_ring.h); disabled
+//!		ones cost a load and a branch.
 //! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
 //!
 #ifndef TAPASCO_LOGGING_H__
@@ -30,6 +33,7 @@
 #include <inttypes.h>
 
 #include <log.h>
+#include <log_ring.h>
 
 #define LIBTAPASCO_LOGLEVELS \
 	_LALL(INIT,		(1 << 1)) \
@@ -48,6 +52,12 @@ typedef enum {
 #undef _LALL
 } tapasco_ll_t;
 
+/** Environment variable: mask of enabled log levels, number or names. **/
+#define LIBTAPASCO_LOGLEVEL_ENV		"LIBTAPASCO_LOGLEVEL"
+
+/** Mask of enabled log levels, set by tapasco_logging_init. **/
+extern unsigned long tapasco_logging_mask;
+
 int tapasco_logging_init(void);
 void tapasco_logging_deinit(void);
 
@@ -55,24 +65,23 @@ void tapasco_logging_deinit(void);
 #define DEV_PREFIX		"device #" PRIdev
 #endif
 
+#define LOG(l, msg, ...) \
+	LOG_RING(tapasco_logging_mask & (l), "[%s]: " msg, log_arg_cstr(__func__), ##__VA_ARGS__)
+#define DEVLOG(dev_id, l, msg, ...) \
+	LOG_RING(tapasco_logging_mask & (l), DEV_PREFIX " [%s]: " msg, dev_id, log_arg_cstr(__func__), \
+			##__VA_ARGS__)
+
 #ifdef NDEBUG
 #include <stdio.h>
 
-#define LOG(l, msg, ...) {}
-#define DEVLOG(dev_id, l, msg, ...)	{}
-
 #define ERR(msg, ...)		fprintf(stderr, "[%s]: " msg "\n", __func__, ##__VA_ARGS__)
 #define WRN(msg, ...)		fprintf(stderr, "[%s]: " msg "\n", __func__, ##__VA_ARGS__)
 
 #define DEVERR(dev_id, msg, ...) \
 			fprintf(stderr, DEV_PREFIX " [%s]: " msg "\n", dev_id, __func__, ##__VA_ARGS__)
-#define DEVWRN(dev_id, l, msg, ...) \
+#define DEVWRN(dev_id, msg, ...) \
 			fprintf(stderr, DEV_PREFIX " [%s]: " msg "\n", dev_id, __func__, ##__VA_ARGS__)
 #else /* !NDEBUG */
-#define LOG(l, msg, ...) log_info("[%s]: " msg, __func__, ##__VA_ARGS__)
-
-#define DEVLOG(dev_id, l, msg, ...)	log_info(DEV_PREFIX " [%s]: " msg, dev_id, __func__, ##__VA_ARGS__)
-
 #define ERR(msg, ...)	log_error("[%s]: " msg, __func__, ##__VA_ARGS__)
 #define WRN(msg, ...)	log_warn("[%s]: " msg, __func__, ##__VA_ARGS__)
 
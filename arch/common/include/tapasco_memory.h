@@ -50,6 +50,82 @@ void tapasco_device_free(tapasco_devctx_t *dev_ctx,
 		tapasco_device_alloc_flag_t const flags,
 		...);
 
+/**
+ * Allocates len bytes of host memory from which transfers to the device
+ * are zero-copy: if possible, the memory is one of the driver's DMA staging
+ * buffers, so @see tapasco_device_copy_to needs no intermediate copy.
+ * Falls back to regular host memory otherwise.
+ * @param dev_ctx device context
+ * @param buf output parameter to write the pointer to
+ * @param len size in bytes
+ * @return TAPASCO_SUCCESS if successful, error code otherwise
+ **/
+tapasco_res_t tapasco_device_alloc_host(tapasco_devctx_t *dev_ctx,
+		void **buf,
+		size_t const len);
+
+/**
+ * Frees host memory allocated with @see tapasco_device_alloc_host.
+ * @param dev_ctx device context
+ * @param buf pointer returned by @see tapasco_device_alloc_host
+ **/
+void tapasco_device_free_host(tapasco_devctx_t *dev_ctx, void *buf);
+
+/**
+ * Maps device memory into the process' address space, if the device shares
+ * the host's memory (e.g., Zynq): data can be written and read in place,
+ * @see tapasco_device_copy_to and @see tapasco_device_copy_from between the
+ * mapping and the mapped device memory become no-ops.
+ * @param dev_ctx device context
+ * @param h device memory handle returned by @see tapasco_device_alloc
+ * @param len size in bytes
+ * @param ptr output parameter to write the pointer to
+ * @return TAPASCO_SUCCESS if successful, TAPASCO_ERR_NOT_IMPLEMENTED if device
+ *         memory cannot be mapped on this platform, error code otherwise
+ **/
+tapasco_res_t tapasco_device_map(tapasco_devctx_t *dev_ctx,
+		tapasco_handle_t const h,
+		size_t const len,
+		void **ptr);
+
+/**
+ * Unmaps device memory mapped with @see tapasco_device_map; must be called
+ * before freeing the memory with @see tapasco_device_free.
+ * @param dev_ctx device context
+ * @param ptr pointer returned by @see tapasco_device_map
+ **/
+void tapasco_device_unmap(tapasco_devctx_t *dev_ctx, void *ptr);
+
+/**
+ * Flushes CPU writes to a range of a buffer allocated with
+ * TAPASCO_DEVICE_ALLOC_FLAGS_CACHEABLE, so the device sees them. Must be
+ * called after writing to its mapping and before launching a job on it.
+ * @param dev_ctx device context
+ * @param h device memory handle returned by @see tapasco_device_alloc
+ * @param offset offset of the range within the buffer
+ * @param len length of the range in bytes
+ * @return TAPASCO_SUCCESS if successful, error code otherwise
+ **/
+tapasco_res_t tapasco_device_sync_for_device(tapasco_devctx_t *dev_ctx,
+		tapasco_handle_t const h,
+		size_t const offset,
+		size_t const len);
+
+/**
+ * Invalidates stale CPU cache lines of a range of a buffer allocated with
+ * TAPASCO_DEVICE_ALLOC_FLAGS_CACHEABLE. Must be called after a job wrote to
+ * the buffer and before reading its mapping.
+ * @param dev_ctx device context
+ * @param h device memory handle returned by @see tapasco_device_alloc
+ * @param offset offset of the range within the buffer
+ * @param len length of the range in bytes
+ * @return TAPASCO_SUCCESS if successful, error code otherwise
+ **/
+tapasco_res_t tapasco_device_sync_for_cpu(tapasco_devctx_t *dev_ctx,
+		tapasco_handle_t const h,
+		size_t const offset,
+		size_t const len);
+
 /**
  * Copys memory from main memory to the FPGA device.
  * @param dev_ctx device context
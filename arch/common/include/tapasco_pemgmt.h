@@ -81,9 +81,29 @@ void tapasco_pemgmt_release_pe(tapasco_pemgmt_t *ctx,
 size_t tapasco_pemgmt_count(tapasco_pemgmt_t const *ctx,
 		tapasco_kernel_id_t const k_id);
 
+/**
+ * Stages the given job before a PE is acquired: allocates and uploads all
+ * transfer arguments which are not PE-local, so the PE is not held idle
+ * during the transfers.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+ **/
+tapasco_res_t tapasco_pemgmt_stage_job(tapasco_devctx_t *dev_ctx,
+		tapasco_job_id_t const j_id);
+
+/**
+ * Frees the device buffers of a staged job without reading them back, e.g.,
+ * if the job could not be launched.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ **/
+void tapasco_pemgmt_unstage_job(tapasco_devctx_t *dev_ctx,
+		tapasco_job_id_t const j_id);
+
 /**
  * Prepares the given job for the execution of the job by transferring
- * all arguments and set PE registers.
+ * all remaining (PE-local) arguments and set PE registers.
  * @param dev_ctx device context.
  * @param j_id job id.
  * @param slot_id id of the slot.
@@ -104,7 +124,8 @@ tapasco_res_t tapasco_pemgmt_start_pe(tapasco_devctx_t *dev_ctx,
 /**
  * Bottom half of job launch: Retrieves the arguments for the given
  * job from the registers of the PE it was assigned to. Then releases
- * the PE and sets the job to finished.
+ * the PE and sets the job to finished; staged transfers are copied
+ * back after the PE was released.
  * @param dev_ctx device context.
  * @param j_id job id.
  * @return TAPASCO_SUCCESS if successful, an error code otherwise.
@@ -25,6 +25,7 @@
 #ifndef TAPASCO_PERFC_H__
 #define TAPASCO_PERFC_H__
 
+#include <time.h>
 #include "tapasco_types.h"
 
 #ifdef _PC
@@ -40,6 +41,20 @@
 	_PC(pe_released) \
 	_PC(waiting_for_job)
 
+#ifdef _PH
+	#undef _PH
+#endif
+
+/* latency histograms in ns with log2-sized buckets */
+#define TAPASCO_PERFC_HISTOGRAMS \
+	_PH(stage_ns) \
+	_PH(acquire_wait_ns) \
+	_PH(launch_ns) \
+	_PH(run_ns) \
+	_PH(collect_ns)
+
+#define TAPASCO_PERFC_HISTOGRAM_BUCKETS			32
+
 #ifndef NPERFC
 	const char *tapasco_perfc_tostring(tapasco_dev_id_t const dev_id);
 	#define _PC(name) \
@@ -50,6 +65,22 @@
 
 	TAPASCO_PERFC_COUNTERS
 	#undef _PC
+
+	#define _PH(name) \
+	void tapasco_perfc_ ## name ## _record(tapasco_dev_id_t dev_id, unsigned long const v); \
+	long tapasco_perfc_ ## name ## _get(tapasco_dev_id_t dev_id, size_t const bucket);
+
+	TAPASCO_PERFC_HISTOGRAMS
+	#undef _PH
+
+	/** Returns a monotonic timestamp in ns for latency histograms. **/
+	static inline
+	unsigned long tapasco_perfc_now(void)
+	{
+		struct timespec t;
+		clock_gettime(CLOCK_MONOTONIC, &t);
+		return t.tv_sec * 1000000000UL + t.tv_nsec;
+	}
 #else /* NPERFC */
 	static inline
 	const char *tapasco_perfc_tostring(tapasco_dev_id_t const dev_id) { return ""; }
@@ -61,5 +92,15 @@
 
 	TAPASCO_PERFC_COUNTERS
 	#undef _PC
+
+	#define _PH(name) \
+	inline static void tapasco_perfc_ ## name ## _record(tapasco_dev_id_t dev_id, unsigned long const v) {} \
+	inline static long tapasco_perfc_ ## name ## _get(tapasco_dev_id_t dev_id, size_t const bucket) { return 0; }
+
+	TAPASCO_PERFC_HISTOGRAMS
+	#undef _PH
+
+	static inline
+	unsigned long tapasco_perfc_now(void) { return 0; }
 #endif /* NPERFC */
 #endif /* TAPASCO_PERFC_H__ */
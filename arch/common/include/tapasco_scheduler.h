@@ -31,9 +31,11 @@
  * Schedule a job for execution on the hardware threadpool.
  * @param dev_ctx device context.
  * @param j_id job id.
+ * @param flags launch flags; TAPASCO_DEVICE_JOB_LAUNCH_POLLED arms the slot for polling.
  * @return TAPASCO_SUCCESS, if job could be scheduled and will execute, an error code otherwise.
  **/
-tapasco_res_t tapasco_scheduler_launch(tapasco_devctx_t *dev_ctx, tapasco_job_id_t const j_id);
+tapasco_res_t tapasco_scheduler_launch(tapasco_devctx_t *dev_ctx, tapasco_job_id_t const j_id,
+		tapasco_device_job_launch_flag_t const flags);
 
 /**
  * Wait for given job and fetch results.
@@ -26,6 +26,7 @@
 #include <tapasco_context.h>
 #include <tapasco_device.h>
 #include <platform.h>
+#include <trace.h>
 
 tapasco_res_t tapasco_transfer_to(tapasco_devctx_t *devctx,
                                   tapasco_job_id_t const j_id,
@@ -34,10 +35,12 @@ tapasco_res_t tapasco_transfer_to(tapasco_devctx_t *devctx,
 {
 	LOG(LALL_TRANSFERS, "job %lu: allocating buffer with length %zd bytes",
 	    (unsigned long)j_id, (unsigned long)t->len);
+	TRACE_BEGIN("transfer_to", devctx->id, j_id);
 	tapasco_res_t res = tapasco_device_alloc(devctx, &t->handle, t->len,
 	                    t->flags, s_id);
 	if (res != TAPASCO_SUCCESS) {
 		ERR("job %lu: memory allocation failed!", (unsigned long)j_id);
+		TRACE_END("transfer_to", devctx->id, j_id);
 		return res;
 	}
 	if (t->dir_flags & TAPASCO_COPY_DIRECTION_TO) {
@@ -50,8 +53,11 @@ tapasco_res_t tapasco_transfer_to(tapasco_devctx_t *devctx,
 			    t->len,
 			    (unsigned long)t->handle,
 			    (unsigned long)t->flags);
+			// callers only free buffers of successful transfers
+			tapasco_device_free(devctx, t->handle, t->flags, s_id, t->len);
 		}
 	}
+	TRACE_END("transfer_to", devctx->id, j_id);
 	return res;
 }
 
@@ -62,6 +68,7 @@ tapasco_res_t tapasco_transfer_from(tapasco_devctx_t *devctx,
                                     tapasco_slot_id_t s_id)
 {
 	tapasco_res_t res = TAPASCO_SUCCESS;
+	TRACE_BEGIN("transfer_from", devctx->id, j_id);
 	if (t->dir_flags & TAPASCO_COPY_DIRECTION_FROM) {
 		LOG(LALL_TRANSFERS, "job %lu: executing transfer from with length %zd bytes",
 		    (unsigned long)j_id, (unsigned long)t->len);
@@ -78,6 +85,7 @@ tapasco_res_t tapasco_transfer_from(tapasco_devctx_t *devctx,
 	LOG(LALL_TRANSFERS, "job %lu: freeing buffer with length %zd bytes",
 	    (unsigned long)j_id, (unsigned long)t->len);
 	tapasco_device_free(devctx, t->handle, t->flags, s_id, t->len);
+	TRACE_END("transfer_from", devctx->id, j_id);
 	return res;
 }
 
@@ -95,14 +103,14 @@ tapasco_res_t tapasco_write_arg(tapasco_devctx_t *devctx,
 		LOG(LALL_TRANSFERS, "job %lu: writing 64b arg #%u = 0x%08lx to 0x%08x",
 		    (unsigned long)j_id, a, (unsigned long)v, (unsigned)h);
 		if (platform_write_ctl(pctx, h, sizeof(v), &v,
-		                       PLATFORM_CTL_FLAGS_NONE) != PLATFORM_SUCCESS)
+		                       PLATFORM_CTL_FLAGS_WC) != PLATFORM_SUCCESS)
 			return TAPASCO_ERR_PLATFORM_FAILURE;
 	} else {
 		uint32_t v = tapasco_jobs_get_arg32(jobs, j_id, a);
 		LOG(LALL_TRANSFERS, "job %lu: writing 32b arg #%u = 0x%08lx to 0x%08x",
 		    (unsigned long)j_id, a, (unsigned long)v, (unsigned)h);
 		if (platform_write_ctl(pctx, h, sizeof(v), &v,
-		                       PLATFORM_CTL_FLAGS_NONE) != PLATFORM_SUCCESS)
+		                       PLATFORM_CTL_FLAGS_WC) != PLATFORM_SUCCESS)
 			return TAPASCO_ERR_PLATFORM_FAILURE;
 	}
 	return TAPASCO_SUCCESS;
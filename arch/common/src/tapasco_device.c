@@ -20,9 +20,12 @@
 //! @brief	Device context struct and helper methods.
 //! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
 //! 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <sched.h>
 #include <tapasco_device.h>
 #include <tapasco_jobs.h>
 #include <tapasco_regs.h>
@@ -33,6 +36,27 @@
 #include <platform.h>
 #include <platform_errors.h>
 #include <platform_info.h>
+#include <trace.h>
+
+/** Set to 0 to allocate the runtime tables wherever the caller runs. */
+#define TAPASCO_NUMA_TABLES_ENV			"LIBTAPASCO_NUMA_TABLES"
+
+/**
+ * Binds the calling thread to the device's NUMA node, so the runtime tables
+ * are first touched there; returns 1 if prev has to be restored afterwards.
+ */
+static int numa_bind_begin(tapasco_devctx_t *devctx, cpu_set_t *prev)
+{
+	char const *e = getenv(TAPASCO_NUMA_TABLES_ENV);
+	if (e && ! strcmp(e, "0")) return 0;
+	if (pthread_getaffinity_np(pthread_self(), sizeof(*prev), prev)) return 0;
+	return platform_numa_bind_thread(devctx->pdctx, pthread_self()) == PLATFORM_SUCCESS;
+}
+
+static void numa_bind_end(cpu_set_t const *prev)
+{
+	pthread_setaffinity_np(pthread_self(), sizeof(*prev), prev);
+}
 
 /** System setup function. */
 static void setup_system(tapasco_devctx_t *devctx)
@@ -48,6 +72,7 @@ tapasco_res_t tapasco_create_device(tapasco_ctx_t *ctx,
 		tapasco_device_create_flag_t const flags)
 {
 	tapasco_devctx_t *p = (tapasco_devctx_t *)calloc(sizeof(struct tapasco_devctx), 1);
+	if (trace_init()) LOG(LALL_DEVICE, "tracing to %s", getenv(TRACE_ENV));
 	if (! p) {
 		ERR("could not allocate tapasco device context");
 		return TAPASCO_ERR_OUT_OF_MEMORY;
@@ -67,9 +92,12 @@ tapasco_res_t tapasco_create_device(tapasco_ctx_t *ctx,
 		return TAPASCO_ERR_PLATFORM_FAILURE;
 	}
 
+	cpu_set_t prev;
+	int const numa = numa_bind_begin(p, &prev);
 	tapasco_res_t res = tapasco_pemgmt_init(p, &p->pemgmt);
 	res = res == TAPASCO_SUCCESS ? tapasco_jobs_init(dev_id, &p->jobs) : res;
 	res = res == TAPASCO_SUCCESS ? tapasco_local_mem_init(p, &p->lmem) : res;
+	if (numa) numa_bind_end(&prev);
 	if (res != TAPASCO_SUCCESS) return res;
 	p->pctx = ctx->pctx;
 	p->id = dev_id;
@@ -92,6 +120,7 @@ void tapasco_destroy_device(tapasco_ctx_t *ctx, tapasco_devctx_t *devctx)
 	tapasco_jobs_deinit(devctx->jobs);
 	tapasco_pemgmt_deinit(devctx->pemgmt);
 	platform_destroy_device(ctx->pctx, devctx->pdctx);
+	if (trace_dump()) ERR("could not write trace to %s", getenv(TRACE_ENV));
 	free(devctx);
 }
 
@@ -115,7 +144,9 @@ tapasco_res_t tapasco_device_acquire_job_id(tapasco_devctx_t *devctx,
 		tapasco_device_acquire_job_id_flag_t flags)
 {
 	if (flags) return TAPASCO_ERR_NOT_IMPLEMENTED;
+	TRACE_BEGIN("acquire_job_id", devctx->id, k_id);
 	*j_id = tapasco_jobs_acquire(devctx->jobs);
+	TRACE_END("acquire_job_id", devctx->id, *j_id);
 	if (*j_id > 0)
 		tapasco_jobs_set_kernel_id(devctx->jobs, *j_id, k_id);
 	return *j_id > 0 ? TAPASCO_SUCCESS : TAPASCO_ERR_UNKNOWN_ERROR;
@@ -131,8 +162,9 @@ tapasco_res_t tapasco_device_job_launch(tapasco_devctx_t *devctx,
 		tapasco_job_id_t const j_id,
 		tapasco_device_job_launch_flag_t const flags)
 {
-	tapasco_res_t const r = tapasco_scheduler_launch(devctx, j_id);
-	if (r != TAPASCO_SUCCESS || (flags & TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING)) {
+	tapasco_res_t const r = tapasco_scheduler_launch(devctx, j_id, flags);
+	if (r != TAPASCO_SUCCESS || (flags & (TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING |
+			TAPASCO_DEVICE_JOB_LAUNCH_POLLED))) {
 		return r;
 	} else {
 		return tapasco_scheduler_finish_job(devctx, j_id);
@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <tapasco_global.h>
 #include <tapasco_jobs.h>
 #include <tapasco_perfc.h>
 #include <gen_fixed_size_pool.h>
@@ -54,6 +55,8 @@ struct tapasco_job {
 	tapasco_transfer_t transfers[TAPASCO_JOB_MAX_ARGS];
 	/** slot id this job is scheduled on **/
 	tapasco_slot_id_t slot;
+	/** time the PE was started (perfc) **/
+	unsigned long t_started;
 };
 typedef struct tapasco_job tapasco_job_t;
 
@@ -73,6 +76,7 @@ struct tapasco_jobs {
 	tapasco_dev_id_t dev_id;
 	tapasco_job_id_t job_id_high_watermark;
 	struct tapasco_jobs_fsp_t q;
+	tapasco_job_id_t slot_job[TAPASCO_NUM_SLOTS];
 };
 
 tapasco_res_t tapasco_jobs_init(tapasco_dev_id_t dev_id, tapasco_jobs_t **jobs)
@@ -250,6 +254,7 @@ tapasco_res_t tapasco_jobs_set_arg_transfer(tapasco_jobs_t *jobs,
 	jobs->q.elems[j_id - JOB_ID_OFFSET].transfers[arg_idx].data  = arg_value;
 	jobs->q.elems[j_id - JOB_ID_OFFSET].transfers[arg_idx].flags = flags;
 	jobs->q.elems[j_id - JOB_ID_OFFSET].transfers[arg_idx].dir_flags = dir_flags;
+	jobs->q.elems[j_id - JOB_ID_OFFSET].transfers[arg_idx].staged = 0;
 	if (jobs->q.elems[j_id - JOB_ID_OFFSET].args_len < arg_idx + 1)
 		jobs->q.elems[j_id - JOB_ID_OFFSET].args_len = arg_idx + 1;
 	return TAPASCO_SUCCESS;
@@ -302,6 +307,28 @@ void tapasco_jobs_set_slot(tapasco_jobs_t *jobs,
 	assert(jobs);
 	assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
 	jobs->q.elems[j_id - JOB_ID_OFFSET].slot = slot_id;
+	if (slot_id < TAPASCO_NUM_SLOTS) jobs->slot_job[slot_id] = j_id;
+}
+
+unsigned long tapasco_jobs_get_started(tapasco_jobs_t const *jobs, tapasco_job_id_t const j_id)
+{
+	assert(jobs);
+	assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
+	return jobs->q.elems[j_id - JOB_ID_OFFSET].t_started;
+}
+
+void tapasco_jobs_set_started(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id, unsigned long const t)
+{
+	assert(jobs);
+	assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
+	jobs->q.elems[j_id - JOB_ID_OFFSET].t_started = t;
+}
+
+tapasco_job_id_t tapasco_jobs_get_slot_job(tapasco_jobs_t const *jobs, tapasco_slot_id_t const slot_id)
+{
+	assert(jobs);
+	assert(slot_id < TAPASCO_NUM_SLOTS);
+	return jobs->slot_job[slot_id];
 }
 
 inline
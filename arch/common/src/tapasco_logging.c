@@ -21,24 +21,33 @@
 //! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
 //!
 
+#include <stdlib.h>
 #include "tapasco_logging.h"
 
-#ifdef NDEBUG
-int tapasco_logging_init(void) { return 1; }
-void tapasco_logging_deinit(void) {}
-#else
+unsigned long tapasco_logging_mask;
 
-#include <stdlib.h>
+static char const *const level_names[] = {
+#define _LALL(name, level) #name,
+	LIBTAPASCO_LOGLEVELS
+#undef _LALL
+};
+
+static unsigned long const level_bits[] = {
+#define _LALL(name, level) level,
+	LIBTAPASCO_LOGLEVELS
+#undef _LALL
+};
 
 static FILE *logfile = 0;
+static int is_initialized = 0;
 
 int tapasco_logging_init(void)
 {
-	static int is_initialized = 0;
 	if (! is_initialized) {
 		is_initialized = 1;
 
 		char const *lgf = getenv("LIBTAPASCO_LOGFILE");
+		char const *lvl = getenv(LIBTAPASCO_LOGLEVEL_ENV);
 		logfile = lgf ? fopen(lgf, "w+") : 0;
 
 		if (lgf && !logfile) {
@@ -51,12 +60,24 @@ int tapasco_logging_init(void)
 			log_set_fp(logfile);
 		}
 
+		// LIBTAPASCO_DEBUG is the name used by older documentation
+		if (! lvl) lvl = getenv("LIBTAPASCO_DEBUG");
+		tapasco_logging_mask = log_ring_parse_mask(lvl, level_names, level_bits,
+				sizeof(level_bits) / sizeof(*level_bits));
+		if (tapasco_logging_mask && ! log_ring_init()) {
+			WRN("could not start log formatter thread, logging disabled");
+			tapasco_logging_mask = 0;
+		}
 	}
 	return 1;
 }
 
 void tapasco_logging_deinit(void)
 {
+	if (is_initialized && tapasco_logging_mask) log_ring_deinit();
+	tapasco_logging_mask = 0;
+	is_initialized = 0;
+
 	log_set_fp(NULL);
 
 	if (logfile != NULL && logfile != stderr) {
@@ -65,5 +86,3 @@ void tapasco_logging_deinit(void)
 	}
 	logfile = NULL;
 }
-
-#endif
\ No newline at end of file
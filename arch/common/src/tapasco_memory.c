@@ -23,6 +23,7 @@
  *  @author	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
  **/
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <assert.h>
@@ -130,7 +131,8 @@ tapasco_res_t tapasco_device_alloc(tapasco_devctx_t *devctx,
 		va_end(ap);
 		return tapasco_device_alloc_local(devctx, h, len, flags, s_id);
 	}
-	r = platform_alloc(p, len, &addr, PLATFORM_ALLOC_FLAGS_NONE);
+	r = platform_alloc(p, len, &addr, flags & TAPASCO_DEVICE_ALLOC_FLAGS_CACHEABLE ?
+			PLATFORM_ALLOC_FLAGS_CACHEABLE : PLATFORM_ALLOC_FLAGS_NONE);
 	if (r == PLATFORM_SUCCESS) {
 		LOG(LALL_MEM, "allocated %zd bytes at " PRImem, len, addr);
 		*h = addr;
@@ -157,6 +159,63 @@ void tapasco_device_free(tapasco_devctx_t *devctx,
 	platform_dealloc(p, handle, PLATFORM_ALLOC_FLAGS_NONE);
 }
 
+tapasco_res_t tapasco_device_alloc_host(tapasco_devctx_t *devctx,
+		void **buf,
+		size_t const len)
+{
+	platform_res_t r = platform_alloc_host(devctx->pdctx, len, buf);
+	if (r == PLATFORM_SUCCESS) {
+		LOG(LALL_MEM, "allocated %zd bytes of host memory at %p", len, *buf);
+		return TAPASCO_SUCCESS;
+	}
+	WRN("could not allocate %zd bytes of host memory: %s (" PRIres ")", len, platform_strerror(r), r);
+	return TAPASCO_ERR_OUT_OF_MEMORY;
+}
+
+void tapasco_device_free_host(tapasco_devctx_t *devctx, void *buf)
+{
+	LOG(LALL_MEM, "freeing host memory at %p", buf);
+	platform_free_host(devctx->pdctx, buf);
+}
+
+tapasco_res_t tapasco_device_map(tapasco_devctx_t *devctx,
+		tapasco_handle_t const h,
+		size_t const len,
+		void **ptr)
+{
+	platform_res_t r = platform_map_mem(devctx->pdctx, h, len, ptr);
+	if (r == PLATFORM_SUCCESS) {
+		LOG(LALL_MEM, "mapped %zd bytes of handle " PRIhandle " at %p", len, h, *ptr);
+		return TAPASCO_SUCCESS;
+	}
+	LOG(LALL_MEM, "could not map handle " PRIhandle ": %s (" PRIres ")", h, platform_strerror(r), r);
+	return r == PERR_NOT_IMPLEMENTED ? TAPASCO_ERR_NOT_IMPLEMENTED : TAPASCO_ERR_PLATFORM_FAILURE;
+}
+
+void tapasco_device_unmap(tapasco_devctx_t *devctx, void *ptr)
+{
+	LOG(LALL_MEM, "unmapping device memory at %p", ptr);
+	platform_unmap_mem(devctx->pdctx, ptr);
+}
+
+tapasco_res_t tapasco_device_sync_for_device(tapasco_devctx_t *devctx,
+		tapasco_handle_t const h,
+		size_t const offset,
+		size_t const len)
+{
+	return platform_sync_mem(devctx->pdctx, h, offset, len, PLATFORM_SYNC_FOR_DEVICE) == PLATFORM_SUCCESS ?
+			TAPASCO_SUCCESS : TAPASCO_ERR_PLATFORM_FAILURE;
+}
+
+tapasco_res_t tapasco_device_sync_for_cpu(tapasco_devctx_t *devctx,
+		tapasco_handle_t const h,
+		size_t const offset,
+		size_t const len)
+{
+	return platform_sync_mem(devctx->pdctx, h, offset, len, PLATFORM_SYNC_FOR_CPU) == PLATFORM_SUCCESS ?
+			TAPASCO_SUCCESS : TAPASCO_ERR_PLATFORM_FAILURE;
+}
+
 tapasco_res_t tapasco_device_copy_to(tapasco_devctx_t *devctx,
 		void const *src,
 		tapasco_handle_t dst,
@@ -208,3 +267,59 @@ tapasco_res_t tapasco_device_copy_from(tapasco_devctx_t *devctx,
 			PLATFORM_SUCCESS ?
 			TAPASCO_SUCCESS : TAPASCO_ERR_PLATFORM_FAILURE;
 }
+
+/** Converts segments to platform segments; returns NULL on error. **/
+static
+platform_mem_seg_t *to_platform_segs(tapasco_copy_seg_t const *segs, size_t const num_segs)
+{
+	platform_mem_seg_t *ps = (platform_mem_seg_t *)malloc(sizeof(*ps) * num_segs);
+	if (! ps) return NULL;
+	for (size_t i = 0; i < num_segs; ++i) {
+		ps[i].data = segs[i].data;
+		ps[i].addr = (platform_mem_addr_t)segs[i].handle;
+		ps[i].len  = segs[i].len;
+	}
+	return ps;
+}
+
+tapasco_res_t tapasco_device_copy_to_v(tapasco_devctx_t *devctx,
+		tapasco_copy_seg_t const *segs,
+		size_t const num_segs,
+		tapasco_device_copy_flag_t const flags)
+{
+	platform_mem_seg_t *ps;
+	platform_res_t r;
+	LOG(LALL_MEM, "segs = %zu, flags = " PRIflags, num_segs, (CSTflags) flags);
+	if (flags & TAPASCO_DEVICE_COPY_NONBLOCKING)
+		return TAPASCO_ERR_NONBLOCKING_MODE_NOT_SUPPORTED;
+	if (flags)
+		return TAPASCO_ERR_NOT_IMPLEMENTED;
+	if (! num_segs)
+		return TAPASCO_SUCCESS;
+	if (! (ps = to_platform_segs(segs, num_segs)))
+		return TAPASCO_ERR_OUT_OF_MEMORY;
+	r = platform_write_mem_v(devctx->pdctx, ps, num_segs, PLATFORM_MEM_FLAGS_NONE);
+	free(ps);
+	return r == PLATFORM_SUCCESS ? TAPASCO_SUCCESS : TAPASCO_ERR_PLATFORM_FAILURE;
+}
+
+tapasco_res_t tapasco_device_copy_from_v(tapasco_devctx_t *devctx,
+		tapasco_copy_seg_t const *segs,
+		size_t const num_segs,
+		tapasco_device_copy_flag_t const flags)
+{
+	platform_mem_seg_t *ps;
+	platform_res_t r;
+	LOG(LALL_MEM, "segs = %zu, flags = " PRIflags, num_segs, (CSTflags) flags);
+	if (flags & TAPASCO_DEVICE_COPY_NONBLOCKING)
+		return TAPASCO_ERR_NONBLOCKING_MODE_NOT_SUPPORTED;
+	if (flags)
+		return TAPASCO_ERR_NOT_IMPLEMENTED;
+	if (! num_segs)
+		return TAPASCO_SUCCESS;
+	if (! (ps = to_platform_segs(segs, num_segs)))
+		return TAPASCO_ERR_OUT_OF_MEMORY;
+	r = platform_read_mem_v(devctx->pdctx, ps, num_segs, PLATFORM_MEM_FLAGS_NONE);
+	free(ps);
+	return r == PLATFORM_SUCCESS ? TAPASCO_SUCCESS : TAPASCO_ERR_PLATFORM_FAILURE;
+}
@@ -36,6 +36,7 @@
 #include <tapasco_perfc.h>
 #include <platform.h>
 #include <gen_stack.h>
+#include <trace.h>
 #include <khash.h>
 
 typedef size_t midx_t;
@@ -177,8 +178,10 @@ tapasco_slot_id_t tapasco_pemgmt_acquire_pe(tapasco_pemgmt_t *ctx,
 	const khiter_t k = kh_get(kidmap, ctx->kidmap, k_id);
 	assert(k != kh_end(ctx->kidmap));
 	const midx_t bucket_idx = kh_val(ctx->kidmap, k);
+	TRACE_BEGIN("acquire_pe", ctx->dev_id, k_id);
 	while (sem_wait(&ctx->kernel[bucket_idx].sem)) ;
 	tapasco_pe_t *pe = (tapasco_pe_t *)gs_pop(&ctx->kernel[bucket_idx].pe_stk);
+	TRACE_END("acquire_pe", ctx->dev_id, pe->slot_id);
 	DEVLOG(ctx->dev_id, LALL_PEMGMT, "k_id = " PRIkernel ", slot_id = " PRIslot, k_id, pe->slot_id);
 	tapasco_perfc_pe_acquired_inc(ctx->dev_id);
 	return pe->slot_id;
@@ -193,6 +196,7 @@ void tapasco_pemgmt_release_pe(tapasco_pemgmt_t *ctx, tapasco_slot_id_t const s_
 	const midx_t bucket_idx = kh_val(ctx->kidmap, k);
 	DEVLOG(ctx->dev_id, LALL_PEMGMT, "slot_id = " PRIslot, s_id);
 	tapasco_perfc_pe_released_inc(ctx->dev_id);
+	TRACE_INSTANT("release_pe", ctx->dev_id, s_id);
 	gs_push(&ctx->kernel[bucket_idx].pe_stk, ctx->pe[s_id]);
 	while (sem_post(&ctx->kernel[bucket_idx].sem)) ;
 }
@@ -210,6 +214,37 @@ size_t tapasco_device_kernel_pe_count(tapasco_devctx_t *devctx, tapasco_kernel_i
 	return tapasco_pemgmt_count(devctx->pemgmt, k_id);
 }
 
+tapasco_res_t tapasco_pemgmt_stage_job(tapasco_devctx_t *devctx,
+		tapasco_job_id_t const j_id)
+{
+	tapasco_res_t r = TAPASCO_SUCCESS;
+	assert(devctx->jobs);
+	size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, j_id);
+	for (size_t a = 0; a < num_args && r == TAPASCO_SUCCESS; ++a) {
+		tapasco_transfer_t *t = tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+		if (t->len > 0 && ! (t->flags & TAPASCO_DEVICE_ALLOC_FLAGS_PE_LOCAL)) {
+			DEVLOG(devctx->id, LALL_PEMGMT, "job " PRIjob ": staging %zd byte arg #%zd", j_id, t->len, a);
+			if ((r = tapasco_transfer_to(devctx, j_id, t, 0)) == TAPASCO_SUCCESS)
+				t->staged = 1;
+		}
+	}
+	// release buffers of the args staged so far
+	if (r != TAPASCO_SUCCESS) tapasco_pemgmt_unstage_job(devctx, j_id);
+	return r;
+}
+
+void tapasco_pemgmt_unstage_job(tapasco_devctx_t *devctx, tapasco_job_id_t const j_id)
+{
+	size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, j_id);
+	for (size_t a = 0; a < num_args; ++a) {
+		tapasco_transfer_t *t = tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+		if (t->staged) {
+			tapasco_device_free(devctx, t->handle, t->flags);
+			t->staged = 0;
+		}
+	}
+}
+
 tapasco_res_t tapasco_pemgmt_prepare_pe(tapasco_devctx_t *devctx,
 		tapasco_job_id_t const j_id,
 		tapasco_slot_id_t const slot_id)
@@ -222,15 +257,20 @@ tapasco_res_t tapasco_pemgmt_prepare_pe(tapasco_devctx_t *devctx,
 		tapasco_transfer_t *t = tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
 
 		if (t->len > 0) {
-			DEVLOG(devctx->id, LALL_PEMGMT, "job " PRIjob ": transferring %zd byte arg #%zd", j_id, t->len, a);
-			if ((r = tapasco_transfer_to(devctx, j_id, t, slot_id)) != TAPASCO_SUCCESS) { return r; }
+			if (! t->staged) {
+				DEVLOG(devctx->id, LALL_PEMGMT, "job " PRIjob ": transferring %zd byte arg #%zd", j_id, t->len, a);
+				if ((r = tapasco_transfer_to(devctx, j_id, t, slot_id)) != TAPASCO_SUCCESS) { return r; }
+			}
 			DEVLOG(devctx->id, LALL_PEMGMT, "job " PRIjob ": writing handle to arg #%zd (" PRIhandle ")", j_id, a, t->handle);
 			if (platform_write_ctl(devctx->pdctx, h, sizeof(t->handle),
-					&t->handle, PLATFORM_CTL_FLAGS_NONE) != PLATFORM_SUCCESS) {
+					&t->handle, PLATFORM_CTL_FLAGS_WC) != PLATFORM_SUCCESS) {
 				return TAPASCO_ERR_PLATFORM_FAILURE;
 			}
-		} else if ((r = tapasco_write_arg(devctx, devctx->jobs, j_id, h, a)) != TAPASCO_SUCCESS) {
-			return r;
+		} else {
+			TRACE_BEGIN("write_arg", devctx->id, j_id);
+			r = tapasco_write_arg(devctx, devctx->jobs, j_id, h, a);
+			TRACE_END("write_arg", devctx->id, j_id);
+			if (r != TAPASCO_SUCCESS) return r;
 		}
 	}
 	return TAPASCO_SUCCESS;
@@ -240,6 +280,7 @@ tapasco_res_t tapasco_pemgmt_start_pe(tapasco_devctx_t *devctx, tapasco_slot_id_
 {
 	uint32_t const start_cmd = 1;
 	tapasco_handle_t ctl = tapasco_regs_named_register(devctx, slot_id, TAPASCO_REG_CTRL);
+	TRACE_INSTANT("start_pe", devctx->id, slot_id);
 
 	if (platform_write_ctl(devctx->pdctx,
 			ctl,
@@ -283,18 +324,34 @@ tapasco_res_t tapasco_pemgmt_finish_pe(tapasco_devctx_t *devctx, tapasco_job_id_
 	tapasco_jobs_set_return(devctx->jobs, j_id, sizeof(ret), &ret);
 	DEVLOG(devctx->id, LALL_PEMGMT, "job #" PRIjob ": read result value 0x%08llx", j_id, ret);
 
-	// Read back values from all argument registers
-	for (size_t a = 0; a < num_args; ++a) {
+	// Read back values from all argument registers and PE-local memory
+	TRACE_BEGIN("readback", devctx->id, j_id);
+	for (size_t a = 0; a < num_args && r == TAPASCO_SUCCESS; ++a) {
 		tapasco_handle_t h    = tapasco_regs_arg_register(devctx, slot_id, a);
 		tapasco_transfer_t *t = tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
 
-		if ((r = tapasco_read_arg(devctx, devctx->jobs, j_id, h, a)) != TAPASCO_SUCCESS) { return r; }
-		if (t->len > 0) {
+		r = tapasco_read_arg(devctx, devctx->jobs, j_id, h, a);
+		if (r == TAPASCO_SUCCESS && t->len > 0 && ! t->staged)
 			r = tapasco_transfer_from(devctx, devctx->jobs, j_id, t, slot_id);
-			if (r != TAPASCO_SUCCESS) { return r; }
-		}
+	}
+	TRACE_END("readback", devctx->id, j_id);
+	if (r != TAPASCO_SUCCESS) {
+		tapasco_pemgmt_unstage_job(devctx, j_id);
+		return r;
 	}
 
 	tapasco_pemgmt_release_pe(pemgmt, slot_id);
-	return TAPASCO_SUCCESS;
+
+	// staged buffers are independent of the PE, next job may start already
+	TRACE_BEGIN("download", devctx->id, j_id);
+	for (size_t a = 0; a < num_args; ++a) {
+		tapasco_transfer_t *t = tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+		if (t->len > 0 && t->staged) {
+			tapasco_res_t const rr = tapasco_transfer_from(devctx, devctx->jobs, j_id, t, slot_id);
+			if (r == TAPASCO_SUCCESS) r = rr;
+			t->staged = 0;
+		}
+	}
+	TRACE_END("download", devctx->id, j_id);
+	return r;
 }
@@ -28,50 +28,117 @@
 #ifndef NPERFC
 
 #define TAPASCO_MAX_DEVS				32
+/* counters are sharded per thread; each shard fills whole cache lines */
+#define TAPASCO_PERFC_SHARDS				16
+#define CACHE_LINE_SZ					64
 
-static
-struct tapasco_perfc_t {
-#define _PC(NAME) 	_Atomic(long int) pc_ ## NAME[TAPASCO_MAX_DEVS];
+struct tapasco_perfc_shard_t {
+#define _PC(NAME) 	long int pc_ ## NAME;
 	TAPASCO_PERFC_COUNTERS
 #undef _PC
+#define _PH(NAME) 	long int ph_ ## NAME[TAPASCO_PERFC_HISTOGRAM_BUCKETS];
+	TAPASCO_PERFC_HISTOGRAMS
+#undef _PH
+} __attribute__((aligned(CACHE_LINE_SZ)));
+
+static
+struct tapasco_perfc_t {
+	struct tapasco_perfc_shard_t shard[TAPASCO_MAX_DEVS][TAPASCO_PERFC_SHARDS];
 } tapasco_perfc;
 
+/** Returns the shard of the calling thread, threads are assigned round-robin. **/
+static inline
+struct tapasco_perfc_shard_t *shard_of_thread(tapasco_dev_id_t const dev_id)
+{
+	static size_t next_shard;
+	static __thread size_t shard __attribute__((tls_model("initial-exec"))) = TAPASCO_PERFC_SHARDS;
+	if (__builtin_expect(shard == TAPASCO_PERFC_SHARDS, 0))
+		shard = __atomic_fetch_add(&next_shard, 1, __ATOMIC_RELAXED) % TAPASCO_PERFC_SHARDS;
+	return &tapasco_perfc.shard[dev_id][shard];
+}
+
+/** Bucket b holds values in [2^(b-1), 2^b), bucket 0 holds 0. **/
+static inline
+size_t bucket_of(unsigned long const v)
+{
+	size_t const b = v ? 64 - __builtin_clzl(v) : 0;
+	return b < TAPASCO_PERFC_HISTOGRAM_BUCKETS ? b : TAPASCO_PERFC_HISTOGRAM_BUCKETS - 1;
+}
+
+/* shards are shared by more than TAPASCO_PERFC_SHARDS threads, so updates
+ * remain atomic, but are uncontended in the common case; _set is meant for
+ * gauges and does not race with _add on the same counter */
 #define _PC(name) \
 void tapasco_perfc_ ## name ## _inc(tapasco_dev_id_t dev_id) \
 { \
-	tapasco_perfc.pc_ ## name[dev_id]++; \
+	__atomic_fetch_add(&shard_of_thread(dev_id)->pc_ ## name, 1, __ATOMIC_RELAXED); \
 } \
 \
 void tapasco_perfc_ ## name ## _add(tapasco_dev_id_t dev_id, int const v) \
 { \
-	tapasco_perfc.pc_ ## name[dev_id] += v; \
+	__atomic_fetch_add(&shard_of_thread(dev_id)->pc_ ## name, v, __ATOMIC_RELAXED); \
 } \
 \
 long int tapasco_perfc_ ## name ## _get(tapasco_dev_id_t dev_id) \
 { \
-	return tapasco_perfc.pc_ ## name[dev_id]; \
+	long int v = 0; \
+	for (size_t s = 0; s < TAPASCO_PERFC_SHARDS; ++s) \
+		v += __atomic_load_n(&tapasco_perfc.shard[dev_id][s].pc_ ## name, __ATOMIC_RELAXED); \
+	return v; \
 } \
 \
 void tapasco_perfc_ ## name ## _set(tapasco_dev_id_t dev_id, int const v) \
 { \
-	tapasco_perfc.pc_ ## name[dev_id] = v; \
+	for (size_t s = 1; s < TAPASCO_PERFC_SHARDS; ++s) \
+		__atomic_store_n(&tapasco_perfc.shard[dev_id][s].pc_ ## name, 0, __ATOMIC_RELAXED); \
+	__atomic_store_n(&tapasco_perfc.shard[dev_id][0].pc_ ## name, v, __ATOMIC_RELAXED); \
 }
 
 TAPASCO_PERFC_COUNTERS
 #undef _PC
 
+#define _PH(name) \
+void tapasco_perfc_ ## name ## _record(tapasco_dev_id_t dev_id, unsigned long const v) \
+{ \
+	__atomic_fetch_add(&shard_of_thread(dev_id)->ph_ ## name[bucket_of(v)], 1, __ATOMIC_RELAXED); \
+} \
+\
+long int tapasco_perfc_ ## name ## _get(tapasco_dev_id_t dev_id, size_t const bucket) \
+{ \
+	long int v = 0; \
+	for (size_t s = 0; s < TAPASCO_PERFC_SHARDS; ++s) \
+		v += __atomic_load_n(&tapasco_perfc.shard[dev_id][s].ph_ ## name[bucket], __ATOMIC_RELAXED); \
+	return v; \
+}
+
+TAPASCO_PERFC_HISTOGRAMS
+#undef _PH
+
 #ifndef STR
 	#define	STR(v)			#v
 #endif
 
 const char *tapasco_perfc_tostring(tapasco_dev_id_t const dev_id)
 {
-	static char _buf[1024];
+	static char _buf[4096];
+	size_t n;
 #define _PC(name) "%39s:\t%8ld\n"
-	const char *const fmt = TAPASCO_PERFC_COUNTERS "\n%c";
+	const char *const fmt = TAPASCO_PERFC_COUNTERS "%c";
 #undef _PC
 #define _PC(name) STR(name), tapasco_perfc_ ## name ## _get(dev_id),
-	snprintf(_buf, 1024, fmt, TAPASCO_PERFC_COUNTERS 0);
+	n = snprintf(_buf, sizeof(_buf), fmt, TAPASCO_PERFC_COUNTERS 0) - 1; // drop the '\0' of %c
+#undef _PC
+	// print non-empty buckets only, as <upper bound>:<count>
+#define _PH(name) \
+	if (n < sizeof(_buf)) n += snprintf(_buf + n, sizeof(_buf) - n, "%39s:\t", STR(name)); \
+	for (size_t b = 0; b < TAPASCO_PERFC_HISTOGRAM_BUCKETS && n < sizeof(_buf); ++b) { \
+		long int const c = tapasco_perfc_ ## name ## _get(dev_id, b); \
+		if (c) n += snprintf(_buf + n, sizeof(_buf) - n, " <2^%zu:%ld", b, c); \
+	} \
+	if (n < sizeof(_buf)) n += snprintf(_buf + n, sizeof(_buf) - n, "\n");
+	TAPASCO_PERFC_HISTOGRAMS
+#undef _PH
+	if (n < sizeof(_buf)) snprintf(_buf + n, sizeof(_buf) - n, "\n");
 	return _buf;
 }
 
@@ -29,45 +29,78 @@
 #include <tapasco_logging.h>
 #include <tapasco_perfc.h>
 #include <platform.h>
+#include <trace.h>
 
-tapasco_res_t tapasco_scheduler_launch(tapasco_devctx_t *devctx, tapasco_job_id_t const j_id)
+tapasco_res_t tapasco_scheduler_launch(tapasco_devctx_t *devctx, tapasco_job_id_t const j_id,
+		tapasco_device_job_launch_flag_t const flags)
 {
 	assert(devctx->jobs);
 	tapasco_kernel_id_t const k_id = tapasco_jobs_get_kernel_id(devctx->jobs, j_id);
 	tapasco_slot_id_t slot_id;
 	tapasco_res_t r;
+	unsigned long t0, t1;
 
-	DEVLOG(devctx->id, LALL_SCHEDULER, "job " PRIjob ": launching for kernel " PRIkernel ", acquiring PE ... ", j_id, k_id);
+	DEVLOG(devctx->id, LALL_SCHEDULER, "job " PRIjob ": launching for kernel " PRIkernel ", staging transfers ... ", j_id, k_id);
 
+	t0 = tapasco_perfc_now();
+	TRACE_BEGIN("stage_job", devctx->id, j_id);
+	r = tapasco_pemgmt_stage_job(devctx, j_id);
+	TRACE_END("stage_job", devctx->id, j_id);
+	if (r != TAPASCO_SUCCESS) {
+		DEVERR(devctx->id, "could not stage job #" PRIjob ": %s (" PRIres ")", j_id, tapasco_strerror(r), r);
+		return r;
+	}
+	t1 = tapasco_perfc_now();
+	tapasco_perfc_stage_ns_record(devctx->id, t1 - t0);
+
+	DEVLOG(devctx->id, LALL_SCHEDULER, "job " PRIjob ": acquiring PE ... ", j_id);
+	t0 = t1;
 	slot_id = tapasco_pemgmt_acquire_pe(devctx->pemgmt, k_id);
+	t1 = tapasco_perfc_now();
+	tapasco_perfc_acquire_wait_ns_record(devctx->id, t1 - t0);
 	if (slot_id < 0 || slot_id >= TAPASCO_NUM_SLOTS) {
 		DEVERR(devctx->id, "received illegal slot id #%u", slot_id);
+		tapasco_pemgmt_unstage_job(devctx, j_id);
 		return TAPASCO_ERR_INVALID_SLOT_ID;
 	}
 	DEVLOG(devctx->id, LALL_SCHEDULER, "job " PRIjob ": got PE " PRIslot, j_id, slot_id);
 
 #ifndef NPERFC
 	if (slot_id > tapasco_perfc_pe_high_watermark_get(devctx->id))
-		tapasco_perfc_pe_high_watermark_set(devctx->id, _slot_high_watermark);
+		tapasco_perfc_pe_high_watermark_set(devctx->id, slot_id);
 #endif
 
 	DEVLOG(devctx->id, LALL_SCHEDULER, "job " PRIjob ": preparing slot #" PRIslot " ...", j_id, slot_id);
-	if ((r = tapasco_pemgmt_prepare_pe(devctx, j_id, slot_id)) != TAPASCO_SUCCESS) {
+	TRACE_BEGIN("prepare_pe", devctx->id, j_id);
+	r = tapasco_pemgmt_prepare_pe(devctx, j_id, slot_id);
+	TRACE_END("prepare_pe", devctx->id, j_id);
+	if (r != TAPASCO_SUCCESS) {
 		DEVERR(devctx->id, "could not prepare slot #" PRIslot " for job #" PRIjob ": %s (" PRIres ")",
 				slot_id, j_id, tapasco_strerror(r), r);
-		return r;
+		goto err_pe;
 	}
 
 	DEVLOG(devctx->id, LALL_SCHEDULER, "job " PRIjob ": starting PE in slot #" PRIslot " ...", j_id, slot_id);
 	tapasco_jobs_set_slot(devctx->jobs, j_id, slot_id);
+	if (flags & TAPASCO_DEVICE_JOB_LAUNCH_POLLED)
+		platform_arm_slot(devctx->pdctx, slot_id);
 
+	TRACE_ASYNC_BEGIN("job", devctx->id, j_id);
 	if ((r = tapasco_pemgmt_start_pe(devctx, slot_id)) != TAPASCO_SUCCESS) {
 		DEVERR(devctx->id, "could not start PE in slot #" PRIslot ": %s (" PRIres ")", slot_id, tapasco_strerror(r), r);
-		return r;
+		goto err_pe;
 	}
+	t0 = tapasco_perfc_now();
+	tapasco_jobs_set_started(devctx->jobs, j_id, t0);
+	tapasco_perfc_launch_ns_record(devctx->id, t0 - t1);
 
 	tapasco_perfc_jobs_launched_inc(devctx->id);
 	return TAPASCO_SUCCESS;
+
+err_pe:
+	tapasco_pemgmt_release_pe(devctx->pemgmt, slot_id);
+	tapasco_pemgmt_unstage_job(devctx, j_id);
+	return r;
 }
 
 inline
@@ -81,15 +114,63 @@ tapasco_res_t tapasco_scheduler_finish_job(tapasco_devctx_t *devctx,
 		tapasco_job_id_t const j_id)
 {
 	platform_res_t pr;
+	tapasco_res_t r;
+	unsigned long t;
 	const tapasco_slot_id_t slot_id = tapasco_jobs_get_slot(devctx->jobs, j_id);
 	DEVLOG(devctx->id, LALL_SCHEDULER, "job " PRIjob ":  waiting for slot #" PRIslot " ...", j_id, slot_id);
 	tapasco_perfc_waiting_for_job_set(devctx->id, j_id);
+	TRACE_BEGIN("collect", devctx->id, j_id);
+	// a job launched as polled may be collected here, too
+	platform_disarm_slot(devctx->pdctx, slot_id);
 	if ((pr = platform_wait_for_slot(devctx->pdctx, slot_id)) != PLATFORM_SUCCESS) {
+		TRACE_END("collect", devctx->id, j_id);
 		DEVERR(devctx->id, "waiting for job #" PRIjob " failed: %s (" PRIres ")", j_id, platform_strerror(pr), pr);
 		return TAPASCO_ERR_PLATFORM_FAILURE;
 	}
 	tapasco_perfc_waiting_for_job_set(devctx->id, 0);
 	DEVLOG(devctx->id, LALL_SCHEDULER, "job " PRIjob ": returned successfully from waiting", j_id);
 	tapasco_perfc_jobs_completed_inc(devctx->id);
-	return tapasco_pemgmt_finish_pe(devctx, j_id);
+	TRACE_ASYNC_END("job", devctx->id, j_id);
+	t = tapasco_perfc_now();
+	tapasco_perfc_run_ns_record(devctx->id, t - tapasco_jobs_get_started(devctx->jobs, j_id));
+	r = tapasco_pemgmt_finish_pe(devctx, j_id);
+	tapasco_perfc_collect_ns_record(devctx->id, tapasco_perfc_now() - t);
+	TRACE_END("collect", devctx->id, j_id);
+	return r;
+}
+
+tapasco_res_t tapasco_device_completion_fd(tapasco_devctx_t *devctx, int *fd)
+{
+	platform_res_t pr;
+	if ((pr = platform_completion_fd(devctx->pdctx, fd)) != PLATFORM_SUCCESS) {
+		DEVERR(devctx->id, "could not get completion fd: %s (" PRIres ")", platform_strerror(pr), pr);
+		return TAPASCO_ERR_PLATFORM_FAILURE;
+	}
+	return TAPASCO_SUCCESS;
+}
+
+size_t tapasco_device_poll_completions(tapasco_devctx_t *devctx,
+		tapasco_job_id_t *out_ids, tapasco_res_t *out_res, size_t const max)
+{
+	tapasco_slot_id_t slots[TAPASCO_NUM_SLOTS];
+	size_t const n = platform_poll_slots(devctx->pdctx, slots,
+			max < TAPASCO_NUM_SLOTS ? max : TAPASCO_NUM_SLOTS);
+	tapasco_res_t r;
+	unsigned long t;
+	for (size_t i = 0; i < n; ++i) {
+		tapasco_job_id_t const j_id = tapasco_jobs_get_slot_job(devctx->jobs, slots[i]);
+		DEVLOG(devctx->id, LALL_SCHEDULER, "job " PRIjob ": polled completion of slot #" PRIslot, j_id, slots[i]);
+		tapasco_perfc_jobs_completed_inc(devctx->id);
+		TRACE_ASYNC_END("job", devctx->id, j_id);
+		TRACE_BEGIN("collect", devctx->id, j_id);
+		t = tapasco_perfc_now();
+		tapasco_perfc_run_ns_record(devctx->id, t - tapasco_jobs_get_started(devctx->jobs, j_id));
+		if ((r = tapasco_pemgmt_finish_pe(devctx, j_id)) != TAPASCO_SUCCESS)
+			DEVERR(devctx->id, "could not finish job #" PRIjob ": %s (" PRIres ")", j_id, tapasco_strerror(r), r);
+		tapasco_perfc_collect_ns_record(devctx->id, tapasco_perfc_now() - t);
+		TRACE_END("collect", devctx->id, j_id);
+		out_ids[i] = j_id;
+		if (out_res) out_res[i] = r;
+	}
+	return n;
 }
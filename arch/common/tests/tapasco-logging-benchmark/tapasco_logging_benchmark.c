@@ -22,6 +22,9 @@
  *  		Starts a number of threads to produce random log messages as
  *  		fast as possible and report the average throughput.
  *  		Random data is preallocated in memory block to avoid L2 effects.
+ *  		Runs twice: once with the log level masked out (cost of a
+ *  		disabled log call) and once with it enabled (cost of recording
+ *  		into the asynchronous log rings).
  *  @author	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
  **/
 #include <stdio.h>
@@ -95,7 +98,7 @@ static inline void log_random_message()
 	long long int lld;
 
 	get_random_data(&ll, sizeof(ll));
-	ll = 2;
+	ll = LALL_DEVICE;
 	get_random_data(&c, sizeof(c));
 	c = 65 + c % 26; // ASCII A-Z
 	get_random_data(&s, sizeof(s));
@@ -163,20 +166,48 @@ static void print_usage(void)
 }
 /* program usage @} */
 
+/* @{ measurement */
+/**
+ * Logs the given number of messages on thrdcnt threads and prints throughput.
+ * @param name name of the run
+ * @param logs total number of messages
+ * @param thrdcnt number of threads
+ **/
+static void measure(char const *name, long const logs, long const thrdcnt)
+{
+	struct timespec tv_begin, tv_end, tv_diff;
+	long long unsigned time_diff;
+	_logs = logs;
+
+	clock_gettime(CLOCK_MONOTONIC_RAW, &tv_begin);
+	run(thrdcnt);
+	clock_gettime(CLOCK_MONOTONIC_RAW, &tv_end);
+	tv_diff = diff(tv_begin, tv_end);
+	time_diff = tv_diff.tv_sec * 1000000LLU + tv_diff.tv_nsec / 1000LLU;
+
+	printf("[%s] Run took %3.4f ms for %lu log messages on %ld threads.\n",
+			name, time_diff / 1000.0, logs, thrdcnt);
+	printf("[%s] Average throughput: %10.1f logs/s\n", name,
+			logs / (time_diff / 1000000.0));
+	printf("[%s] Thread  throughput: %10.1f logs/s\n", name,
+			logs / (time_diff / 1000000.0) / (double)thrdcnt);
+	printf("[%s] Time per message:   %10.1f ns\n", name,
+			time_diff * 1000.0 * thrdcnt / (double)logs);
+}
+/* measurement @} */
+
 /* @{ main */
 int main(int argc, char *argv[])
 {
-	struct timespec tv_begin, tv_end, tv_diff;
+	struct timespec tv_res;
 	long thrdcnt = DEFAULT_THREADS;
-	long long unsigned time_diff;
-	long logs;
-	_logs = DEFAULT_LOGS;
+	long logs = DEFAULT_LOGS;
+	unsigned long mask;
 	if (argc > 1) thrdcnt = strtoul(argv[1], NULL, 0);
 	if (errno) goto err_invalid_argument;
 
-	if (argc > 2) _logs = strtoul(argv[2], NULL, 0);
+	if (argc > 2) logs = strtoul(argv[2], NULL, 0);
 	if (errno) goto err_invalid_argument;
-	logs = _logs;
 
 	printf("Starting logging benchmark with %ld threads for %ld messages.\n",
 			thrdcnt, logs);
@@ -184,22 +215,19 @@ int main(int argc, char *argv[])
 	if (! prepare_random_data((void *)&_rnd_data, RANDOM_DATA_SZ))
 		goto err_random_data;
 	printf("done!\n");
+	// enable the benchmarked level unless the user chose a mask
+	setenv(LIBTAPASCO_LOGLEVEL_ENV, "DEVICE", 0);
 	tapasco_logging_init();
 
-	clock_getres(CLOCK_MONOTONIC_RAW, &tv_begin);
-	printf("clock resolution: %ld, %ld\n", tv_begin.tv_sec, tv_begin.tv_nsec);
-
-	clock_gettime(CLOCK_MONOTONIC_RAW, &tv_begin);
-	run(thrdcnt);
-	clock_gettime(CLOCK_MONOTONIC_RAW, &tv_end);
-	tv_diff = diff(tv_begin, tv_end);
-	time_diff = tv_diff.tv_sec * 1000000LLU + tv_diff.tv_nsec / 1000LLU;
+	clock_getres(CLOCK_MONOTONIC_RAW, &tv_res);
+	printf("clock resolution: %ld, %ld\n", tv_res.tv_sec, tv_res.tv_nsec);
 
-	printf("Run took %3.4f ms for %lu log messages on %ld threads.\n",
-			time_diff / 1000.0, logs, thrdcnt);
-	printf("Average throughput: %10.1f logs/s\n", logs / (time_diff / 1000000.0));
-	printf("Thread  throughput: %10.1f logs/s\n",
-			logs / (time_diff / 1000000.0) / (double)thrdcnt);
+	mask = tapasco_logging_mask;
+	tapasco_logging_mask = mask & ~(unsigned long)LALL_DEVICE;
+	measure("masked", logs, thrdcnt);
+	tapasco_logging_mask = mask;
+	if (mask & LALL_DEVICE)
+		measure("enabled", logs, thrdcnt);
 
 	free(_rnd_data);
 	printf("Finished the test.\n");
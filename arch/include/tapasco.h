@@ -290,6 +290,82 @@ void tapasco_device_free(tapasco_devctx_t *dev_ctx,
 		tapasco_device_alloc_flag_t const flags,
 		...);
 
+/**
+ * Allocates len bytes of host memory from which transfers to the device
+ * are zero-copy: if possible, the memory is one of the driver's DMA staging
+ * buffers, so @see tapasco_device_copy_to needs no intermediate copy.
+ * Falls back to regular host memory otherwise.
+ * @param dev_ctx device context
+ * @param buf output parameter to write the pointer to
+ * @param len size in bytes
+ * @return TAPASCO_SUCCESS if successful, error code otherwise
+ **/
+tapasco_res_t tapasco_device_alloc_host(tapasco_devctx_t *dev_ctx,
+		void **buf,
+		size_t const len);
+
+/**
+ * Frees host memory allocated with @see tapasco_device_alloc_host.
+ * @param dev_ctx device context
+ * @param buf pointer returned by @see tapasco_device_alloc_host
+ **/
+void tapasco_device_free_host(tapasco_devctx_t *dev_ctx, void *buf);
+
+/**
+ * Maps device memory into the process' address space, if the device shares
+ * the host's memory (e.g., Zynq): data can be written and read in place,
+ * @see tapasco_device_copy_to and @see tapasco_device_copy_from between the
+ * mapping and the mapped device memory become no-ops.
+ * @param dev_ctx device context
+ * @param h device memory handle returned by @see tapasco_device_alloc
+ * @param len size in bytes
+ * @param ptr output parameter to write the pointer to
+ * @return TAPASCO_SUCCESS if successful, TAPASCO_ERR_NOT_IMPLEMENTED if device
+ *         memory cannot be mapped on this platform, error code otherwise
+ **/
+tapasco_res_t tapasco_device_map(tapasco_devctx_t *dev_ctx,
+		tapasco_handle_t const h,
+		size_t const len,
+		void **ptr);
+
+/**
+ * Unmaps device memory mapped with @see tapasco_device_map; must be called
+ * before freeing the memory with @see tapasco_device_free.
+ * @param dev_ctx device context
+ * @param ptr pointer returned by @see tapasco_device_map
+ **/
+void tapasco_device_unmap(tapasco_devctx_t *dev_ctx, void *ptr);
+
+/**
+ * Flushes CPU writes to a range of a buffer allocated with
+ * TAPASCO_DEVICE_ALLOC_FLAGS_CACHEABLE, so the device sees them. Must be
+ * called after writing to its mapping and before launching a job on it.
+ * @param dev_ctx device context
+ * @param h device memory handle returned by @see tapasco_device_alloc
+ * @param offset offset of the range within the buffer
+ * @param len length of the range in bytes
+ * @return TAPASCO_SUCCESS if successful, error code otherwise
+ **/
+tapasco_res_t tapasco_device_sync_for_device(tapasco_devctx_t *dev_ctx,
+		tapasco_handle_t const h,
+		size_t const offset,
+		size_t const len);
+
+/**
+ * Invalidates stale CPU cache lines of a range of a buffer allocated with
+ * TAPASCO_DEVICE_ALLOC_FLAGS_CACHEABLE. Must be called after a job wrote to
+ * the buffer and before reading its mapping.
+ * @param dev_ctx device context
+ * @param h device memory handle returned by @see tapasco_device_alloc
+ * @param offset offset of the range within the buffer
+ * @param len length of the range in bytes
+ * @return TAPASCO_SUCCESS if successful, error code otherwise
+ **/
+tapasco_res_t tapasco_device_sync_for_cpu(tapasco_devctx_t *dev_ctx,
+		tapasco_handle_t const h,
+		size_t const offset,
+		size_t const len);
+
 /**
  * Copys memory from main memory to the FPGA device.
  * @param dev_ctx device context
@@ -322,6 +398,35 @@ tapasco_res_t tapasco_device_copy_from(tapasco_devctx_t *dev_ctx,
 		tapasco_device_copy_flag_t const flags,
 		...);
 
+/**
+ * Copys several segments of main memory to FPGA device memory in one call:
+ * the driver pipelines all segments through its DMA engine, instead of
+ * draining it after each of them. PE-local memory is not supported.
+ * @param dev_ctx device context
+ * @param segs array of segments (source, destination handle, length)
+ * @param num_segs number of segments
+ * @param flags	flags for copy operation
+ * @return TAPASCO_SUCCESS if copy was successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_copy_to_v(tapasco_devctx_t *dev_ctx,
+		tapasco_copy_seg_t const *segs,
+		size_t const num_segs,
+		tapasco_device_copy_flag_t const flags);
+
+/**
+ * Copys several segments of FPGA device memory to main memory in one call,
+ * @see tapasco_device_copy_to_v.
+ * @param dev_ctx device context
+ * @param segs array of segments (destination, source handle, length)
+ * @param num_segs number of segments
+ * @param flags	flags for copy operation
+ * @return TAPASCO_SUCCESS if copy was successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_copy_from_v(tapasco_devctx_t *dev_ctx,
+		tapasco_copy_seg_t const *segs,
+		size_t const num_segs,
+		tapasco_device_copy_flag_t const flags);
+
 /** @} **/
 
 
@@ -378,6 +483,34 @@ tapasco_res_t tapasco_device_job_launch(tapasco_devctx_t *dev_ctx,
 tapasco_res_t tapasco_device_job_collect(tapasco_devctx_t *dev_ctx,
 		tapasco_job_id_t const job_id);
 
+/**
+ * Returns a file descriptor which becomes readable when a job launched with
+ * TAPASCO_DEVICE_JOB_LAUNCH_POLLED completes; suitable for poll/epoll. Read
+ * it to reset it, then drain the finished jobs with
+ * tapasco_device_poll_completions. The descriptor is owned by the device.
+ * @param dev_ctx device context
+ * @param fd output file descriptor
+ * @return TAPASCO_SUCCESS, if successful, an error code otherwise.
+ **/
+tapasco_res_t tapasco_device_completion_fd(tapasco_devctx_t *dev_ctx, int *fd);
+
+/**
+ * Collects finished jobs launched with TAPASCO_DEVICE_JOB_LAUNCH_POLLED
+ * without blocking. Returned jobs are finished as by
+ * tapasco_device_job_collect, i.e., return values and transfers are ready,
+ * unless the corresponding entry of out_res is an error code. A polled job
+ * may be collected with tapasco_device_job_collect instead, it is then no
+ * longer reported here; both must not be used for the same job concurrently.
+ * @param dev_ctx device context
+ * @param out_ids output array of finished job ids
+ * @param out_res output array of job results as returned by
+ *        tapasco_device_job_collect (may be NULL)
+ * @param max maximal number of ids to return
+ * @return number of job ids written to out_ids.
+ **/
+size_t tapasco_device_poll_completions(tapasco_devctx_t *dev_ctx,
+		tapasco_job_id_t *out_ids, tapasco_res_t *out_res, size_t const max);
+
 /**
  * Sets the arg_idx'th argument of kernel k_id to arg_value.
  * @param dev_ctx device context
@@ -43,6 +43,16 @@ extern "C" {
 #include <cstdint>
 #include <iostream>
 #include <functional>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <deque>
+#include <map>
+#include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 using namespace std;
 
@@ -134,6 +144,238 @@ WrappedPointer<T> makeWrappedPointer(T *t, size_t sz) {
   return WrappedPointer<T>(t, sz);
 }
 
+/**
+ * Device memory mapped into the address space of the process (shared-memory
+ * platforms, e.g., Zynq): PEs and host access the same buffer, no transfers
+ * are necessary. Passed to launch, the PE receives the device address;
+ * cacheable buffers are flushed before launch and invalidated on collect.
+ * Copies share the buffer, it is unmapped and freed with the last copy.
+ **/
+template<typename T>
+class MappedBuffer final {
+public:
+  MappedBuffer() = default;
+  T* data() const noexcept { return ptr.get(); }
+  size_t size() const noexcept { return count; }
+  tapasco_handle_t handle() const noexcept { return h; }
+  bool cacheable() const noexcept { return cached; }
+  T& operator[](size_t const i) const noexcept { return ptr.get()[i]; }
+  T* begin() const noexcept { return ptr.get(); }
+  T* end() const noexcept { return ptr.get() + count; }
+  explicit operator bool() const noexcept { return static_cast<bool>(ptr); }
+
+private:
+  friend struct Tapasco;
+  MappedBuffer(tapasco_devctx_t *devctx, tapasco_handle_t const h, T *p, size_t const count, bool const cached)
+    : ptr(p, [devctx, h](T *p) {
+        tapasco_device_unmap(devctx, p);
+        tapasco_device_free(devctx, h, TAPASCO_DEVICE_ALLOC_FLAGS_NONE);
+      }), h(h), count(count), cached(cached) {
+    static_assert(is_trivially_copyable<T>::value, "Types must be trivially copyable!");
+  }
+  shared_ptr<T> ptr;
+  tapasco_handle_t h { 0 };
+  size_t count { 0 };
+  bool cached { false };
+};
+
+/**
+ * Device memory with a host copy and validity tracking: the buffer owns a
+ * device allocation for its lifetime, host writes mark a range dirty and
+ * device writes mark the whole buffer as modified. Passed to launch, the PE
+ * receives the device address; only the dirty range is copied to the
+ * device before, and the data is read back lazily on the next host access
+ * after a job that may have written it.
+ * The direction passed to alloc_buffer states what the PEs do with the data:
+ * TAPASCO_COPY_DIRECTION_TO for read-only data (e.g., lookup tables), which
+ * is never read back, TAPASCO_COPY_DIRECTION_FROM for output only, which is
+ * never uploaded.
+ * Dirty ranges are merged into a single range [first, last).
+ * Copies share the buffer, it is freed with the last copy.
+ **/
+template<typename T>
+class DeviceBuffer {
+public:
+  DeviceBuffer() = default;
+  size_t size() const noexcept { return s ? s->host.size() : 0; }
+  tapasco_handle_t handle() const noexcept { return s ? s->h : 0; }
+  tapasco_copy_direction_flag_t direction() const noexcept { return s ? s->dir : TAPASCO_COPY_DIRECTION_BOTH; }
+  /** Returns true, if the device copy is newer than the host copy. **/
+  bool device_modified() const noexcept { return s && s->device_dirty; }
+  /** Returns true, if the host copy has changes not yet on the device. **/
+  bool host_modified() const noexcept { return s && s->first < s->last; }
+  /** Returns an id of the buffer, shared by all copies. **/
+  void const *id() const noexcept { return s.get(); }
+  explicit operator bool() const noexcept { return static_cast<bool>(s); }
+
+  /** @{ Read access; fetches device modifications first (may throw). **/
+  T const* data() const { fetch(); return s->host.data(); }
+  T const& operator[](size_t const i) const { fetch(); return s->host[i]; }
+  T const* begin() const { return data(); }
+  T const* end() const { return data() + size(); }
+  /** Read access @} **/
+
+  /**
+   * Write access: marks elements [first, first + n) as dirty (may throw).
+   * @return pointer to host copy of element first
+   **/
+  T* modify(size_t const first = 0, size_t const n = numeric_limits<size_t>::max()) {
+    fetch();
+    mark(first, n);
+    return s->host.data() + first;
+  }
+
+  /** Copies n elements from src to [first, first + n) (may throw). **/
+  void write(size_t const first, T const *src, size_t const n) {
+    copy(src, src + n, modify(first, n));
+  }
+
+  /** Copies the dirty range to the device, if the PEs read the data. **/
+  tapasco_res_t sync_for_device() const noexcept {
+    tapasco_res_t r;
+    if ((r = reserve()) != TAPASCO_SUCCESS || ! host_modified()) return r;
+    if (s->dir & TAPASCO_COPY_DIRECTION_TO)
+      r = tapasco_device_copy_to(s->devctx, s->host.data() + s->first,
+          s->h + s->first * sizeof(T), (s->last - s->first) * sizeof(T),
+          TAPASCO_DEVICE_COPY_FLAGS_NONE);
+    if (r == TAPASCO_SUCCESS) s->first = s->last = 0;
+    return r;
+  }
+
+  /** Copies the buffer from the device, if a job may have modified it. **/
+  tapasco_res_t sync_for_cpu() const noexcept {
+    tapasco_res_t r { TAPASCO_SUCCESS };
+    if (! device_modified()) return r;
+    if ((r = tapasco_device_copy_from(s->devctx, s->h, s->host.data(), size() * sizeof(T),
+        TAPASCO_DEVICE_COPY_FLAGS_NONE)) == TAPASCO_SUCCESS)
+      s->device_dirty = false;
+    return r;
+  }
+
+protected:
+  friend struct Tapasco;
+  struct State {
+    State(tapasco_devctx_t *devctx, size_t const count, tapasco_copy_direction_flag_t const dir,
+        tapasco_device_alloc_flag_t const flags)
+      : devctx(devctx), host(count), dir(dir), flags(flags) {}
+    ~State() { if (h) tapasco_device_free(devctx, h, flags); }
+    tapasco_devctx_t *devctx;
+    tapasco_handle_t h { 0 };
+    vector<T> host;
+    size_t capacity { 0 };                      // elements allocated on device
+    size_t first { 0 }, last { 0 };             // dirty host range
+    bool device_dirty { false };
+    tapasco_copy_direction_flag_t dir;
+    tapasco_device_alloc_flag_t flags;
+  };
+
+  DeviceBuffer(shared_ptr<State> s) : s(s) {
+    static_assert(is_trivially_copyable<T>::value, "Types must be trivially copyable!");
+  }
+
+  /** Allocates device memory for the host copy, if necessary. **/
+  tapasco_res_t reserve() const noexcept {
+    tapasco_handle_t h { 0 };
+    tapasco_res_t r;
+    size_t const capacity { max(max(size(), 2 * s->capacity), size_t(1)) };
+    if (s->capacity >= size() && s->h) return TAPASCO_SUCCESS;
+    if ((r = tapasco_device_alloc(s->devctx, &h, capacity * sizeof(T), s->flags)) != TAPASCO_SUCCESS)
+      return r;
+    if (s->h) tapasco_device_free(s->devctx, s->h, s->flags);
+    s->h = h;
+    s->capacity = capacity;
+    s->first = 0;
+    s->last = size();
+    return TAPASCO_SUCCESS;
+  }
+
+  void mark(size_t const first, size_t const n) const noexcept {
+    size_t const last { n > size() - min(first, size()) ? size() : first + n };
+    if (first >= last) return;
+    if (host_modified()) {
+      s->first = min(s->first, first);
+      s->last = max(s->last, last);
+    } else {
+      s->first = first;
+      s->last = last;
+    }
+  }
+
+  void fetch() const {
+    tapasco_res_t const r { sync_for_cpu() };
+    if (r != TAPASCO_SUCCESS) throw runtime_error(tapasco_strerror(r));
+  }
+
+  shared_ptr<State> s;
+};
+
+/**
+ * DeviceBuffer with a resizable host copy; the device memory is reallocated
+ * (and the buffer uploaded as a whole) on the next launch after it grew.
+ **/
+template<typename T>
+class DeviceVector final : public DeviceBuffer<T> {
+public:
+  DeviceVector() = default;
+  using DeviceBuffer<T>::size;
+
+  void resize(size_t const count, T const& v = T()) {
+    size_t const old { size() };
+    auto& s = this->s;
+    this->fetch();
+    s->host.resize(count, v);
+    s->last = min(s->last, count);
+    if (s->first >= s->last) s->first = s->last = 0;
+    this->mark(old, count > old ? count - old : 0);
+  }
+
+  void push_back(T const& v) {
+    this->fetch();
+    this->s->host.push_back(v);
+    this->mark(size() - 1, 1);
+  }
+
+  void assign(T const *first, T const *last) {
+    this->fetch();
+    this->s->host.assign(first, last);
+    this->mark(0, size());
+  }
+
+private:
+  friend struct Tapasco;
+  DeviceVector(shared_ptr<typename DeviceBuffer<T>::State> s) : DeviceBuffer<T>(s) {}
+};
+
+/**
+ * Access annotations for device buffer arguments: the job only reads
+ * (InOnly) or only writes (OutOnly) the buffer, whatever direction it was
+ * allocated with. Read-only arguments are never marked as modified by the
+ * device; write-only arguments are not uploaded before the job and host
+ * changes not yet on the device are discarded after it. The buffer is
+ * held by value, i.e., the annotation shares it.
+ **/
+template<typename T>
+struct InOnly<DeviceBuffer<T> > final {
+  InOnly(DeviceBuffer<T> const& value) : value(value) {}
+  DeviceBuffer<T> value;
+};
+
+template<typename T>
+struct OutOnly<DeviceBuffer<T> > final {
+  OutOnly(DeviceBuffer<T> const& value) : value(value) {}
+  DeviceBuffer<T> value;
+};
+
+template<typename T>
+InOnly<DeviceBuffer<T> > makeInOnly(DeviceVector<T> &t) {
+  return InOnly<DeviceBuffer<T> >(t);
+}
+
+template<typename T>
+OutOnly<DeviceBuffer<T> > makeOutOnly(DeviceVector<T> &t) {
+  return OutOnly<DeviceBuffer<T> >(t);
+}
+
 /**
  * C++ Wrapper class for TaPaSCo API. Currently wraps a single device.
  **/
@@ -226,7 +468,7 @@ struct Tapasco {
     if ((res = tapasco_device_acquire_job_id(devctx, &j_id, k_id, TAPASCO_DEVICE_ACQUIRE_JOB_ID_BLOCKING)) != TAPASCO_SUCCESS) return mkerr(res);
     if ((res = set_args(j_id, 0, args...)) != TAPASCO_SUCCESS) return mkerr(res);
     if ((res = tapasco_device_job_launch(devctx, j_id, TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING)) != TAPASCO_SUCCESS) return mkerr(res);
-    return [this, j_id, &ret, &args...]() { return collect<R, Targs...>(j_id, ret, args...); };
+    return [this, j_id, &ret, args...]() { return collect<R, Targs...>(j_id, ret, args...); };
   }
 
   template<typename... Targs>
@@ -238,7 +480,7 @@ struct Tapasco {
     if ((res = tapasco_device_acquire_job_id(devctx, &j_id, k_id, TAPASCO_DEVICE_ACQUIRE_JOB_ID_BLOCKING)) != TAPASCO_SUCCESS) return mkerr(res);
     if ((res = set_args(j_id, 0, args...)) != TAPASCO_SUCCESS) return mkerr(res);
     if ((res = tapasco_device_job_launch(devctx, j_id, TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING)) != TAPASCO_SUCCESS) return mkerr(res);
-    return [this, j_id, &args...]() { return collect<Targs...>(j_id, args...); };
+    return [this, j_id, args...]() { return collect<Targs...>(j_id, args...); };
   }
 
   /**
@@ -262,6 +504,131 @@ struct Tapasco {
     tapasco_device_free(devctx, handle, flags);
   }
 
+  /**
+   * Allocates len bytes of host memory for zero-copy transfers to the device.
+   * @param buf output parameter for pointer
+   * @param len size in bytes
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+   **/
+  tapasco_res_t alloc_host(void *&buf, size_t const len) const noexcept
+  {
+    return tapasco_device_alloc_host(devctx, &buf, len);
+  }
+
+  /**
+   * Frees host memory allocated with @see alloc_host.
+   * @param buf pointer returned by @see alloc_host
+   **/
+  void free_host(void *buf) const noexcept
+  {
+    tapasco_device_free_host(devctx, buf);
+  }
+
+  /**
+   * Allocates device memory for count elements and maps it into the address
+   * space of the process.
+   * @param buf output parameter for buffer
+   * @param count number of elements
+   * @param flags TAPASCO_DEVICE_ALLOC_FLAGS_CACHEABLE for a cached mapping
+   * @return TAPASCO_SUCCESS if successful, TAPASCO_ERR_NOT_IMPLEMENTED if
+   *         device memory cannot be mapped on this platform.
+   **/
+  template<typename T>
+  tapasco_res_t alloc_mapped(MappedBuffer<T> &buf, size_t const count,
+      tapasco_device_alloc_flag_t const flags = TAPASCO_DEVICE_ALLOC_FLAGS_NONE) const noexcept
+  {
+    tapasco_handle_t h { 0 };
+    void *p { nullptr };
+    size_t const len { count * sizeof(T) };
+    bool const cached { (flags & TAPASCO_DEVICE_ALLOC_FLAGS_CACHEABLE) != 0 };
+    tapasco_res_t r { tapasco_device_alloc(devctx, &h, len, flags) };
+    if (r != TAPASCO_SUCCESS) return r;
+    if ((r = tapasco_device_map(devctx, h, len, &p)) != TAPASCO_SUCCESS) {
+      tapasco_device_free(devctx, h, TAPASCO_DEVICE_ALLOC_FLAGS_NONE);
+      return r;
+    }
+    try {
+      buf = MappedBuffer<T>(devctx, h, static_cast<T *>(p), count, cached);
+    } catch (bad_alloc &e) {
+      tapasco_device_unmap(devctx, p);
+      tapasco_device_free(devctx, h, TAPASCO_DEVICE_ALLOC_FLAGS_NONE);
+      return TAPASCO_ERR_OUT_OF_MEMORY;
+    }
+    return TAPASCO_SUCCESS;
+  }
+
+  /**
+   * Makes CPU writes to a cacheable mapped buffer visible to the device.
+   * @param buf mapped buffer
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+   **/
+  template<typename T>
+  tapasco_res_t sync_for_device(MappedBuffer<T> const &buf) const noexcept
+  {
+    if (! buf.cacheable()) return TAPASCO_SUCCESS;
+    return tapasco_device_sync_for_device(devctx, buf.handle(), 0, buf.size() * sizeof(T));
+  }
+
+  /**
+   * Makes device writes to a cacheable mapped buffer visible to the CPU.
+   * @param buf mapped buffer
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+   **/
+  template<typename T>
+  tapasco_res_t sync_for_cpu(MappedBuffer<T> const &buf) const noexcept
+  {
+    if (! buf.cacheable()) return TAPASCO_SUCCESS;
+    return tapasco_device_sync_for_cpu(devctx, buf.handle(), 0, buf.size() * sizeof(T));
+  }
+
+  /**
+   * Allocates a device buffer for count elements; the host copy is value
+   * initialized and, unless the PEs only write it, uploaded on first use.
+   * @param buf output parameter for buffer (DeviceBuffer or DeviceVector)
+   * @param count number of elements
+   * @param dir what the PEs do with the data, e.g., TAPASCO_COPY_DIRECTION_TO
+   *        for read-only data
+   * @param flags device memory allocation flags
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+   **/
+  template<template<typename> class B, typename T>
+  tapasco_res_t alloc_buffer(B<T> &buf, size_t const count,
+      tapasco_copy_direction_flag_t const dir = TAPASCO_COPY_DIRECTION_BOTH,
+      tapasco_device_alloc_flag_t const flags = TAPASCO_DEVICE_ALLOC_FLAGS_NONE) const noexcept
+  {
+    static_assert(is_base_of<DeviceBuffer<T>, B<T> >::value, "Buffer must be a DeviceBuffer!");
+    tapasco_res_t r;
+    try {
+      buf = B<T>(make_shared<typename DeviceBuffer<T>::State>(devctx, count, dir, flags));
+    } catch (bad_alloc &e) {
+      return TAPASCO_ERR_OUT_OF_MEMORY;
+    }
+    if ((r = buf.reserve()) != TAPASCO_SUCCESS) buf = B<T>();
+    return r;
+  }
+
+  /**
+   * Copies the dirty range of a device buffer to the device.
+   * @param buf device buffer
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+   **/
+  template<typename T>
+  tapasco_res_t sync_for_device(DeviceBuffer<T> const &buf) const noexcept
+  {
+    return buf.sync_for_device();
+  }
+
+  /**
+   * Copies a device buffer from the device, if a job may have modified it.
+   * @param buf device buffer
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+   **/
+  template<typename T>
+  tapasco_res_t sync_for_cpu(DeviceBuffer<T> const &buf) const noexcept
+  {
+    return buf.sync_for_cpu();
+  }
+
   /**
    * Copys memory from main memory to the FPGA device.
    * @param src source address
@@ -288,6 +655,28 @@ struct Tapasco {
     return tapasco_device_copy_from(devctx, src, dst, len, flags);
   }
 
+  /**
+   * Copys several segments from main memory to the FPGA device in one call.
+   * @param segs segments (source address, destination handle, length)
+   * @param flags flags for copy operation
+   * @return TAPASCO_SUCCESS if copy was successful, an error code otherwise
+   **/
+  tapasco_res_t copy_to_v(std::vector<tapasco_copy_seg_t> const& segs, tapasco_device_copy_flag_t const flags = TAPASCO_DEVICE_COPY_BLOCKING) const noexcept
+  {
+    return tapasco_device_copy_to_v(devctx, segs.data(), segs.size(), flags);
+  }
+
+  /**
+   * Copys several segments from FPGA device memory to main memory in one call.
+   * @param segs segments (destination address, source handle, length)
+   * @param flags flags for copy operation
+   * @return TAPASCO_SUCCESS if copy was successful, an error code otherwise
+   **/
+  tapasco_res_t copy_from_v(std::vector<tapasco_copy_seg_t> const& segs, tapasco_device_copy_flag_t const flags = TAPASCO_DEVICE_COPY_BLOCKING) const noexcept
+  {
+    return tapasco_device_copy_from_v(devctx, segs.data(), segs.size(), flags);
+  }
+
   /**
    * Returns the number of PEs of kernel k_id in the currently loaded bitstream.
    * @param k_id kernel id
@@ -415,6 +804,49 @@ private:
     return tapasco_device_job_set_arg_transfer(devctx, j_id, arg_idx, t.sz, t.value, flags, copy_flags);
   }
 
+  /** Sets a mapped buffer argument (device address only, no transfer). **/
+  template<typename T>
+  tapasco_res_t set_arg(tapasco_job_id_t const j_id, size_t const arg_idx, MappedBuffer<T> t) noexcept
+  {
+    tapasco_handle_t const h { t.handle() };
+    tapasco_res_t r;
+    if ((r = sync_for_device(t)) != TAPASCO_SUCCESS) return r;
+    return tapasco_device_job_set_arg(devctx, j_id, arg_idx, sizeof(h), &h);
+  }
+
+  /** Sets a device buffer argument (device address, transfers dirty range only). **/
+  template<typename T>
+  tapasco_res_t set_arg(tapasco_job_id_t const j_id, size_t const arg_idx, DeviceBuffer<T> t) noexcept
+  {
+    tapasco_res_t r;
+    if ((r = sync_for_device(t)) != TAPASCO_SUCCESS) return r;
+    tapasco_handle_t const h { t.handle() };
+    return tapasco_device_job_set_arg(devctx, j_id, arg_idx, sizeof(h), &h);
+  }
+
+  template<typename T>
+  tapasco_res_t set_arg(tapasco_job_id_t const j_id, size_t const arg_idx, DeviceVector<T> t) noexcept
+  {
+    return set_arg(j_id, arg_idx, static_cast<DeviceBuffer<T>&>(t));
+  }
+
+  /** Sets a read-only device buffer argument (transfers dirty range only). **/
+  template<typename T>
+  tapasco_res_t set_arg(tapasco_job_id_t const j_id, size_t const arg_idx, InOnly<DeviceBuffer<T> > t) noexcept
+  {
+    return set_arg(j_id, arg_idx, t.value);
+  }
+
+  /** Sets a write-only device buffer argument (device address only, no transfer). **/
+  template<typename T>
+  tapasco_res_t set_arg(tapasco_job_id_t const j_id, size_t const arg_idx, OutOnly<DeviceBuffer<T> > t) noexcept
+  {
+    tapasco_res_t r;
+    if ((r = t.value.reserve()) != TAPASCO_SUCCESS) return r;
+    tapasco_handle_t const h { t.value.handle() };
+    return tapasco_device_job_set_arg(devctx, j_id, arg_idx, sizeof(h), &h);
+  }
+
   template<typename T>
   tapasco_res_t set_args(tapasco_job_id_t const j_id, size_t arg_idx, T &t) noexcept
   {
@@ -448,6 +880,37 @@ private:
     return TAPASCO_SUCCESS;
   }
 
+  /** Makes device writes to a mapped buffer visible. **/
+  template<typename T>
+  tapasco_res_t get_arg(tapasco_job_id_t const j_id, size_t const arg_idx, MappedBuffer<T> &t) noexcept
+  {
+    return sync_for_cpu(t);
+  }
+
+  /** Marks a device buffer as modified, unless the PEs only read it. **/
+  template<typename T>
+  tapasco_res_t get_arg(tapasco_job_id_t const j_id, size_t const arg_idx, DeviceBuffer<T> &t) noexcept
+  {
+    if (t && (t.direction() & TAPASCO_COPY_DIRECTION_FROM)) t.s->device_dirty = true;
+    return TAPASCO_SUCCESS;
+  }
+
+  template<typename T>
+  tapasco_res_t get_arg(tapasco_job_id_t const j_id, size_t const arg_idx, DeviceVector<T> &t) noexcept
+  {
+    return get_arg(j_id, arg_idx, static_cast<DeviceBuffer<T>&>(t));
+  }
+
+  /** Marks a write-only device buffer as modified, drops pending host changes. **/
+  template<typename T>
+  tapasco_res_t get_arg(tapasco_job_id_t const j_id, size_t const arg_idx, OutOnly<DeviceBuffer<T> > &t) noexcept
+  {
+    if (! t.value) return TAPASCO_SUCCESS;
+    t.value.s->first = t.value.s->last = 0;
+    t.value.s->device_dirty = true;
+    return TAPASCO_SUCCESS;
+  }
+
   template<typename T>
   tapasco_res_t get_args(tapasco_job_id_t const j_id, size_t const arg_idx, T &t) noexcept
   {
@@ -469,6 +932,229 @@ private:
   tapasco_devctx_t* devctx { nullptr };
 };
 
+/**
+ * Job dependency graph: jobs are declared once with their arguments and run
+ * as a whole, as often as needed. Each run launches a job as soon as all
+ * jobs it depends on have finished; independent jobs run concurrently on
+ * different PEs.
+ * Dependencies are derived from DeviceBuffer/DeviceVector arguments in the
+ * order of declaration (a job reading a buffer depends on its last writer,
+ * a job writing it also on all readers since), further ones can be added via
+ * depends. The access of a job is given per argument by makeInOnly (reads)
+ * and makeOutOnly (writes); a plain buffer argument is read unless it was
+ * allocated with TAPASCO_COPY_DIRECTION_FROM and written unless it was
+ * allocated with TAPASCO_COPY_DIRECTION_TO. E.g., jobs that all take a
+ * buffer via makeInOnly run concurrently after its writer, and a job taking
+ * a TAPASCO_COPY_DIRECTION_TO buffer via makeOutOnly orders the jobs
+ * reading it after itself. Buffers passed between jobs stay on the device:
+ * host-modified ranges are uploaded once at the start of a run, data is only
+ * read back when the host accesses it.
+ * Jobs must not be added while the graph is running.
+ **/
+class JobGraph final {
+public:
+  using node_t = size_t;
+
+  /**
+   * Constructor.
+   * @param tapasco device to run the jobs on
+   * @param max_jobs maximal number of concurrent jobs (default: number of
+   *        PEs of all kernels in the graph)
+   **/
+  explicit JobGraph(Tapasco& tapasco, size_t const max_jobs = 0) : tapasco(tapasco), max_jobs(max_jobs) {}
+  JobGraph(JobGraph const&) = delete;
+  JobGraph& operator=(JobGraph const&) = delete;
+
+  ~JobGraph() {
+    {
+      lock_guard<mutex> l(mtx);
+      stop = true;
+    }
+    cv_work.notify_all();
+    for (auto& w : workers) w.join();
+  }
+
+  /**
+   * Adds a job; arguments are the same as for Tapasco::launch and are kept
+   * (by value) for all runs.
+   * @param k_id kernel id
+   * @return node id of the job
+   **/
+  template<typename... Targs>
+  node_t add(tapasco_kernel_id_t const k_id, Targs... args)
+  {
+    node_t const n { nodes.size() };
+    Tapasco& t = tapasco;
+    uses_t uses;
+    nodes.emplace_back();
+    nodes[n].k_id = k_id;
+    nodes[n].launch = [&t, k_id, args...]() mutable { return t.launch(k_id, args...); };
+    buffers(uses, args...);
+    for (auto const& u : uses) {
+      Access& a = access[u.first];
+      if (a.writer < n) depends(n, a.writer);
+      if (u.second & TAPASCO_COPY_DIRECTION_FROM) {
+        for (auto r : a.readers) depends(n, r);
+        a.readers.clear();
+        a.writer = n;
+      } else {
+        a.readers.push_back(n);
+      }
+    }
+    return n;
+  }
+
+  /**
+   * Adds a dependency: job n runs after job on has finished.
+   * @param n node id
+   * @param on node id, must have been added before n
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+   **/
+  tapasco_res_t depends(node_t const n, node_t const on) noexcept
+  {
+    if (n >= nodes.size() || on >= n) return TAPASCO_ERR_JOB_ID_NOT_FOUND;
+    if (nodes[n].preds.insert(on).second) nodes[on].succs.push_back(n);
+    return TAPASCO_SUCCESS;
+  }
+
+  /** Returns the number of jobs in the graph. **/
+  size_t size() const noexcept { return nodes.size(); }
+
+  /** Returns the jobs job n depends on (may throw). **/
+  set<node_t> const& dependencies(node_t const n) const { return nodes.at(n).preds; }
+
+  /**
+   * Runs all jobs once and waits for them; after an error, jobs which were
+   * not launched yet are skipped.
+   * @return TAPASCO_SUCCESS if all jobs were successful, the first error otherwise.
+   **/
+  tapasco_res_t run()
+  {
+    tapasco_res_t r;
+    if (nodes.empty()) return TAPASCO_SUCCESS;
+    for (auto const& u : uploads)
+      if ((r = u.second()) != TAPASCO_SUCCESS) return r;
+    spawn_workers();
+    unique_lock<mutex> l(mtx);
+    result = TAPASCO_SUCCESS;
+    remaining = nodes.size();
+    for (node_t n = 0; n < nodes.size(); ++n)
+      if (! (nodes[n].pending = nodes[n].preds.size())) ready.push_back(n);
+    cv_work.notify_all();
+    cv_done.wait(l, [this]() { return remaining == 0; });
+    return result;
+  }
+
+private:
+  struct Node {
+    tapasco_kernel_id_t k_id { 0 };
+    function<job_future (void)> launch;
+    set<node_t> preds;
+    vector<node_t> succs;
+    size_t pending { 0 };
+  };
+  struct Access {
+    node_t writer { numeric_limits<node_t>::max() };
+    vector<node_t> readers;
+  };
+
+  /* @{ Collects the buffer arguments of a job and how the job accesses them. */
+  using uses_t = vector<pair<void const *, tapasco_copy_direction_flag_t> >;
+
+  template<typename T>
+  void use(uses_t& uses, DeviceBuffer<T> const& b, tapasco_copy_direction_flag_t const dir)
+  {
+    if (! b) return;
+    uses.emplace_back(b.id(), dir);
+    if (dir & TAPASCO_COPY_DIRECTION_TO) uploads[b.id()] = [b]() { return b.sync_for_device(); };
+  }
+
+  void buffers(uses_t& uses) {}
+
+  template<typename T, typename... Targs>
+  void buffers(uses_t& uses, T const& t, Targs const&... args)
+  {
+    buffers(uses, args...);
+  }
+
+  template<typename T, typename... Targs>
+  void buffers(uses_t& uses, DeviceBuffer<T> const& b, Targs const&... args)
+  {
+    use(uses, b, b.direction());
+    buffers(uses, args...);
+  }
+
+  template<typename T, typename... Targs>
+  void buffers(uses_t& uses, DeviceVector<T> const& b, Targs const&... args)
+  {
+    buffers(uses, static_cast<DeviceBuffer<T> const&>(b), args...);
+  }
+
+  template<typename T, typename... Targs>
+  void buffers(uses_t& uses, InOnly<DeviceBuffer<T> > const& b, Targs const&... args)
+  {
+    use(uses, b.value, TAPASCO_COPY_DIRECTION_TO);
+    buffers(uses, args...);
+  }
+
+  template<typename T, typename... Targs>
+  void buffers(uses_t& uses, OutOnly<DeviceBuffer<T> > const& b, Targs const&... args)
+  {
+    use(uses, b.value, TAPASCO_COPY_DIRECTION_FROM);
+    buffers(uses, args...);
+  }
+  /* Collects the buffer arguments of a job and how the job accesses them. @} */
+
+  /** Starts workers up to the maximal number of concurrent jobs. **/
+  void spawn_workers()
+  {
+    size_t n { max_jobs };
+    if (! n) {
+      set<tapasco_kernel_id_t> kernels;
+      for (auto const& nd : nodes)
+        if (kernels.insert(nd.k_id).second) n += tapasco.kernel_pe_count(nd.k_id);
+    }
+    n = max(min(n, nodes.size()), size_t(1));
+    while (workers.size() < n) workers.emplace_back([this]() { work(); });
+  }
+
+  /** Worker: launches ready jobs and waits for them, one at a time. **/
+  void work()
+  {
+    unique_lock<mutex> l(mtx);
+    while (true) {
+      cv_work.wait(l, [this]() { return stop || ! ready.empty(); });
+      if (stop) return;
+      node_t const n { ready.front() };
+      bool const skip { result != TAPASCO_SUCCESS };
+      tapasco_res_t r { TAPASCO_SUCCESS };
+      ready.pop_front();
+      l.unlock();
+      if (! skip) r = nodes[n].launch()();
+      l.lock();
+      if (r != TAPASCO_SUCCESS && result == TAPASCO_SUCCESS) result = r;
+      for (auto s : nodes[n].succs)
+        if (! --nodes[s].pending) ready.push_back(s);
+      if (! ready.empty()) cv_work.notify_all();
+      if (! --remaining) cv_done.notify_all();
+    }
+  }
+
+  Tapasco& tapasco;
+  size_t const max_jobs;
+  vector<Node> nodes;
+  map<void const *, Access> access;
+  map<void const *, function<tapasco_res_t (void)> > uploads;
+  vector<thread> workers;
+  mutex mtx;
+  condition_variable cv_work;
+  condition_variable cv_done;
+  deque<node_t> ready;
+  size_t remaining { 0 };
+  tapasco_res_t result { TAPASCO_SUCCESS };
+  bool stop { false };
+};
+
 } /* namespace tapasco */
 
 #endif /* TAPASCO_HPP__ */
@@ -65,6 +65,16 @@ typedef ul tapasco_job_id_t;
 typedef ul tapasco_handle_t;
 #define PRIhandle					"%#08lx"
 
+/** Segment of a vectored copy, @see tapasco_device_copy_to_v. **/
+typedef struct tapasco_copy_seg {
+	/** host memory **/
+	void *data;
+	/** device memory handle (prev. alloc'ed with tapasco_alloc) **/
+	tapasco_handle_t handle;
+	/** length in bytes **/
+	size_t len;
+} tapasco_copy_seg_t;
+
 /** default value for no flags **/
 #define NONE						0
 
@@ -82,6 +92,8 @@ typedef enum {
 	TAPASCO_DEVICE_ALLOC_FLAGS_NONE 		= NONE,
 	/** PE-local, i.e., only accessible from scheduled PE **/
 	TAPASCO_DEVICE_ALLOC_FLAGS_PE_LOCAL             = PE_LOCAL_FLAG,
+	/** cacheable when mapped, see @tapasco_device_sync_for_device **/
+	TAPASCO_DEVICE_ALLOC_FLAGS_CACHEABLE		= 4,
 } tapasco_device_alloc_flag_t;
 
 /** Flags for bitstream loading (implementation defined). **/
@@ -120,6 +132,8 @@ typedef enum {
 	TAPASCO_DEVICE_JOB_LAUNCH_BLOCKING		= NONE,
 	/** return immediately after job is scheduled **/
 	TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING		= 1,
+	/** return immediately, completion is reported by tapasco_device_poll_completions **/
+	TAPASCO_DEVICE_JOB_LAUNCH_POLLED		= 2,
 } tapasco_device_job_launch_flag_t;
 
 /** Flags for memory transfer directions. **/
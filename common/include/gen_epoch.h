@@ -0,0 +1,82 @@
+//
+// Copyright (C) 2018 Jens Korinth, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	gen_epoch.h
+//! @brief	Epoch-based memory reclamation and node recycling for the
+//!		lock-free structures (gen_stack, gen_queue).
+//!		Threads access shared nodes only between ge_enter and
+//!		ge_exit. A node that was unlinked is retired, not freed:
+//!		it is kept in a limbo list of the retiring thread until
+//!		the global epoch has advanced twice, i.e., until every
+//!		thread that could still hold a reference has left its
+//!		critical section. Then the node is moved to a per-thread
+//!		freelist and handed out again by ge_node_alloc, so that
+//!		under load no memory is returned to or taken from malloc.
+//!		Per-thread state is adopted by the next new thread when
+//!		its owner exits.
+//!
+#ifndef GEN_EPOCH_H__
+#define GEN_EPOCH_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** Node sizes are rounded up to multiples of GE_CLASS_SZ. **/
+#define GE_CLASS_SZ					16
+/** Number of size classes that are recycled; larger nodes are freed. **/
+#define GE_CLASSES					8
+/** Maximal number of nodes per freelist and thread, surplus is freed. **/
+#define GE_FREELIST_MAX					4096
+/** Number of retired nodes after which a thread tries to advance the epoch. **/
+#define GE_RETIRE_THRESHOLD				64
+
+/** Enters a critical section; may be nested. **/
+void ge_enter(void);
+
+/** Leaves a critical section. **/
+void ge_exit(void);
+
+/**
+ * Allocates a node, preferably from the freelist of the calling thread.
+ * @param sz size of node in bytes
+ * @return pointer to node, or NULL on error
+ **/
+void *ge_node_alloc(size_t const sz);
+
+/**
+ * Retires a node which was unlinked from its structure; it is recycled as
+ * soon as no critical section can reference it anymore.
+ * @param p pointer to node allocated via ge_node_alloc
+ **/
+void ge_node_retire(void *p);
+
+/**
+ * Frees a node immediately; caller must guarantee that no other thread can
+ * reference it (e.g., during destruction).
+ * @param p pointer to node allocated via ge_node_alloc
+ **/
+void ge_node_free(void *p);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* GEN_EPOCH_H__ */
@@ -22,11 +22,15 @@
  *  		"Nonblocking algorithms and preemption-safe locking on
  *  		multiprogrammed shared-memory multiprocessors." by M. Michael
  *  		and M. Scott (1998).
+ *  		Also provides a bounded variant (gq_ring_t) with the same
+ *  		operations: a ring of sequence-numbered cells (after D. Vyukov),
+ *  		which needs no allocation per element and only word-sized CAS.
  *  @author	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
  **/
 #ifndef __GEN_QUEUE_H__
 #define __GEN_QUEUE_H__
 
+#include <stddef.h>
 #ifdef __cplusplus
 #include <atomic>
 extern "C" {
@@ -45,6 +49,9 @@ struct gq_e_t;
 /** Queue type. **/
 struct gq_t;
 
+/** Bounded queue type. **/
+struct gq_ring_t;
+
 /** @} **/
 
 
@@ -88,6 +95,58 @@ void gq_destroy(struct gq_t *q);
 
 /** @} **/
 
+
+/** @defgroup ring Bounded FIFO operations
+ *  Values must not be NULL, NULL indicates an empty queue.
+ *  @{
+ **/
+
+/**
+ * Initializes a bounded queue.
+ * @param capacity maximal number of elements, rounded up to a power of two
+ * @return pointer to queue struct or NULL on error
+ **/
+struct gq_ring_t *gq_ring_init(size_t const capacity);
+
+/**
+ * Destroys a bounded queue.
+ * @param q pointer to queue struct
+ **/
+void gq_ring_destroy(struct gq_ring_t *q);
+
+/**
+ * Enqueue operation, pushes element to queue if there is space.
+ * @param q pointer to queue struct
+ * @param v value to push
+ * @return 1 if successful, 0 if the queue is full
+ **/
+int gq_ring_try_enqueue(struct gq_ring_t *q, void *v);
+
+/**
+ * Enqueue operation, pushes element to queue; waits while the queue is full.
+ * @param q pointer to queue struct
+ * @param v value to push
+ **/
+void gq_ring_enqueue(struct gq_ring_t *q, void *v);
+
+/**
+ * Dequeue pops the "oldest" element in FIFO order; if a concurrent enqueue
+ * has claimed the next cell, but not written it yet, waits for it.
+ * @param q pointer to queue struct.
+ * @return pointer to element, or NULL if empty
+ **/
+void *gq_ring_dequeue(struct gq_ring_t *q);
+
+/**
+ * Dequeue pops the "oldest" element in FIFO order; waits while the queue is
+ * empty.
+ * @param q pointer to queue struct.
+ * @return pointer to element
+ **/
+void *gq_ring_dequeue_blocking(struct gq_ring_t *q);
+
+/** @} **/
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
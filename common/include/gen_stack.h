@@ -18,8 +18,8 @@
 //
 //! @file	gen_stack.h
 //! @brief	Generic, header-only, lock-free implementation of a dynamic
-//!		sized pool of things. Note: uses malloc, so not entirely
-//!		lock-free (memory locks).
+//!		sized pool of things. Elements are recycled via gen_epoch,
+//!		malloc is only used when the freelists are empty.
 //! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
 //!
 #ifndef __GEN_STACK_H__
@@ -30,6 +30,7 @@
 #error "C compiler does not have atomics"
 #endif
 #include <stdatomic.h>
+#include "gen_epoch.h"
 
 #define TAGGED_PTR(VAR) struct gs_tagged_ptr_t VAR __attribute__ ((aligned(16)))
 
@@ -63,6 +64,7 @@ static inline void *gs_pop(struct gs_t *stack) {
 	TAGGED_PTR(old);
 	volatile TAGGED_PTR(n);
 	void *ret = NULL;
+	ge_enter();
 	do {	
 		old = stack->free;
 		n.tc = old.tc + 1;
@@ -74,7 +76,8 @@ static inline void *gs_pop(struct gs_t *stack) {
 		}
 	} while (! atomic_compare_exchange_strong(&stack->free, &old, n));
 	if (ret)
-		free(old.p);
+		ge_node_retire(old.p);
+	ge_exit();
 	return ret;
 }
 
@@ -86,7 +89,7 @@ static inline void *gs_pop(struct gs_t *stack) {
 static inline void gs_push(struct gs_t *stack, void *elem) {
 	TAGGED_PTR(old);
 	TAGGED_PTR(n);
-	struct gs_e_t *e = malloc(sizeof(*e));
+	struct gs_e_t *e = ge_node_alloc(sizeof(*e));
 	e->data = elem;
 	do {
 		old = stack->free;
@@ -0,0 +1,165 @@
+//
+// Copyright (C) 2018 Jens Korinth, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	log_ring.h
+//! @brief	Asynchronous binary logging.
+//!		A log call stores a binary record (format string pointer and
+//!		raw argument values) in a ring of the calling thread (single
+//!		producer, no locks); a background thread formats the records
+//!		and writes them via log.c. String arguments are copied into
+//!		the record at the call site, the format string must be a
+//!		literal. Full rings drop new records, the number of dropped
+//!		records is reported in the log.
+//!		Records of one thread appear in order, records of different
+//!		threads may interleave out of order.
+//!
+#ifndef LOG_RING_H__
+#define LOG_RING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Environment variable: records per thread (default: LOG_RING_DEFAULT_RECORDS). **/
+#define LOG_RING_RECORDS_ENV				"LIBTAPASCO_LOG_RECORDS"
+#define LOG_RING_DEFAULT_RECORDS			1024
+/** Maximal number of arguments per record. **/
+#define LOG_RING_MAX_ARGS				16
+/** Bytes per record for copies of string arguments (truncated beyond). **/
+#define LOG_RING_STR_SZ					128
+/** Maximal interval between two passes of the formatter thread. **/
+#define LOG_RING_FLUSH_MS				10
+
+typedef enum {
+	LOG_ARG_INT,
+	LOG_ARG_UINT,
+	LOG_ARG_DBL,
+	LOG_ARG_PTR,
+	LOG_ARG_STR,					// copied into the record
+	LOG_ARG_CSTR,					// static string, e.g., __func__
+} log_arg_kind_t;
+
+typedef struct {
+	log_arg_kind_t				kind;
+	union {
+		long long			i;
+		unsigned long long		u;
+		double				d;
+		void const volatile		*p;
+		char const			*s;
+	};
+} log_arg_t;
+
+/**
+ * Starts the formatter thread on first call; reference counted, each call
+ * must be matched by log_ring_deinit.
+ * @return 1 if successful, 0 otherwise.
+ **/
+int log_ring_init(void);
+
+/** Stops the formatter thread on last call and writes all pending records. **/
+void log_ring_deinit(void);
+
+/** Stores a record in the ring of the calling thread (use LOG_RING below). **/
+void log_ring_record(char const *file, int const line, char const *fmt,
+		size_t const n, log_arg_t const *args);
+
+/**
+ * Parses a log level mask: either a number (strtoul base 0, -1 for all) or
+ * a comma-separated list of the given level names (case insensitive).
+ * @param s string to parse, may be NULL
+ * @param names level names
+ * @param levels level bits, same order as names
+ * @param n number of levels
+ * @return mask, 0 for NULL or empty strings.
+ **/
+unsigned long log_ring_parse_mask(char const *s, char const *const names[],
+		unsigned long const levels[], size_t const n);
+
+/** @defgroup args Argument capture
+ *  @{
+ **/
+static inline log_arg_t log_arg_int(long long const v)
+{ return (log_arg_t){ .kind = LOG_ARG_INT, .i = v }; }
+static inline log_arg_t log_arg_uint(unsigned long long const v)
+{ return (log_arg_t){ .kind = LOG_ARG_UINT, .u = v }; }
+static inline log_arg_t log_arg_dbl(double const v)
+{ return (log_arg_t){ .kind = LOG_ARG_DBL, .d = v }; }
+static inline log_arg_t log_arg_ptr(void const volatile *v)
+{ return (log_arg_t){ .kind = LOG_ARG_PTR, .p = v }; }
+static inline log_arg_t log_arg_str(char const *v)
+{ return (log_arg_t){ .kind = LOG_ARG_STR, .s = v }; }
+static inline log_arg_t log_arg_cstr(char const *v)
+{ return (log_arg_t){ .kind = LOG_ARG_CSTR, .s = v }; }
+static inline log_arg_t log_arg_self(log_arg_t const v) { return v; }
+
+#define LOG_ARG(x) _Generic((x), \
+	log_arg_t: log_arg_self, \
+	_Bool: log_arg_uint, \
+	char: log_arg_int, \
+	signed char: log_arg_int, \
+	short: log_arg_int, \
+	int: log_arg_int, \
+	long: log_arg_int, \
+	long long: log_arg_int, \
+	unsigned char: log_arg_uint, \
+	unsigned short: log_arg_uint, \
+	unsigned int: log_arg_uint, \
+	unsigned long: log_arg_uint, \
+	unsigned long long: log_arg_uint, \
+	float: log_arg_dbl, \
+	double: log_arg_dbl, \
+	long double: log_arg_dbl, \
+	char *: log_arg_str, \
+	char const *: log_arg_str, \
+	unsigned char *: log_arg_str, \
+	unsigned char const *: log_arg_str, \
+	default: log_arg_ptr)(x)
+
+#define LOG_RING_NARGS(...) \
+	LOG_RING_NARGS_(0, ##__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_RING_NARGS_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, n, ...) n
+
+#define LOG_RING_CAT(a, b)		LOG_RING_CAT_(a, b)
+#define LOG_RING_CAT_(a, b)		a##b
+#define LOG_RING_MAP(...)		LOG_RING_CAT(LOG_RING_MAP_, LOG_RING_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define LOG_RING_MAP_0(...)		{ 0 }
+#define LOG_RING_MAP_1(a)		LOG_ARG(a)
+#define LOG_RING_MAP_2(a, ...)		LOG_ARG(a), LOG_RING_MAP_1(__VA_ARGS__)
+#define LOG_RING_MAP_3(a, ...)		LOG_ARG(a), LOG_RING_MAP_2(__VA_ARGS__)
+#define LOG_RING_MAP_4(a, ...)		LOG_ARG(a), LOG_RING_MAP_3(__VA_ARGS__)
+#define LOG_RING_MAP_5(a, ...)		LOG_ARG(a), LOG_RING_MAP_4(__VA_ARGS__)
+#define LOG_RING_MAP_6(a, ...)		LOG_ARG(a), LOG_RING_MAP_5(__VA_ARGS__)
+#define LOG_RING_MAP_7(a, ...)		LOG_ARG(a), LOG_RING_MAP_6(__VA_ARGS__)
+#define LOG_RING_MAP_8(a, ...)		LOG_ARG(a), LOG_RING_MAP_7(__VA_ARGS__)
+#define LOG_RING_MAP_9(a, ...)		LOG_ARG(a), LOG_RING_MAP_8(__VA_ARGS__)
+#define LOG_RING_MAP_10(a, ...)		LOG_ARG(a), LOG_RING_MAP_9(__VA_ARGS__)
+#define LOG_RING_MAP_11(a, ...)		LOG_ARG(a), LOG_RING_MAP_10(__VA_ARGS__)
+#define LOG_RING_MAP_12(a, ...)		LOG_ARG(a), LOG_RING_MAP_11(__VA_ARGS__)
+#define LOG_RING_MAP_13(a, ...)		LOG_ARG(a), LOG_RING_MAP_12(__VA_ARGS__)
+#define LOG_RING_MAP_14(a, ...)		LOG_ARG(a), LOG_RING_MAP_13(__VA_ARGS__)
+#define LOG_RING_MAP_15(a, ...)		LOG_ARG(a), LOG_RING_MAP_14(__VA_ARGS__)
+#define LOG_RING_MAP_16(a, ...)		LOG_ARG(a), LOG_RING_MAP_15(__VA_ARGS__)
+/** @} **/
+
+/* enabled is evaluated first; arguments are only evaluated if it is true */
+#define LOG_RING(enabled, fmt, ...) \
+	do { if (__builtin_expect(!!(enabled), 0)) \
+		log_ring_record(__MY_FILE__, __LINE__, fmt, LOG_RING_NARGS(__VA_ARGS__), \
+				(log_arg_t const []){ LOG_RING_MAP(__VA_ARGS__) }); } while (0)
+
+#endif /* LOG_RING_H__ */
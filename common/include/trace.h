@@ -0,0 +1,76 @@
+//
+// Copyright (C) 2018 Jens Korinth, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	trace.h
+//! @brief	Low-overhead event tracing with Chrome trace-event export.
+//!		Each thread records into its own ring buffer (single producer,
+//!		no locks); events are timestamped with CLOCK_MONOTONIC_RAW.
+//!		When disabled, a trace point costs one load and a branch.
+//!		Full rings overwrite their oldest events, the number of lost
+//!		events is reported in the trace file. Rings of exited threads
+//!		are reused by new threads, so threads may come and go freely.
+//!
+#ifndef TRACE_H__
+#define TRACE_H__
+
+#include <stdint.h>
+
+/** Environment variable: name of the trace file, tracing is off if unset. **/
+#define TRACE_ENV					"LIBTAPASCO_TRACE"
+/** Environment variable: events per ring (default: TRACE_DEFAULT_EVENTS). **/
+#define TRACE_EVENTS_ENV				"LIBTAPASCO_TRACE_EVENTS"
+#define TRACE_DEFAULT_EVENTS				(1 << 16)
+
+/** Event phases, see Chrome trace-event format. **/
+typedef enum {
+	TRACE_PH_BEGIN					= 'B',
+	TRACE_PH_END					= 'E',
+	TRACE_PH_INSTANT				= 'i',
+	TRACE_PH_ASYNC_BEGIN				= 'b',
+	TRACE_PH_ASYNC_END				= 'e',
+} trace_phase_t;
+
+extern int trace_enabled;
+
+/**
+ * Enables tracing if TRACE_ENV is set; idempotent.
+ * @return 1 if tracing is enabled, 0 otherwise.
+ **/
+int trace_init(void);
+
+/** Records an event in the ring of the calling thread (use the macros below). **/
+void trace_record(trace_phase_t const ph, char const *name, unsigned const pid, uint64_t const id);
+
+/**
+ * Writes all recorded events as Chrome trace-event JSON to the file named
+ * by TRACE_ENV (view in chrome://tracing or Perfetto).
+ * @return 0 if successful, -1 otherwise.
+ **/
+int trace_dump(void);
+
+/* name must be a string literal or otherwise outlive the trace; pid is the
+ * device id, id the job id (or slot id for platform events) */
+#define TRACE(ph, name, pid, id) \
+	do { if (__builtin_expect(trace_enabled, 0)) trace_record(ph, name, pid, id); } while (0)
+#define TRACE_BEGIN(name, pid, id)		TRACE(TRACE_PH_BEGIN, name, pid, id)
+#define TRACE_END(name, pid, id)		TRACE(TRACE_PH_END, name, pid, id)
+#define TRACE_INSTANT(name, pid, id)		TRACE(TRACE_PH_INSTANT, name, pid, id)
+#define TRACE_ASYNC_BEGIN(name, pid, id)	TRACE(TRACE_PH_ASYNC_BEGIN, name, pid, id)
+#define TRACE_ASYNC_END(name, pid, id)		TRACE(TRACE_PH_ASYNC_END, name, pid, id)
+
+#endif /* TRACE_H__ */
@@ -0,0 +1,249 @@
+//
+// Copyright (C) 2018 Jens Korinth, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+/**
+ *  @file	gen_epoch.c
+ *  @brief	Epoch-based reclamation after K. Fraser, "Practical lock-
+ *  		freedom" (2004): a node retired in epoch e is recycled once
+ *  		the global epoch reached e + 2; the epoch advances only if
+ *  		all threads in critical sections have observed it.
+ *  @author	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
+ **/
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <gen_epoch.h>
+
+/** Node header in front of each node; keeps 16 byte alignment. **/
+struct ge_node {
+	struct ge_node				*next;
+	size_t					cls;		// GE_CLASSES: not recycled
+} __attribute__((aligned(16)));
+
+/** Per-thread state; owned by one thread, adopted after it exited. **/
+struct ge_thread {
+	struct ge_thread			*next;
+	int					in_use;		// 0 after owner thread exited
+	int					depth;		// nesting of critical sections
+	int					active;		// read by other threads
+	unsigned long				epoch;		// read by other threads
+	size_t					retired;
+	unsigned long				limbo_epoch[3];
+	struct ge_node				*limbo[3];
+	struct ge_node				*free[GE_CLASSES];
+	size_t					nfree[GE_CLASSES];
+} __attribute__((aligned(64)));
+
+static struct ge_thread *threads;
+static unsigned long global_epoch;
+static pthread_key_t thread_key;
+static pthread_once_t thread_once = PTHREAD_ONCE_INIT;
+
+/* shared pool for surplus nodes, balances producer and consumer threads */
+static pthread_mutex_t pool_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct ge_node *pool[GE_CLASSES];
+static size_t npool[GE_CLASSES];
+
+/** Marks the state of an exiting thread for reuse by the next new thread. **/
+static
+void release_thread(void *p)
+{
+	struct ge_thread *t = (struct ge_thread *)p;
+	t->depth = 0;
+	__atomic_store_n(&t->active, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&t->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static
+void thread_setup(void)
+{
+	pthread_key_create(&thread_key, release_thread);
+}
+
+/** Returns the state of the calling thread, adopts a released or allocates a new one. **/
+static inline
+struct ge_thread *self(void)
+{
+	static __thread struct ge_thread *me;
+	if (__builtin_expect(! me, 0)) {
+		struct ge_thread *t;
+		pthread_once(&thread_once, thread_setup);
+		for (t = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+			int unused = 0;
+			if (__atomic_compare_exchange_n(&t->in_use, &unused, 1, 0,
+					__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+				break;
+		}
+		if (! t) {
+			if (posix_memalign((void **)&t, 64, sizeof(*t))) abort();
+			memset(t, 0, sizeof(*t));
+			t->in_use = 1;
+			t->next = __atomic_load_n(&threads, __ATOMIC_RELAXED);
+			while (! __atomic_compare_exchange_n(&threads, &t->next, t, 1,
+					__ATOMIC_RELEASE, __ATOMIC_RELAXED)) ;
+		}
+		pthread_setspecific(thread_key, t);
+		me = t;
+	}
+	return me;
+}
+
+static inline
+struct ge_node *node_hdr(void *p)
+{
+	return (struct ge_node *)p - 1;
+}
+
+/** Moves half of an overfull freelist to the shared pool. **/
+static
+void spill(struct ge_thread *t, size_t const cls)
+{
+	size_t const n = t->nfree[cls] / 2;
+	struct ge_node *first = t->free[cls], *last = first;
+	for (size_t i = 1; i < n; ++i) last = last->next;
+	t->free[cls] = last->next;
+	t->nfree[cls] -= n;
+	pthread_mutex_lock(&pool_mtx);
+	last->next = pool[cls];
+	pool[cls] = first;
+	npool[cls] += n;
+	pthread_mutex_unlock(&pool_mtx);
+}
+
+/** Refills an empty freelist from the shared pool. **/
+static
+void refill(struct ge_thread *t, size_t const cls)
+{
+	struct ge_node *first, *last;
+	size_t n = 1;
+	if (! __atomic_load_n(&npool[cls], __ATOMIC_RELAXED)) return;
+	pthread_mutex_lock(&pool_mtx);
+	if ((first = last = pool[cls])) {
+		for (; n < GE_FREELIST_MAX / 2 && last->next; ++n) last = last->next;
+		pool[cls] = last->next;
+		npool[cls] -= n;
+		last->next = NULL;
+		t->free[cls] = first;
+		t->nfree[cls] = n;
+	}
+	pthread_mutex_unlock(&pool_mtx);
+}
+
+static inline
+void recycle(struct ge_thread *t, struct ge_node *n)
+{
+	if (n->cls >= GE_CLASSES) {
+		free(n);
+		return;
+	}
+	n->next = t->free[n->cls];
+	t->free[n->cls] = n;
+	if (++t->nfree[n->cls] > GE_FREELIST_MAX) spill(t, n->cls);
+}
+
+/** Recycles all limbo lists which are at least two epochs old. **/
+static
+void reclaim(struct ge_thread *t)
+{
+	unsigned long const g = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+	for (int i = 0; i < 3; ++i) {
+		if (t->limbo[i] && t->limbo_epoch[i] + 2 <= g) {
+			struct ge_node *n = t->limbo[i], *nxt;
+			t->limbo[i] = NULL;
+			for (; n; n = nxt) {
+				nxt = n->next;
+				recycle(t, n);
+			}
+		}
+	}
+}
+
+/** Advances the global epoch, if all active threads have observed it. **/
+static
+void try_advance(void)
+{
+	unsigned long e = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	for (struct ge_thread *t = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); t; t = t->next)
+		if (__atomic_load_n(&t->active, __ATOMIC_ACQUIRE) &&
+				__atomic_load_n(&t->epoch, __ATOMIC_ACQUIRE) != e)
+			return;
+	__atomic_compare_exchange_n(&global_epoch, &e, e + 1, 0,
+			__ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+void ge_enter(void)
+{
+	struct ge_thread *t = self();
+	if (t->depth++) return;
+	__atomic_store_n(&t->epoch, __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE),
+			__ATOMIC_RELAXED);
+	__atomic_store_n(&t->active, 1, __ATOMIC_RELAXED);
+	// publish before any shared node is read
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void ge_exit(void)
+{
+	struct ge_thread *t = self();
+	if (--t->depth) return;
+	__atomic_store_n(&t->active, 0, __ATOMIC_RELEASE);
+}
+
+void *ge_node_alloc(size_t const sz)
+{
+	struct ge_thread *t = self();
+	size_t const cls = (sz + GE_CLASS_SZ - 1) / GE_CLASS_SZ - 1;
+	struct ge_node *n;
+	if (cls < GE_CLASSES) {
+		if (! t->free[cls]) reclaim(t);
+		if (! t->free[cls]) refill(t, cls);
+		if ((n = t->free[cls])) {
+			t->free[cls] = n->next;
+			--t->nfree[cls];
+			return n + 1;
+		}
+	}
+	n = malloc(sizeof(*n) + (cls < GE_CLASSES ? (cls + 1) * GE_CLASS_SZ : sz));
+	if (! n) return NULL;
+	n->cls = cls < GE_CLASSES ? cls : GE_CLASSES;
+	return n + 1;
+}
+
+void ge_node_retire(void *p)
+{
+	struct ge_thread *t = self();
+	struct ge_node *n = node_hdr(p);
+	unsigned long const g = __atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE);
+	int const i = g % 3;
+	// slot still holds nodes of epoch g - 3 or older: recycle first
+	if (t->limbo[i] && t->limbo_epoch[i] != g) reclaim(t);
+	n->next = t->limbo[i];
+	t->limbo[i] = n;
+	t->limbo_epoch[i] = g;
+	if (++t->retired >= GE_RETIRE_THRESHOLD) {
+		t->retired = 0;
+		try_advance();
+		reclaim(t);
+	}
+}
+
+void ge_node_free(void *p)
+{
+	if (p) free(node_hdr(p));
+}
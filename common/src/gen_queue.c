@@ -22,6 +22,8 @@
  *  		"Nonblocking algorithms and preemption-safe locking on
  *  		multiprogrammed shared-memory multiprocessors." by M. Michael
  *  		and M. Scott (1998).
+ *  		Nodes are allocated and retired via gen_epoch, i.e., recycled
+ *  		only once no concurrent operation can dereference them.
  *  @author	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
  **/
 
@@ -32,7 +34,14 @@
 #error "C/C++ compiler does not have atomics"
 #endif
 #include <stdatomic.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include "gen_queue.h"
+#include "gen_epoch.h"
 
 #define TAGGED_PTR(n) struct gq_tagged_ptr n __attribute__ ((aligned(16)))
 
@@ -79,11 +88,13 @@ void gq_enqueue(struct gq_t *q, void *v)
 {
 	TAGGED_PTR(tail);
 	TAGGED_PTR(next);
-	struct gq_e_t *nd = calloc(sizeof(*nd), 1);
+	struct gq_e_t *nd = ge_node_alloc(sizeof(*nd));
+	memset(nd, 0, sizeof(*nd));
 	nd->data = v;
 	struct gq_tagged_ptr tmp = atomic_load(&nd->next);
 	tmp.ptr = NULL;
 	atomic_store(&nd->next, tmp);
+	ge_enter();
 	while (1) {
 		tail = atomic_load(&q->tail);
 		next = atomic_load(&tail.ptr->next);
@@ -102,6 +113,7 @@ void gq_enqueue(struct gq_t *q, void *v)
 	}
 	TAGGED_PTR(n) = { .ptr = nd, .tag = tail.tag + 1 };
 	atomic_compare_exchange_strong(&q->tail, &tail, n);
+	ge_exit();
 }
 
 /**
@@ -115,6 +127,7 @@ void *gq_dequeue(struct gq_t *q)
 	TAGGED_PTR(tail);
 	TAGGED_PTR(next);
 	void *data;
+	ge_enter();
 	while (1) {
 		head = atomic_load(&q->head);
 		tail = atomic_load(&q->tail);
@@ -122,6 +135,7 @@ void *gq_dequeue(struct gq_t *q)
 		if (_gq_pointers_equal(head, atomic_load(&q->head))) {
 			if (head.ptr == tail.ptr) {
 				if (next.ptr == NULL) {
+					ge_exit();
 					return NULL;
 				}
 				TAGGED_PTR(new) = { .ptr = next.ptr, tail.tag + 1 };
@@ -135,7 +149,8 @@ void *gq_dequeue(struct gq_t *q)
 			}
 		}
 	}
-	free(head.ptr);
+	ge_node_retire(head.ptr);
+	ge_exit();
 	return data;
 }
 /** @} **/
@@ -152,7 +167,8 @@ void *gq_dequeue(struct gq_t *q)
 struct gq_t *gq_init(void)
 {
 	struct gq_t *q = calloc(sizeof(*q), 1);
-	struct gq_e_t *nd = calloc(sizeof(*nd), 1);
+	struct gq_e_t *nd = ge_node_alloc(sizeof(*nd));
+	memset(nd, 0, sizeof(*nd));
 	struct gq_tagged_ptr tmp = atomic_load(&nd->next);
 	tmp.ptr = NULL;
 	atomic_store(&nd->next, tmp);
@@ -172,8 +188,161 @@ void gq_destroy(struct gq_t *q)
 	if (! q) return;
 	while(gq_dequeue(q));
 	struct gq_tagged_ptr tmp = atomic_load(&q->head);
-	free(tmp.ptr);
+	ge_node_free(tmp.ptr);
 	free(q);
 }
 
 /** @} **/
+
+
+/** @defgroup ring Bounded FIFO operations
+ *  @{
+ **/
+
+#define GQ_CACHELINE_SZ				64
+/** number of tries (yielding in between) before sleeping on the futex **/
+#define GQ_RING_SPINS				16
+
+/** Ring cell: seq == pos means empty for pos, seq == pos + 1 full for pos. **/
+struct gq_cell_t {
+	_Atomic(size_t) seq;
+	void *data;
+};
+
+/** Bounded queue type; positions and wait words on separate cache lines. **/
+struct gq_ring_t {
+	size_t mask;
+	struct gq_cell_t *cells;
+	_Atomic(size_t) enq_pos __attribute__ ((aligned(GQ_CACHELINE_SZ)));
+	_Atomic(size_t) deq_pos __attribute__ ((aligned(GQ_CACHELINE_SZ)));
+	/* futex words: bumped on enqueue/dequeue while there are waiters */
+	_Atomic(uint32_t) enqueued __attribute__ ((aligned(GQ_CACHELINE_SZ)));
+	_Atomic(uint32_t) dequeued;
+	_Atomic(uint32_t) waiters;
+};
+
+static inline long _gq_futex(_Atomic(uint32_t) *uaddr, int op, uint32_t val)
+{
+	return syscall(SYS_futex, uaddr, op, val, NULL, NULL, 0);
+}
+
+/** Internal: wakes all waiters on w, if there are any. **/
+static inline void _gq_ring_notify(struct gq_ring_t *q, _Atomic(uint32_t) *w)
+{
+	/* orders the cell update before the waiters check */
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_load_explicit(&q->waiters, memory_order_relaxed)) {
+		atomic_fetch_add(w, 1);
+		_gq_futex(w, FUTEX_WAKE_PRIVATE, INT_MAX);
+	}
+}
+
+struct gq_ring_t *gq_ring_init(size_t const capacity)
+{
+	size_t sz = 2;
+	struct gq_ring_t *q;
+	while (sz < capacity) sz <<= 1;
+	if (posix_memalign((void **)&q, GQ_CACHELINE_SZ, sizeof(*q))) return NULL;
+	memset(q, 0, sizeof(*q));
+	if (! (q->cells = calloc(sz, sizeof(*q->cells)))) {
+		free(q);
+		return NULL;
+	}
+	q->mask = sz - 1;
+	for (size_t i = 0; i < sz; ++i)
+		atomic_init(&q->cells[i].seq, i);
+	return q;
+}
+
+void gq_ring_destroy(struct gq_ring_t *q)
+{
+	if (! q) return;
+	free(q->cells);
+	free(q);
+}
+
+int gq_ring_try_enqueue(struct gq_ring_t *q, void *v)
+{
+	struct gq_cell_t *c;
+	size_t pos = atomic_load_explicit(&q->enq_pos, memory_order_relaxed);
+	while (1) {
+		c = &q->cells[pos & q->mask];
+		intptr_t const d = (intptr_t)atomic_load_explicit(&c->seq, memory_order_acquire) - (intptr_t)pos;
+		if (d == 0) {
+			if (atomic_compare_exchange_weak_explicit(&q->enq_pos, &pos, pos + 1,
+					memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (d < 0) {
+			return 0;
+		} else {
+			pos = atomic_load_explicit(&q->enq_pos, memory_order_relaxed);
+		}
+	}
+	c->data = v;
+	atomic_store_explicit(&c->seq, pos + 1, memory_order_release);
+	_gq_ring_notify(q, &q->enqueued);
+	return 1;
+}
+
+void *gq_ring_dequeue(struct gq_ring_t *q)
+{
+	struct gq_cell_t *c;
+	void *data;
+	size_t pos = atomic_load_explicit(&q->deq_pos, memory_order_relaxed);
+	while (1) {
+		c = &q->cells[pos & q->mask];
+		intptr_t const d = (intptr_t)atomic_load_explicit(&c->seq, memory_order_acquire) - (intptr_t)(pos + 1);
+		if (d == 0) {
+			if (atomic_compare_exchange_weak_explicit(&q->deq_pos, &pos, pos + 1,
+					memory_order_relaxed, memory_order_relaxed))
+				break;
+		} else if (d < 0) {
+			// empty, unless a producer claimed pos and did not publish yet:
+			// wait for it, NULL must mean empty
+			if (atomic_load_explicit(&q->enq_pos, memory_order_relaxed) == pos) return NULL;
+			sched_yield();
+			pos = atomic_load_explicit(&q->deq_pos, memory_order_relaxed);
+		} else {
+			pos = atomic_load_explicit(&q->deq_pos, memory_order_relaxed);
+		}
+	}
+	data = c->data;
+	atomic_store_explicit(&c->seq, pos + q->mask + 1, memory_order_release);
+	_gq_ring_notify(q, &q->dequeued);
+	return data;
+}
+
+void gq_ring_enqueue(struct gq_ring_t *q, void *v)
+{
+	for (int i = 0; i < GQ_RING_SPINS; ++i, sched_yield())
+		if (gq_ring_try_enqueue(q, v)) return;
+	while (1) {
+		uint32_t const seq = atomic_load(&q->dequeued);
+		atomic_fetch_add(&q->waiters, 1);
+		if (gq_ring_try_enqueue(q, v)) {
+			atomic_fetch_sub(&q->waiters, 1);
+			return;
+		}
+		_gq_futex(&q->dequeued, FUTEX_WAIT_PRIVATE, seq);
+		atomic_fetch_sub(&q->waiters, 1);
+	}
+}
+
+void *gq_ring_dequeue_blocking(struct gq_ring_t *q)
+{
+	void *data;
+	for (int i = 0; i < GQ_RING_SPINS; ++i, sched_yield())
+		if ((data = gq_ring_dequeue(q))) return data;
+	while (1) {
+		uint32_t const seq = atomic_load(&q->enqueued);
+		atomic_fetch_add(&q->waiters, 1);
+		if ((data = gq_ring_dequeue(q))) {
+			atomic_fetch_sub(&q->waiters, 1);
+			return data;
+		}
+		_gq_futex(&q->enqueued, FUTEX_WAIT_PRIVATE, seq);
+		atomic_fetch_sub(&q->waiters, 1);
+	}
+}
+
+/** @} **/
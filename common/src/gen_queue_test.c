@@ -4,9 +4,11 @@
 #include <stdatomic.h>
 #include <limits.h>
 #include <unistd.h>
+#include <time.h>
 #include "gen_queue.h"
 
 #define RUNS		(long)(1L << 22)
+#define RING_SZ		1024
 
 static atomic_long jobs = RUNS;
 static atomic_bool stop = 0;
@@ -32,26 +34,71 @@ void *pop_data(void *p)
 		}
 		usleep(1000);
 	}
+	while ((id = (long)gq_dequeue(q))) {
+		++recv;
+	}
 	return NULL;
 }
 
-int main(int argc, char *argv[])
+void *push_ring(void *p)
+{
+	struct gq_ring_t *q = (struct gq_ring_t *)p;
+	long id;
+	while ((id = atomic_fetch_sub(&jobs, 1)) > 0) {
+		gq_ring_enqueue(q, (void *)id);
+	}
+	return NULL;
+}
+
+void *pop_ring(void *p)
+{
+	struct gq_ring_t *q = (struct gq_ring_t *)p;
+	for (long i = 0; i < RUNS; ++i) {
+		if (gq_ring_dequeue_blocking(q)) ++recv;
+	}
+	return NULL;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static long run(const char *name, long num_cpus, void *q,
+		void *(*push)(void *), void *(*pop)(void *))
 {
-	const long num_cpus = argc > 1 ? strtol(argv[1], NULL, 0) : sysconf(_SC_NPROCESSORS_ONLN) + 1;
 	pthread_t threads[num_cpus];
-	struct gq_t *q = gq_init();
-	printf("Creating %ld threads ...\n", num_cpus);
-	pthread_create(&threads[0], NULL, pop_data, q);
-	for (size_t i = 1; i < num_cpus; ++i) {
-		pthread_create(&threads[i], NULL, push_data, q);
+	double const start = now();
+	jobs = RUNS;
+	stop = 0;
+	recv = 0;
+	pthread_create(&threads[0], NULL, pop, q);
+	for (long i = 1; i < num_cpus; ++i) {
+		pthread_create(&threads[i], NULL, push, q);
 	}
-	for (size_t i = 1; i < num_cpus; ++i) {
+	for (long i = 1; i < num_cpus; ++i) {
 		pthread_join(threads[i], NULL);
 	}
 	stop = 1;
-	usleep(10000);
 	pthread_join(threads[0], NULL);
-	printf("recv: %ld, expected: %ld\n", recv, RUNS);
+	double const t = now() - start;
+	printf("%s: recv: %ld, expected: %ld, %.0f ops/s\n", name, recv, RUNS,
+			recv / t);
+	return recv;
+}
+
+int main(int argc, char *argv[])
+{
+	const long num_cpus = argc > 1 ? strtol(argv[1], NULL, 0) : sysconf(_SC_NPROCESSORS_ONLN) + 1;
+	struct gq_t *q = gq_init();
+	struct gq_ring_t *r = gq_ring_init(RING_SZ);
+	int ret = 0;
+	printf("Creating %ld threads ...\n", num_cpus);
+	ret |= run("gq_t", num_cpus, q, push_data, pop_data) != RUNS;
+	ret |= run("gq_ring_t", num_cpus, r, push_ring, pop_ring) != RUNS;
+	gq_ring_destroy(r);
 	gq_destroy(q);
-	return recv == RUNS ? 0 : 1;
+	return ret;
 }
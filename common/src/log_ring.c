@@ -0,0 +1,397 @@
+//
+// Copyright (C) 2018 Jens Korinth, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+/**
+ *  @file	log_ring.c
+ *  @brief	Per-thread binary log rings and background formatter thread.
+ *  @author	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <log.h>
+#include <log_ring.h>
+
+struct log_record {
+	char const				*file;
+	char const				*fmt;
+	int					line;
+	unsigned				nargs;
+	log_arg_t				args[LOG_RING_MAX_ARGS];
+	char					str[LOG_RING_STR_SZ];
+};
+
+/** Ring of one thread; the owner advances head, the formatter advances tail. **/
+struct log_ring {
+	struct log_ring				*next;
+	int					in_use;		// 0 after owner thread exited
+	size_t					head __attribute__((aligned(64)));
+	size_t					dropped;
+	size_t					tail __attribute__((aligned(64)));
+	struct log_record			rec[];
+};
+
+static struct log_ring *rings;
+static size_t capacity = LOG_RING_DEFAULT_RECORDS;
+static pthread_key_t ring_key;
+static pthread_once_t ring_once = PTHREAD_ONCE_INIT;
+
+static pthread_mutex_t ring_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ring_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t formatter;
+static int refcnt;
+static int stop;
+
+/* serializes log_log between the formatter and synchronous ERR/WRN calls */
+static pthread_mutex_t log_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+static
+void log_lock(void *udata, int lock)
+{
+	if (lock) pthread_mutex_lock(&log_mtx);
+	else      pthread_mutex_unlock(&log_mtx);
+}
+
+/** Marks the ring of an exiting thread for reuse by the next new thread. **/
+static
+void release_ring(void *p)
+{
+	__atomic_store_n(&((struct log_ring *)p)->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static
+void ring_setup(void)
+{
+	char const *n = getenv(LOG_RING_RECORDS_ENV);
+	unsigned long const c = n ? strtoul(n, NULL, 0) : 0;
+	if (c > 0) capacity = c;
+	pthread_key_create(&ring_key, release_ring);
+}
+
+/** Returns the ring of the calling thread, adopts a released or allocates a new one. **/
+static
+struct log_ring *thread_ring(void)
+{
+	static __thread struct log_ring *ring;
+	if (__builtin_expect(! ring, 0)) {
+		struct log_ring *r;
+		pthread_once(&ring_once, ring_setup);
+		for (r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+			int unused = 0;
+			if (__atomic_compare_exchange_n(&r->in_use, &unused, 1, 0,
+					__ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+				break;
+		}
+		if (! r) {
+			r = (struct log_ring *)calloc(1, sizeof(*r) + capacity * sizeof(r->rec[0]));
+			if (! r) return NULL;
+			r->in_use = 1;
+			r->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+			while (! __atomic_compare_exchange_n(&rings, &r->next, r, 1,
+					__ATOMIC_RELEASE, __ATOMIC_RELAXED)) ;
+		}
+		pthread_setspecific(ring_key, r);
+		ring = r;
+	}
+	return ring;
+}
+
+/**
+ * Finds the conversion of each argument in fmt (as format_record parses it),
+ * e.g., 's' or 'p'; arguments consumed by '*' get '*', missing ones 0.
+ **/
+static
+void arg_conversions(char const *f, size_t const n, char *conv)
+{
+	size_t a = 0;
+	memset(conv, 0, n);
+	while (*f && a < n) {
+		if (*f++ != '%') continue;
+		if (*f == '%') { ++f; continue; }
+		while (*f && strchr("-+ #0'.123456789*", *f)) {
+			if (*f == '*' && a < n) conv[a++] = '*';
+			++f;
+		}
+		while (*f && strchr("hlLqjzt", *f)) ++f;
+		if (! *f) break;
+		if (a < n) conv[a++] = *f;
+		++f;
+	}
+}
+
+void log_ring_record(char const *file, int const line, char const *fmt,
+		size_t const n, log_arg_t const *args)
+{
+	char conv[LOG_RING_MAX_ARGS];
+	int have_conv = 0;
+	struct log_ring *r = thread_ring();
+	struct log_record *rec;
+	size_t h, used, s = 0;
+	if (! r) return;
+	h = r->head;
+	used = h - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	if (used >= capacity) {
+		__atomic_store_n(&r->dropped, r->dropped + 1, __ATOMIC_RELAXED);
+		return;
+	}
+	rec = &r->rec[h % capacity];
+	rec->file  = file;
+	rec->fmt   = fmt;
+	rec->line  = line;
+	rec->nargs = n;
+	memcpy(rec->args, args, n * sizeof(*args));
+	for (size_t i = 0; i < n; ++i) {
+		// copy transient strings, keep offset into str
+		if (args[i].kind == LOG_ARG_STR) {
+			size_t l;
+			// char pointers are strings only for %s, e.g., %p wants the address
+			if (! have_conv) {
+				arg_conversions(fmt, n, conv);
+				have_conv = 1;
+			}
+			if (conv[i] != 's') {
+				rec->args[i] = log_arg_ptr(args[i].s);
+				continue;
+			}
+			if (! args[i].s || s >= LOG_RING_STR_SZ - 1) {
+				rec->args[i] = log_arg_cstr(args[i].s ? "..." : NULL);
+				continue;
+			}
+			l = strnlen(args[i].s, LOG_RING_STR_SZ - s - 1);
+			memcpy(&rec->str[s], args[i].s, l);
+			rec->str[s + l] = '\0';
+			rec->args[i].u = s;
+			s += l + 1;
+		}
+	}
+	__atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+	// wake the formatter early, once per half-full ring
+	if (used + 1 == capacity / 2) {
+		pthread_mutex_lock(&ring_mtx);
+		pthread_cond_signal(&ring_cond);
+		pthread_mutex_unlock(&ring_mtx);
+	}
+}
+
+static inline
+unsigned long long as_u64(log_arg_t const *a)
+{
+	switch (a->kind) {
+	case LOG_ARG_DBL: return (unsigned long long)a->d;
+	case LOG_ARG_PTR: return (unsigned long long)(uintptr_t)a->p;
+	default:          return a->u;
+	}
+}
+
+static inline
+double as_dbl(log_arg_t const *a)
+{
+	switch (a->kind) {
+	case LOG_ARG_DBL:  return a->d;
+	case LOG_ARG_INT:  return (double)a->i;
+	default:           return (double)a->u;
+	}
+}
+
+/**
+ * Formats a record into buf, i.e., a minimal printf that takes its
+ * arguments from the record instead of a va_list. Each conversion is
+ * delegated to snprintf with the argument cast to the type its length
+ * modifier denotes.
+ **/
+static
+void format_record(struct log_record const *rec, char *buf, size_t const sz)
+{
+	char const *f = rec->fmt;
+	unsigned a = 0;
+	size_t o = 0;
+	while (*f && o + 1 < sz) {
+		char spec[32], len[3] = "";
+		size_t sl = 0, ll = 0;
+		log_arg_t const *arg;
+		int w;
+		if (*f != '%') { buf[o++] = *f++; continue; }
+		if (f[1] == '%') { buf[o++] = '%'; f += 2; continue; }
+		spec[sl++] = *f++;
+		// flags, width and precision; '*' consumes an argument
+		while (*f && strchr("-+ #0'.123456789*", *f) && sl < sizeof(spec) - 16) {
+			if (*f == '*') {
+				w = a < rec->nargs ? (int)as_u64(&rec->args[a++]) : 0;
+				sl += snprintf(&spec[sl], sizeof(spec) - sl, "%d", w);
+				++f;
+			} else spec[sl++] = *f++;
+		}
+		while (*f && strchr("hlLqjzt", *f) && ll < sizeof(len) - 1) len[ll++] = *f++;
+		if (! *f) break;
+		arg = a < rec->nargs ? &rec->args[a++] : NULL;
+		spec[sl] = '\0';
+		if (! arg) {
+			w = snprintf(&buf[o], sz - o, "%s", "(?)");
+			o += w > 0 ? w : 0;
+			++f;
+			continue;
+		}
+		switch (*f) {
+		case 'd': case 'i': {
+			long long v = (long long)as_u64(arg);
+			if      (! ll)              v = (int)v;
+			else if (! strcmp(len, "hh")) v = (signed char)v;
+			else if (! strcmp(len, "h"))  v = (short)v;
+			else if (! strcmp(len, "l"))  v = (long)v;
+			spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = *f; spec[sl] = '\0';
+			w = snprintf(&buf[o], sz - o, spec, v);
+			break;
+		}
+		case 'u': case 'o': case 'x': case 'X': {
+			unsigned long long v = as_u64(arg);
+			if      (! ll)              v = (unsigned)v;
+			else if (! strcmp(len, "hh")) v = (unsigned char)v;
+			else if (! strcmp(len, "h"))  v = (unsigned short)v;
+			else if (! strcmp(len, "l"))  v = (unsigned long)v;
+			spec[sl++] = 'l'; spec[sl++] = 'l'; spec[sl++] = *f; spec[sl] = '\0';
+			w = snprintf(&buf[o], sz - o, spec, v);
+			break;
+		}
+		case 'c':
+			spec[sl++] = *f; spec[sl] = '\0';
+			w = snprintf(&buf[o], sz - o, spec, (int)as_u64(arg));
+			break;
+		case 'e': case 'E': case 'f': case 'F':
+		case 'g': case 'G': case 'a': case 'A':
+			spec[sl++] = *f; spec[sl] = '\0';
+			w = snprintf(&buf[o], sz - o, spec, as_dbl(arg));
+			break;
+		case 's':
+			spec[sl++] = *f; spec[sl] = '\0';
+			w = snprintf(&buf[o], sz - o, spec,
+					arg->kind == LOG_ARG_STR ? &rec->str[arg->u] :
+					arg->kind == LOG_ARG_CSTR ? (arg->s ? arg->s : "(null)") : "(?)");
+			break;
+		case 'p':
+			spec[sl++] = *f; spec[sl] = '\0';
+			w = snprintf(&buf[o], sz - o, spec, (void *)(uintptr_t)as_u64(arg));
+			break;
+		default:
+			w = 0;
+		}
+		o += w > 0 ? w : 0;
+		++f;
+	}
+	buf[o < sz ? o : sz - 1] = '\0';
+}
+
+/** Formats and writes all records currently in the rings. **/
+static
+void drain(void)
+{
+	char buf[1024];
+	for (struct log_ring *r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+		size_t const h = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		size_t t = r->tail;
+		size_t const d = __atomic_exchange_n(&r->dropped, 0, __ATOMIC_RELAXED);
+		for (; t != h; ++t) {
+			struct log_record const *rec = &r->rec[t % capacity];
+			format_record(rec, buf, sizeof(buf));
+			log_log(LOG_INFO, rec->file, rec->line, "%s", buf);
+			__atomic_store_n(&r->tail, t + 1, __ATOMIC_RELEASE);
+		}
+		if (d) log_log(LOG_WARN, "log_ring.c", __LINE__, "log ring full, dropped %zu records", d);
+	}
+}
+
+static
+void *formatter_main(void *p)
+{
+	pthread_mutex_lock(&ring_mtx);
+	while (! stop) {
+		struct timespec ts;
+		pthread_mutex_unlock(&ring_mtx);
+		drain();
+		pthread_mutex_lock(&ring_mtx);
+		if (stop) break;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += LOG_RING_FLUSH_MS * 1000000L;
+		ts.tv_sec  += ts.tv_nsec / 1000000000L;
+		ts.tv_nsec %= 1000000000L;
+		pthread_cond_timedwait(&ring_cond, &ring_mtx, &ts);
+	}
+	pthread_mutex_unlock(&ring_mtx);
+	return NULL;
+}
+
+int log_ring_init(void)
+{
+	int ok = 1;
+	pthread_once(&ring_once, ring_setup);
+	pthread_mutex_lock(&ring_mtx);
+	if (! refcnt++) {
+		log_set_lock(log_lock);
+		stop = 0;
+		if (pthread_create(&formatter, NULL, formatter_main, NULL)) {
+			--refcnt;
+			ok = 0;
+		}
+	}
+	pthread_mutex_unlock(&ring_mtx);
+	return ok;
+}
+
+void log_ring_deinit(void)
+{
+	int last;
+	pthread_mutex_lock(&ring_mtx);
+	if (! refcnt) {
+		pthread_mutex_unlock(&ring_mtx);
+		return;
+	}
+	if ((last = ! --refcnt)) {
+		stop = 1;
+		pthread_cond_signal(&ring_cond);
+	}
+	pthread_mutex_unlock(&ring_mtx);
+	if (last) {
+		pthread_join(formatter, NULL);
+		drain();
+	}
+}
+
+unsigned long log_ring_parse_mask(char const *s, char const *const names[],
+		unsigned long const levels[], size_t const n)
+{
+	unsigned long m = 0;
+	char *end;
+	if (! s || ! *s) return 0;
+	errno = 0;
+	m = strtoul(s, &end, 0);
+	if (! errno && end != s && ! *end) return m;
+	m = 0;
+	while (*s) {
+		size_t const l = strcspn(s, ",");
+		if (l == 3 && ! strncasecmp(s, "all", 3)) m = ~0UL;
+		for (size_t i = 0; i < n; ++i)
+			if (strlen(names[i]) == l && ! strncasecmp(s, names[i], l))
+				m |= levels[i];
+		s += l;
+		if (*s == ',') ++s;
+	}
+	return m;
+}
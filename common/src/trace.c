@@ -0,0 +1,196 @@
+//
+// Copyright (C) 2018 Jens Korinth, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+/**
+ *  @file	trace.c
+ *  @brief	Per-thread event rings and Chrome trace-event export.
+ *  		Rings wrap around and overwrite their oldest events; rings of
+ *  		exited threads are released by a thread-specific destructor
+ *  		and adopted by the next new thread, so memory is bounded by
+ *  		the number of concurrently tracing threads.
+ *  @author	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <time.h>
+#include <trace.h>
+
+struct trace_event {
+	uint64_t				ts;
+	char const				*name;
+	uint64_t				id;
+	uint32_t				pid;
+	char					ph;
+};
+
+/**
+ * Ring of one thread; only the owner writes. Event i lives in
+ * ev[i % capacity]; head counts the started, done the completed events,
+ * the dump uses both to skip slots overwritten while it reads them.
+ * The tid identifies the ring, a thread adopting it continues on the
+ * same track.
+ **/
+struct trace_ring {
+	struct trace_ring			*next;
+	unsigned				tid;
+	int					in_use;
+	size_t					head;
+	size_t					done;
+	struct trace_event			ev[];
+};
+
+int trace_enabled;
+
+static struct trace_ring *rings;
+static unsigned next_tid;
+static size_t capacity = TRACE_DEFAULT_EVENTS;
+static char const *trace_fn;
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+static __thread struct trace_ring *ring;
+
+/** Thread-specific destructor: releases the ring of an exiting thread. **/
+static
+void release_ring(void *p)
+{
+	struct trace_ring *r = (struct trace_ring *)p;
+	ring = NULL;
+	__atomic_store_n(&r->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static
+void trace_setup(void)
+{
+	char const *n = getenv(TRACE_EVENTS_ENV);
+	if (! (trace_fn = getenv(TRACE_ENV)) || ! *trace_fn) return;
+	if (n && strtoul(n, NULL, 0) > 0) capacity = strtoul(n, NULL, 0);
+	if (pthread_key_create(&ring_key, release_ring)) return;
+	__atomic_store_n(&trace_enabled, 1, __ATOMIC_RELEASE);
+}
+
+int trace_init(void)
+{
+	pthread_once(&trace_once, trace_setup);
+	return trace_enabled;
+}
+
+static inline
+uint64_t now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &t);
+	return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+/** Adopts the ring of an exited thread, if any. **/
+static
+struct trace_ring *adopt_ring(void)
+{
+	for (struct trace_ring *r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+		int released = 0;
+		if (__atomic_load_n(&r->in_use, __ATOMIC_RELAXED)) continue;
+		if (__atomic_compare_exchange_n(&r->in_use, &released, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+			return r;
+	}
+	return NULL;
+}
+
+/**
+ * Returns the ring of the calling thread; on first use adopts a released
+ * ring or allocates and publishes a new one.
+ **/
+static
+struct trace_ring *thread_ring(void)
+{
+	if (__builtin_expect(! ring, 0)) {
+		struct trace_ring *r = adopt_ring();
+		if (! r) {
+			r = (struct trace_ring *)calloc(1, sizeof(*r) + capacity * sizeof(r->ev[0]));
+			if (! r) return NULL;
+			r->tid = __atomic_fetch_add(&next_tid, 1, __ATOMIC_RELAXED);
+			r->in_use = 1;
+			r->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+			while (! __atomic_compare_exchange_n(&rings, &r->next, r, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) ;
+		}
+		pthread_setspecific(ring_key, r);
+		ring = r;
+	}
+	return ring;
+}
+
+void trace_record(trace_phase_t const ph, char const *name, unsigned const pid, uint64_t const id)
+{
+	struct trace_ring *r = thread_ring();
+	size_t h;
+	struct trace_event *e;
+	if (! r) return;
+	h = r->head;
+	e = &r->ev[h % capacity];
+	// announce the overwrite before touching the slot, see trace_dump
+	__atomic_store_n(&r->head, h + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	e->ts   = now();
+	e->name = name;
+	e->id   = id;
+	e->pid  = pid;
+	e->ph   = (char)ph;
+	__atomic_store_n(&r->done, h + 1, __ATOMIC_RELEASE);
+}
+
+int trace_dump(void)
+{
+	FILE *fp;
+	size_t dropped = 0;
+	char const *sep = "";
+	if (! trace_enabled) return 0;
+	if (! (fp = fopen(trace_fn, "w"))) return -1;
+	fprintf(fp, "{\"traceEvents\":[");
+	for (struct trace_ring *r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+		size_t const d = __atomic_load_n(&r->done, __ATOMIC_ACQUIRE);
+		size_t const lo = d > capacity ? d - capacity : 0;
+		dropped += lo;
+		for (size_t i = lo; i < d; ++i) {
+			struct trace_event const e = r->ev[i % capacity];
+			// slot was reused by event i + capacity while copying it
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&r->head, __ATOMIC_RELAXED) > i + capacity) {
+				++dropped;
+				continue;
+			}
+			fprintf(fp, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%" PRIu64 ".%03u,\"pid\":%u,\"tid\":%u",
+					sep, e.name, e.ph, e.ts / 1000, (unsigned)(e.ts % 1000), e.pid, r->tid);
+			switch (e.ph) {
+			case TRACE_PH_ASYNC_BEGIN:
+			case TRACE_PH_ASYNC_END:
+				// async spans are matched by category and id across threads
+				fprintf(fp, ",\"cat\":\"job\",\"id\":%" PRIu64 "}", e.id);
+				break;
+			case TRACE_PH_INSTANT:
+				fprintf(fp, ",\"s\":\"t\",\"args\":{\"id\":%" PRIu64 "}}", e.id);
+				break;
+			default:
+				fprintf(fp, ",\"args\":{\"id\":%" PRIu64 "}}", e.id);
+			}
+			sep = ",";
+		}
+	}
+	fprintf(fp, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":\"%zu\"}}\n", dropped);
+	return fclose(fp) ? -1 : 0;
+}
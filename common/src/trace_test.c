@@ -0,0 +1,113 @@
+//
+// Copyright (C) 2018 Jens Korinth, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+/**
+ *  @file	trace_test.c
+ *  @brief	Records events from several threads, dumps the trace and
+ *  		checks the number of events and dropped events in the file;
+ *  		then lets threads come and go and checks that their rings
+ *  		are reused instead of allocating new ones.
+ *  @author	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <trace.h>
+
+#define THREADS		4
+#define CHURN		16	// short-lived threads started one after another
+#define EVENTS		100	// per thread, incl. dropped ones
+#define CAPACITY	64
+
+static pthread_barrier_t started, finished;
+
+static void record_events(void)
+{
+	for (long i = 0; i < EVENTS / 2; ++i) {
+		TRACE_BEGIN("span", 0, i);
+		TRACE_END("span", 0, i);
+	}
+}
+
+static void *record(void *p)
+{
+	// keep all threads alive at the same time, each needs its own ring
+	pthread_barrier_wait(&started);
+	record_events();
+	pthread_barrier_wait(&finished);
+	return NULL;
+}
+
+static void *record_once(void *p)
+{
+	record_events();
+	return NULL;
+}
+
+static void check(char const *fn, size_t exp_events, size_t exp_dropped)
+{
+	char buf[256];
+	size_t events = 0, dropped = 0;
+	unsigned max_tid = 0;
+	FILE *fp;
+
+	assert(trace_dump() == 0);
+	assert((fp = fopen(fn, "r")));
+	while (fgets(buf, sizeof(buf), fp)) {
+		char *d;
+		if (strstr(buf, "\"ph\":")) ++events;
+		if ((d = strstr(buf, "\"tid\":")) && strtoul(d + 6, NULL, 10) > max_tid)
+			max_tid = strtoul(d + 6, NULL, 10);
+		if ((d = strstr(buf, "\"dropped_events\":\""))) dropped = strtoul(d + 18, NULL, 10);
+	}
+	fclose(fp);
+	remove(fn);
+	printf("events: %zu, dropped: %zu, rings: %u\n", events, dropped, max_tid + 1);
+	assert(events == exp_events);
+	assert(dropped == exp_dropped);
+	assert(max_tid < THREADS);
+}
+
+int main(int argc, char *argv[])
+{
+	char const *fn = "trace_test.json";
+	pthread_t t[THREADS];
+
+	TRACE_INSTANT("disabled", 0, 0);		// no-op before trace_init
+	setenv(TRACE_ENV, fn, 1);
+	setenv(TRACE_EVENTS_ENV, "64", 1);
+	assert(trace_init());
+	pthread_barrier_init(&started, NULL, THREADS);
+	pthread_barrier_init(&finished, NULL, THREADS);
+	for (int i = 0; i < THREADS; ++i) pthread_create(&t[i], NULL, record, NULL);
+	for (int i = 0; i < THREADS; ++i) pthread_join(t[i], NULL);
+	check(fn, THREADS * CAPACITY, THREADS * (EVENTS - CAPACITY));
+
+	// exited threads released their rings, new threads must adopt them
+	for (int i = 0; i < CHURN; ++i) {
+		pthread_create(&t[0], NULL, record_once, NULL);
+		pthread_join(t[0], NULL);
+	}
+	check(fn, THREADS * CAPACITY, (THREADS + CHURN) * EVENTS - THREADS * CAPACITY);
+	pthread_barrier_destroy(&started);
+	pthread_barrier_destroy(&finished);
+	printf("trace_test: OK\n");
+	return 0;
+}
@@ -0,0 +1,113 @@
+//
+// Copyright (C) 2018 Jens Korinth, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	jobgraph-example.cpp
+//! @brief	JobGraph with per-argument buffer access: arrayinit produces a
+//!		buffer, several arraysum jobs read it via makeInOnly and must
+//!		not depend on each other, arrayupdate writes it after all of
+//!		them. A second arrayinit writes a TAPASCO_COPY_DIRECTION_TO
+//!		buffer via makeOutOnly, the arraysum reading it must depend on
+//!		it. Checks the dependencies and the results of several runs.
+//!		Runs on a simulated device, unless LIBPLATFORM_SIM is set
+//!		explicitly (0 selects the hardware).
+//! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
+//!
+#include <iostream>
+#include <cstdlib>
+#include <tapasco.hpp>
+
+#define SZ				256
+#define READERS				3
+#define RUNS				3
+#define DEFAULT_SIM			"11x2,10x3,9"
+#define ARRAYINIT_ID			11
+#define ARRAYSUM_ID			10
+#define ARRAYUPDATE_ID			9
+
+using namespace std;
+using namespace tapasco;
+using node_t = JobGraph::node_t;
+
+static int errors = 0;
+
+static void check(bool const ok, char const *what)
+{
+  if (! ok) {
+    cerr << "FAILED: " << what << endl;
+    ++errors;
+  }
+}
+
+static bool depends_exactly(JobGraph const& g, node_t const n, set<node_t> const& on)
+{
+  return g.dependencies(n) == on;
+}
+
+int main(int argc, char *argv[])
+{
+  int const init_sum = SZ * (SZ - 1) / 2;
+  int sums[READERS], updated_sum = 0, in_sum = 0;
+  vector<RetVal<int> > rv;
+  RetVal<int> rv_updated(updated_sum), rv_in(in_sum);
+  node_t readers[READERS];
+
+  setenv("LIBPLATFORM_SIM", DEFAULT_SIM, 0);
+  Tapasco tapasco;
+  DeviceBuffer<int> a, in;	// freed before the device is released
+  if (tapasco.alloc_buffer(a, SZ) != TAPASCO_SUCCESS ||
+      tapasco.alloc_buffer(in, SZ, TAPASCO_COPY_DIRECTION_TO) != TAPASCO_SUCCESS) {
+    cerr << "could not allocate buffers" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  JobGraph g(tapasco);
+  // fan-out: readers only depend on the producer, the writer on all of them
+  node_t const producer { g.add(ARRAYINIT_ID, a) };
+  for (int i = 0; i < READERS; ++i) {
+    rv.emplace_back(sums[i]);
+    readers[i] = g.add(ARRAYSUM_ID, rv[i], makeInOnly(a));
+  }
+  node_t const writer { g.add(ARRAYUPDATE_ID, a) };
+  node_t const last { g.add(ARRAYSUM_ID, rv_updated, makeInOnly(a)) };
+  for (int i = 0; i < READERS; ++i)
+    check(depends_exactly(g, readers[i], { producer }), "reader depends on producer only");
+  check(depends_exactly(g, writer, { producer, readers[0], readers[1], readers[2] }),
+      "writer depends on producer and all readers");
+  check(depends_exactly(g, last, { writer }), "last reader depends on writer only");
+
+  // producer -> consumer through a buffer the PEs otherwise only read
+  node_t const in_producer { g.add(ARRAYINIT_ID, makeOutOnly(in)) };
+  node_t const in_consumer { g.add(ARRAYSUM_ID, rv_in, in) };
+  check(depends_exactly(g, in_producer, { }), "TO buffer producer is independent");
+  check(depends_exactly(g, in_consumer, { in_producer }), "TO buffer consumer depends on producer");
+
+  for (int r = 0; r < RUNS; ++r) {
+    for (int i = 0; i < READERS; ++i) sums[i] = 0;
+    updated_sum = in_sum = 0;
+    check(g.run() == TAPASCO_SUCCESS, "run");
+    for (int i = 0; i < READERS; ++i)
+      check(sums[i] == init_sum, "reader sees the producer's data");
+    check(updated_sum == init_sum + 42 * SZ, "last reader sees the writer's data");
+    check(in_sum == init_sum, "TO buffer consumer sees the producer's data");
+  }
+  check(a.device_modified() && a[1] == 43, "host reads back the writer's data");
+  check(in.device_modified() && in[1] == 1, "host reads back the TO buffer producer's data");
+
+  cout << (errors ? "FAILED" : "OK") << endl;
+  return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,66 @@
+/**
+ *  @file	CpuUsage.hpp
+ *  @brief	Snapshots of host CPU time and context switches; the difference
+ *              of two snapshots divided by the number of jobs gives the host
+ *              CPU cost per job.
+ *  @author	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
+ **/
+#ifndef CPU_USAGE_HPP__
+#define CPU_USAGE_HPP__
+
+#include <cstdint>
+#include <ctime>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+/**
+ * CpuUsage holds the CPU time of the whole process (all threads, including
+ * the collectors in the libraries), its context switches, and the CPU time of
+ * the calling thread.
+ **/
+struct CpuUsage {
+  uint64_t process_ns { 0 };
+  uint64_t thread_ns  { 0 };
+  uint64_t csw_vol    { 0 };
+  uint64_t csw_invol  { 0 };
+
+  static CpuUsage now() {
+    CpuUsage u;
+    struct rusage r;
+    struct timespec ts;
+    if (! getrusage(RUSAGE_SELF, &r)) {
+      u.process_ns = tv2ns(r.ru_utime) + tv2ns(r.ru_stime);
+      u.csw_vol    = r.ru_nvcsw;
+      u.csw_invol  = r.ru_nivcsw;
+    }
+    if (! clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+      u.thread_ns = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    return u;
+  }
+
+  CpuUsage operator -(CpuUsage const& o) const {
+    CpuUsage d;
+    d.process_ns = process_ns - o.process_ns;
+    d.thread_ns  = thread_ns - o.thread_ns;
+    d.csw_vol    = csw_vol - o.csw_vol;
+    d.csw_invol  = csw_invol - o.csw_invol;
+    return d;
+  }
+
+  /** Process CPU time per job in us. **/
+  double us_per_job(uint64_t const jobs) const {
+    return jobs ? process_ns / 1000.0 / jobs : 0.0;
+  }
+  /** Context switches (voluntary and involuntary) per job. **/
+  double csw_per_job(uint64_t const jobs) const {
+    return jobs ? static_cast<double>(csw_vol + csw_invol) / jobs : 0.0;
+  }
+
+private:
+  static uint64_t tv2ns(struct timeval const& tv) {
+    return tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+  }
+};
+
+#endif // CPU_USAGE_HPP__
+/* vim: set foldmarker=@{,@} foldlevel=0 foldmethod=marker : */
@@ -20,6 +20,8 @@
 #include <cmath>
 #include <unistd.h>
 #include <tapasco.hpp>
+#include "LatencyHistogram.hpp"
+#include "CpuUsage.hpp"
 extern "C" {
 #include <platform.h>
 }
@@ -54,6 +56,8 @@ public:
   double atcycles(uint32_t const clock_cycles, size_t const min_runs = 100, double *min = NULL, double *max = NULL) {
     CumulativeAverage<double> cavg { 0 };
     atomic<bool> stop { false };
+    hist.reset();
+    CpuUsage const u0 { CpuUsage::now() };
     future<void> f = async(launch::async, [&]() { trigger(stop, clock_cycles, cavg); });
     do {
       std::ios_base::fmtflags coutf( cout.flags() );
@@ -69,6 +73,7 @@ public:
     } while (((!fast && fabs(cavg.delta()) > 0.01) || cavg.size() < min_runs));
     stop = true;
     f.get();
+    cpu = CpuUsage::now() - u0;
     if (min) *min = cavg.min();
     if (max) *max = cavg.max();
 
@@ -79,6 +84,8 @@ public:
               << ", Min: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << cavg.min()
               << ", Precision: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << fabs(cavg.delta())
               << ", Samples: " << std::dec << std::setw(3) << cavg.size()
+              << ", p99: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << hist.percentile(99.0) / 1000.0
+              << ", p99.9: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << hist.percentile(99.9) / 1000.0
               << std::flush;
     cout.flags( coutf );
 
@@ -87,6 +94,11 @@ public:
     return cavg();
   }
 
+  /** Latency samples (in ns) of the last call to atcycles. **/
+  LatencyHistogram<> const& histogram() const { return hist; }
+  /** Host CPU usage during the last call to atcycles. **/
+  CpuUsage const& cpu_usage() const { return cpu; }
+
 private:
   void trigger(volatile atomic<bool>& stop, uint32_t const clock_cycles, CumulativeAverage<double>& cavg) {
     tapasco_res_t res;
@@ -96,8 +108,10 @@ private:
       uint32_t cc = clock_cycles > 0 ? clock_cycles : (rand() % (10000000 - 100) + 100);
       if ((res = tapasco.launch(COUNTER_ID, cc)()) != TAPASCO_SUCCESS)
         throw Tapasco::tapasco_error(res);
-      microseconds const d = duration_cast<microseconds>(high_resolution_clock::now() - tstart);
-      cavg.update(d.count() - cc / design_clk);
+      nanoseconds const d = duration_cast<nanoseconds>(high_resolution_clock::now() - tstart);
+      int64_t const l = d.count() - static_cast<int64_t>(cc) * 1000 / design_clk;
+      cavg.update(static_cast<double>(d.count() / 1000 - cc / design_clk));
+      hist.record(l > 0 ? l : 0);
     }
   }
 
@@ -111,6 +125,8 @@ private:
   uint32_t design_clk;
   Tapasco& tapasco;
   bool fast;
+  LatencyHistogram<> hist;
+  CpuUsage cpu;
 };
 
 #endif /* INTERRUPT_LATENCY_HPP__ */
@@ -5,6 +5,8 @@
  *              interrupts after 1cc runtime and count finished jobs. Useful
  *              upper bound for job throughput in the system.
  *              The design must run at 100 MHz (assumption of timing calc).
+ *              Each thread launches batches of jobs and collects them
+ *              afterwards; per-job roundtrip latencies are recorded.
  *  @author  J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
  **/
 #ifndef JOB_THROUGHPUT_HPP__
@@ -15,6 +17,8 @@
 #include <mutex>
 #include <vector>
 #include <tapasco.hpp>
+#include "LatencyHistogram.hpp"
+#include "CpuUsage.hpp"
 extern "C" {
 #include <gen_queue.h>
 #include <assert.h>
@@ -34,17 +38,21 @@ public:
   }
   virtual ~JobThroughput() {}
 
-  double operator()(size_t const num_threads) {
+  double operator()(size_t const num_threads, size_t const batch_sz = 1) {
     CumulativeAverage<double> cavg { 0 };
     jobs.store(0U);
+    thread_ns.store(0U);
+    hist.reset();
     stop = false;
     vector<future<void> > threads;
+    CpuUsage const u0 { CpuUsage::now() };
     auto const t_start = high_resolution_clock::now();
     for (size_t t = 0; t < num_threads; ++t)
-      threads.push_back(async(launch::async, [&]() { run(); }));
+      threads.push_back(async(launch::async, [&]() { run(batch_sz); }));
     do {
       std::ios_base::fmtflags coutf( cout.flags() );
       std::cout << "\rNum threads: " << std::dec << std::fixed << std::setw(4) << std::setprecision(0) << num_threads
+                << ", Batch: " << std::dec << std::setw(3) << batch_sz
                 << ", Jobs/Second: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << cavg()
                 << ", Max: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << cavg.max()
                 << ", Min: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << cavg.min()
@@ -62,15 +70,20 @@ public:
     stop = true;
     for (auto &f : threads)
       f.wait();
+    cpu = CpuUsage::now() - u0;
+    cpu.thread_ns = thread_ns.load();
 
     std::ios_base::fmtflags coutf( cout.flags() );
     std::cout << "\rNum threads: " << std::dec << std::fixed << std::setw(4) << std::setprecision(0) << num_threads
+              << ", Batch: " << std::dec << std::setw(3) << batch_sz
               << ", Jobs/Second: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << cavg()
               << ", Max: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << cavg.max()
               << ", Min: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << cavg.min()
               << ", Precision: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << fabs(cavg.delta())
               << ", Samples: " << std::dec << std::setw(3) << cavg.size()
-              << std::flush;
+              << ", p99: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << hist.percentile(99.0) / 1000.0
+              << " us, CPU/job: " << std::dec << std::fixed << std::setw(6) << std::setprecision(2) << cpu.us_per_job(jobs.load())
+              << " us" << std::flush;
     cout.flags( coutf );
 
     std::cout << std::endl;
@@ -78,14 +91,32 @@ public:
     return cavg();
   }
 
+  /** Job roundtrip latencies (in ns) of the last measurement. **/
+  LatencyHistogram<> const& histogram() const { return hist; }
+  /** Host CPU usage of the last measurement; thread_ns is the sum over the launching threads. **/
+  CpuUsage const& cpu_usage() const { return cpu; }
+  /** Number of jobs of the last measurement. **/
+  uint64_t num_jobs() const { return jobs.load(); }
+
 private:
-  void run(void) {
+  void run(size_t const batch_sz) {
     tapasco_res_t res;
+    vector<job_future> fs(batch_sz);
+    vector<high_resolution_clock::time_point> ts(batch_sz);
+    CpuUsage const u0 { CpuUsage::now() };
     while (! stop) {
-      if ((res = tapasco.launch(COUNTER_ID, 1U)()) != TAPASCO_SUCCESS)
-        throw Tapasco::tapasco_error(res);
-      jobs++;
+      for (size_t i = 0; i < batch_sz; ++i) {
+        ts[i] = high_resolution_clock::now();
+        fs[i] = tapasco.launch(COUNTER_ID, 1U);
+      }
+      for (size_t i = 0; i < batch_sz; ++i) {
+        if ((res = fs[i]()) != TAPASCO_SUCCESS)
+          throw Tapasco::tapasco_error(res);
+        hist.record(duration_cast<nanoseconds>(high_resolution_clock::now() - ts[i]).count());
+      }
+      jobs += batch_sz;
     }
+    thread_ns += (CpuUsage::now() - u0).thread_ns;
   }
 
   gq_t *q;
@@ -93,6 +124,9 @@ private:
   atomic<bool> stop { false };
   atomic<uint64_t> jobs { 0 };
   atomic<tapasco_job_id_t> job { 0 };
+  atomic<uint64_t> thread_ns { 0 };
   bool fast;
+  LatencyHistogram<> hist;
+  CpuUsage cpu;
 };
 #endif /* JOB_THROUGHPUT_HPP__ */
@@ -0,0 +1,93 @@
+/**
+ *  @file	LatencyHistogram.hpp
+ *  @brief	A class wrapping a lock-free, HDR-style latency histogram.
+ *              Values are recorded into log-linear buckets: each power of two
+ *              is split into 2^SUB_BITS equally sized buckets, so the relative
+ *              error of any reported percentile is below 2^-SUB_BITS over the
+ *              full 64bit range, at constant memory and recording cost.
+ *  @author	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
+ **/
+#ifndef LATENCY_HISTOGRAM_HPP__
+#define LATENCY_HISTOGRAM_HPP__
+
+#include <atomic>
+#include <limits>
+#include <cstdint>
+#include <cmath>
+
+/**
+ * LatencyHistogram records samples (e.g., latencies in ns) from any number
+ * of threads and reports arbitrary percentiles.
+ **/
+template <unsigned SUB_BITS = 7> class LatencyHistogram {
+public:
+  LatencyHistogram() { reset(); }
+  virtual ~LatencyHistogram() {}
+
+  void reset() {
+    for (auto& b : _buckets) b.store(0, std::memory_order_relaxed);
+    _count.store(0);
+    _sum.store(0);
+    _min.store(std::numeric_limits<uint64_t>::max());
+    _max.store(0);
+  }
+
+  void record(uint64_t const v) {
+    _buckets[index(v)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(v, std::memory_order_relaxed);
+    uint64_t m = _min.load(std::memory_order_relaxed);
+    while (v < m && ! _min.compare_exchange_weak(m, v)) ;
+    m = _max.load(std::memory_order_relaxed);
+    while (v > m && ! _max.compare_exchange_weak(m, v)) ;
+  }
+  void operator ()(uint64_t const v) { record(v); }
+
+  /** Returns the smallest value v such that p percent of the samples are <= v. **/
+  uint64_t percentile(double const p) const {
+    uint64_t const n = size();
+    if (! n) return 0;
+    uint64_t const target = p >= 100.0 ? n : static_cast<uint64_t>(std::ceil(p / 100.0 * n));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+      seen += _buckets[i].load(std::memory_order_relaxed);
+      if (seen >= target && seen > 0) {
+        uint64_t const v = highest(i);
+        return v < max() ? v : max();
+      }
+    }
+    return max();
+  }
+
+  uint64_t size()  const { return _count.load(); }
+  uint64_t min()   const { return size() ? _min.load() : 0; }
+  uint64_t max()   const { return _max.load(); }
+  double   mean()  const { return size() ? static_cast<double>(_sum.load()) / size() : 0.0; }
+
+private:
+  static constexpr uint64_t SUB_BUCKETS = 1ULL << SUB_BITS;
+  static constexpr size_t   NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+  static size_t index(uint64_t const v) {
+    if (v < SUB_BUCKETS) return v;
+    unsigned const e = 63 - __builtin_clzll(v);
+    unsigned const shift = e - SUB_BITS;
+    return (shift + 1) * SUB_BUCKETS + ((v >> shift) - SUB_BUCKETS);
+  }
+
+  /** Returns the highest value that falls into bucket i. **/
+  static uint64_t highest(size_t const i) {
+    uint64_t const g = i / SUB_BUCKETS, s = i % SUB_BUCKETS;
+    if (! g) return s;
+    return ((SUB_BUCKETS + s + 1) << (g - 1)) - 1;
+  }
+
+  std::atomic<uint64_t> _buckets[NUM_BUCKETS];
+  std::atomic<uint64_t> _count;
+  std::atomic<uint64_t> _sum;
+  std::atomic<uint64_t> _min;
+  std::atomic<uint64_t> _max;
+};
+
+#endif // LATENCY_HISTOGRAM_HPP__
+/* vim: set foldmarker=@{,@} foldlevel=0 foldmethod=marker : */
@@ -18,6 +18,7 @@
 #include <unistd.h>
 #include <tapasco.hpp>
 #include <iomanip>
+#include "LatencyHistogram.hpp"
 
 using namespace std;
 using namespace std::chrono;
@@ -41,6 +42,7 @@ public:
     double b        { 0.0 };
 
     bytes = 0;
+    hist.reset();
 
     auto tstart       { high_resolution_clock::now() };
     duration<double> d      { high_resolution_clock::now() - tstart };
@@ -83,6 +85,9 @@ public:
     return cavg();
   }
 
+  /** Durations (in ns) of the single transfers of the last measurement. **/
+  LatencyHistogram<> const& histogram() const { return hist; }
+
 private:
 
   tapasco_res_t do_read(volatile atomic<bool>& stop, size_t const chunk_sz, long opmask, uint8_t *data) {
@@ -92,7 +97,9 @@ private:
     tapasco_res_t r { tapasco.alloc(h, chunk_sz, TAPASCO_DEVICE_ALLOC_FLAGS_NONE) };
     if (r != TAPASCO_SUCCESS)   { return r; }
     while (! stop.load()) {
+      auto const t0 = high_resolution_clock::now();
       r = tapasco.copy_from(h, data, chunk_sz, TAPASCO_DEVICE_COPY_BLOCKING);
+      hist.record(duration_cast<nanoseconds>(high_resolution_clock::now() - t0).count());
       if (r != TAPASCO_SUCCESS) { stop  = true; }
       else      { bytes += chunk_sz; }
     }
@@ -107,7 +114,9 @@ private:
     tapasco_res_t r { tapasco.alloc(h, chunk_sz, TAPASCO_DEVICE_ALLOC_FLAGS_NONE) };
     if (r != TAPASCO_SUCCESS)   { return r; }
     while (! stop.load()) {
+      auto const t0 = high_resolution_clock::now();
       r = tapasco.copy_to(data, h, chunk_sz, TAPASCO_DEVICE_COPY_BLOCKING);
+      hist.record(duration_cast<nanoseconds>(high_resolution_clock::now() - t0).count());
       if (r != TAPASCO_SUCCESS) { stop  = true; }
       else                      { bytes += chunk_sz; }
     }
@@ -141,6 +150,7 @@ private:
   atomic<uint64_t> bytes { 0 };
   Tapasco& tapasco;
   bool fast;
+  LatencyHistogram<> hist;
 };
 
 #endif /* TRANSFER_SPEED_HPP__ */
@@ -18,20 +18,21 @@ using namespace tapasco;
 
 static constexpr tapasco_kernel_id_t COUNTER_ID { 14 };
 static constexpr size_t INIT_SZ { 100000 };
+static constexpr size_t Q_SZ { 1024 };
 
 static const string err_job { "could not get job id" };
 static const string err_set { "could not set arg" };
 static const string err_run { "failed to launch" };
 
 struct Jobs {
-  Jobs(): q(gq_init()), stop(false) {
+  Jobs(): q(gq_ring_init(Q_SZ)), stop(false) {
     launched.reserve(INIT_SZ);
     collected.reserve(INIT_SZ);
   }
-  virtual ~Jobs() { gq_destroy(q); }
+  virtual ~Jobs() { gq_ring_destroy(q); }
 
   Tapasco tapasco;
-  gq_t *q;
+  gq_ring_t *q;
   atomic<bool> stop { false };
   vector<tapasco_job_id_t> launched;
   vector<tapasco_job_id_t> collected;
@@ -57,7 +58,7 @@ void launcher_thread(Jobs& j) {
       j.errors.push_back(err_run);
       j.stop = true;
     }
-    gq_enqueue(j.q, (void *)j_id);
+    gq_ring_enqueue(j.q, (void *)j_id);
     j.launched.push_back(j_id);
   }
 }
@@ -67,7 +68,7 @@ void collector_thread(Jobs& j) {
   tapasco_res_t res;
   tapasco_job_id_t j_id { 0 };
   while (! j.stop) {
-    while ((j_id = (tapasco_job_id_t)gq_dequeue(j.q))) {
+    while ((j_id = (tapasco_job_id_t)gq_ring_dequeue(j.q))) {
       j.slots.push_back(tapasco_jobs_get_slot(j.tapasco.device()->jobs, j_id));
       if ((res = tapasco_device_job_collect(j.tapasco.device(), j_id)) != TAPASCO_SUCCESS) {
         stringstream ss;
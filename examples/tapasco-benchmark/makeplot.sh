@@ -0,0 +1,25 @@
+#!/bin/bash
+#
+# Copyright (C) 2014 Jens Korinth, TU Darmstadt
+#
+# This file is part of Tapasco (TPC).
+#
+# Tapasco is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Lesser General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Tapasco is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+#
+# Plots <PLATFORM>.transfer-speed.csv as written by `tapasco-benchmark m`.
+FILENAME=${1%.csv}
+CSV=$FILENAME.csv
+PDF=$FILENAME.pdf
+
+cat $(dirname $0)/transfer-speed.gnuplot | sed "s|<CSV>|$CSV|g" | sed "s|<PDF>|$PDF|g" | gnuplot
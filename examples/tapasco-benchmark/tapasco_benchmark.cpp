@@ -39,6 +39,8 @@ extern "C" {
 #include <signal.h>
 
 #include "CumulativeAverage.hpp"
+#include "LatencyHistogram.hpp"
+#include "CpuUsage.hpp"
 #include "TransferSpeed.hpp"
 #include "InterruptLatency.hpp"
 #include "JobThroughput.hpp"
@@ -48,22 +50,43 @@ using namespace std;
 using namespace tapasco;
 using namespace json11;
 
+/** Comma-separated list of batch sizes for the batched job throughput sweep. **/
+#define BATCH_SIZES_ENV "TAPASCO_BENCHMARK_BATCH_SIZES"
+#define BATCH_SIZES_DEFAULT "8,32"
+
 typedef enum {
   MEASURE_TRANSFER_SPEED    = (1 << 0),
   MEASURE_INTERRUPT_LATENCY = (1 << 1),
   MEASURE_JOB_THROUGHPUT    = (1 << 2)
 } measure_t;
 
+/** Percentiles of a histogram of ns samples, in us. **/
+static Json percentiles(LatencyHistogram<> const& h) {
+  return Json::object {
+    {"p50",   h.percentile(50.0) / 1000.0},
+    {"p90",   h.percentile(90.0) / 1000.0},
+    {"p99",   h.percentile(99.0) / 1000.0},
+    {"p99.9", h.percentile(99.9) / 1000.0},
+    {"max",   h.max() / 1000.0}
+  };
+}
+
 struct transfer_speed_t {
   size_t chunk_sz;
   double speed_r;
   double speed_w;
   double speed_rw;
+  Json pct_r;
+  Json pct_w;
+  Json pct_rw;
   Json to_json() const { return Json::object {
       {"Chunk Size", static_cast<int>(chunk_sz)},
       {"Read", speed_r},
       {"Write", speed_w},
-      {"ReadWrite", speed_rw}
+      {"ReadWrite", speed_rw},
+      {"Read Percentiles", pct_r},
+      {"Write Percentiles", pct_w},
+      {"ReadWrite Percentiles", pct_rw}
     }; }
 };
 
@@ -72,21 +95,46 @@ struct interrupt_latency_t {
   double latency_us;
   double min_latency_us;
   double max_latency_us;
+  Json pct;
+  double cpu_us;
+  double csw;
   Json to_json() const { return Json::object {
       {"Cycle Count", static_cast<double>(cycle_count)},
       {"Avg Latency", latency_us},
       {"Min Latency", min_latency_us},
-      {"Max Latency", max_latency_us}
+      {"Max Latency", max_latency_us},
+      {"Percentiles", pct},
+      {"CPU Time per Job", cpu_us},
+      {"Context Switches per Job", csw}
     }; }
 };
 
 struct job_throughput_t {
   size_t num_threads;
+  size_t batch_sz;
   double jobs_per_sec;
+  Json pct;
+  double cpu_us;
+  double thread_cpu_us;
+  double csw;
   Json to_json() const { return Json::object {
       {"Number of threads", static_cast<double>(num_threads)},
-      {"Jobs per second", jobs_per_sec}
+      {"Batch Size", static_cast<double>(batch_sz)},
+      {"Jobs per second", jobs_per_sec},
+      {"Percentiles", pct},
+      {"CPU Time per Job", cpu_us},
+      {"Thread CPU Time per Job", thread_cpu_us},
+      {"Context Switches per Job", csw}
     }; }
+  void measure(JobThroughput& jt, size_t const threads, size_t const batch) {
+    num_threads   = threads;
+    batch_sz      = batch;
+    jobs_per_sec  = jt(threads, batch);
+    pct           = percentiles(jt.histogram());
+    cpu_us        = jt.cpu_usage().us_per_job(jt.num_jobs());
+    thread_cpu_us = jt.num_jobs() ? jt.cpu_usage().thread_ns / 1000.0 / jt.num_jobs() : 0.0;
+    csw           = jt.cpu_usage().csw_per_job(jt.num_jobs());
+  }
 };
 
 int main(int argc, const char *argv[]) {
@@ -117,6 +165,7 @@ int main(int argc, const char *argv[]) {
     vector<Json> latency;
     struct interrupt_latency_t ls;
     vector<Json> jobs;
+    vector<Json> batched;
     struct job_throughput_t js;
 
     string platform = "vc709";
@@ -141,11 +190,14 @@ int main(int argc, const char *argv[]) {
     if(fast) {
       max_size = 18;
     }
-    for (size_t i = 10; mode & MEASURE_TRANSFER_SPEED && i < max_size; ++i) {
+    for (size_t i = 10; mode & MEASURE_TRANSFER_SPEED && i <= max_size; ++i) {
       ts.chunk_sz = 1 << i;
       ts.speed_r  = tp(ts.chunk_sz, TransferSpeed::OP_COPYFROM);
+      ts.pct_r    = percentiles(tp.histogram());
       ts.speed_w  = tp(ts.chunk_sz, TransferSpeed::OP_COPYTO);
+      ts.pct_w    = percentiles(tp.histogram());
       ts.speed_rw = tp(ts.chunk_sz, TransferSpeed::OP_COPYFROM | TransferSpeed::OP_COPYTO);
+      ts.pct_rw   = percentiles(tp.histogram());
       if (ts.speed_r > 0.0 || ts.speed_w > 0 || ts.speed_rw > 0) {
         Json json = ts.to_json();
         speed.push_back(json);
@@ -157,6 +209,9 @@ int main(int argc, const char *argv[]) {
     for (size_t i = 0; mode & MEASURE_INTERRUPT_LATENCY && i < max_size; ++i) {
       ls.cycle_count = 1UL << i;
       ls.latency_us  = il.atcycles(ls.cycle_count, 10, &ls.min_latency_us, &ls.max_latency_us);
+      ls.pct         = percentiles(il.histogram());
+      ls.cpu_us      = il.cpu_usage().us_per_job(il.histogram().size());
+      ls.csw         = il.cpu_usage().csw_per_job(il.histogram().size());
       Json json = ls.to_json();
       latency.push_back(json);
     }
@@ -168,11 +223,25 @@ int main(int argc, const char *argv[]) {
       const size_t min_threads = sysconf(_SC_NPROCESSORS_ONLN) * 2;
       do {
         prev = js.jobs_per_sec;
-        js.num_threads = i;
-        js.jobs_per_sec = jt(i);
+        js.measure(jt, i, 1);
         ++i;
         jobs.push_back(js.to_json());
       } while (i <= 128 && (i <= min_threads || js.jobs_per_sec > prev));
+
+      // sweep thread counts (powers of two) for each batch size; PEs are
+      // held until collected, so all batches together must fit the PEs
+      size_t const pes = tapasco.kernel_pe_count(JobThroughput::COUNTER_ID);
+      char const *bs = getenv(BATCH_SIZES_ENV);
+      stringstream bss { bs ? bs : BATCH_SIZES_DEFAULT };
+      string b;
+      while (getline(bss, b, ',')) {
+        size_t const batch_sz = strtoul(b.c_str(), NULL, 0);
+        if (batch_sz < 2) continue;
+        for (size_t t = 1; t <= 128 && t <= min_threads && t * batch_sz <= pes; t <<= 1) {
+          js.measure(jt, t, batch_sz);
+          batched.push_back(js.to_json());
+        }
+      }
     }
 
     // record current time
@@ -195,6 +264,7 @@ int main(int argc, const char *argv[]) {
       {"Transfer Speed", speed},
       {"Interrupt Latency", latency},
       {"Job Throughput", jobs},
+      {"Batched Job Throughput", batched},
       {"Library Versions", Json::object {
           {"Tapasco API",  tapasco_version()},
           {"Platform API", platform_version()}
@@ -202,6 +272,21 @@ int main(int argc, const char *argv[]) {
       }
     };
 
+    // dump transfer speeds as CSV for transfer-speed.gnuplot
+    if (mode & MEASURE_TRANSFER_SPEED) {
+      stringstream cs;
+      cs << platform << ".transfer-speed.csv";
+      cout << "Dumping transfer speed CSV to " << cs.str() << endl;
+      ofstream c(cs.str());
+      c << "Chunk Size (KiB),Read,Write,ReadWrite" << endl;
+      for (auto const& j : speed)
+        c << (j["Chunk Size"].int_value() / 1024) << ","
+          << j["Read"].number_value() << ","
+          << j["Write"].number_value() << ","
+          << j["ReadWrite"].number_value() << endl;
+      c.close();
+    }
+
     // dump it
     stringstream ss;
     ss << platform << ".benchmark";
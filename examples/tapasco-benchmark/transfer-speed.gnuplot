@@ -0,0 +1,18 @@
+#!/usr/bin/gnuplot
+set terminal pdf enhanced
+set output '<PDF>'
+
+set style data linespoints
+set logscale x 2
+set logscale y
+set xrange [1:524288]
+set format x '2^{%L}'
+set xlabel 'Transfer Size (KiB)'
+set ylabel 'Transfer Speed (MiB/s)'
+set grid xtics ytics
+
+set datafile separator ","
+
+set key left top
+
+plot for [i=2:4] "<CSV>" using 1:i title col
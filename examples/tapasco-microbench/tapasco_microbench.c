@@ -0,0 +1,363 @@
+//
+// Copyright (C) 2018 Jens Korinth, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	tapasco_microbench.c
+//! @brief	Microbenchmarks for the data structures on the job path:
+//!		gen_queue, gen_stack, fixed size pools, gen_mem, job ids and
+//!		PE management. Each benchmark runs at 1..N threads, either on
+//!		one shared instance or on one instance per thread, with an
+//!		optional amount of work between two operations. Results are
+//!		written as one JSON object per line to stdout.
+//!		Job ids and PEs are taken from a simulated device, unless
+//!		LIBPLATFORM_SIM is set explicitly (0 selects the hardware).
+//! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
+//!
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <tapasco.h>
+#include <tapasco_device.h>
+#include <tapasco_jobs.h>
+#include <tapasco_pemgmt.h>
+#include <gen_queue.h>
+#include <gen_stack.h>
+#include <gen_mem.h>
+#include <gen_fixed_size_pool.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define DEFAULT_DURATION_MS				200
+#define DEFAULT_SIM					"14x64"
+#define FSP_SZ						256
+#define MEM_SZ						(1UL << 30)
+#define MEM_CHUNK					4096
+
+/** @defgroup cycles Time stamps
+ *  @{
+ **/
+static inline uint64_t ns_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/** Returns cycle counter, or ns on architectures without one. **/
+static inline uint64_t cycles_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return ns_now();
+#endif
+}
+
+/** Busy work between two operations; models the rest of a job's path. **/
+static inline void think(unsigned long const n)
+{
+	for (volatile unsigned long i = 0; i < n; ++i) ;
+}
+/** @} **/
+
+/** @defgroup instances Benchmark subjects
+ *  @{
+ **/
+struct fsp_elem { int v; };
+static inline void init_fsp_elem(struct fsp_elem *e, fsp_idx_t const i) { e->v = i; }
+MAKE_FIXED_SIZE_POOL(bench, FSP_SZ, struct fsp_elem, init_fsp_elem)
+
+struct gm_inst {
+	pthread_mutex_t mtx;
+	block_t *mem;
+};
+
+static tapasco_devctx_t *dev;
+static tapasco_kernel_id_t k_id = 14;
+
+static void *gq_setup(void)	{ return gq_init(); }
+static void gq_teardown(void *p)	{ gq_destroy((struct gq_t *)p); }
+static int gq_op(void *p, unsigned int *seed)
+{
+	gq_enqueue((struct gq_t *)p, seed);
+	return gq_dequeue((struct gq_t *)p) != NULL;
+}
+
+static void *gr_setup(void)	{ return gq_ring_init(1024); }
+static void gr_teardown(void *p)	{ gq_ring_destroy((struct gq_ring_t *)p); }
+static int gr_op(void *p, unsigned int *seed)
+{
+	gq_ring_enqueue((struct gq_ring_t *)p, seed);
+	return gq_ring_dequeue((struct gq_ring_t *)p) != NULL;
+}
+
+static void *gs_setup(void)	{ return calloc(sizeof(struct gs_t), 1); }
+static void gs_teardown(void *p)
+{
+	while (gs_pop((struct gs_t *)p)) ;
+	free(p);
+}
+static int gs_op(void *p, unsigned int *seed)
+{
+	gs_push((struct gs_t *)p, seed);
+	return gs_pop((struct gs_t *)p) != NULL;
+}
+
+static void *fsp_setup(void)
+{
+	struct bench_fsp_t *fsp = malloc(sizeof(*fsp));
+	if (fsp) bench_fsp_init(fsp);
+	return fsp;
+}
+static void fsp_teardown(void *p)	{ free(p); }
+static int fsp_op(void *p, unsigned int *seed)
+{
+	fsp_idx_t const idx = bench_fsp_get((struct bench_fsp_t *)p);
+	if (idx == INVALID_IDX) return 0;
+	bench_fsp_put((struct bench_fsp_t *)p, idx);
+	return 1;
+}
+
+static void *gm_setup(void)
+{
+	struct gm_inst *gm = malloc(sizeof(*gm));
+	if (! gm) return NULL;
+	pthread_mutex_init(&gm->mtx, NULL);
+	gm->mem = gen_mem_create(0, MEM_SZ);
+	return gm;
+}
+static void gm_teardown(void *p)
+{
+	struct gm_inst *gm = (struct gm_inst *)p;
+	pthread_mutex_destroy(&gm->mtx);
+	free(gm->mem);
+	free(gm);
+}
+/* locked like the platform allocators */
+static int gm_op(void *p, unsigned int *seed)
+{
+	struct gm_inst *gm = (struct gm_inst *)p;
+	size_t const len = MEM_CHUNK * (1 + rand_r(seed) % 16);
+	addr_t a;
+	pthread_mutex_lock(&gm->mtx);
+	a = gen_mem_malloc(&gm->mem, len);
+	pthread_mutex_unlock(&gm->mtx);
+	if (a == INVALID_ADDRESS) return 0;
+	pthread_mutex_lock(&gm->mtx);
+	gen_mem_free(&gm->mem, a, len);
+	pthread_mutex_unlock(&gm->mtx);
+	return 1;
+}
+
+static void *dev_setup(void)	{ return dev; }
+static void dev_teardown(void *p)	{ }
+static int jobs_op(void *p, unsigned int *seed)
+{
+	tapasco_devctx_t *d = (tapasco_devctx_t *)p;
+	tapasco_job_id_t const j_id = tapasco_jobs_acquire(d->jobs);
+	if (! j_id) return 0;
+	tapasco_jobs_release(d->jobs, j_id);
+	return 1;
+}
+static int pemgmt_op(void *p, unsigned int *seed)
+{
+	tapasco_devctx_t *d = (tapasco_devctx_t *)p;
+	tapasco_slot_id_t const s = tapasco_pemgmt_acquire_pe(d->pemgmt, k_id);
+	if (s < 0) return 0;
+	tapasco_pemgmt_release_pe(d->pemgmt, s);
+	return 1;
+}
+
+// name, setup, op, teardown, can have private instances
+#define MICROBENCHMARKS \
+	_X(gen_queue,	gq_setup,	gq_op,		gq_teardown,	1) \
+	_X(gen_queue_ring, gr_setup,	gr_op,		gr_teardown,	1) \
+	_X(gen_stack,	gs_setup,	gs_op,		gs_teardown,	1) \
+	_X(fsp,		fsp_setup,	fsp_op,		fsp_teardown,	1) \
+	_X(gen_mem,	gm_setup,	gm_op,		gm_teardown,	1) \
+	_X(jobs,	dev_setup,	jobs_op,	dev_teardown,	0) \
+	_X(pemgmt,	dev_setup,	pemgmt_op,	dev_teardown,	0)
+
+struct microbench {
+	char const *name;
+	void *(*setup)(void);
+	int (*op)(void *, unsigned int *);
+	void (*teardown)(void *);
+	int can_private;
+};
+
+static struct microbench const benchmarks[] = {
+#define _X(name, setup, op, teardown, p) { #name, setup, op, teardown, p },
+	MICROBENCHMARKS
+#undef _X
+};
+/** @} **/
+
+/** @defgroup runner Thread runner
+ *  @{
+ **/
+struct thrd {
+	pthread_t thread;
+	struct microbench const *b;
+	void *inst;
+	unsigned long think;
+	unsigned int seed;
+	uint64_t ops;
+	uint64_t fails;
+	uint64_t cycles;
+};
+
+static pthread_barrier_t start;
+static volatile int stop;
+
+static void *run(void *p)
+{
+	struct thrd *t = (struct thrd *)p;
+	void *inst = t->inst ? t->inst : t->b->setup();
+	uint64_t c0, cycles = 0;
+	pthread_barrier_wait(&start);
+	while (! __atomic_load_n(&stop, __ATOMIC_RELAXED)) {
+		c0 = cycles_now();
+		if (t->b->op(inst, &t->seed)) ++t->ops;
+		else ++t->fails;
+		cycles += cycles_now() - c0;
+		think(t->think);
+	}
+	t->cycles = cycles;
+	if (! t->inst) t->b->teardown(inst);
+	return NULL;
+}
+
+static void measure(struct microbench const *b, size_t const n, int const priv,
+		unsigned long const think_n, unsigned long const ms)
+{
+	struct thrd t[n];
+	void *shared = priv ? NULL : b->setup();
+	uint64_t ops = 0, fails = 0, cycles = 0, t0, t1;
+	double sq = 0.0, min = -1.0, max = 0.0;
+	if (! priv && ! shared) {
+		fprintf(stderr, "%s: setup failed\n", b->name);
+		return;
+	}
+	memset(t, 0, sizeof(t));
+	stop = 0;
+	pthread_barrier_init(&start, NULL, n + 1);
+	for (size_t i = 0; i < n; ++i) {
+		t[i].b = b;
+		t[i].inst = shared;
+		t[i].think = think_n;
+		t[i].seed = i + 1;
+		pthread_create(&t[i].thread, NULL, run, &t[i]);
+	}
+	pthread_barrier_wait(&start);
+	t0 = ns_now();
+	usleep(ms * 1000);
+	__atomic_store_n(&stop, 1, __ATOMIC_RELAXED);
+	for (size_t i = 0; i < n; ++i) pthread_join(t[i].thread, NULL);
+	t1 = ns_now();
+	pthread_barrier_destroy(&start);
+	if (shared) b->teardown(shared);
+
+	for (size_t i = 0; i < n; ++i) {
+		ops    += t[i].ops;
+		fails  += t[i].fails;
+		cycles += t[i].cycles;
+		sq     += (double)t[i].ops * t[i].ops;
+		if (min < 0 || t[i].ops < min) min = t[i].ops;
+		if (t[i].ops > max) max = t[i].ops;
+	}
+	// fairness: Jain's index over per-thread operation counts, 1.0 is fair
+	printf("{\"benchmark\": \"%s\", \"pattern\": \"%s\", \"threads\": %zu, \"think\": %lu, "
+			"\"ops\": %lu, \"failed\": %lu, \"ops_per_sec\": %.1f, \"cycles_per_op\": %.1f, "
+			"\"fairness\": %.4f, \"min_max_ratio\": %.4f}\n",
+			b->name, priv ? "private" : "shared", n, think_n,
+			(unsigned long)ops, (unsigned long)fails, ops * 1e9 / (t1 - t0),
+			ops + fails ? (double)cycles / (ops + fails) : 0.0,
+			sq > 0 ? (double)ops * ops / (n * sq) : 0.0,
+			max > 0 ? min / max : 0.0);
+	fflush(stdout);
+}
+/** @} **/
+
+static void usage(char const *prg)
+{
+	fprintf(stderr, "Usage: %s [-t max threads] [-d duration ms] [-w think iterations] "
+			"[-p shared|private|both] [-k kernel id] [benchmark ...]\n"
+			"Benchmarks:", prg);
+#define _X(name, setup, op, teardown, p) fprintf(stderr, " " #name);
+	MICROBENCHMARKS
+#undef _X
+	fprintf(stderr, "\n");
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+	size_t max_threads = sysconf(_SC_NPROCESSORS_ONLN) * 2;
+	unsigned long ms = DEFAULT_DURATION_MS, think_n = 0;
+	int shared = 1, priv = 1, opt;
+	tapasco_ctx_t *ctx = NULL;
+	tapasco_res_t r;
+
+	while ((opt = getopt(argc, argv, "t:d:w:p:k:h")) != -1) {
+		switch (opt) {
+		case 't': max_threads = strtoul(optarg, NULL, 0); break;
+		case 'd': ms = strtoul(optarg, NULL, 0); break;
+		case 'w': think_n = strtoul(optarg, NULL, 0); break;
+		case 'k': k_id = strtoul(optarg, NULL, 0); break;
+		case 'p':
+			shared = strcmp(optarg, "private") != 0;
+			priv = strcmp(optarg, "shared") != 0;
+			break;
+		default: usage(argv[0]);
+		}
+	}
+	if (max_threads < 1) max_threads = 1;
+
+	setenv("LIBPLATFORM_SIM", DEFAULT_SIM, 0);
+	if ((r = tapasco_init(&ctx)) != TAPASCO_SUCCESS ||
+			(r = tapasco_create_device(ctx, 0, &dev, 0)) != TAPASCO_SUCCESS) {
+		fprintf(stderr, "tapasco fatal error: %s\n", tapasco_strerror(r));
+		exit(r);
+	}
+
+	for (size_t i = 0; i < sizeof(benchmarks) / sizeof(*benchmarks); ++i) {
+		struct microbench const *b = &benchmarks[i];
+		int selected = optind >= argc;
+		for (int a = optind; a < argc; ++a) selected |= ! strcmp(argv[a], b->name);
+		if (! selected) continue;
+		if (b->op == pemgmt_op && ! tapasco_pemgmt_count(dev->pemgmt, k_id)) {
+			fprintf(stderr, "pemgmt: no PEs with kernel id %lu, skipped\n", (unsigned long)k_id);
+			continue;
+		}
+		for (size_t n = 1; n <= max_threads; ++n) {
+			if (shared) measure(b, n, 0, think_n, ms);
+			if (priv && b->can_private) measure(b, n, 1, think_n, ms);
+		}
+	}
+
+	tapasco_destroy_device(ctx, dev);
+	tapasco_deinit(ctx);
+	return EXIT_SUCCESS;
+}
+/* vim: set foldmarker=@{,@} foldlevel=0 foldmethod=marker : */
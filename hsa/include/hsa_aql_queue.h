@@ -0,0 +1,223 @@
+//
+// Copyright (C) 2018 Jaco A. Hofmann, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	hsa_aql_queue.h
+//! @brief	User space runtime for the HSA AQL queue device: thread-safe
+//!		packet submission, completion signal pool and waiting.
+//!
+//!		Packets are submitted in three steps: a producer reserves a
+//!		slot by atomically incrementing the write index, fills in the
+//!		packet body and publishes it by storing the header with
+//!		release semantics. The doorbell is only advanced over
+//!		contiguously published slots, so the hardware never fetches a
+//!		slot that is still being written, no matter how many threads
+//!		submit concurrently.
+//!
+#ifndef HSA_AQL_QUEUE_H__
+#define HSA_AQL_QUEUE_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define HSA_AQL_ERRORS \
+	_X(HSA_AQL_ERR_OPEN_DEV        , -1       , "could not open HSA queue device file") \
+	_X(HSA_AQL_ERR_MMAP_DEV        , -2       , "could not mmap HSA queue device file") \
+	_X(HSA_AQL_ERR_IOCTL           , -3       , "ioctl on HSA queue device failed") \
+	_X(HSA_AQL_ERR_OUT_OF_MEMORY   , -4       , "out of memory (host)") \
+	_X(HSA_AQL_ERR_NO_SIGNALS      , -5       , "no free completion signals in pool") \
+	_X(HSA_AQL_ERR_TIMEOUT         , -6       , "timeout while waiting for signal") \
+	_X(HSA_AQL_ERR_INVALID_QUEUE   , -7       , "invalid queue memory layout") \
+	_X(HSA_AQL_ERR_SENTINEL        , -8       , "--- no error, just end of list ---")
+
+#ifdef _X
+	#undef _X
+#endif
+
+#define _X(constant, code, msg) \
+	constant = code,
+typedef enum {
+	HSA_AQL_SUCCESS = 0,
+	HSA_AQL_ERRORS
+} hsa_aql_res_t;
+#undef _X
+
+/** Returns a human-readable message for res. **/
+const char *const hsa_aql_strerror(hsa_aql_res_t const res);
+
+/** @defgroup types AQL packet types
+ *  @{
+ **/
+typedef struct hsa_signal_s {
+	uint64_t				handle;
+} hsa_signal_t;
+
+typedef enum {
+	HSA_PACKET_TYPE_VENDOR_SPECIFIC = 0,
+	HSA_PACKET_TYPE_INVALID = 1,
+	HSA_PACKET_TYPE_KERNEL_DISPATCH = 2,
+	HSA_PACKET_TYPE_BARRIER_AND = 3,
+	HSA_PACKET_TYPE_AGENT_DISPATCH = 4,
+	HSA_PACKET_TYPE_BARRIER_OR = 5
+} hsa_packet_type_t;
+
+typedef enum {
+	HSA_PACKET_HEADER_TYPE = 0,
+	HSA_PACKET_HEADER_BARRIER = 8,
+	HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE = 9,
+	HSA_PACKET_HEADER_RELEASE_FENCE_SCOPE = 11
+} hsa_packet_header_t;
+
+typedef enum {
+	HSA_FENCE_SCOPE_NONE = 0,
+	HSA_FENCE_SCOPE_AGENT = 1,
+	HSA_FENCE_SCOPE_SYSTEM = 2
+} hsa_fence_scope_t;
+
+typedef struct hsa_kernel_dispatch_packet_s {
+	uint16_t				header;
+	uint16_t				setup;
+	uint16_t				workgroup_size_x;
+	uint16_t				workgroup_size_y;
+	uint16_t				workgroup_size_z;
+	uint16_t				reserved0;
+	uint32_t				grid_size_x;
+	uint32_t				grid_size_y;
+	uint32_t				grid_size_z;
+	uint32_t				private_segment_size;
+	uint32_t				group_segment_size;
+	uint64_t				kernel_object;
+	void					*kernarg_address;
+	uint64_t				reserved2;
+	hsa_signal_t				completion_signal;
+} hsa_kernel_dispatch_packet_t;
+
+/** Returns a packet header with system-scope acquire and release fences. **/
+static inline
+uint16_t hsa_aql_header(hsa_packet_type_t const type)
+{
+	return (uint16_t)(type << HSA_PACKET_HEADER_TYPE |
+			HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE |
+			HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_RELEASE_FENCE_SCOPE);
+}
+/** @} **/
+
+typedef struct hsa_aql_queue hsa_aql_queue_t;
+
+/** A completion signal from the pool of a queue. **/
+typedef struct hsa_aql_signal {
+	uint64_t				*value;		// signal value in user space
+	hsa_signal_t				handle;		// signal address seen by the device
+	int					idx;		// index within the pool
+} hsa_aql_signal_t;
+
+/**
+ * Memory layout of a queue which is not backed by the device file, e.g., an
+ * in-memory stand-in for unit tests. signals[0] is used as doorbell, the
+ * remaining signals form the completion signal pool.
+ **/
+typedef struct hsa_aql_queue_mem {
+	void					*packets;	// array of length packet slots
+	size_t					length;		// number of slots, power of 2
+	uint64_t				*read_index;	// consumer read index
+	uint64_t				*signals;	// signal array
+	size_t					num_signals;	// number of signals
+	uint64_t				signals_dev;	// device address of signals[0]
+	uint64_t				write_index;	// initial write index
+} hsa_aql_queue_mem_t;
+
+/**
+ * Opens the HSA AQL queue device, maps the queue and allocates the doorbell
+ * and a pool of completion signals.
+ * @param dev_id queue number (/dev/HSA_AQL_QUEUE_<dev_id>), see module parameter hsa_queues
+ * @param q output queue pointer
+ * @return HSA_AQL_SUCCESS, if successful, an error code otherwise.
+ **/
+hsa_aql_res_t hsa_aql_queue_open(int const dev_id, hsa_aql_queue_t **q);
+
+/**
+ * Attaches a queue to the given memory layout instead of a device.
+ * @param mem queue memory layout
+ * @param q output queue pointer
+ * @return HSA_AQL_SUCCESS, if successful, an error code otherwise.
+ **/
+hsa_aql_res_t hsa_aql_queue_attach(hsa_aql_queue_mem_t const *mem, hsa_aql_queue_t **q);
+
+/** Releases all signals and mappings of the queue. **/
+void hsa_aql_queue_close(hsa_aql_queue_t *q);
+
+/** Returns the number of packet slots of the queue. **/
+size_t hsa_aql_queue_length(hsa_aql_queue_t const *q);
+
+/**
+ * Reserves the next packet slot; blocks while the queue is full.
+ * Thread-safe.
+ * @param q queue
+ * @return write index of the reserved slot.
+ **/
+uint64_t hsa_aql_queue_reserve(hsa_aql_queue_t *q);
+
+/** Returns the packet slot at write index idx. **/
+hsa_kernel_dispatch_packet_t *hsa_aql_queue_packet(hsa_aql_queue_t *q, uint64_t const idx);
+
+/**
+ * Publishes the packet at write index idx: stores header and setup with
+ * release semantics, then rings the doorbell for all contiguously published
+ * slots. The packet body must be complete before calling. Thread-safe.
+ * @param q queue
+ * @param idx write index returned by hsa_aql_queue_reserve
+ * @param header packet header, e.g., hsa_aql_header(HSA_PACKET_TYPE_KERNEL_DISPATCH)
+ * @param setup packet setup field
+ **/
+void hsa_aql_queue_publish(hsa_aql_queue_t *q, uint64_t const idx, uint16_t const header,
+		uint16_t const setup);
+
+/**
+ * Takes a completion signal from the pool of the queue (lock-free).
+ * @param q queue
+ * @param s output signal
+ * @return HSA_AQL_SUCCESS, if successful, HSA_AQL_ERR_NO_SIGNALS if pool is empty.
+ **/
+hsa_aql_res_t hsa_aql_signal_acquire(hsa_aql_queue_t *q, hsa_aql_signal_t *s);
+
+/** Returns a completion signal to the pool of the queue (lock-free). **/
+void hsa_aql_signal_release(hsa_aql_queue_t *q, hsa_aql_signal_t const *s);
+
+/** Sets the value of signal s, e.g., to the number of packets it completes. **/
+void hsa_aql_signal_store(hsa_aql_signal_t const *s, uint64_t const value);
+
+/** Returns the current value of signal s. **/
+uint64_t hsa_aql_signal_load(hsa_aql_signal_t const *s);
+
+/**
+ * Waits until signal s reaches zero: spins for a while, then backs off to
+ * sleeping with exponentially increasing intervals.
+ * @param s signal
+ * @param timeout_ns timeout in nanoseconds, 0 waits indefinitely
+ * @return HSA_AQL_SUCCESS, if signal reached zero, HSA_AQL_ERR_TIMEOUT otherwise.
+ **/
+hsa_aql_res_t hsa_aql_signal_wait(hsa_aql_signal_t const *s, uint64_t const timeout_ns);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif /* __cplusplus */
+
+#endif /* HSA_AQL_QUEUE_H__ */
@@ -0,0 +1,358 @@
+//
+// Copyright (C) 2018 Jaco A. Hofmann, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	hsa_aql_queue.c
+//! @brief	User space runtime for the HSA AQL queue device.
+//!
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <hsa_aql_queue.h>
+#include <hsa/hsa_ioctl_calls.h>
+
+#define HSA_AQL_DEV_FN					"/dev/HSA_AQL_QUEUE_%d"
+#define HSA_AQL_ARBITER_PGOFF				2
+#define HSA_AQL_ARBITER_SZ				0x1000
+#define HSA_AQL_ARBITER_WRITE_INDEX			26
+#define HSA_AQL_ARBITER_QUEUE_STRIDE			(0x100 / 8)
+#define HSA_AQL_SIGNAL_POOL_SZ				32
+#define HSA_AQL_SIGNAL_POOL_MAX				64
+#define HSA_AQL_SPIN_ITERATIONS				4096
+#define HSA_AQL_BACKOFF_MIN_NS				1000UL
+#define HSA_AQL_BACKOFF_MAX_NS				1000000UL
+#define HSA_AQL_UNPUBLISHED				UINT64_MAX
+
+#if defined(__x86_64__) || defined(__i386__)
+	#define cpu_relax()				__asm__ __volatile__("pause" ::: "memory")
+#elif defined(__aarch64__) || defined(__arm__)
+	#define cpu_relax()				__asm__ __volatile__("yield" ::: "memory")
+#else
+	#define cpu_relax()				__asm__ __volatile__("" ::: "memory")
+#endif
+
+struct hsa_aql_queue {
+	int					fd;
+	void					*mem;
+	size_t					mem_sz;
+	hsa_kernel_dispatch_packet_t		*packets;
+	uint64_t				mask;
+	uint64_t				*read_index;
+	uint64_t				*signals;
+	uint64_t				signals_dev;
+	uint64_t				*doorbell;
+	int					doorbell_idx;
+	uint64_t				write_index;	// next slot to reserve
+	uint64_t				*published;	// write index last published per slot
+	uint64_t				free_signals;	// bitmap of free pool signals
+	size_t					pool_sz;
+	int					pool[HSA_AQL_SIGNAL_POOL_MAX];
+};
+
+#ifdef _X
+	#undef _X
+#endif
+
+#define _X(constant, code, msg) msg,
+static const char *const _err_msg[] = {
+	"success",
+	HSA_AQL_ERRORS
+};
+#undef _X
+
+const char *const hsa_aql_strerror(hsa_aql_res_t const res)
+{
+	static unsigned long const _l = (unsigned long)-HSA_AQL_ERR_SENTINEL;
+	unsigned long const i = (unsigned long) -res;
+	if (i >= _l) return "unknown error";
+	return _err_msg[i];
+}
+
+static inline
+uint64_t now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+/** Sleeps for *delay ns and doubles *delay up to the maximum. **/
+static inline
+void backoff(unsigned long *delay)
+{
+	struct timespec const ts = { .tv_sec = 0, .tv_nsec = *delay };
+	nanosleep(&ts, NULL);
+	if (*delay < HSA_AQL_BACKOFF_MAX_NS) *delay <<= 1;
+}
+
+static
+hsa_aql_res_t queue_init(hsa_aql_queue_t *q, void *packets, size_t const length,
+		uint64_t *read_index, uint64_t *signals, uint64_t const signals_dev,
+		uint64_t const write_index)
+{
+	if (! length || (length & (length - 1))) return HSA_AQL_ERR_INVALID_QUEUE;
+	q->published = (uint64_t *)malloc(length * sizeof(*q->published));
+	if (! q->published) return HSA_AQL_ERR_OUT_OF_MEMORY;
+	for (size_t i = 0; i < length; ++i) q->published[i] = HSA_AQL_UNPUBLISHED;
+	q->packets = (hsa_kernel_dispatch_packet_t *)packets;
+	q->mask = length - 1;
+	q->read_index = read_index;
+	q->signals = signals;
+	q->signals_dev = signals_dev;
+	q->write_index = write_index;
+	return HSA_AQL_SUCCESS;
+}
+
+static
+void pool_add(hsa_aql_queue_t *q, int const signal_idx)
+{
+	q->pool[q->pool_sz] = signal_idx;
+	q->free_signals |= 1ULL << q->pool_sz;
+	++q->pool_sz;
+}
+
+hsa_aql_res_t hsa_aql_queue_attach(hsa_aql_queue_mem_t const *mem, hsa_aql_queue_t **q)
+{
+	hsa_aql_res_t res;
+	if (mem->num_signals < 2) return HSA_AQL_ERR_INVALID_QUEUE;
+	*q = (hsa_aql_queue_t *)calloc(sizeof(**q), 1);
+	if (! *q) return HSA_AQL_ERR_OUT_OF_MEMORY;
+	(*q)->fd = -1;
+	res = queue_init(*q, mem->packets, mem->length, mem->read_index, mem->signals,
+			mem->signals_dev, mem->write_index);
+	if (res != HSA_AQL_SUCCESS) {
+		free(*q);
+		*q = NULL;
+		return res;
+	}
+	(*q)->doorbell_idx = 0;
+	(*q)->doorbell = &mem->signals[0];
+	*(*q)->doorbell = mem->write_index;
+	for (size_t i = 1; i < mem->num_signals && i <= HSA_AQL_SIGNAL_POOL_MAX; ++i)
+		pool_add(*q, i);
+	return HSA_AQL_SUCCESS;
+}
+
+hsa_aql_res_t hsa_aql_queue_open(int const dev_id, hsa_aql_queue_t **q)
+{
+	struct hsa_ioctl_params p = { 0 };
+	size_t len = HSA_QUEUE_LENGTH;
+	int queue_idx = 0;
+	uint8_t *mem;
+	uint64_t *arbiter, wi;
+	hsa_aql_res_t res;
+	char fn[32];
+	*q = (hsa_aql_queue_t *)calloc(sizeof(**q), 1);
+	if (! *q) return HSA_AQL_ERR_OUT_OF_MEMORY;
+	(*q)->doorbell_idx = -1;
+
+	snprintf(fn, sizeof(fn), HSA_AQL_DEV_FN, dev_id);
+	if (((*q)->fd = open(fn, O_RDWR, 0)) < 0) {
+		res = HSA_AQL_ERR_OPEN_DEV;
+		goto err_open;
+	}
+
+	// queue length is a module parameter; older modules only know the default
+	if (! ioctl((*q)->fd, IOCTL_CMD_HSA_QUEUE_INFO, &p)) {
+		len = p.data;
+		queue_idx = p.offset;
+	}
+
+	(*q)->mem_sz = hsa_mmap_space_size(len);
+	mem = (uint8_t *)mmap(NULL, (*q)->mem_sz, PROT_READ | PROT_WRITE, MAP_SHARED, (*q)->fd, 0);
+	if (mem == MAP_FAILED) {
+		res = HSA_AQL_ERR_MMAP_DEV;
+		goto err_mem;
+	}
+	(*q)->mem = mem;
+
+	// current write index of the hardware, queue may have been used before
+	arbiter = (uint64_t *)mmap(NULL, HSA_AQL_ARBITER_SZ, PROT_READ, MAP_SHARED, (*q)->fd,
+			HSA_AQL_ARBITER_PGOFF * sysconf(_SC_PAGESIZE));
+	if (arbiter == MAP_FAILED) {
+		res = HSA_AQL_ERR_MMAP_DEV;
+		goto err_arbiter;
+	}
+	wi = arbiter[queue_idx * HSA_AQL_ARBITER_QUEUE_STRIDE + HSA_AQL_ARBITER_WRITE_INDEX];
+	munmap(arbiter, HSA_AQL_ARBITER_SZ);
+
+	if (ioctl((*q)->fd, IOCTL_CMD_HSA_SIGNAL_ALLOC, &p)) {
+		res = HSA_AQL_ERR_IOCTL;
+		goto err_arbiter;
+	}
+	(*q)->doorbell_idx = p.offset;
+
+	res = queue_init(*q, mem, len, (uint64_t *)(mem + hsa_mmap_read_index_offset(len)),
+			(uint64_t *)(mem + hsa_mmap_signals_offset(len)),
+			(uintptr_t)p.addr - p.offset * sizeof(uint64_t), wi);
+	if (res != HSA_AQL_SUCCESS) goto err_arbiter;
+
+	// preallocate completion signals, avoids an ioctl per job
+	while ((*q)->pool_sz < HSA_AQL_SIGNAL_POOL_SZ && ! ioctl((*q)->fd, IOCTL_CMD_HSA_SIGNAL_ALLOC, &p))
+		pool_add(*q, p.offset);
+	if (! (*q)->pool_sz) {
+		res = HSA_AQL_ERR_NO_SIGNALS;
+		goto err_arbiter;
+	}
+
+	(*q)->doorbell = &(*q)->signals[(*q)->doorbell_idx];
+	__atomic_store_n((*q)->doorbell, wi, __ATOMIC_RELEASE);
+	p.offset = (*q)->doorbell_idx;
+	if (ioctl((*q)->fd, IOCTL_CMD_HSA_DOORBELL_ASSIGN, &p)) {
+		(*q)->doorbell = NULL;
+		res = HSA_AQL_ERR_IOCTL;
+		goto err_arbiter;
+	}
+	return HSA_AQL_SUCCESS;
+
+err_arbiter:
+	hsa_aql_queue_close(*q);
+	*q = NULL;
+	return res;
+err_mem:
+	close((*q)->fd);
+err_open:
+	free(*q);
+	*q = NULL;
+	return res;
+}
+
+void hsa_aql_queue_close(hsa_aql_queue_t *q)
+{
+	struct hsa_ioctl_params p = { 0 };
+	if (! q) return;
+	if (q->fd >= 0) {
+		if (q->doorbell) {
+			p.offset = q->doorbell_idx;
+			ioctl(q->fd, IOCTL_CMD_HSA_DOORBELL_UNASSIGN, &p);
+		}
+		for (size_t i = 0; i < q->pool_sz; ++i) {
+			p.offset = q->pool[i];
+			ioctl(q->fd, IOCTL_CMD_HSA_SIGNAL_DEALLOC, &p);
+		}
+		if (q->doorbell_idx >= 0) {
+			p.offset = q->doorbell_idx;
+			ioctl(q->fd, IOCTL_CMD_HSA_SIGNAL_DEALLOC, &p);
+		}
+		if (q->mem) munmap(q->mem, q->mem_sz);
+		close(q->fd);
+	}
+	free(q->published);
+	free(q);
+}
+
+size_t hsa_aql_queue_length(hsa_aql_queue_t const *q)
+{
+	return q->mask + 1;
+}
+
+uint64_t hsa_aql_queue_reserve(hsa_aql_queue_t *q)
+{
+	uint64_t const idx = __atomic_fetch_add(&q->write_index, 1, __ATOMIC_RELAXED);
+	unsigned long delay = HSA_AQL_BACKOFF_MIN_NS;
+	int spin = HSA_AQL_SPIN_ITERATIONS;
+	// slot is free once the consumer has moved past its previous use
+	while (idx - __atomic_load_n(q->read_index, __ATOMIC_ACQUIRE) > q->mask) {
+		if (spin-- > 0) cpu_relax();
+		else backoff(&delay);
+	}
+	return idx;
+}
+
+hsa_kernel_dispatch_packet_t *hsa_aql_queue_packet(hsa_aql_queue_t *q, uint64_t const idx)
+{
+	return &q->packets[idx & q->mask];
+}
+
+void hsa_aql_queue_publish(hsa_aql_queue_t *q, uint64_t const idx, uint16_t const header,
+		uint16_t const setup)
+{
+	uint64_t d;
+	// header and setup share the first 32bit word: one store validates the packet
+	__atomic_store_n((uint32_t *)&q->packets[idx & q->mask], header | (uint32_t)setup << 16,
+			__ATOMIC_RELEASE);
+	__atomic_store_n(&q->published[idx & q->mask], idx, __ATOMIC_SEQ_CST);
+
+	/* Advance the doorbell over all contiguously published slots. Any
+	 * producer may move it on behalf of the others: if the owner of slot d
+	 * sees the doorbell still short of d, the producer that moves the
+	 * doorbell onto d is guaranteed to see slot d published (all accesses
+	 * are sequentially consistent), so no slot is left behind. */
+	d = __atomic_load_n(q->doorbell, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&q->published[d & q->mask], __ATOMIC_SEQ_CST) == d) {
+		if (__atomic_compare_exchange_n(q->doorbell, &d, d + 1, 0, __ATOMIC_SEQ_CST,
+				__ATOMIC_SEQ_CST))
+			++d;
+	}
+}
+
+hsa_aql_res_t hsa_aql_signal_acquire(hsa_aql_queue_t *q, hsa_aql_signal_t *s)
+{
+	uint64_t f = __atomic_load_n(&q->free_signals, __ATOMIC_ACQUIRE);
+	int bit;
+	do {
+		if (! f) return HSA_AQL_ERR_NO_SIGNALS;
+		bit = __builtin_ctzll(f);
+	} while (! __atomic_compare_exchange_n(&q->free_signals, &f, f & ~(1ULL << bit), 1,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+	s->idx = bit;
+	s->value = &q->signals[q->pool[bit]];
+	s->handle.handle = q->signals_dev + q->pool[bit] * sizeof(uint64_t);
+	return HSA_AQL_SUCCESS;
+}
+
+void hsa_aql_signal_release(hsa_aql_queue_t *q, hsa_aql_signal_t const *s)
+{
+	__atomic_fetch_or(&q->free_signals, 1ULL << s->idx, __ATOMIC_RELEASE);
+}
+
+void hsa_aql_signal_store(hsa_aql_signal_t const *s, uint64_t const value)
+{
+	__atomic_store_n(s->value, value, __ATOMIC_RELEASE);
+}
+
+uint64_t hsa_aql_signal_load(hsa_aql_signal_t const *s)
+{
+	return __atomic_load_n(s->value, __ATOMIC_ACQUIRE);
+}
+
+hsa_aql_res_t hsa_aql_signal_wait(hsa_aql_signal_t const *s, uint64_t const timeout_ns)
+{
+	unsigned long delay = HSA_AQL_BACKOFF_MIN_NS;
+	uint64_t deadline;
+	for (int i = 0; i < HSA_AQL_SPIN_ITERATIONS; ++i) {
+		if (! __atomic_load_n(s->value, __ATOMIC_ACQUIRE)) return HSA_AQL_SUCCESS;
+		cpu_relax();
+	}
+	// signals are decremented by the interrupt handler, there is nothing
+	// to block on in the kernel: back off to sleeping instead
+	deadline = timeout_ns ? now_ns() + timeout_ns : 0;
+	while (__atomic_load_n(s->value, __ATOMIC_ACQUIRE)) {
+		if (deadline && now_ns() >= deadline) return HSA_AQL_ERR_TIMEOUT;
+		backoff(&delay);
+	}
+	return HSA_AQL_SUCCESS;
+}
@@ -0,0 +1,199 @@
+//
+// Copyright (C) 2018 Jaco A. Hofmann, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	hsa_aql_queue_test.c
+//! @brief	Unit test for the HSA AQL queue runtime against an in-memory
+//!		stand-in of the queue: a model of the packet processor walks
+//!		the queue from its read index up to the doorbell, checks that
+//!		every packet it fetches is valid and decrements the packet's
+//!		completion signal.
+//!
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <hsa_aql_queue.h>
+
+#define QUEUE_LENGTH	16
+#define NUM_SIGNALS	8
+#define START_INDEX	5
+#define PRODUCERS	6
+#define PACKETS		2000
+#define TOTAL		(PRODUCERS * PACKETS)
+
+/* in-memory stand-in of the queue */
+static hsa_kernel_dispatch_packet_t packets[QUEUE_LENGTH];
+static uint64_t read_index;
+static uint64_t signals[NUM_SIGNALS];
+
+/* model state */
+static unsigned char seen[TOTAL];
+static unsigned long invalid, duplicate;
+static int stop;
+
+static hsa_aql_queue_t *stand_in(void)
+{
+	hsa_aql_queue_mem_t const mem = {
+		.packets     = packets,
+		.length      = QUEUE_LENGTH,
+		.read_index  = &read_index,
+		.signals     = signals,
+		.num_signals = NUM_SIGNALS,
+		.signals_dev = (uintptr_t)signals,
+		.write_index = START_INDEX,
+	};
+	hsa_aql_queue_t *q;
+	for (int i = 0; i < QUEUE_LENGTH; ++i) packets[i].header = HSA_PACKET_TYPE_INVALID;
+	read_index = START_INDEX;
+	memset(signals, 0, sizeof(signals));
+	assert(hsa_aql_queue_attach(&mem, &q) == HSA_AQL_SUCCESS);
+	return q;
+}
+
+/* processes all packets up to the doorbell, returns number processed */
+static unsigned model_run(void)
+{
+	uint64_t const d = __atomic_load_n(&signals[0], __ATOMIC_ACQUIRE);
+	uint64_t ri = read_index;
+	unsigned n = 0;
+	for (; ri < d; ++ri, ++n) {
+		hsa_kernel_dispatch_packet_t *p = &packets[ri % QUEUE_LENGTH];
+		uint16_t const h = __atomic_load_n(&p->header, __ATOMIC_ACQUIRE);
+		if ((h & 0xff) != HSA_PACKET_TYPE_KERNEL_DISPATCH) {
+			++invalid;
+		} else {
+			uint64_t const id = p->kernel_object;
+			uint64_t const s = (p->completion_signal.handle - (uintptr_t)signals) / sizeof(uint64_t);
+			if (id >= TOTAL || seen[id]++) ++duplicate;
+			assert(s > 0 && s < NUM_SIGNALS);
+			__atomic_fetch_sub(&signals[s], 1, __ATOMIC_RELEASE);
+		}
+		__atomic_store_n(&p->header, HSA_PACKET_TYPE_INVALID, __ATOMIC_RELAXED);
+		__atomic_store_n(&read_index, ri + 1, __ATOMIC_RELEASE);
+	}
+	return n;
+}
+
+static void *model_thread(void *p)
+{
+	while (! __atomic_load_n(&stop, __ATOMIC_ACQUIRE) || read_index < START_INDEX + TOTAL)
+		model_run();
+	return NULL;
+}
+
+static void submit(hsa_aql_queue_t *q, uint64_t const idx, uint64_t const id, hsa_aql_signal_t const *s)
+{
+	hsa_kernel_dispatch_packet_t *p = hsa_aql_queue_packet(q, idx);
+	p->kernel_object = id;
+	p->completion_signal = s->handle;
+	hsa_aql_queue_publish(q, idx, hsa_aql_header(HSA_PACKET_TYPE_KERNEL_DISPATCH), 0);
+}
+
+/* doorbell never covers a reserved, but unpublished slot */
+static int test_out_of_order_publish(void)
+{
+	hsa_aql_queue_t *q = stand_in();
+	hsa_aql_signal_t s;
+	uint64_t a, b, c;
+	memset(seen, 0, sizeof(seen));
+	assert(hsa_aql_signal_acquire(q, &s) == HSA_AQL_SUCCESS);
+	hsa_aql_signal_store(&s, 3);
+	a = hsa_aql_queue_reserve(q);
+	b = hsa_aql_queue_reserve(q);
+	c = hsa_aql_queue_reserve(q);
+	assert(a == START_INDEX && b == a + 1 && c == b + 1);
+	submit(q, c, 2, &s);
+	submit(q, b, 1, &s);
+	assert(signals[0] == a);
+	assert(model_run() == 0);
+	submit(q, a, 0, &s);
+	assert(signals[0] == c + 1);
+	assert(model_run() == 3);
+	assert(hsa_aql_signal_wait(&s, 0) == HSA_AQL_SUCCESS);
+	assert(! invalid && ! duplicate);
+	hsa_aql_signal_release(q, &s);
+	hsa_aql_queue_close(q);
+	return 0;
+}
+
+/* pool hands out every signal once and takes them back */
+static int test_signal_pool(void)
+{
+	hsa_aql_queue_t *q = stand_in();
+	hsa_aql_signal_t s[NUM_SIGNALS];
+	for (int i = 0; i < NUM_SIGNALS - 1; ++i) {
+		assert(hsa_aql_signal_acquire(q, &s[i]) == HSA_AQL_SUCCESS);
+		assert(s[i].value != &signals[0]);
+		for (int j = 0; j < i; ++j) assert(s[i].value != s[j].value);
+	}
+	assert(hsa_aql_signal_acquire(q, &s[NUM_SIGNALS - 1]) == HSA_AQL_ERR_NO_SIGNALS);
+	hsa_aql_signal_release(q, &s[3]);
+	assert(hsa_aql_signal_acquire(q, &s[NUM_SIGNALS - 1]) == HSA_AQL_SUCCESS);
+	assert(s[NUM_SIGNALS - 1].value == s[3].value);
+	hsa_aql_signal_store(&s[0], 1);
+	assert(hsa_aql_signal_wait(&s[0], 1000000) == HSA_AQL_ERR_TIMEOUT);
+	hsa_aql_queue_close(q);
+	return 0;
+}
+
+static void *producer(void *p)
+{
+	hsa_aql_queue_t *q = (hsa_aql_queue_t *)p;
+	static uint64_t next_id;
+	hsa_aql_signal_t s;
+	assert(hsa_aql_signal_acquire(q, &s) == HSA_AQL_SUCCESS);
+	for (int i = 0; i < PACKETS; ++i) {
+		hsa_aql_signal_store(&s, 1);
+		submit(q, hsa_aql_queue_reserve(q), __atomic_fetch_add(&next_id, 1, __ATOMIC_RELAXED), &s);
+		assert(hsa_aql_signal_wait(&s, 1000000000UL) == HSA_AQL_SUCCESS);
+	}
+	hsa_aql_signal_release(q, &s);
+	return NULL;
+}
+
+/* concurrent producers on a small queue: every packet is seen exactly once */
+static int test_multi_producer(void)
+{
+	hsa_aql_queue_t *q = stand_in();
+	pthread_t m, t[PRODUCERS];
+	memset(seen, 0, sizeof(seen));
+	invalid = duplicate = 0;
+	stop = 0;
+	pthread_create(&m, NULL, model_thread, NULL);
+	for (int i = 0; i < PRODUCERS; ++i) pthread_create(&t[i], NULL, producer, q);
+	for (int i = 0; i < PRODUCERS; ++i) pthread_join(t[i], NULL);
+	__atomic_store_n(&stop, 1, __ATOMIC_RELEASE);
+	pthread_join(m, NULL);
+	assert(! invalid && ! duplicate);
+	assert(signals[0] == START_INDEX + TOTAL);
+	for (int i = 0; i < TOTAL; ++i) assert(seen[i] == 1);
+	hsa_aql_queue_close(q);
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int r = 0;
+	assert(hsa_aql_header(HSA_PACKET_TYPE_KERNEL_DISPATCH) == 0x1402);
+	assert(! strcmp(hsa_aql_strerror(HSA_AQL_ERR_TIMEOUT), "timeout while waiting for signal"));
+	r |= test_out_of_order_publish();
+	r |= test_signal_pool();
+	r |= test_multi_producer();
+	printf("hsa_aql_queue_test: %s\n", r ? "FAILED" : "OK");
+	return r;
+}
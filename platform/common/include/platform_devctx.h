@@ -31,6 +31,8 @@
 
 typedef struct platform_addr_map platform_addr_map_t;
 typedef struct platform_signaling platform_signaling_t;
+typedef struct platform_staging platform_staging_t;
+typedef struct platform_mapping platform_mapping_t;
 
 struct platform_devctx {
 	platform_dev_id_t			dev_id;
@@ -40,6 +42,8 @@ struct platform_devctx {
 	platform_info_t 			info;
 	platform_addr_map_t 			*addrmap;
 	platform_signaling_t 			*signaling;
+	platform_staging_t			*staging;
+	platform_mapping_t			*mappings;
 	platform_device_operations_t		dops;
 	struct platform				platform;
 	void					*private_data;
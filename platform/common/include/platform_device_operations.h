@@ -23,6 +23,14 @@ typedef struct platform_device_operations {
 			size_t const length,
 			void const *data,
 			platform_mem_flags_t const flags);
+	platform_res_t (*read_mem_v)(platform_devctx_t const *devctx,
+			platform_mem_seg_t const *segs,
+			size_t const num_segs,
+			platform_mem_flags_t const flags);
+	platform_res_t (*write_mem_v)(platform_devctx_t const *devctx,
+			platform_mem_seg_t const *segs,
+			size_t const num_segs,
+			platform_mem_flags_t const flags);
 	platform_res_t (*read_ctl)(platform_devctx_t const *devctx,
 			platform_ctl_addr_t const addr,
 			size_t const length,
@@ -58,6 +66,16 @@ platform_res_t default_write_mem(platform_devctx_t const *devctx,
 		void const *data,
 		platform_mem_flags_t const flags);
 
+platform_res_t default_read_mem_v(platform_devctx_t const *devctx,
+		platform_mem_seg_t const *segs,
+		size_t const num_segs,
+		platform_mem_flags_t const flags);
+
+platform_res_t default_write_mem_v(platform_devctx_t const *devctx,
+		platform_mem_seg_t const *segs,
+		size_t const num_segs,
+		platform_mem_flags_t const flags);
+
 platform_res_t default_read_ctl(platform_devctx_t const *devctx,
 		platform_ctl_addr_t const addr,
 		size_t const length,
@@ -77,6 +95,8 @@ void default_dops(platform_device_operations_t *dops)
 	dops->dealloc   = default_dealloc;
 	dops->read_mem  = default_read_mem;
 	dops->write_mem = default_write_mem;
+	dops->read_mem_v  = default_read_mem_v;
+	dops->write_mem_v = default_write_mem_v;
 	dops->read_ctl  = default_read_ctl;
 	dops->write_ctl = default_write_ctl;
 }
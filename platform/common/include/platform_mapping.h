@@ -0,0 +1,25 @@
+#ifndef PLATFORM_MAPPING_H__
+#define PLATFORM_MAPPING_H__
+
+#include <platform_types.h>
+
+typedef struct platform_mapping platform_mapping_t;
+
+platform_res_t platform_mapping_init(platform_devctx_t const *pctx, platform_mapping_t **m);
+void platform_mapping_deinit(platform_mapping_t *m);
+
+/**
+ * Checks whether [data, data + len) is the user space mapping of device
+ * memory [addr, addr + len), i.e., a copy between both would be a no-op.
+ * @param m mapping registry
+ * @param data start address in user space
+ * @param addr start address in device memory
+ * @param len length in bytes
+ * @param base start address of the mapped buffer (out, may be NULL)
+ * @param cacheable set to 1, if the mapping is cacheable (out, may be NULL)
+ * @return 1 if data is the mapping of addr, 0 otherwise.
+ **/
+int platform_mapping_is_mapped(platform_mapping_t *m, void const *data, platform_mem_addr_t const addr,
+		size_t const len, platform_mem_addr_t *base, int *cacheable);
+
+#endif /* PLATFORM_MAPPING_H__ */
@@ -36,7 +36,19 @@
 	_PC(waiting_for_slot) \
 	_PC(slot_interrupts_active) \
 	_PC(sem_wait_error) \
-	_PC(sem_post_error)
+	_PC(sem_post_error) \
+	_PC(futex_wakeups)
+
+#ifdef _PH
+	#undef _PH
+#endif
+
+/* histograms with log2-sized buckets, one per collector thread */
+#define PLATFORM_PERFC_HISTOGRAMS \
+	_PH(collector_latency_ns) \
+	_PH(collector_batch_sz)
+
+#define PLATFORM_PERFC_HISTOGRAM_BUCKETS		32
 
 #ifndef NPERFC
 	const char *platform_perfc_tostring(platform_dev_id_t const dev_id);
@@ -48,6 +60,13 @@
 
 	PLATFORM_PERFC_COUNTERS
 	#undef _PC
+
+	#define _PH(name) \
+	void platform_perfc_ ## name ## _record(platform_dev_id_t dev_id, size_t const idx, unsigned long const v); \
+	long platform_perfc_ ## name ## _get(platform_dev_id_t dev_id, size_t const idx, size_t const bucket);
+
+	PLATFORM_PERFC_HISTOGRAMS
+	#undef _PH
 #else /* NPERFC */
 	static inline
 	const char *platform_perfc_tostring(platform_dev_id_t const dev_id) { return ""; }
@@ -59,5 +78,12 @@
 
 	PLATFORM_PERFC_COUNTERS
 	#undef _PC
+
+	#define _PH(name) \
+	inline static void platform_perfc_ ## name ## _record(platform_dev_id_t dev_id, size_t const idx, unsigned long const v) {} \
+	inline static long platform_perfc_ ## name ## _get(platform_dev_id_t dev_id, size_t const idx, size_t const bucket) { return 0; }
+
+	PLATFORM_PERFC_HISTOGRAMS
+	#undef _PH
 #endif /* NPERFC */
 #endif /* PLATFORM_PERFC_H__ */
@@ -4,6 +4,7 @@
 #include <platform_types.h>
 
 typedef struct platform_signaling platform_signaling_t;
+/** Callback for each batch of completions; may run concurrently on several collectors. **/
 typedef void (*platform_signal_received_f)(size_t num, platform_slot_id_t *slots);
 
 platform_res_t platform_signaling_init(platform_devctx_t const *pctx, platform_signaling_t **a);
@@ -12,6 +13,11 @@ void platform_signaling_deinit(platform_signaling_t *a);
 platform_res_t platform_signaling_wait_for_slot(platform_signaling_t *a, platform_slot_id_t const slot);
 platform_res_t platform_wait_for_slot(platform_devctx_t *ctx, platform_slot_id_t const slot);
 
+platform_res_t platform_signaling_completion_fd(platform_signaling_t *a, int *fd);
+void platform_signaling_arm_slot(platform_signaling_t *a, platform_slot_id_t const slot);
+void platform_signaling_disarm_slot(platform_signaling_t *a, platform_slot_id_t const slot);
+size_t platform_signaling_poll_slots(platform_signaling_t *a, platform_slot_id_t *slots, size_t const max);
+
 void platform_signaling_signal_received(platform_signaling_t *s, platform_signal_received_f callback);
 
 #endif /* PLATFORM_ASYNC_H__ */
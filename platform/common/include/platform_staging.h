@@ -0,0 +1,21 @@
+#ifndef PLATFORM_STAGING_H__
+#define PLATFORM_STAGING_H__
+
+#include <platform_types.h>
+
+typedef struct platform_staging platform_staging_t;
+
+platform_res_t platform_staging_init(platform_devctx_t const *pctx, platform_staging_t **s);
+void platform_staging_deinit(platform_staging_t *s);
+
+/**
+ * Looks up the staging buffer containing [data, data + len).
+ * @param s staging buffer pool
+ * @param data start address in user space
+ * @param len length in bytes
+ * @param offset offset of data within the buffer (out param)
+ * @return index of the buffer, or -1 if data is not in a staging buffer.
+ **/
+ssize_t platform_staging_find(platform_staging_t const *s, void const *data, size_t const len, size_t *offset);
+
+#endif /* PLATFORM_STAGING_H__ */
@@ -9,6 +9,7 @@
 #include <platform_devfiles.h>
 #include <platform_devctx.h>
 #include <platform_logging.h>
+#include <platform_sim.h>
 
 struct platform_ctx {
 	int				fd_tlkm;
@@ -65,6 +66,12 @@ static
 platform_res_t init_platform(platform_ctx_t *ctx)
 {
 	platform_res_t r = PLATFORM_SUCCESS;
+	if (sim_enabled()) {
+		LOG(LPLL_TLKM, "using simulated devices, TLKM is not required");
+		ctx->fd_tlkm = -1;
+		strncpy(ctx->version, SIM_CLASS_NAME, sizeof(ctx->version) - 1);
+		return sim_enum_devices(ctx->devs, &ctx->num_devs);
+	}
 	ctx->fd_tlkm = open(TLKM_CONTROL_FN, O_RDWR);
 	if (ctx->fd_tlkm == -1) {
 		ERR("could not open " TLKM_CONTROL_FN ": %s (%d)", strerror(errno), errno);
@@ -99,7 +106,7 @@ err_tlkm:
 static
 void deinit_platform(platform_ctx_t *ctx)
 {
-	close(ctx->fd_tlkm);
+	if (ctx->fd_tlkm >= 0) close(ctx->fd_tlkm);
 	LOG(LPLL_INIT, "platform deinited");
 }
 
@@ -167,12 +174,11 @@ platform_res_t platform_create_device(platform_ctx_t *ctx,
 	platform_res_t res = PLATFORM_SUCCESS;
 	assert(ctx);
 	assert(dev_id < PLATFORM_MAX_DEVS);
-	assert(ctx->fd_tlkm > 0);
 	struct tlkm_ioctl_device_cmd c = {
 		.dev_id = dev_id,
 		.access = mode,
 	};
-	if ((r = ioctl(ctx->fd_tlkm, TLKM_IOCTL_CREATE_DEVICE, &c))) {
+	if (ctx->fd_tlkm >= 0 && (r = ioctl(ctx->fd_tlkm, TLKM_IOCTL_CREATE_DEVICE, &c))) {
 		ERR("could not create device #" PRIdev ": %s (%d)", dev_id, strerror(errno), errno);
 		return PERR_TLKM_ERROR;
 	}
@@ -201,11 +207,10 @@ void platform_destroy_device_by_id(platform_ctx_t *ctx, platform_dev_id_t const
 	};
 	int r = 0;
 	assert(ctx);
-	assert(ctx->fd_tlkm > 0);
 	assert(dev_id < PLATFORM_MAX_DEVS);
 	platform_devctx_deinit(ctx->devctx[dev_id]);
 	ctx->devctx[dev_id] = NULL;
-	if ((r = ioctl(ctx->fd_tlkm, TLKM_IOCTL_DESTROY_DEVICE, &c))) {
+	if (ctx->fd_tlkm >= 0 && (r = ioctl(ctx->fd_tlkm, TLKM_IOCTL_DESTROY_DEVICE, &c))) {
 		ERR("could not destroy device #" PRIdev ": %s (%d)", dev_id, strerror(errno), errno);
 	} else {
 		LOG(LPLL_DEVICE, "device #" PRIdev " destroyed", dev_id);
@@ -13,9 +13,12 @@
 #include <platform_devfiles.h>
 #include <platform_addr_map.h>
 #include <platform_signaling.h>
+#include <platform_staging.h>
+#include <platform_mapping.h>
 #include <platform_device_operations.h>
 #include <platform_zynq.h>
 #include <platform_pcie.h>
+#include <platform_sim.h>
 #include <platform_perfc.h>
 #include <zynq/zynq.h>
 #include <pcie/pcie.h>
@@ -27,6 +30,8 @@ platform_res_t platform_specific_init(platform_devctx_t *devctx)
 		return pcie_init(devctx);
 	} else if (! strncmp(ZYNQ_CLASS_NAME, devctx->dev_info.name, TLKM_DEVNAME_SZ)) {
 		return zynq_init(devctx);
+	} else if (! strncmp(SIM_CLASS_NAME, devctx->dev_info.name, TLKM_DEVNAME_SZ)) {
+		return sim_init(devctx);
 	} else {
 		DEVERR(devctx->dev_id, "unknown device type: '%s'", devctx->dev_info.name);
 		return PERR_UNKNOWN_DEVICE;
@@ -40,6 +45,8 @@ void platform_specific_deinit(platform_devctx_t *devctx)
 		pcie_deinit(devctx);
 	} else if (! strncmp(ZYNQ_CLASS_NAME, devctx->dev_info.name, TLKM_DEVNAME_SZ)) {
 		zynq_deinit(devctx);
+	} else if (! strncmp(SIM_CLASS_NAME, devctx->dev_info.name, TLKM_DEVNAME_SZ)) {
+		sim_deinit(devctx);
 	}
 }
 
@@ -59,7 +66,7 @@ void log_perfc(platform_devctx_t *devctx)
 	}
 	platform_perfc_slot_interrupts_active_set(devctx->dev_id, slots_active);
 #ifndef NPERFC
-	fprintf(stderr, "platform device #" PRIdev_id " performance counters:\n%s",
+	fprintf(stderr, "platform device #" PRIdev " performance counters:\n%s",
 			devctx->dev_id, platform_perfc_tostring(devctx->dev_id));
 	#define BUFSZ (1 << 12)
 	char *fn = perfc_file(devctx->dev_id);
@@ -85,6 +92,7 @@ platform_res_t platform_devctx_init(platform_ctx_t *ctx,
 {
 	platform_res_t res = PLATFORM_SUCCESS;
 	char *fn = control_file(dev_id);
+	int is_sim;
 	assert(ctx);
 	assert(pdctx);
 	assert(fn);
@@ -108,8 +116,10 @@ platform_res_t platform_devctx_init(platform_ctx_t *ctx,
 	}
 	DEVLOG(dev_id, LPLL_DEVICE, "device: %s", devctx->dev_info.name);
 
-	devctx->fd_ctrl = open(fn, O_RDWR);
-	if (devctx->fd_ctrl == -1) {
+	// simulated devices have no device file, sim_init provides fd_ctrl
+	is_sim = ! strncmp(SIM_CLASS_NAME, devctx->dev_info.name, TLKM_DEVNAME_SZ);
+	devctx->fd_ctrl = is_sim ? -1 : open(fn, O_RDWR);
+	if (! is_sim && devctx->fd_ctrl == -1) {
 		DEVERR(dev_id, "could not open %s: %s (%d)", fn, strerror(errno), errno);
 		free(fn);
 		res = PERR_OPEN_DEV;
@@ -141,10 +151,26 @@ platform_res_t platform_devctx_init(platform_ctx_t *ctx,
 	}
 	DEVLOG(dev_id, LPLL_INIT, "initialized device signaling");
 
+	res = platform_staging_init(devctx, &devctx->staging);
+	if (res != PLATFORM_SUCCESS) {
+		DEVERR(dev_id, "could not initialize staging buffers: %s (" PRIres ")", platform_strerror(res), res);
+		goto err_staging;
+	}
+
+	res = platform_mapping_init(devctx, &devctx->mappings);
+	if (res != PLATFORM_SUCCESS) {
+		DEVERR(dev_id, "could not initialize device memory mappings: %s (" PRIres ")", platform_strerror(res), res);
+		goto err_mapping;
+	}
+
 	if (pdctx) *pdctx = devctx;
 	DEVLOG(dev_id, LPLL_INIT, "context initialization finished");
 	return PLATFORM_SUCCESS;
 
+	platform_mapping_deinit(devctx->mappings);
+err_mapping:
+	platform_staging_deinit(devctx->staging);
+err_staging:
 	platform_signaling_deinit(devctx->signaling);
 err_signaling:
 	platform_addr_map_deinit(devctx, devctx->addrmap);
@@ -152,7 +178,7 @@ err_addr_map:
 err_info:
 	platform_specific_deinit(devctx);
 err_spec:
-	close(devctx->fd_ctrl);
+	if (devctx->fd_ctrl != -1) close(devctx->fd_ctrl);
 	return res;
 }
 
@@ -160,9 +186,14 @@ void platform_devctx_deinit(platform_devctx_t *devctx)
 {
 	if (devctx) {
 		log_perfc(devctx);
-		platform_specific_deinit(devctx);
+		DEVLOG(devctx->dev_id, LPLL_INIT, "releasing device memory mappings ...");
+		platform_mapping_deinit(devctx->mappings);
+		DEVLOG(devctx->dev_id, LPLL_INIT, "releasing staging buffers ...");
+		platform_staging_deinit(devctx->staging);
+		// stop the collectors before the platform, it may own their fd
 		DEVLOG(devctx->dev_id, LPLL_INIT, "destroying platform signaling ...");
 		platform_signaling_deinit(devctx->signaling);
+		platform_specific_deinit(devctx);
 		DEVLOG(devctx->dev_id, LPLL_INIT, "destroying platform address map ...");
 		platform_addr_map_deinit(devctx, devctx->addrmap);
 		close(devctx->fd_ctrl);
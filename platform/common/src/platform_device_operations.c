@@ -1,10 +1,14 @@
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
+#include <platform.h>
 #include <platform_errors.h>
 #include <platform_logging.h>
 #include <tlkm_device_ioctl_cmds.h>
 #include <platform_device_operations.h>
 #include <platform_devctx.h>
+#include <platform_staging.h>
+#include <platform_mapping.h>
 
 platform_res_t default_alloc(platform_devctx_t *devctx,
 		size_t const len,
@@ -12,7 +16,11 @@ platform_res_t default_alloc(platform_devctx_t *devctx,
 		platform_alloc_flags_t const flags)
 {
 	DEVLOG(devctx->dev_id, LPLL_MM, "allocating %zu bytes with flags " PRIflags, len, (CSTflags) flags);
-	struct tlkm_mm_cmd cmd = { .sz = len, .dev_addr = -1, };
+	struct tlkm_mm_cmd cmd = {
+		.sz       = len,
+		.dev_addr = -1,
+		.flags    = flags & PLATFORM_ALLOC_FLAGS_CACHEABLE ? TLKM_MM_FLAGS_CACHEABLE : 0,
+	};
 	long ret = ioctl(devctx->fd_ctrl, TLKM_DEV_IOCTL_ALLOC, &cmd);
 	if (ret) {
 		DEVERR(devctx->dev_id, "error allocating device memory: %s (%d)", strerror(errno), errno);
@@ -43,6 +51,15 @@ platform_res_t default_read_mem(platform_devctx_t const *devctx,
 		platform_mem_flags_t const flags)
 {
 	DEVLOG(devctx->dev_id, LPLL_MM, "reading from device at " PRImem " with flags " PRIflags, addr, (CSTflags) flags);
+	platform_mem_addr_t base;
+	int cacheable;
+	if (platform_mapping_is_mapped(devctx->mappings, data, addr, length, &base, &cacheable)) {
+		// data is the device memory, only order against preceding device accesses
+		if (cacheable)
+			return platform_sync_mem(devctx, base, addr - base, length, PLATFORM_SYNC_FOR_CPU);
+		__sync_synchronize();
+		return PLATFORM_SUCCESS;
+	}
 	struct tlkm_copy_cmd cmd = { .length = length, .dev_addr = addr, .user_addr = data };
 	long ret = ioctl(devctx->fd_ctrl, TLKM_DEV_IOCTL_COPYFROM, &cmd);
 	if (ret) {
@@ -59,6 +76,29 @@ platform_res_t default_write_mem(platform_devctx_t const *devctx,
 		platform_mem_flags_t const flags)
 {
 	DEVLOG(devctx->dev_id, LPLL_MM, "writing to device at " PRImem " with flags " PRIflags, addr, (CSTflags)flags);
+	platform_mem_addr_t base;
+	int cacheable;
+	if (platform_mapping_is_mapped(devctx->mappings, data, addr, length, &base, &cacheable)) {
+		// data is the device memory, only make writes visible before the PE starts
+		if (cacheable)
+			return platform_sync_mem(devctx, base, addr - base, length, PLATFORM_SYNC_FOR_DEVICE);
+		__sync_synchronize();
+		return PLATFORM_SUCCESS;
+	}
+	size_t offset = 0;
+	ssize_t const buf_idx = platform_staging_find(devctx->staging, data, length, &offset);
+	if (buf_idx >= 0) {
+		struct tlkm_staged_copy_cmd scmd = {
+			.buf_idx  = buf_idx,
+			.offset   = offset,
+			.length   = length,
+			.dev_addr = addr,
+		};
+		// data is already in DMA-able memory, no copy through the kernel
+		if (! ioctl(devctx->fd_ctrl, TLKM_DEV_IOCTL_COPYTO_STAGED, &scmd))
+			return PLATFORM_SUCCESS;
+		DEVWRN(devctx->dev_id, "staged write failed, falling back to copy: %s (%d)", strerror(errno), errno);
+	}
 	struct tlkm_copy_cmd cmd = { .length = length, .dev_addr = addr, .user_addr = (void *)data };
 	long ret = ioctl(devctx->fd_ctrl, TLKM_DEV_IOCTL_COPYTO, &cmd);
 	if (ret) {
@@ -68,6 +108,99 @@ platform_res_t default_write_mem(platform_devctx_t const *devctx,
 	return PLATFORM_SUCCESS;
 }
 
+/** Issues a vectored copy ioctl for the n commands in cmds, if any. **/
+static
+platform_res_t copy_v(platform_devctx_t const *devctx,
+		unsigned long const ioctl_cmd,
+		struct tlkm_copy_cmd *cmds,
+		size_t const n)
+{
+	struct tlkm_copy_v_cmd vcmd = { .num_segs = n, .segs = cmds, };
+	if (! n) return PLATFORM_SUCCESS;
+	DEVLOG(devctx->dev_id, LPLL_MM, "vectored copy of %zu segments", n);
+	if (ioctl(devctx->fd_ctrl, ioctl_cmd, &vcmd)) {
+		DEVERR(devctx->dev_id, "error in vectored copy of %zu segments: %s (%d)",
+				n, strerror(errno), errno);
+		return PERR_TLKM_ERROR;
+	}
+	return PLATFORM_SUCCESS;
+}
+
+platform_res_t default_read_mem_v(platform_devctx_t const *devctx,
+		platform_mem_seg_t const *segs,
+		size_t const num_segs,
+		platform_mem_flags_t const flags)
+{
+	platform_res_t r = PLATFORM_SUCCESS;
+	platform_mem_addr_t base;
+	int cacheable;
+	size_t n = 0;
+	struct tlkm_copy_cmd *cmds;
+	if (! num_segs) return PLATFORM_SUCCESS;
+	cmds = malloc(sizeof(*cmds) *
+			(num_segs < TLKM_COPY_V_MAX_SEGS ? num_segs : TLKM_COPY_V_MAX_SEGS));
+	if (! cmds) return PERR_OUT_OF_MEMORY;
+	for (size_t i = 0; i < num_segs && r == PLATFORM_SUCCESS; ++i) {
+		// mapped segments need no copy, only the sync of default_read_mem;
+		// pending segments go first, they may overlap this one
+		if (platform_mapping_is_mapped(devctx->mappings, segs[i].data, segs[i].addr,
+				segs[i].len, &base, &cacheable)) {
+			if ((r = copy_v(devctx, TLKM_DEV_IOCTL_COPYFROM_V, cmds, n)) == PLATFORM_SUCCESS)
+				r = default_read_mem(devctx, segs[i].addr, segs[i].len, segs[i].data, flags);
+			n = 0;
+			continue;
+		}
+		cmds[n].length    = segs[i].len;
+		cmds[n].user_addr = segs[i].data;
+		cmds[n].dev_addr  = segs[i].addr;
+		if (++n == TLKM_COPY_V_MAX_SEGS) {
+			r = copy_v(devctx, TLKM_DEV_IOCTL_COPYFROM_V, cmds, n);
+			n = 0;
+		}
+	}
+	if (r == PLATFORM_SUCCESS) r = copy_v(devctx, TLKM_DEV_IOCTL_COPYFROM_V, cmds, n);
+	free(cmds);
+	return r;
+}
+
+platform_res_t default_write_mem_v(platform_devctx_t const *devctx,
+		platform_mem_seg_t const *segs,
+		size_t const num_segs,
+		platform_mem_flags_t const flags)
+{
+	platform_res_t r = PLATFORM_SUCCESS;
+	platform_mem_addr_t base;
+	int cacheable;
+	size_t offset, n = 0;
+	struct tlkm_copy_cmd *cmds;
+	if (! num_segs) return PLATFORM_SUCCESS;
+	cmds = malloc(sizeof(*cmds) *
+			(num_segs < TLKM_COPY_V_MAX_SEGS ? num_segs : TLKM_COPY_V_MAX_SEGS));
+	if (! cmds) return PERR_OUT_OF_MEMORY;
+	for (size_t i = 0; i < num_segs && r == PLATFORM_SUCCESS; ++i) {
+		// mapped and staged segments take the zero-copy paths of
+		// default_write_mem; pending segments go first, they may overlap
+		if (platform_mapping_is_mapped(devctx->mappings, segs[i].data, segs[i].addr,
+				segs[i].len, &base, &cacheable) ||
+				platform_staging_find(devctx->staging, segs[i].data, segs[i].len, &offset) >= 0) {
+			if ((r = copy_v(devctx, TLKM_DEV_IOCTL_COPYTO_V, cmds, n)) == PLATFORM_SUCCESS)
+				r = default_write_mem(devctx, segs[i].addr, segs[i].len, segs[i].data, flags);
+			n = 0;
+			continue;
+		}
+		cmds[n].length    = segs[i].len;
+		cmds[n].user_addr = segs[i].data;
+		cmds[n].dev_addr  = segs[i].addr;
+		if (++n == TLKM_COPY_V_MAX_SEGS) {
+			r = copy_v(devctx, TLKM_DEV_IOCTL_COPYTO_V, cmds, n);
+			n = 0;
+		}
+	}
+	if (r == PLATFORM_SUCCESS) r = copy_v(devctx, TLKM_DEV_IOCTL_COPYTO_V, cmds, n);
+	free(cmds);
+	return r;
+}
+
 platform_res_t default_read_ctl(platform_devctx_t const *devctx,
 		platform_ctl_addr_t const addr,
 		size_t const length,
@@ -16,8 +16,13 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
 //
+#define _GNU_SOURCE
 #include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <platform_info.h>
 #include <platform_caps.h>
 #include <platform_devctx.h>
@@ -54,81 +59,163 @@ typedef enum {
 #define REG_PLATFORM_BASE_START					0x1000
 #define	REG_ARCH_BASE_START \
 		(REG_PLATFORM_BASE_START + sizeof(uint64_t) * PLATFORM_NUM_SLOTS)
+/* status registers are read in one block, the slot tables in another */
+#define REG_HEADER_SZ						0x0028
+#define REG_SNAPSHOT_SZ \
+		(REG_ARCH_BASE_START + sizeof(uint64_t) * PLATFORM_NUM_SLOTS)
+
+#define INFO_CACHE_MAGIC					0x7ac0ca5e
+#define INFO_CACHE_FN						"%s/tapasco-info-%s-%02u-%08x"
 
 #define STRINGIFY(f)					#f
 
+struct info_cache_hdr {
+	uint32_t magic;
+	uint32_t size;
+};
+
 static platform_info_t _info[PLATFORM_MAX_DEVS];
 
 static
-platform_res_t read_info_from_status_core(platform_devctx_t const *p,
-		platform_info_t *info)
+void parse_header(platform_dev_id_t const dev_id, uint8_t const *buf, platform_info_t *info)
 {
-	platform_res_t r;
-	platform_dev_id_t dev_id = p->dev_id;
-	platform_ctl_addr_t status = p->platform.status.base;
 #ifdef _X
 	#undef _X
 #endif
 #define _X(_name, _val, _field) \
-	r = platform_read_ctl(p, status + _name, sizeof(info->_field), \
-			&(info->_field), PLATFORM_CTL_FLAGS_NONE); \
-	if (r != PLATFORM_SUCCESS) { \
-		DEVERR(dev_id, "could not read " STRINGIFY(_name) ": %s (" PRIres ")", platform_strerror(r), r); \
-		return r; \
-	} \
+	memcpy(&(info->_field), buf + _name, sizeof(info->_field)); \
 	DEVLOG(dev_id, LPLL_STATUS, "read " STRINGIFY(_name) ": %#08x", info->_field);
 	PLATFORM_STATUS_REGISTERS
 #undef _X
+}
+
+static
+void parse_slots(uint8_t const *buf, platform_info_t *info)
+{
 	for (platform_slot_id_t s = 0; s < PLATFORM_NUM_SLOTS; ++s) {
-		platform_ctl_addr_t const rk = status + REG_KERNEL_ID_START + s * REG_SLOT_OFFSET;
-		r = platform_read_ctl(p, rk, sizeof(uint32_t), &(info->composition.kernel[s]), 0);
-		if (r != PLATFORM_SUCCESS) {
-			DEVERR(dev_id, "could not read kernel id at slot " PRIslot ": %s (" PRIres ")",
-					s, platform_strerror(r), r);
-			return r;
-		}
-		platform_ctl_addr_t const rm = status + REG_LOCAL_MEM_START + s * REG_SLOT_OFFSET;
-		r = platform_read_ctl(p, rm, sizeof(info->composition.memory[s]),
-				&(info->composition.memory[s]), PLATFORM_CTL_FLAGS_NONE);
-		if (r != PLATFORM_SUCCESS) {
-			DEVERR(dev_id, "could not read memory at slot " PRIslot ": %s (" PRIres ")",
-					s, platform_strerror(r), r);
-			return r;
-		}
+		memcpy(&(info->composition.kernel[s]), buf + REG_KERNEL_ID_START + s * REG_SLOT_OFFSET,
+				sizeof(info->composition.kernel[s]));
+		memcpy(&(info->composition.memory[s]), buf + REG_LOCAL_MEM_START + s * REG_SLOT_OFFSET,
+				sizeof(info->composition.memory[s]));
+		memcpy(&(info->base.platform[s]), buf + REG_PLATFORM_BASE_START + s * sizeof(uint64_t),
+				sizeof(info->base.platform[s]));
+		memcpy(&(info->base.arch[s]), buf + REG_ARCH_BASE_START + s * sizeof(uint64_t),
+				sizeof(info->base.arch[s]));
+	}
+}
 
-		if (info->caps0 & PLATFORM_CAP0_DYNAMIC_ADDRESS_MAP) {
-			platform_ctl_addr_t const pb = status +
-					REG_PLATFORM_BASE_START +
-					s * sizeof(uint64_t);
-			r = platform_read_ctl(p, pb,
-					sizeof(info->base.platform[s]),
-					&(info->base.platform[s]),
-					PLATFORM_CTL_FLAGS_NONE);
-			if (r != PLATFORM_SUCCESS) {
-				DEVERR(dev_id, "could not read platform base " PRIslot ": %s (" PRIres ")",
-						s, platform_strerror(r), r);
-				return r;
-			} 
-
-			platform_ctl_addr_t const ab = status + REG_ARCH_BASE_START + s * sizeof(uint64_t);
-			r = platform_read_ctl(p, ab, sizeof(info->base.arch[s]), &(info->base.arch[s]), 0);
-			if (r != PLATFORM_SUCCESS) {
-				DEVERR(dev_id, "could not read platform base " PRIslot ": %s (" PRIres ")",
-						s, platform_strerror(r), r);
-				return r;
-			} 
-		} else {
-			DEVERR(dev_id, "loaded bitstream does not support dynamic address map - "
-			    "please use a libplatform version < 1.5 with this bitstream");
-			return PERR_INCOMPATIBLE_BITSTREAM;
-		}
-        if (info->version.tapasco < 0x7e20001) {
-			DEVERR(dev_id, "loaded bitstream is generated by Tapasco older than 2018.1 - "
-			    "please use a libplatform version < 1.5 with this bitstream");
-			return PERR_INCOMPATIBLE_BITSTREAM;
-        }
+/** Returns the name of the cache file for the device, or NULL if caching is disabled. **/
+static
+char *cache_file(platform_devctx_t const *p, uint32_t const compose_ts)
+{
+	char const *dir = getenv(PLATFORM_INFO_CACHE_ENV);
+	char *fn;
+	if (! dir) dir = getenv("XDG_RUNTIME_DIR");
+	if (! dir || ! *dir || ! strcmp(dir, "0")) return NULL;
+	if (asprintf(&fn, INFO_CACHE_FN, dir, p->dev_info.name, p->dev_id, compose_ts) < 0) return NULL;
+	return fn;
+}
+
+/** Fills in composition and bases from the cache, if it matches the status registers in info. **/
+static
+int load_cached_info(platform_devctx_t const *p, platform_info_t *info)
+{
+	struct info_cache_hdr hdr;
+	platform_info_t cached;
+	char *fn = cache_file(p, info->compose_ts);
+	FILE *fp = fn ? fopen(fn, "rb") : NULL;
+	int ok = fp &&
+			fread(&hdr, sizeof(hdr), 1, fp) == 1 &&
+			hdr.magic == INFO_CACHE_MAGIC && hdr.size == sizeof(cached) &&
+			fread(&cached, sizeof(cached), 1, fp) == 1;
+#ifdef _X
+	#undef _X
+#endif
+#define _X(_name, _val, _field) \
+	ok = ok && cached._field == info->_field;
+	PLATFORM_STATUS_REGISTERS
+#undef _X
+	if (fp) fclose(fp);
+	if (ok) {
+		memcpy(&info->composition, &cached.composition, sizeof(info->composition));
+		memcpy(&info->base, &cached.base, sizeof(info->base));
+		DEVLOG(p->dev_id, LPLL_STATUS, "loaded device info from %s", fn);
+	}
+	free(fn);
+	return ok;
+}
+
+/** Writes info to the cache; replaces the file atomically, so concurrent readers never see partial data. **/
+static
+void store_cached_info(platform_devctx_t const *p, platform_info_t const *info)
+{
+	struct info_cache_hdr const hdr = { .magic = INFO_CACHE_MAGIC, .size = sizeof(*info) };
+	char *fn = cache_file(p, info->compose_ts), *tmp = NULL;
+	FILE *fp = NULL;
+	int fd = -1;
+	if (! fn || asprintf(&tmp, "%s.XXXXXX", fn) < 0) goto out;
+	if ((fd = mkstemp(tmp)) < 0 || ! (fp = fdopen(fd, "wb"))) {
+		DEVWRN(p->dev_id, "could not create device info cache %s: %s (%d)", tmp, strerror(errno), errno);
+		if (fd >= 0) { close(fd); unlink(tmp); }
+		goto out;
+	}
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 || fwrite(info, sizeof(*info), 1, fp) != 1 ||
+			fclose(fp) || rename(tmp, fn)) {
+		DEVWRN(p->dev_id, "could not write device info cache %s: %s (%d)", fn, strerror(errno), errno);
+		unlink(tmp);
+	} else {
+		DEVLOG(p->dev_id, LPLL_STATUS, "cached device info in %s", fn);
+	}
+out:
+	free(tmp);
+	free(fn);
+}
+
+static
+platform_res_t read_info_from_status_core(platform_devctx_t const *p,
+		platform_info_t *info)
+{
+	platform_res_t r;
+	platform_dev_id_t dev_id = p->dev_id;
+	platform_ctl_addr_t status = p->platform.status.base;
+	uint8_t *buf = (uint8_t *)calloc(REG_SNAPSHOT_SZ, 1);
+	if (! buf) {
+		DEVERR(dev_id, "could not allocate status core snapshot");
+		return PERR_OUT_OF_MEMORY;
+	}
+	r = platform_read_ctl(p, status, REG_HEADER_SZ, buf, PLATFORM_CTL_FLAGS_NONE);
+	if (r != PLATFORM_SUCCESS) {
+		DEVERR(dev_id, "could not read status registers: %s (" PRIres ")", platform_strerror(r), r);
+		goto out;
 	}
-	return PLATFORM_SUCCESS;
+	parse_header(dev_id, buf, info);
+
+	if (! (info->caps0 & PLATFORM_CAP0_DYNAMIC_ADDRESS_MAP)) {
+		DEVERR(dev_id, "loaded bitstream does not support dynamic address map - "
+		    "please use a libplatform version < 1.5 with this bitstream");
+		r = PERR_INCOMPATIBLE_BITSTREAM;
+		goto out;
+	}
+	if (info->version.tapasco < 0x7e20001) {
+		DEVERR(dev_id, "loaded bitstream is generated by Tapasco older than 2018.1 - "
+		    "please use a libplatform version < 1.5 with this bitstream");
+		r = PERR_INCOMPATIBLE_BITSTREAM;
+		goto out;
+	}
+
+	if (load_cached_info(p, info)) goto out;
+
+	r = platform_read_ctl(p, status + REG_KERNEL_ID_START, REG_SNAPSHOT_SZ - REG_KERNEL_ID_START,
+			buf + REG_KERNEL_ID_START, PLATFORM_CTL_FLAGS_NONE);
+	if (r != PLATFORM_SUCCESS) {
+		DEVERR(dev_id, "could not read slot tables: %s (" PRIres ")", platform_strerror(r), r);
+		goto out;
+	}
+	parse_slots(buf, info);
+	store_cached_info(p, info);
+out:
+	free(buf);
+	return r;
 }
 
 inline
@@ -20,7 +20,45 @@
 //! @brief	Logging helper implementation. Initialization for debug output.
 //! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
 //!
+#include <stdlib.h>
 #include "platform_logging.h"
 
-int platform_logging_init(void) { return 1; }
-void platform_logging_deinit(void) {}
+unsigned long platform_logging_mask;
+
+static char const *const level_names[] = {
+#define _LPLL(name, level) #name,
+	LIBPLATFORM_LOGLEVELS
+#undef _LPLL
+};
+
+static unsigned long const level_bits[] = {
+#define _LPLL(name, level) level,
+	LIBPLATFORM_LOGLEVELS
+#undef _LPLL
+};
+
+static int is_initialized = 0;
+
+int platform_logging_init(void)
+{
+	if (! is_initialized) {
+		char const *lvl = getenv(LIBPLATFORM_LOGLEVEL_ENV);
+		is_initialized = 1;
+		// LIBPLATFORM_DEBUG is the name used by older documentation
+		if (! lvl) lvl = getenv("LIBPLATFORM_DEBUG");
+		platform_logging_mask = log_ring_parse_mask(lvl, level_names, level_bits,
+				sizeof(level_bits) / sizeof(*level_bits));
+		if (platform_logging_mask && ! log_ring_init()) {
+			WRN("could not start log formatter thread, logging disabled");
+			platform_logging_mask = 0;
+		}
+	}
+	return 1;
+}
+
+void platform_logging_deinit(void)
+{
+	if (is_initialized && platform_logging_mask) log_ring_deinit();
+	platform_logging_mask = 0;
+	is_initialized = 0;
+}
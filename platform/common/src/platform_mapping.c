@@ -0,0 +1,145 @@
+#include <platform.h>
+#include <platform_mapping.h>
+#include <platform_devctx.h>
+#include <platform_errors.h>
+#include <platform_logging.h>
+#include <tlkm_device_ioctl_cmds.h>
+#include <pthread.h>
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/mman.h>
+
+#define PLATFORM_MAPPING_MAX					64
+
+struct platform_mapping_entry {
+	void					*ptr;
+	platform_mem_addr_t			addr;
+	size_t					len;
+	int					cacheable;
+};
+
+struct platform_mapping {
+	platform_dev_id_t			dev_id;
+	size_t					num_maps;
+	struct platform_mapping_entry		map[PLATFORM_MAPPING_MAX];
+	pthread_mutex_t				mtx;
+};
+
+platform_res_t platform_mapping_init(platform_devctx_t const *pctx, platform_mapping_t **m)
+{
+	*m = (platform_mapping_t *)calloc(sizeof(**m), 1);
+	if (! *m) {
+		DEVERR(pctx->dev_id, "could not allocate platform_mapping");
+		return PERR_OUT_OF_MEMORY;
+	}
+	(*m)->dev_id = pctx->dev_id;
+	pthread_mutex_init(&(*m)->mtx, NULL);
+	return PLATFORM_SUCCESS;
+}
+
+void platform_mapping_deinit(platform_mapping_t *m)
+{
+	if (m) {
+		for (size_t i = 0; i < m->num_maps; ++i) {
+			DEVWRN(m->dev_id, "device memory at " PRImem " still mapped at %p, unmapping",
+					m->map[i].addr, m->map[i].ptr);
+			munmap(m->map[i].ptr, m->map[i].len);
+		}
+		pthread_mutex_destroy(&m->mtx);
+		free(m);
+	}
+}
+
+int platform_mapping_is_mapped(platform_mapping_t *m, void const *data, platform_mem_addr_t const addr,
+		size_t const len, platform_mem_addr_t *base, int *cacheable)
+{
+	uintptr_t const p = (uintptr_t)data;
+	int r = 0;
+	if (! m || ! m->num_maps) return 0;
+	pthread_mutex_lock(&m->mtx);
+	for (size_t i = 0; ! r && i < m->num_maps; ++i) {
+		struct platform_mapping_entry const *e = &m->map[i];
+		uintptr_t const b = (uintptr_t)e->ptr;
+		r = p >= b && p - b < e->len && len <= e->len - (p - b) && addr == e->addr + (p - b);
+		if (r && base) *base = e->addr;
+		if (r && cacheable) *cacheable = e->cacheable;
+	}
+	pthread_mutex_unlock(&m->mtx);
+	return r;
+}
+
+platform_res_t platform_map_mem(platform_devctx_t *ctx, platform_mem_addr_t const addr, size_t const len,
+		void **ptr)
+{
+	platform_mapping_t *m = ctx->mappings;
+	struct tlkm_dmabuf_cmd cmd = { .dev_addr = addr, };
+	assert(ptr);
+	*ptr = NULL;
+	if (ioctl(ctx->fd_ctrl, TLKM_DEV_IOCTL_DMABUF_INFO, &cmd)) {
+		DEVLOG(ctx->dev_id, LPLL_MM, "device memory at " PRImem " cannot be mapped: %s (%d)",
+				addr, strerror(errno), errno);
+		return PERR_NOT_IMPLEMENTED;
+	}
+	if (len > cmd.sz) {
+		DEVERR(ctx->dev_id, "cannot map %zu bytes of buffer at " PRImem " with %zu bytes", len, addr, cmd.sz);
+		return PERR_MEM_ALLOC_INVALID_SIZE;
+	}
+	pthread_mutex_lock(&m->mtx);
+	if (m->num_maps >= PLATFORM_MAPPING_MAX) {
+		pthread_mutex_unlock(&m->mtx);
+		DEVERR(ctx->dev_id, "too many mapped buffers (max. %d)", PLATFORM_MAPPING_MAX);
+		return PERR_OUT_OF_MEMORY;
+	}
+	*ptr = mmap(NULL, cmd.sz, PROT_READ | PROT_WRITE, MAP_SHARED, ctx->fd_ctrl, cmd.mmap_offset);
+	if (*ptr == MAP_FAILED) {
+		pthread_mutex_unlock(&m->mtx);
+		*ptr = NULL;
+		DEVERR(ctx->dev_id, "could not map device memory at " PRImem ": %s (%d)", addr, strerror(errno), errno);
+		return PERR_MEM_MMAP;
+	}
+	m->map[m->num_maps].ptr  = *ptr;
+	m->map[m->num_maps].addr = addr;
+	m->map[m->num_maps].len  = cmd.sz;
+	m->map[m->num_maps].cacheable = !! (cmd.flags & TLKM_MM_FLAGS_CACHEABLE);
+	++m->num_maps;
+	pthread_mutex_unlock(&m->mtx);
+	DEVLOG(ctx->dev_id, LPLL_MM, "mapped %zu bytes of %s device memory at " PRImem " to %p", cmd.sz,
+			cmd.flags & TLKM_MM_FLAGS_CACHEABLE ? "cacheable" : "uncached", addr, *ptr);
+	return PLATFORM_SUCCESS;
+}
+
+void platform_unmap_mem(platform_devctx_t *ctx, void *ptr)
+{
+	platform_mapping_t *m = ctx->mappings;
+	pthread_mutex_lock(&m->mtx);
+	for (size_t i = 0; i < m->num_maps; ++i) {
+		if (m->map[i].ptr == ptr) {
+			DEVLOG(ctx->dev_id, LPLL_MM, "unmapping device memory at " PRImem " from %p", m->map[i].addr, ptr);
+			munmap(ptr, m->map[i].len);
+			m->map[i] = m->map[--m->num_maps];
+			pthread_mutex_unlock(&m->mtx);
+			return;
+		}
+	}
+	pthread_mutex_unlock(&m->mtx);
+	DEVWRN(ctx->dev_id, "%p is not a mapping of device memory", ptr);
+}
+
+platform_res_t platform_sync_mem(platform_devctx_t const *ctx, platform_mem_addr_t const addr, size_t const offset,
+		size_t const len, platform_sync_dir_t const dir)
+{
+	struct tlkm_sync_cmd cmd = {
+		.dev_addr = addr,
+		.offset   = offset,
+		.length   = len,
+		.dir      = dir == PLATFORM_SYNC_FOR_CPU ? TLKM_SYNC_FOR_CPU : TLKM_SYNC_FOR_DEVICE,
+	};
+	DEVLOG(ctx->dev_id, LPLL_MM, "syncing %zu bytes at " PRImem " + %zu for %s", len, addr, offset,
+			dir == PLATFORM_SYNC_FOR_CPU ? "cpu" : "device");
+	if (ioctl(ctx->fd_ctrl, TLKM_DEV_IOCTL_SYNC, &cmd)) {
+		DEVERR(ctx->dev_id, "could not sync device memory at " PRImem ": %s (%d)", addr, strerror(errno), errno);
+		return PERR_TLKM_ERROR;
+	}
+	return PLATFORM_SUCCESS;
+}
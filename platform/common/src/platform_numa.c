@@ -0,0 +1,63 @@
+#define _GNU_SOURCE
+#include <platform.h>
+#include <platform_devctx.h>
+#include <platform_errors.h>
+#include <platform_logging.h>
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUMA_CPULIST_FN					"/sys/devices/system/node/node%d/cpulist"
+
+/** Parses a cpulist such as "0-7,16-23" into a cpu set. **/
+static
+int parse_cpulist(char const *s, cpu_set_t *set)
+{
+	CPU_ZERO(set);
+	while (*s && *s != '\n') {
+		char *e;
+		unsigned long lo = strtoul(s, &e, 10), hi = lo;
+		if (e == s) return 0;
+		if (*e == '-') {
+			s = e + 1;
+			hi = strtoul(s, &e, 10);
+			if (e == s || hi < lo) return 0;
+		}
+		for (; lo <= hi && lo < CPU_SETSIZE; ++lo) CPU_SET(lo, set);
+		s = *e == ',' ? e + 1 : e;
+	}
+	return CPU_COUNT(set) > 0;
+}
+
+platform_res_t platform_numa_bind_thread(platform_devctx_t const *ctx, pthread_t thread)
+{
+	char fn[64], buf[1024];
+	cpu_set_t set;
+	FILE *fp;
+	int r;
+	if (ctx->dev_info.numa_node < 0) {
+		DEVLOG(ctx->dev_id, LPLL_DEVICE, "NUMA node of device unknown");
+		return PERR_NOT_IMPLEMENTED;
+	}
+	snprintf(fn, sizeof(fn), NUMA_CPULIST_FN, ctx->dev_info.numa_node);
+	if (! (fp = fopen(fn, "r"))) {
+		DEVWRN(ctx->dev_id, "could not open %s: %s (%d)", fn, strerror(errno), errno);
+		return PERR_NOT_IMPLEMENTED;
+	}
+	r = fgets(buf, sizeof(buf), fp) && parse_cpulist(buf, &set);
+	fclose(fp);
+	if (! r) {
+		DEVWRN(ctx->dev_id, "could not parse cpulist of NUMA node %d", ctx->dev_info.numa_node);
+		return PERR_NOT_IMPLEMENTED;
+	}
+	if ((r = pthread_setaffinity_np(thread, sizeof(set), &set))) {
+		DEVWRN(ctx->dev_id, "could not set thread affinity: %s (%d)", strerror(r), r);
+		return PERR_PTHREAD_ERROR;
+	}
+	DEVLOG(ctx->dev_id, LPLL_DEVICE, "bound thread to %d CPUs of NUMA node %d",
+			CPU_COUNT(&set), ctx->dev_info.numa_node);
+	return PLATFORM_SUCCESS;
+}
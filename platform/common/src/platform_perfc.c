@@ -23,53 +23,138 @@
 //! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
 //!
 #include <stdio.h>
+#include <stdatomic.h>
+#include "platform_global.h"
 #include "platform_perfc.h"
 
 #ifndef NPERFC
 
-static
-struct platform_perfc_t {
-#define _PC(NAME) 	_Atomic(long int) pc_ ## NAME[PLATFORM_MAX_DEVS];
+/* counters are sharded per thread; each shard fills whole cache lines */
+#define PLATFORM_PERFC_SHARDS				16
+#define CACHE_LINE_SZ					64
+
+struct platform_perfc_shard_t {
+#define _PC(NAME) 	long int pc_ ## NAME;
 	PLATFORM_PERFC_COUNTERS
 #undef _PC
+} __attribute__((aligned(CACHE_LINE_SZ)));
+
+static
+struct platform_perfc_t {
+	struct platform_perfc_shard_t shard[PLATFORM_MAX_DEVS][PLATFORM_PERFC_SHARDS];
+#define _PH(NAME) 	_Atomic(long int) ph_ ## NAME[PLATFORM_MAX_DEVS][PLATFORM_MAX_COLLECTORS][PLATFORM_PERFC_HISTOGRAM_BUCKETS];
+	PLATFORM_PERFC_HISTOGRAMS
+#undef _PH
 } platform_perfc;
 
+/** Returns the shard of the calling thread, threads are assigned round-robin. **/
+static inline
+size_t shard_of_thread(void)
+{
+	static size_t next_shard;
+	static __thread size_t shard __attribute__((tls_model("initial-exec"))) = PLATFORM_PERFC_SHARDS;
+	if (__builtin_expect(shard == PLATFORM_PERFC_SHARDS, 0))
+		shard = __atomic_fetch_add(&next_shard, 1, __ATOMIC_RELAXED) % PLATFORM_PERFC_SHARDS;
+	return shard;
+}
+
+/** Bucket b holds values in [2^(b-1), 2^b), bucket 0 holds 0. **/
+static inline
+size_t bucket_of(unsigned long const v)
+{
+	size_t const b = v ? 64 - __builtin_clzl(v) : 0;
+	return b < PLATFORM_PERFC_HISTOGRAM_BUCKETS ? b : PLATFORM_PERFC_HISTOGRAM_BUCKETS - 1;
+}
+
+/* shards are shared by more than PLATFORM_PERFC_SHARDS threads, so updates
+ * remain atomic, but are uncontended in the common case; _set is meant for
+ * gauges and does not race with _add on the same counter */
 #define _PC(name) \
 void platform_perfc_ ## name ## _inc(platform_dev_id_t dev_id) \
 { \
-	platform_perfc.pc_ ## name[dev_id]++; \
+	__atomic_fetch_add(&platform_perfc.shard[dev_id][shard_of_thread()].pc_ ## name, 1, __ATOMIC_RELAXED); \
 } \
 \
 void platform_perfc_ ## name ## _add(platform_dev_id_t dev_id, int const v) \
 { \
-	platform_perfc.pc_ ## name[dev_id] += v; \
+	__atomic_fetch_add(&platform_perfc.shard[dev_id][shard_of_thread()].pc_ ## name, v, __ATOMIC_RELAXED); \
 } \
 \
 long int platform_perfc_ ## name ## _get(platform_dev_id_t dev_id) \
 { \
-	return platform_perfc.pc_ ## name[dev_id]; \
+	long int v = 0; \
+	for (size_t s = 0; s < PLATFORM_PERFC_SHARDS; ++s) \
+		v += __atomic_load_n(&platform_perfc.shard[dev_id][s].pc_ ## name, __ATOMIC_RELAXED); \
+	return v; \
 } \
 \
 void platform_perfc_ ## name ## _set(platform_dev_id_t dev_id, int const v) \
 { \
-	platform_perfc.pc_ ## name[dev_id] = v; \
+	for (size_t s = 1; s < PLATFORM_PERFC_SHARDS; ++s) \
+		__atomic_store_n(&platform_perfc.shard[dev_id][s].pc_ ## name, 0, __ATOMIC_RELAXED); \
+	__atomic_store_n(&platform_perfc.shard[dev_id][0].pc_ ## name, v, __ATOMIC_RELAXED); \
 }
 
 PLATFORM_PERFC_COUNTERS
 #undef _PC
 
+#define _PH(name) \
+void platform_perfc_ ## name ## _record(platform_dev_id_t dev_id, size_t const idx, unsigned long const v) \
+{ \
+	atomic_fetch_add_explicit(&platform_perfc.ph_ ## name[dev_id][idx][bucket_of(v)], 1, memory_order_relaxed); \
+} \
+\
+long int platform_perfc_ ## name ## _get(platform_dev_id_t dev_id, size_t const idx, size_t const bucket) \
+{ \
+	return platform_perfc.ph_ ## name[dev_id][idx][bucket]; \
+}
+
+PLATFORM_PERFC_HISTOGRAMS
+#undef _PH
+
 #ifndef STR
 	#define	STR(v)			#v
 #endif
 
+static
+size_t histogram_tostring(char *buf, size_t sz, char const *name, long int const *h)
+{
+	size_t n = 0, last = 0;
+	for (size_t b = 0; b < PLATFORM_PERFC_HISTOGRAM_BUCKETS; ++b)
+		if (h[b]) last = b + 1;
+	if (! last) return 0;
+	n += snprintf(buf + n, sz - n, "%40s:\t", name);
+	// print non-empty buckets only, as <upper bound>:<count>
+	for (size_t b = 0; b < last && n < sz; ++b)
+		if (h[b]) n += snprintf(buf + n, sz - n, " <2^%zu:%ld", b, h[b]);
+	if (n < sz) n += snprintf(buf + n, sz - n, "\n");
+	return n < sz ? n : sz;
+}
+
 const char *platform_perfc_tostring(platform_dev_id_t const dev_id)
 {
-	static char _buf[1024];
+	static char _buf[8192];
+	size_t n;
+	long int h[PLATFORM_PERFC_HISTOGRAM_BUCKETS];
+	char name[64];
 #define _PC(name) "%40s:\t%8ld\n"
-	const char *const fmt = PLATFORM_PERFC_COUNTERS "\n%c";
+	const char *const fmt = PLATFORM_PERFC_COUNTERS "%c";
 #undef _PC
 #define _PC(name) STR(name), platform_perfc_ ## name ## _get(dev_id),
-	snprintf(_buf, 1024, fmt, PLATFORM_PERFC_COUNTERS 0);
+	n = snprintf(_buf, sizeof(_buf), fmt, PLATFORM_PERFC_COUNTERS 0) - 1; // drop the '\0' of %c
+#undef _PC
+	n = n < sizeof(_buf) ? n : sizeof(_buf) - 1;
+#define _PH(nm) \
+	for (size_t c = 0; c < PLATFORM_MAX_COLLECTORS; ++c) { \
+		for (size_t b = 0; b < PLATFORM_PERFC_HISTOGRAM_BUCKETS; ++b) \
+			h[b] = platform_perfc_ ## nm ## _get(dev_id, c, b); \
+		snprintf(name, sizeof(name), "%s[%zu]", STR(nm), c); \
+		n += histogram_tostring(_buf + n, sizeof(_buf) - n, name, h); \
+		if (n >= sizeof(_buf) - 1) break; \
+	}
+	PLATFORM_PERFC_HISTOGRAMS
+#undef _PH
+	snprintf(_buf + n, sizeof(_buf) - n, "\n");
 	return _buf;
 }
 
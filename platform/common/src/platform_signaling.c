@@ -1,25 +1,62 @@
+#define _GNU_SOURCE
 #include <platform.h>
 #include <platform_signaling.h>
 #include <platform_devctx.h>
 #include <platform_errors.h>
 #include <platform_logging.h>
 #include <platform_perfc.h>
+#include <trace.h>
 #include <pthread.h>
-#include <semaphore.h>
+#include <sched.h>
 #include <errno.h>
+#include <limits.h>
 #include <string.h>
 #include <assert.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+
+/* waiters on the slots of one word share a futex */
+#define SLOTS_PER_WORD					32
+#define NUM_WORDS					((PLATFORM_NUM_SLOTS + SLOTS_PER_WORD - 1) / SLOTS_PER_WORD)
+/* bitmaps of armed and pending slots for polling */
+#define NUM_MASKS					((PLATFORM_NUM_SLOTS + 63) / 64)
+
+struct platform_collector {
+	pthread_t				thread;
+	platform_signaling_t			*s;
+	size_t					idx;
+};
 
 struct platform_signaling {
 	int					fd_wait;
 	platform_dev_id_t			dev_id;
-	pthread_t 				collector;
-	sem_t 					finished[PLATFORM_NUM_SLOTS];
+	size_t					num_collectors;
+	struct platform_collector		collector[PLATFORM_MAX_COLLECTORS];
+	uint32_t				finished[PLATFORM_NUM_SLOTS];
+	uint32_t				seq[NUM_WORDS];
+	uint32_t				waiters[NUM_WORDS];
+	uint64_t				armed[NUM_MASKS];
+	uint64_t				pending[NUM_MASKS];
+	int					fd_event;
 	platform_signal_received_f		cb;
 };
 
+static inline
+long futex(uint32_t *uaddr, int op, uint32_t val)
+{
+	return syscall(SYS_futex, uaddr, op, val, NULL, NULL, 0);
+}
+
+static inline
+unsigned long elapsed_ns(struct timespec const *a, struct timespec const *b)
+{
+	return (b->tv_sec - a->tv_sec) * 1000000000UL + b->tv_nsec - a->tv_nsec;
+}
+
 void platform_signaling_signal_received(platform_signaling_t *s, platform_signal_received_f callback)
 {
 	s->cb = callback;
@@ -30,25 +67,55 @@ void *platform_signaling_read_waitfile(void *p)
 {
 	ssize_t read_sz, read_cnt;
 	platform_slot_id_t s[PLATFORM_NUM_SLOTS];
+	uint32_t words;
+	uint64_t polled;
+	struct timespec t0, t1;
 	assert(p);
-	platform_signaling_t *a = (platform_signaling_t *)p;
+	struct platform_collector *c = (struct platform_collector *)p;
+	platform_signaling_t *a = c->s;
 	assert(a->fd_wait);
 	do {
 		memset(s, 0xFF, sizeof(s)); // poison the array
 		if ((read_sz = read(a->fd_wait, &s, sizeof(s))) > 0) {
+			clock_gettime(CLOCK_MONOTONIC, &t0);
 			read_cnt = read_sz / sizeof(*s);
 			platform_perfc_signals_received_add(a->dev_id, read_cnt);
+			platform_perfc_collector_batch_sz_record(a->dev_id, c->idx, read_cnt);
 			if (read_cnt && a->cb) a->cb(read_cnt, s);
+			// first mark all slots of the batch ...
+			words = 0;
+			polled = 0;
 			for (--read_cnt; read_cnt >= 0; --read_cnt) {
 				const platform_slot_id_t slot = s[read_cnt];
 				DEVLOG(a->dev_id, LPLL_ASYNC, "received finish for slot %u", slot);
 				if (slot < PLATFORM_NUM_SLOTS) {
-					while (sem_post(&a->finished[slot]))
-						platform_perfc_sem_post_error_inc(a->dev_id);
+					uint64_t const bit = 1ULL << (slot % 64);
+					TRACE_INSTANT("irq", a->dev_id, slot);
+					__atomic_fetch_add(&a->finished[slot], 1, __ATOMIC_SEQ_CST);
+					words |= 1U << (slot / SLOTS_PER_WORD);
+					if (__atomic_load_n(&a->armed[slot / 64], __ATOMIC_SEQ_CST) & bit) {
+						__atomic_fetch_or(&a->pending[slot / 64], bit, __ATOMIC_SEQ_CST);
+						++polled;
+					}
 				} else {
 					DEVERR(a->dev_id, "invalid slot id received: %u", slot);
 				}
 			}
+			// ... then wake each futex word once
+			for (size_t w = 0; words; ++w, words >>= 1) {
+				if (! (words & 1)) continue;
+				__atomic_fetch_add(&a->seq[w], 1, __ATOMIC_SEQ_CST);
+				if (__atomic_load_n(&a->waiters[w], __ATOMIC_SEQ_CST)) {
+					futex(&a->seq[w], FUTEX_WAKE_PRIVATE, INT_MAX);
+					platform_perfc_futex_wakeups_inc(a->dev_id);
+				}
+			}
+			// ... and notify pollers once per batch
+			if (polled && __atomic_load_n(&a->fd_event, __ATOMIC_SEQ_CST) >= 0 &&
+					write(a->fd_event, &polled, sizeof(polled)) != sizeof(polled))
+				DEVERR(a->dev_id, "could not signal completion eventfd: %s", strerror(errno));
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			platform_perfc_collector_latency_ns_record(a->dev_id, c->idx, elapsed_ns(&t0, &t1));
 		} else {
 			DEVERR(a->dev_id, "error during read: %s", strerror(errno));
 		}
@@ -56,28 +123,90 @@ void *platform_signaling_read_waitfile(void *p)
 	return NULL;
 }
 
+/** Parses a comma-separated list of CPUs, returns number of entries. **/
+static
+size_t parse_cpus(char const *s, long *cpus, size_t const max)
+{
+	size_t n = 0;
+	char *e;
+	while (*s && n < max) {
+		cpus[n] = strtol(s, &e, 10);
+		if (e == s || cpus[n] < 0 || cpus[n] >= CPU_SETSIZE) return 0;
+		++n;
+		s = *e == ',' ? e + 1 : e;
+	}
+	return n;
+}
+
+static
+void setup_collector(platform_devctx_t const *pctx, platform_signaling_t *a, size_t const i)
+{
+	char const *cpus = getenv(PLATFORM_COLLECTOR_CPUS_ENV);
+	char const *prio = getenv(PLATFORM_COLLECTOR_PRIO_ENV);
+	char const *numa = getenv(PLATFORM_NUMA_COLLECTOR_ENV);
+	pthread_t const t = a->collector[i].thread;
+	long cpu[PLATFORM_MAX_COLLECTORS];
+	size_t n;
+	int r;
+	if (cpus && *cpus) {
+		if ((n = parse_cpus(cpus, cpu, PLATFORM_MAX_COLLECTORS))) {
+			// collector i is pinned to the i-th CPU, wrapping around
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu[i % n], &set);
+			if ((r = pthread_setaffinity_np(t, sizeof(set), &set)))
+				DEVWRN(pctx->dev_id, "could not pin collector #%zu to CPU %ld: %s (%d)",
+						i, cpu[i % n], strerror(r), r);
+			else
+				DEVLOG(pctx->dev_id, LPLL_ASYNC, "pinned collector #%zu to CPU %ld", i, cpu[i % n]);
+		} else {
+			DEVWRN(pctx->dev_id, "invalid CPU list in %s: %s", PLATFORM_COLLECTOR_CPUS_ENV, cpus);
+		}
+	} else if (! numa || strcmp(numa, "0")) {
+		platform_numa_bind_thread(pctx, t);
+	}
+	if (prio && strtol(prio, NULL, 0) > 0) {
+		struct sched_param const sp = { .sched_priority = (int)strtol(prio, NULL, 0) };
+		if ((r = pthread_setschedparam(t, SCHED_FIFO, &sp)))
+			DEVWRN(pctx->dev_id, "could not set SCHED_FIFO priority %d for collector #%zu: %s (%d)",
+					sp.sched_priority, i, strerror(r), r);
+	}
+}
+
 platform_res_t platform_signaling_init(platform_devctx_t const *pctx, platform_signaling_t **a)
 {
+	char const *n = getenv(PLATFORM_COLLECTORS_ENV);
 	*a = (platform_signaling_t *)calloc(sizeof(**a), 1);
-	if (! a) {
+	if (! *a) {
 		DEVERR(pctx->dev_id, "could not allocate platform_signaling");
 		return PERR_OUT_OF_MEMORY;
 	}
 
-	for (platform_slot_id_t s = 0; s < PLATFORM_NUM_SLOTS; ++s) {
-		sem_init(&(*a)->finished[s], 0, 0);
-	}
-
 	(*a)->fd_wait = pctx->fd_ctrl;
 	(*a)->dev_id  = pctx->dev_id;
+	(*a)->fd_event = -1;
+	trace_init();
+	(*a)->num_collectors = n ? strtoul(n, NULL, 0) : 1;
+	if ((*a)->num_collectors < 1) (*a)->num_collectors = 1;
+	if ((*a)->num_collectors > PLATFORM_MAX_COLLECTORS) (*a)->num_collectors = PLATFORM_MAX_COLLECTORS;
 	assert((*a)->fd_wait != -1);
 
-	DEVLOG(pctx->dev_id, LPLL_ASYNC, "starting collector thread");
-	int x = pthread_create(&(*a)->collector, NULL, platform_signaling_read_waitfile, *a);
-	if (x != 0) {
-		DEVERR(pctx->dev_id, "could not start collector thread: %s (%d)", strerror(errno), errno);
-		free(*a);
-		return PERR_PTHREAD_ERROR;
+	DEVLOG(pctx->dev_id, LPLL_ASYNC, "starting %zu collector threads", (*a)->num_collectors);
+	for (size_t i = 0; i < (*a)->num_collectors; ++i) {
+		(*a)->collector[i].s = *a;
+		(*a)->collector[i].idx = i;
+		int x = pthread_create(&(*a)->collector[i].thread, NULL, platform_signaling_read_waitfile,
+				&(*a)->collector[i]);
+		if (x != 0) {
+			DEVERR(pctx->dev_id, "could not start collector thread: %s (%d)", strerror(x), x);
+			while (i--) {
+				pthread_cancel((*a)->collector[i].thread);
+				pthread_join((*a)->collector[i].thread, NULL);
+			}
+			free(*a);
+			return PERR_PTHREAD_ERROR;
+		}
+		setup_collector(pctx, *a, i);
 	}
 
 	DEVLOG(pctx->dev_id, LPLL_ASYNC, "signaling initialized successfully");
@@ -86,26 +215,49 @@ platform_res_t platform_signaling_init(platform_devctx_t const *pctx, platform_s
 
 void platform_signaling_deinit(platform_signaling_t *a)
 {
-	pthread_cancel(a->collector);
-	pthread_join(a->collector, NULL);
+	if (a) {
+		for (size_t i = 0; i < a->num_collectors; ++i)
+			pthread_cancel(a->collector[i].thread);
+		for (size_t i = 0; i < a->num_collectors; ++i)
+			pthread_join(a->collector[i].thread, NULL);
 
-	close(a->fd_wait);
+		close(a->fd_wait);
+		if (a->fd_event >= 0) close(a->fd_event);
 
-	for (platform_slot_id_t s = 0; s < PLATFORM_NUM_SLOTS; ++s) {
-		sem_close(&a->finished[s]);
-	}
-	if (a) {
 		DEVLOG(a->dev_id, LPLL_ASYNC, "async deinitialized");
 		free(a);
 	}
 }
 
+/** Consumes one completion of slot, if there is any. **/
+static inline
+int take_finished(platform_signaling_t *a, platform_slot_id_t const slot)
+{
+	uint32_t f = __atomic_load_n(&a->finished[slot], __ATOMIC_SEQ_CST);
+	while (f)
+		if (__atomic_compare_exchange_n(&a->finished[slot], &f, f - 1, 1,
+				__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+			return 1;
+	return 0;
+}
+
 platform_res_t platform_signaling_wait_for_slot(platform_signaling_t *a, platform_slot_id_t const slot)
 {
+	size_t const w = slot / SLOTS_PER_WORD;
 	DEVLOG(a->dev_id, LPLL_ASYNC, "waiting for slot #%lu", (unsigned long)slot);
 	platform_perfc_waiting_for_slot_set(a->dev_id, slot);
-	while (sem_wait(&a->finished[slot]))
-		platform_perfc_sem_wait_error_inc(a->dev_id);
+	TRACE_BEGIN("wait_for_slot", a->dev_id, slot);
+	while (! take_finished(a, slot)) {
+		uint32_t const seq = __atomic_load_n(&a->seq[w], __ATOMIC_SEQ_CST);
+		__atomic_fetch_add(&a->waiters[w], 1, __ATOMIC_SEQ_CST);
+		// recheck after announcing: collector bumps seq after marking the slot
+		if (! __atomic_load_n(&a->finished[slot], __ATOMIC_SEQ_CST) &&
+				futex(&a->seq[w], FUTEX_WAIT_PRIVATE, seq) && errno != EAGAIN && errno != EINTR)
+			platform_perfc_sem_wait_error_inc(a->dev_id);
+		__atomic_fetch_sub(&a->waiters[w], 1, __ATOMIC_SEQ_CST);
+		TRACE_INSTANT("wakeup", a->dev_id, slot);
+	}
+	TRACE_END("wait_for_slot", a->dev_id, slot);
 	platform_perfc_waiting_for_slot_set(a->dev_id, 0);
 	DEVLOG(a->dev_id, LPLL_ASYNC, "slot #%lu has finished", (unsigned long)slot);
 	return PLATFORM_SUCCESS;
@@ -115,3 +267,79 @@ platform_res_t platform_wait_for_slot(platform_devctx_t *ctx, platform_slot_id_t
 {
 	return platform_signaling_wait_for_slot(ctx->signaling, s);
 }
+
+platform_res_t platform_signaling_completion_fd(platform_signaling_t *a, int *fd)
+{
+	int e = __atomic_load_n(&a->fd_event, __ATOMIC_SEQ_CST);
+	if (e < 0) {
+		int const n = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (n < 0) {
+			DEVERR(a->dev_id, "could not create completion eventfd: %s (%d)", strerror(errno), errno);
+			return PERR_IRQ_WAIT;
+		}
+		// first caller wins, all others share its eventfd
+		if (__atomic_compare_exchange_n(&a->fd_event, &e, n, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+			e = n;
+		else
+			close(n);
+		DEVLOG(a->dev_id, LPLL_ASYNC, "completion eventfd is %d", e);
+	}
+	*fd = e;
+	return PLATFORM_SUCCESS;
+}
+
+void platform_signaling_arm_slot(platform_signaling_t *a, platform_slot_id_t const slot)
+{
+	assert(slot < PLATFORM_NUM_SLOTS);
+	__atomic_fetch_or(&a->armed[slot / 64], 1ULL << (slot % 64), __ATOMIC_SEQ_CST);
+}
+
+void platform_signaling_disarm_slot(platform_signaling_t *a, platform_slot_id_t const slot)
+{
+	uint64_t const bit = 1ULL << (slot % 64);
+	assert(slot < PLATFORM_NUM_SLOTS);
+	if (! (__atomic_load_n(&a->armed[slot / 64], __ATOMIC_SEQ_CST) & bit)) return;
+	__atomic_fetch_and(&a->armed[slot / 64], ~bit, __ATOMIC_SEQ_CST);
+	__atomic_fetch_and(&a->pending[slot / 64], ~bit, __ATOMIC_SEQ_CST);
+}
+
+size_t platform_signaling_poll_slots(platform_signaling_t *a, platform_slot_id_t *slots, size_t const max)
+{
+	size_t n = 0;
+	for (size_t w = 0; w < NUM_MASKS && n < max; ++w) {
+		uint64_t bits = __atomic_exchange_n(&a->pending[w], 0, __ATOMIC_SEQ_CST);
+		while (bits && n < max) {
+			platform_slot_id_t const slot = w * 64 + __builtin_ctzll(bits);
+			uint64_t const bit = bits & -bits;
+			bits ^= bit;
+			// pending may be stale if the slot was disarmed meanwhile
+			if ((__atomic_load_n(&a->armed[w], __ATOMIC_SEQ_CST) & bit) && take_finished(a, slot)) {
+				__atomic_fetch_and(&a->armed[w], ~bit, __ATOMIC_SEQ_CST);
+				slots[n++] = slot;
+			}
+		}
+		// out of space: leave the rest for the next call
+		if (bits) __atomic_fetch_or(&a->pending[w], bits, __ATOMIC_SEQ_CST);
+	}
+	return n;
+}
+
+platform_res_t platform_completion_fd(platform_devctx_t *ctx, int *fd)
+{
+	return platform_signaling_completion_fd(ctx->signaling, fd);
+}
+
+void platform_arm_slot(platform_devctx_t *ctx, platform_slot_id_t const slot)
+{
+	platform_signaling_arm_slot(ctx->signaling, slot);
+}
+
+void platform_disarm_slot(platform_devctx_t *ctx, platform_slot_id_t const slot)
+{
+	platform_signaling_disarm_slot(ctx->signaling, slot);
+}
+
+size_t platform_poll_slots(platform_devctx_t *ctx, platform_slot_id_t *slots, size_t const max)
+{
+	return platform_signaling_poll_slots(ctx->signaling, slots, max);
+}
@@ -0,0 +1,127 @@
+#include <platform.h>
+#include <platform_staging.h>
+#include <platform_devctx.h>
+#include <platform_errors.h>
+#include <platform_logging.h>
+#include <tlkm_device_ioctl_cmds.h>
+#include <pthread.h>
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define PLATFORM_STAGING_MAX_BUFS				32
+
+struct platform_staging {
+	platform_dev_id_t			dev_id;
+	size_t					num_bufs;
+	size_t					buf_sz;
+	void					*buf[PLATFORM_STAGING_MAX_BUFS];
+	uint32_t				used;
+	pthread_mutex_t				mtx;
+};
+
+platform_res_t platform_staging_init(platform_devctx_t const *pctx, platform_staging_t **s)
+{
+	struct tlkm_staging_cmd cmd = { 0 };
+	*s = (platform_staging_t *)calloc(sizeof(**s), 1);
+	if (! *s) {
+		DEVERR(pctx->dev_id, "could not allocate platform_staging");
+		return PERR_OUT_OF_MEMORY;
+	}
+	(*s)->dev_id = pctx->dev_id;
+	pthread_mutex_init(&(*s)->mtx, NULL);
+
+	// staging buffers are owned by the device, not the process
+	if (pctx->mode != PLATFORM_EXCLUSIVE_ACCESS) {
+		DEVLOG(pctx->dev_id, LPLL_INIT, "no exclusive access, staging buffers disabled");
+		return PLATFORM_SUCCESS;
+	}
+	if (ioctl(pctx->fd_ctrl, TLKM_DEV_IOCTL_STAGING_INFO, &cmd)) {
+		DEVLOG(pctx->dev_id, LPLL_INIT, "staging buffers not supported: %s (%d)", strerror(errno), errno);
+		return PLATFORM_SUCCESS;
+	}
+	if (cmd.num_bufs > PLATFORM_STAGING_MAX_BUFS) cmd.num_bufs = PLATFORM_STAGING_MAX_BUFS;
+
+	for (size_t i = 0; i < cmd.num_bufs; ++i) {
+		void *p = mmap(NULL, cmd.buf_sz, PROT_READ | PROT_WRITE, MAP_SHARED, pctx->fd_ctrl,
+				cmd.mmap_offset + i * cmd.buf_sz);
+		if (p == MAP_FAILED) {
+			DEVWRN(pctx->dev_id, "could not map staging buffer #%zu: %s (%d)", i, strerror(errno), errno);
+			break;
+		}
+		(*s)->buf[i] = p;
+		(*s)->num_bufs = i + 1;
+	}
+	(*s)->buf_sz = cmd.buf_sz;
+	DEVLOG(pctx->dev_id, LPLL_INIT, "mapped %zu staging buffers of %zu bytes", (*s)->num_bufs, (*s)->buf_sz);
+	return PLATFORM_SUCCESS;
+}
+
+void platform_staging_deinit(platform_staging_t *s)
+{
+	if (s) {
+		for (size_t i = 0; i < s->num_bufs; ++i)
+			munmap(s->buf[i], s->buf_sz);
+		pthread_mutex_destroy(&s->mtx);
+		free(s);
+	}
+}
+
+ssize_t platform_staging_find(platform_staging_t const *s, void const *data, size_t const len, size_t *offset)
+{
+	uintptr_t const p = (uintptr_t)data;
+	if (! s) return -1;
+	for (size_t i = 0; i < s->num_bufs; ++i) {
+		uintptr_t const b = (uintptr_t)s->buf[i];
+		if (p >= b && p - b < s->buf_sz && len <= s->buf_sz - (p - b)) {
+			if (offset) *offset = p - b;
+			return i;
+		}
+	}
+	return -1;
+}
+
+platform_res_t platform_alloc_host(platform_devctx_t *ctx, size_t const len, void **buf)
+{
+	platform_staging_t *s = ctx->staging;
+	assert(buf);
+	*buf = NULL;
+	if (s && len <= s->buf_sz) {
+		pthread_mutex_lock(&s->mtx);
+		for (size_t i = 0; i < s->num_bufs; ++i) {
+			if (! (s->used & (1U << i))) {
+				s->used |= 1U << i;
+				*buf = s->buf[i];
+				break;
+			}
+		}
+		pthread_mutex_unlock(&s->mtx);
+	}
+	if (*buf) {
+		DEVLOG(ctx->dev_id, LPLL_MM, "allocated staging buffer at %p for %zu bytes", *buf, len);
+		return PLATFORM_SUCCESS;
+	}
+	// no staging buffer available: fall back to regular memory
+	if (posix_memalign(buf, sysconf(_SC_PAGESIZE), len)) {
+		DEVERR(ctx->dev_id, "could not allocate %zu bytes of host memory", len);
+		return PERR_OUT_OF_MEMORY;
+	}
+	DEVLOG(ctx->dev_id, LPLL_MM, "allocated host memory at %p for %zu bytes", *buf, len);
+	return PLATFORM_SUCCESS;
+}
+
+void platform_free_host(platform_devctx_t *ctx, void *buf)
+{
+	platform_staging_t *s = ctx->staging;
+	ssize_t const i = platform_staging_find(s, buf, 0, NULL);
+	if (i >= 0) {
+		DEVLOG(ctx->dev_id, LPLL_MM, "releasing staging buffer at %p", buf);
+		pthread_mutex_lock(&s->mtx);
+		s->used &= ~(1U << i);
+		pthread_mutex_unlock(&s->mtx);
+	} else {
+		free(buf);
+	}
+}
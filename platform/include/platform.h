@@ -34,6 +34,7 @@
 #include <platform_global.h>
 #include <platform_types.h>
 #include <platform_devctx.h>
+#include <pthread.h>
 
 /** @defgroup version Version Info
  *  @{
@@ -145,6 +146,27 @@ void platform_destroy_device_by_id(platform_ctx_t *ctx, platform_dev_id_t const
 /** Retrieves an info struct from the hardware. **/
 platform_res_t platform_info(platform_devctx_t const *ctx, platform_info_t *info);
 
+/** Directory to cache device info in (default: $XDG_RUNTIME_DIR); set to 0 to disable. **/
+#define PLATFORM_INFO_CACHE_ENV				"LIBPLATFORM_INFO_CACHE"
+
+/** Set to 0 to leave the collector thread unbound. **/
+#define PLATFORM_NUMA_COLLECTOR_ENV			"LIBPLATFORM_NUMA_COLLECTOR"
+/** Number of collector threads (default: 1, max: PLATFORM_MAX_COLLECTORS). **/
+#define PLATFORM_COLLECTORS_ENV				"LIBPLATFORM_COLLECTORS"
+/** Comma-separated list of CPUs, collector i is pinned to the i-th CPU. **/
+#define PLATFORM_COLLECTOR_CPUS_ENV			"LIBPLATFORM_COLLECTOR_CPUS"
+/** SCHED_FIFO priority of the collector threads (default: 0 = SCHED_OTHER). **/
+#define PLATFORM_COLLECTOR_PRIO_ENV			"LIBPLATFORM_COLLECTOR_PRIO"
+
+/**
+ * Restricts a thread to the CPUs of the device's NUMA node.
+ * @param ctx Platform context
+ * @param thread thread to bind
+ * @return PLATFORM_SUCCESS, if successful, an error code otherwise (e.g.,
+ *         if the NUMA node of the device is unknown).
+ **/
+platform_res_t platform_numa_bind_thread(platform_devctx_t const *ctx, pthread_t thread);
+
 /** @} **/
 
 /** @defgroup platform Platform device functions
@@ -184,6 +206,69 @@ platform_res_t platform_dealloc(platform_devctx_t *ctx,
 	return ctx->dops.dealloc(ctx, addr, flags);
 }
 
+/**
+ * Allocates len bytes of host memory, preferably in one of the driver's
+ * DMA staging buffers: writes from such memory via @see platform_write_mem
+ * are submitted directly, without copying the data. Falls back to regular
+ * memory if no staging buffer is available.
+ * @param ctx Platform context
+ * @param len Size in bytes.
+ * @param buf Pointer to host memory (out).
+ * @return PLATFORM_SUCCESS, if allocation succeeded.
+ **/
+platform_res_t platform_alloc_host(platform_devctx_t *ctx,
+		size_t const len,
+		void **buf);
+
+/**
+ * Releases host memory allocated with @see platform_alloc_host.
+ * @param ctx Platform context
+ * @param buf Pointer to host memory.
+ **/
+void platform_free_host(platform_devctx_t *ctx, void *buf);
+
+/**
+ * Maps device memory into the address space of the process, if the device
+ * shares the host's memory (e.g., Zynq). Copies between the mapping and the
+ * mapped device memory via @see platform_write_mem and @see platform_read_mem
+ * are skipped.
+ * @param ctx Platform context
+ * @param addr Device memory address returned by @see platform_alloc.
+ * @param len Size in bytes.
+ * @param ptr Pointer to mapping (out).
+ * @return PLATFORM_SUCCESS, if mapping succeeded, PERR_NOT_IMPLEMENTED if
+ *         device memory cannot be mapped on this platform.
+ **/
+platform_res_t platform_map_mem(platform_devctx_t *ctx,
+		platform_mem_addr_t const addr,
+		size_t const len,
+		void **ptr);
+
+/**
+ * Unmaps device memory mapped with @see platform_map_mem.
+ * @param ctx Platform context
+ * @param ptr Pointer to mapping.
+ **/
+void platform_unmap_mem(platform_devctx_t *ctx, void *ptr);
+
+/**
+ * Cache maintenance for a range of a buffer allocated with
+ * PLATFORM_ALLOC_FLAGS_CACHEABLE: flushes CPU writes before the device reads
+ * (PLATFORM_SYNC_FOR_DEVICE), or invalidates stale lines after the device
+ * wrote (PLATFORM_SYNC_FOR_CPU). No-op for uncached memory.
+ * @param ctx Platform context
+ * @param addr Device memory address returned by @see platform_alloc.
+ * @param offset Offset of the range within the buffer.
+ * @param len Length of the range in bytes.
+ * @param dir Direction.
+ * @return PLATFORM_SUCCESS, if successful.
+ **/
+platform_res_t platform_sync_mem(platform_devctx_t const *ctx,
+		platform_mem_addr_t const addr,
+		size_t const offset,
+		size_t const len,
+		platform_sync_dir_t const dir);
+
 /**
  * Reads the device memory at the given address.
  * @param ctx Platform context
@@ -224,6 +309,53 @@ platform_res_t platform_write_mem(platform_devctx_t const *ctx,
 	return ctx->dops.write_mem(ctx, addr, len, data, flags);
 }
 
+/**
+ * Reads several segments of device memory at once; on platforms with a DMA
+ * engine all segments are transferred in a single driver call.
+ * @param ctx Platform context
+ * @param segs Array of segments (host memory, device address, length).
+ * @param num_segs Number of segments.
+ * @return PLATFORM_SUCCESS if all reads succeeded, an error code otherwise.
+ **/
+static inline
+platform_res_t platform_read_mem_v(platform_devctx_t const *ctx,
+		platform_mem_seg_t const *segs,
+		size_t const num_segs,
+		platform_mem_flags_t const flags)
+{
+	platform_res_t r = PLATFORM_SUCCESS;
+	assert(ctx);
+	if (ctx->dops.read_mem_v)
+		return ctx->dops.read_mem_v(ctx, segs, num_segs, flags);
+	for (size_t i = 0; i < num_segs && r == PLATFORM_SUCCESS; ++i)
+		r = platform_read_mem(ctx, segs[i].addr, segs[i].len, segs[i].data, flags);
+	return r;
+}
+
+/**
+ * Writes several segments to device memory at once; on platforms with a DMA
+ * engine all segments are transferred in a single driver call. Segments are
+ * written in array order, where they overlap the later one wins.
+ * @param ctx Platform context
+ * @param segs Array of segments (host memory, device address, length).
+ * @param num_segs Number of segments.
+ * @return PLATFORM_SUCCESS if all writes succeeded, an error code otherwise.
+ **/
+static inline
+platform_res_t platform_write_mem_v(platform_devctx_t const *ctx,
+		platform_mem_seg_t const *segs,
+		size_t const num_segs,
+		platform_mem_flags_t const flags)
+{
+	platform_res_t r = PLATFORM_SUCCESS;
+	assert(ctx);
+	if (ctx->dops.write_mem_v)
+		return ctx->dops.write_mem_v(ctx, segs, num_segs, flags);
+	for (size_t i = 0; i < num_segs && r == PLATFORM_SUCCESS; ++i)
+		r = platform_write_mem(ctx, segs[i].addr, segs[i].len, segs[i].data, flags);
+	return r;
+}
+
 /**
  * Reads the device register space at the given address.
  * @param ctx Platform context
@@ -275,6 +407,45 @@ platform_res_t platform_write_ctl(platform_devctx_t const *ctx,
 platform_res_t platform_wait_for_slot(platform_devctx_t *ctx,
 		const platform_slot_id_t slot);
 
+/**
+ * Returns an eventfd which becomes readable whenever a slot armed with
+ * platform_arm_slot finishes; it is created on first use and shared by all
+ * callers. Reading it resets the counter, the completed slots must then be
+ * drained with platform_poll_slots.
+ * @param ctx Platform context
+ * @param fd output file descriptor (non-blocking, owned by the platform)
+ * @return PLATFORM_SUCCESS if successful, an error code otherwise.
+ **/
+platform_res_t platform_completion_fd(platform_devctx_t *ctx, int *fd);
+
+/**
+ * Arms the given slot for polling: its next completion is reported by
+ * platform_poll_slots instead of platform_wait_for_slot. Must be called
+ * before the slot is started.
+ * @param ctx Platform context
+ * @param slot id to arm
+ **/
+void platform_arm_slot(platform_devctx_t *ctx, const platform_slot_id_t slot);
+
+/**
+ * Disarms the given slot: its next completion is reported by
+ * platform_wait_for_slot again, even if it has finished already.
+ * @param ctx Platform context
+ * @param slot id to disarm
+ **/
+void platform_disarm_slot(platform_devctx_t *ctx, const platform_slot_id_t slot);
+
+/**
+ * Drains finished armed slots without blocking; each slot is disarmed when
+ * it is reported.
+ * @param ctx Platform context
+ * @param slots output array of finished slot ids
+ * @param max maximal number of entries in slots
+ * @return number of slot ids written to slots.
+ **/
+size_t platform_poll_slots(platform_devctx_t *ctx, platform_slot_id_t *slots,
+		size_t const max);
+
 /** @} **/
 
 /** @defgroup Address Map
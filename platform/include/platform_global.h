@@ -27,5 +27,6 @@
 
 #define PLATFORM_NUM_SLOTS				128
 #define PLATFORM_MAX_DEVS				 16
+#define PLATFORM_MAX_COLLECTORS				  8
 
 #endif /* PLATFORM_API_GLOBAL_H__ */
@@ -90,13 +90,25 @@ typedef enum {
 	PLATFORM_ALLOC_FLAGS_NONE 				= 0,
 	/** PE-local memory **/
 	PLATFORM_ALLOC_FLAGS_PE_LOCAL           		= PE_LOCAL_FLAG,
+	/** cacheable host mapping, needs @see platform_sync_mem **/
+	PLATFORM_ALLOC_FLAGS_CACHEABLE				= 4,
 } platform_alloc_flags_t;
 
+typedef enum {
+	/** make CPU writes visible to the device **/
+	PLATFORM_SYNC_FOR_DEVICE				= 0,
+	/** make device writes visible to the CPU **/
+	PLATFORM_SYNC_FOR_CPU,
+} platform_sync_dir_t;
+
 typedef enum {
 	/** no flags **/
 	PLATFORM_CTL_FLAGS_NONE					= 0,
 	/** raw mode: no range checks, no added offsets **/
-	PLATFORM_CTL_FLAGS_RAW					= 1
+	PLATFORM_CTL_FLAGS_RAW					= 1,
+	/** posted write, may be combined with adjacent writes; ordered only
+	 *  before the next write without this flag **/
+	PLATFORM_CTL_FLAGS_WC					= 4,
 } platform_ctl_flags_t;
 
 typedef enum {
@@ -106,6 +118,16 @@ typedef enum {
 
 typedef struct tlkm_device_info platform_device_info_t;
 
+/** Segment of a vectored copy, @see platform_write_mem_v. **/
+typedef struct platform_mem_seg {
+	/** host memory **/
+	void *data;
+	/** device memory address **/
+	platform_mem_addr_t addr;
+	/** length in bytes **/
+	size_t len;
+} platform_mem_seg_t;
+
 #include <platform_info.h>
 /** @} **/
 
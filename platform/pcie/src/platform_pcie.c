@@ -43,9 +43,12 @@
 #include <gen_mem.h>
 
 #define	PCIE_MEM_SZ					(1ULL << 32)
+/** set to map PE argument registers write-combined */
+#define PCIE_WC_ENV					"LIBPLATFORM_PCIE_WC"
 
 typedef struct pcie_platform {
 	volatile void			*arch_map;
+	volatile void			*arch_wc_map;
 	volatile void			*plat_map;
 	volatile void			*status_map;
 	platform_devctx_t		*devctx;
@@ -55,6 +58,7 @@ typedef struct pcie_platform {
 
 #define INIT_PCIE_PLATFORM		(pcie_platform_t) { \
 	.arch_map       		= MAP_FAILED, \
+	.arch_wc_map       		= MAP_FAILED, \
 	.plat_map       		= MAP_FAILED, \
 	.status_map    			= MAP_FAILED, \
 	.devctx        			= NULL, \
@@ -68,6 +72,10 @@ void pcie_unmap(pcie_platform_t *pcie_platform)
 		munmap((void *)pcie_platform->arch_map, pcie_def.arch.size);
 		pcie_platform->arch_map = MAP_FAILED;
 	}
+	if (pcie_platform->arch_wc_map != MAP_FAILED) {
+		munmap((void *)pcie_platform->arch_wc_map, pcie_def.arch.size);
+		pcie_platform->arch_wc_map = MAP_FAILED;
+	}
 	if (pcie_platform->plat_map != MAP_FAILED) {
 		munmap((void *)pcie_platform->plat_map, pcie_def.plat.size);
 		pcie_platform->plat_map = MAP_FAILED;
@@ -125,9 +133,35 @@ platform_res_t pcie_iomapping(pcie_platform_t *pcie_platform)
 		return PERR_MMAP_DEV;
 	}
 	DEVLOG(pcie_platform->devctx->dev_id, LPLL_DEVICE, "successfully mapped status");
+
+	if (getenv(PCIE_WC_ENV)) {
+		pcie_platform->arch_wc_map = mmap(NULL,
+		                                  pcie_def.arch.size,
+		                                  PROT_READ | PROT_WRITE,
+		                                  MAP_SHARED,
+		                                  pcie_platform->devctx->fd_ctrl,
+		                                  TLKM_DEV_WC_MMAP_OFFSET);
+		if (pcie_platform->arch_wc_map == MAP_FAILED) {
+			DEVWRN(pcie_platform->devctx->dev_id, "could not map architecture write-combined, "
+			       "using uncached writes: %s (%d)", strerror(errno), errno);
+		} else {
+			DEVLOG(pcie_platform->devctx->dev_id, LPLL_DEVICE, "successfully mapped architecture write-combined");
+		}
+	}
 	return PLATFORM_SUCCESS;
 }
 
+/** Drains pending write-combined stores before the next uncached write. **/
+static inline
+void pcie_wc_fence(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__asm__ __volatile__("sfence" ::: "memory");
+#else
+	__sync_synchronize();
+#endif
+}
+
 static
 platform_res_t pcie_alloc(platform_devctx_t *devctx,
                           size_t const len,
@@ -164,16 +198,20 @@ platform_res_t pcie_read_ctl(platform_devctx_t const *ctx,
 {
 	const pcie_platform_t *pp = (pcie_platform_t *)ctx->private_data;
 	volatile void *r;
+	platform_ctl_addr_t high;
 	DEVLOG(ctx->dev_id, LPLL_CTL, "addr = " PRIctl ", length = %zu", addr, length);
 
 	if (IS_BETWEEN(addr, pcie_def.arch.base, pcie_def.arch.high)) {
 		r = (void *) (((uintptr_t) pp->arch_map) + (addr - pcie_def.arch.base));
+		high = pcie_def.arch.high;
 	}
 	else if (IS_BETWEEN(addr, pcie_def.plat.base, pcie_def.plat.high)) {
 		r = (void *) (((uintptr_t) pp->plat_map) + (addr - pcie_def.plat.base));
+		high = pcie_def.plat.high;
 	}
 	else if (IS_BETWEEN(addr, pcie_def.status.base, pcie_def.status.high)) {
 		r = (void *) (((uintptr_t) pp->status_map) + (addr - pcie_def.status.base));
+		high = pcie_def.status.high;
 	}
 	else {
 		DEVERR(ctx->dev_id, "invalid platform address: " PRIctl, addr);
@@ -194,8 +232,13 @@ platform_res_t pcie_read_ctl(platform_devctx_t const *ctx,
 		*((uint64_t*)data) = *((volatile uint64_t*)r);
 		break;
 	default:
-		DEVERR(ctx->dev_id, "invalid size: %zd", length);
-		return PERR_CTL_INVALID_SIZE;
+		// block reads, e.g., of the status core, are copied word by word
+		if (length % sizeof(uint32_t) || addr + length > high) {
+			DEVERR(ctx->dev_id, "invalid size: %zd", length);
+			return PERR_CTL_INVALID_SIZE;
+		}
+		for (size_t i = 0; i < length / sizeof(uint32_t); ++i)
+			((uint32_t *)data)[i] = ((volatile uint32_t *)r)[i];
 	}
 
 	return PLATFORM_SUCCESS;
@@ -212,8 +255,17 @@ platform_res_t pcie_write_ctl(platform_devctx_t const *ctx,
 	volatile void *r;
 	DEVLOG(ctx->dev_id, LPLL_CTL, "addr = " PRIctl ", length = %zu", addr, length);
 
-	if (IS_BETWEEN(addr, pcie_def.arch.base, pcie_def.arch.high))
-		r = (volatile void *) (((uintptr_t) pp->arch_map) + (addr - pcie_def.arch.base));
+	if (IS_BETWEEN(addr, pcie_def.arch.base, pcie_def.arch.high)) {
+		if (pp->arch_wc_map == MAP_FAILED) {
+			r = (volatile void *) (((uintptr_t) pp->arch_map) + (addr - pcie_def.arch.base));
+		} else if (flags & PLATFORM_CTL_FLAGS_WC) {
+			r = (volatile void *) (((uintptr_t) pp->arch_wc_map) + (addr - pcie_def.arch.base));
+		} else {
+			// e.g., start register: all argument writes must have landed
+			pcie_wc_fence();
+			r = (volatile void *) (((uintptr_t) pp->arch_map) + (addr - pcie_def.arch.base));
+		}
+	}
 	else if (IS_BETWEEN(addr, pcie_def.plat.base, pcie_def.plat.high))
 		r = (volatile void *) (((uintptr_t) pp->plat_map) + (addr - pcie_def.plat.base));
 	else {
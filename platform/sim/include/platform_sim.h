@@ -0,0 +1,86 @@
+//
+// Copyright (C) 2018 Jens Korinth, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	platform_sim.h
+//! @brief	Software-simulated platform: replaces the kernel module and
+//!		the bitstream by host memory and threads, so that libplatform
+//!		and libtapasco can run without a device.
+//!		The simulator emulates a status core for the configured
+//!		composition, one thread per PE that models its latency, and
+//!		the device memory. Completions are delivered through a socket
+//!		that takes the place of the device file, i.e., through the
+//!		regular signaling path.
+//!		Configuration via environment variables:
+//!		  LIBPLATFORM_SIM         composition, enables the simulator;
+//!		                          comma-separated list of
+//!		                          <kernel id>[:<local mem bytes>][x<count>],
+//!		                          or 1 for SIM_DEFAULT_COMPOSITION
+//!		  LIBPLATFORM_SIM_LATENCY PE latencies in ns; comma-separated
+//!		                          list of [<kernel id>=]<distribution>
+//!		                          with distribution one of <ns>,
+//!		                          uniform:<min>:<max>, exp:<mean> or
+//!		                          normal:<mean>:<stddev>
+//!		  LIBPLATFORM_SIM_MEM     device memory size in bytes
+//!		  LIBPLATFORM_SIM_DEVS    number of simulated devices
+//!		Some kernels have functional models (see SIM_KERNELS), all
+//!		others only take time; the counter (ID 14) takes its first
+//!		argument in design clock cycles.
+//! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
+//!
+#ifndef PLATFORM_SIM_H__
+#define PLATFORM_SIM_H__
+
+#include "platform_types.h"
+#include "platform_devctx.h"
+
+#define SIM_CLASS_NAME					"sim"
+#define SIM_ENV						"LIBPLATFORM_SIM"
+#define SIM_LATENCY_ENV					"LIBPLATFORM_SIM_LATENCY"
+#define SIM_MEM_ENV					"LIBPLATFORM_SIM_MEM"
+#define SIM_DEVS_ENV					"LIBPLATFORM_SIM_DEVS"
+
+#define SIM_DEFAULT_COMPOSITION				"14x8,11x2,10x2,9x2"
+#define SIM_DEFAULT_MEM_SZ				(256UL << 20)
+#define SIM_DESIGN_CLOCK_MHZ				100
+/** latencies below are busy-waited, above slept */
+#define SIM_SPIN_NS					20000
+
+#define SIM_STATUS_SZ					0x2000
+
+#define SIM_DEF 			INIT_PLATFORM(0x02800000ULL, SIM_STATUS_SZ,  /* status */ \
+						      0x10000000ULL, 0x80000000,  /* arch */ \
+						      0x00300000ULL, 0x00001000)  /* platf */
+
+static const
+struct platform sim_def = SIM_DEF;
+
+/** Returns non-zero, if the simulator is selected via SIM_ENV. **/
+int sim_enabled(void);
+
+/**
+ * Fills in the list of simulated devices instead of enumerating TLKM.
+ * @param devs device info array of length PLATFORM_MAX_DEVS
+ * @param num_devs output number of devices
+ * @return PLATFORM_SUCCESS, if successful, an error code otherwise.
+ **/
+platform_res_t sim_enum_devices(platform_device_info_t *devs, size_t *num_devs);
+
+platform_res_t sim_init(platform_devctx_t *devctx);
+void sim_deinit(platform_devctx_t *devctx);
+
+#endif /* PLATFORM_SIM_H__ */
@@ -0,0 +1,4 @@
+set(PLATFORM "${CMAKE_CURRENT_LIST_DIR}")
+
+target_sources(platform PRIVATE "${PLATFORM}/src/platform_sim.c")
+LIST(APPEND EXTRA_INCLUDES_PRIVATE "${PLATFORM}/include")
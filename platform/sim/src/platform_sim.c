@@ -0,0 +1,668 @@
+//
+// Copyright (C) 2018 Jens Korinth, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	platform_sim.c
+//! @brief	Platform API implementation for the software-simulated
+//!		platform: status core, PE register files and local memories
+//!		are host memory, PEs are threads.
+//! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
+//!
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+#include <assert.h>
+#include <pthread.h>
+#include <platform.h>
+#include <platform_caps.h>
+#include <platform_info.h>
+#include <platform_errors.h>
+#include <platform_logging.h>
+#include <platform_device_operations.h>
+#include <platform_sim.h>
+#include <gen_mem.h>
+
+/* PE registers, see arch/axi4mm/src/tapasco_regs.c */
+#define REG_CTRL					0x00
+#define REG_IAR						0x0c
+#define REG_RET						0x10
+#define REG_ARG0					0x20
+#define SIM_REGS_SZ					0x1000
+
+/* status core layout, see platform_info.c */
+#define STATUS_MAGIC_ID					0x0000
+#define STATUS_NUM_INTC					0x0004
+#define STATUS_CAPS0					0x0008
+#define STATUS_VIVADO_VERSION				0x0010
+#define STATUS_PLATFORM_VERSION				0x0014
+#define STATUS_COMPOSE_TS				0x0018
+#define STATUS_HOST_CLOCK				0x001c
+#define STATUS_DESIGN_CLOCK				0x0020
+#define STATUS_MEMORY_CLOCK				0x0024
+#define STATUS_KERNEL_ID_START				0x0100
+#define STATUS_LOCAL_MEM_START				0x0104
+#define STATUS_SLOT_OFFSET				0x0010
+#define STATUS_PLATFORM_BASE_START			0x1000
+#define STATUS_ARCH_BASE_START \
+		(STATUS_PLATFORM_BASE_START + sizeof(uint64_t) * PLATFORM_NUM_SLOTS)
+
+#define SIM_VERSION					((2018 << 16) | 2)
+#define SIM_MIN_WINDOW					0x10000
+#define SIM_MAX_WINDOW					(sim_def.arch.size / PLATFORM_NUM_SLOTS)
+
+#define SIM_COUNTER_ID					14
+#define SIM_ARRAY_SZ					256
+
+typedef struct sim_platform sim_platform_t;
+struct sim_pe;
+
+typedef uint64_t (*sim_kernel_f)(sim_platform_t *sp, struct sim_pe *pe);
+
+typedef enum {
+	SIM_LAT_FIXED,
+	SIM_LAT_UNIFORM,
+	SIM_LAT_EXP,
+	SIM_LAT_NORMAL,
+} sim_dist_t;
+
+struct sim_latency {
+	sim_dist_t				dist;
+	double					a, b;
+};
+
+/** A slot: either a PE with its register file, or a local memory. **/
+struct sim_pe {
+	pthread_t				thread;
+	sim_platform_t				*sp;
+	platform_slot_id_t			slot;
+	platform_kernel_id_t			kernel;
+	sim_kernel_f				fn;
+	struct sim_latency			lat;
+	uint32_t				busy;		// futex word, 1 while running
+	uint8_t					*mem;		// registers or local memory
+	size_t					sz;
+	unsigned short				xsubi[3];
+};
+
+struct sim_platform {
+	platform_devctx_t			*devctx;
+	int					fd_irq;		// completions, read end is fd_ctrl
+	int					stop;
+	size_t					window;		// arch space per slot
+	uint8_t					status[SIM_STATUS_SZ];
+	uint8_t					*ddr;
+	size_t					ddr_sz;
+	block_t					*ddr_mem;
+	pthread_mutex_t				ddr_mtx;
+	struct sim_pe				pe[PLATFORM_NUM_SLOTS];
+};
+
+static inline
+long futex(uint32_t *uaddr, int op, uint32_t val)
+{
+	return syscall(SYS_futex, uaddr, op, val, NULL, NULL, 0);
+}
+
+/** @defgroup kernels Functional models of the example kernels
+ *  @{
+ **/
+static inline
+int *sim_array_arg(sim_platform_t *sp, struct sim_pe *pe)
+{
+	uint32_t addr;
+	memcpy(&addr, pe->mem + REG_ARG0, sizeof(addr));
+	if ((size_t)addr + SIM_ARRAY_SZ * sizeof(int) > sp->ddr_sz) {
+		DEVWRN(sp->devctx->dev_id, "slot #" PRIslot ": array at " PRImem " is out of bounds",
+				pe->slot, addr);
+		return NULL;
+	}
+	return (int *)(sp->ddr + addr);
+}
+
+static
+uint64_t sim_arrayupdate(sim_platform_t *sp, struct sim_pe *pe)
+{
+	int *a = sim_array_arg(sp, pe);
+	for (size_t i = 0; a && i < SIM_ARRAY_SZ; ++i) a[i] += 42;
+	return 0;
+}
+
+static
+uint64_t sim_arraysum(sim_platform_t *sp, struct sim_pe *pe)
+{
+	int *a = sim_array_arg(sp, pe);
+	int sum = 0;
+	for (size_t i = 0; a && i < SIM_ARRAY_SZ; ++i) sum += a[i];
+	return (uint64_t)(int64_t)sum;
+}
+
+static
+uint64_t sim_arrayinit(sim_platform_t *sp, struct sim_pe *pe)
+{
+	int *a = sim_array_arg(sp, pe);
+	for (size_t i = 0; a && i < SIM_ARRAY_SZ; ++i) a[i] = i;
+	return 0;
+}
+
+#define SIM_KERNELS \
+	_X(9 ,	arrayupdate,	sim_arrayupdate) \
+	_X(10,	arraysum,	sim_arraysum) \
+	_X(11,	arrayinit,	sim_arrayinit)
+
+static
+sim_kernel_f sim_kernel(platform_kernel_id_t const k_id)
+{
+	switch (k_id) {
+#define _X(id, name, fn) case id: return fn;
+	SIM_KERNELS
+#undef _X
+	default: return NULL;
+	}
+}
+/** @} **/
+
+/** @defgroup config Configuration
+ *  @{
+ **/
+int sim_enabled(void)
+{
+	char const *c = getenv(SIM_ENV);
+	return c && *c && strcmp(c, "0");
+}
+
+/** Parses the composition in SIM_ENV; returns 0 on syntax errors. **/
+static
+int parse_composition(platform_kernel_id_t *kernel, uint32_t *memory)
+{
+	char const *c = getenv(SIM_ENV);
+	platform_slot_id_t s = 0;
+	char *e;
+	if (! c || ! strcmp(c, "1")) c = SIM_DEFAULT_COMPOSITION;
+	while (*c) {
+		unsigned long const k = strtoul(c, &e, 0);
+		unsigned long m = 0, n = 1;
+		if (e == c || ! k) return 0;
+		if (*e == ':') m = strtoul(e + 1, &e, 0);
+		if (*e == 'x') n = strtoul(e + 1, &e, 0);
+		if ((*e && *e != ',') || s + n * (m ? 2 : 1) > PLATFORM_NUM_SLOTS) return 0;
+		for (; n > 0; --n) {
+			kernel[s++] = k;
+			if (m) memory[s++] = m;
+		}
+		c = *e ? e + 1 : e;
+	}
+	return 1;
+}
+
+/** Parses a distribution: <ns>, uniform:<min>:<max>, exp:<mean> or normal:<mean>:<stddev>. **/
+static
+int parse_dist(char const *d, struct sim_latency *l)
+{
+	int n = 0;
+	if (! strncmp(d, "uniform:", 8)) {
+		l->dist = SIM_LAT_UNIFORM;
+		return sscanf(d + 8, "%lf:%lf%n", &l->a, &l->b, &n) == 2 && (! d[8 + n] || d[8 + n] == ',');
+	} else if (! strncmp(d, "exp:", 4)) {
+		l->dist = SIM_LAT_EXP;
+		return sscanf(d + 4, "%lf%n", &l->a, &n) == 1 && (! d[4 + n] || d[4 + n] == ',');
+	} else if (! strncmp(d, "normal:", 7)) {
+		l->dist = SIM_LAT_NORMAL;
+		return sscanf(d + 7, "%lf:%lf%n", &l->a, &l->b, &n) == 2 && (! d[7 + n] || d[7 + n] == ',');
+	}
+	l->dist = SIM_LAT_FIXED;
+	return sscanf(d, "%lf%n", &l->a, &n) == 1 && (! d[n] || d[n] == ',');
+}
+
+/** Finds the latency of kernel k_id in SIM_LATENCY_ENV: its own entry, else the default entry. **/
+static
+int parse_latency(platform_kernel_id_t const k_id, struct sim_latency *l)
+{
+	char const *c = getenv(SIM_LATENCY_ENV);
+	int found = 0;
+	*l = (struct sim_latency) { .dist = SIM_LAT_FIXED, };
+	while (c && *c) {
+		char const *eq = strchr(c, '='), *end = c + strcspn(c, ",");
+		if (eq && eq < end) {
+			if (strtoul(c, NULL, 0) == k_id) {
+				if (! parse_dist(eq + 1, l)) return 0;
+				found = 1;
+			}
+		} else if (! found && ! parse_dist(c, l)) {
+			return 0;
+		}
+		c = *end ? end + 1 : end;
+	}
+	return 1;
+}
+
+static
+uint32_t fnv1a(char const *s)
+{
+	uint32_t h = 2166136261U;
+	while (*s) h = (h ^ (uint8_t)*s++) * 16777619U;
+	return h;
+}
+/** @} **/
+
+platform_res_t sim_enum_devices(platform_device_info_t *devs, size_t *num_devs)
+{
+	char const *n = getenv(SIM_DEVS_ENV);
+	*num_devs = n ? strtoul(n, NULL, 0) : 1;
+	if (*num_devs < 1) *num_devs = 1;
+	if (*num_devs > PLATFORM_MAX_DEVS) *num_devs = PLATFORM_MAX_DEVS;
+	for (size_t i = 0; i < *num_devs; ++i) {
+		memset(&devs[i], 0, sizeof(devs[i]));
+		devs[i].dev_id    = i;
+		devs[i].numa_node = -1;
+		strncpy(devs[i].name, SIM_CLASS_NAME, sizeof(devs[i].name) - 1);
+	}
+	LOG(LPLL_TLKM, "simulating %zu devices", *num_devs);
+	return PLATFORM_SUCCESS;
+}
+
+/** @defgroup pe PE threads
+ *  @{
+ **/
+static inline
+double sample(struct sim_pe *pe)
+{
+	double const u = erand48(pe->xsubi);
+	switch (pe->lat.dist) {
+	case SIM_LAT_UNIFORM:	return pe->lat.a + u * (pe->lat.b - pe->lat.a);
+	case SIM_LAT_EXP:	return -pe->lat.a * log(1.0 - u);
+	case SIM_LAT_NORMAL:	// Box-Muller
+		return pe->lat.a + pe->lat.b * sqrt(-2.0 * log(1.0 - u)) * cos(2.0 * M_PI * erand48(pe->xsubi));
+	default:		return pe->lat.a;
+	}
+}
+
+/** Waits until deadline; short latencies are busy-waited, sleeping is too coarse for them. **/
+static
+void wait_until(struct timespec const *deadline, double const ns)
+{
+	if (ns < SIM_SPIN_NS) {
+		struct timespec now;
+		do clock_gettime(CLOCK_MONOTONIC, &now);
+		while (now.tv_sec < deadline->tv_sec ||
+				(now.tv_sec == deadline->tv_sec && now.tv_nsec < deadline->tv_nsec));
+	} else {
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL) == EINTR) ;
+	}
+}
+
+static
+void *sim_pe_main(void *p)
+{
+	struct sim_pe *pe = (struct sim_pe *)p;
+	sim_platform_t *sp = pe->sp;
+	uint32_t const design_clk = SIM_DESIGN_CLOCK_MHZ;
+	while (1) {
+		struct timespec deadline;
+		uint64_t ret = 0;
+		uint32_t cycles;
+		double ns;
+		// stop may come while a job runs, its busy = 0 below then overwrites
+		// the wakeup of sim_stop: check the flag before every wait
+		while (! __atomic_load_n(&pe->busy, __ATOMIC_ACQUIRE) &&
+				! __atomic_load_n(&sp->stop, __ATOMIC_ACQUIRE))
+			futex(&pe->busy, FUTEX_WAIT_PRIVATE, 0);
+		if (__atomic_load_n(&sp->stop, __ATOMIC_ACQUIRE)) break;
+
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		if (pe->fn) ret = pe->fn(sp, pe);
+		ns = sample(pe);
+		if (pe->kernel == SIM_COUNTER_ID) {
+			memcpy(&cycles, pe->mem + REG_ARG0, sizeof(cycles));
+			ns += cycles * 1000.0 / design_clk;
+		}
+		if (ns > 0) {
+			deadline.tv_nsec += (long)ns % 1000000000L;
+			deadline.tv_sec  += (time_t)(ns / 1e9) + deadline.tv_nsec / 1000000000L;
+			deadline.tv_nsec %= 1000000000L;
+			wait_until(&deadline, ns);
+		}
+
+		memcpy(pe->mem + REG_RET, &ret, sizeof(ret));
+		__atomic_store_n(&pe->busy, 0, __ATOMIC_RELEASE);
+		// raise the "interrupt": collectors read slot ids from fd_ctrl
+		if (send(sp->fd_irq, &pe->slot, sizeof(pe->slot), MSG_NOSIGNAL) != sizeof(pe->slot) &&
+				! __atomic_load_n(&sp->stop, __ATOMIC_ACQUIRE))
+			DEVERR(sp->devctx->dev_id, "slot #" PRIslot ": could not signal completion: %s (%d)",
+					pe->slot, strerror(errno), errno);
+		if (__atomic_load_n(&sp->stop, __ATOMIC_ACQUIRE)) break;
+	}
+	return NULL;
+}
+
+static
+void sim_start_pe(struct sim_pe *pe)
+{
+	uint32_t idle = 0;
+	// starting a running PE has no effect, as in hardware
+	if (__atomic_compare_exchange_n(&pe->busy, &idle, 1, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		futex(&pe->busy, FUTEX_WAKE_PRIVATE, 1);
+}
+/** @} **/
+
+/** @defgroup dops Device operations
+ *  @{
+ **/
+static
+platform_res_t sim_alloc(platform_devctx_t *devctx,
+                         size_t const len,
+                         platform_mem_addr_t *addr,
+                         platform_alloc_flags_t const flags)
+{
+	sim_platform_t *sp = (sim_platform_t *)devctx->private_data;
+	pthread_mutex_lock(&sp->ddr_mtx);
+	const addr_t a = gen_mem_malloc(&sp->ddr_mem, len);
+	pthread_mutex_unlock(&sp->ddr_mtx);
+	if (a == INVALID_ADDRESS)	return PERR_OUT_OF_MEMORY;
+	else	 			*addr = a;
+	return PLATFORM_SUCCESS;
+}
+
+static
+platform_res_t sim_dealloc(platform_devctx_t *devctx,
+                           platform_mem_addr_t const addr,
+                           platform_alloc_flags_t const flags)
+{
+	sim_platform_t *sp = (sim_platform_t *)devctx->private_data;
+	pthread_mutex_lock(&sp->ddr_mtx);
+	gen_mem_free(&sp->ddr_mem, addr, 0);
+	pthread_mutex_unlock(&sp->ddr_mtx);
+	return PLATFORM_SUCCESS;
+}
+
+static
+platform_res_t sim_read_mem(platform_devctx_t const *devctx,
+                            platform_mem_addr_t const addr,
+                            size_t const length,
+                            void *data,
+                            platform_mem_flags_t const flags)
+{
+	sim_platform_t const *sp = (sim_platform_t *)devctx->private_data;
+	if ((size_t)addr + length > sp->ddr_sz) {
+		DEVERR(devctx->dev_id, "invalid memory access at " PRImem ", length = %zu", addr, length);
+		return PERR_DMA_INVALID_ADDRESS;
+	}
+	memcpy(data, sp->ddr + addr, length);
+	return PLATFORM_SUCCESS;
+}
+
+static
+platform_res_t sim_write_mem(platform_devctx_t const *devctx,
+                             platform_mem_addr_t const addr,
+                             size_t const length,
+                             void const *data,
+                             platform_mem_flags_t const flags)
+{
+	sim_platform_t const *sp = (sim_platform_t *)devctx->private_data;
+	if ((size_t)addr + length > sp->ddr_sz) {
+		DEVERR(devctx->dev_id, "invalid memory access at " PRImem ", length = %zu", addr, length);
+		return PERR_DMA_INVALID_ADDRESS;
+	}
+	memcpy(sp->ddr + addr, data, length);
+	return PLATFORM_SUCCESS;
+}
+
+/** Resolves an arch address to its slot, returns NULL if unmapped. **/
+static inline
+struct sim_pe *sim_slot(sim_platform_t const *sp, platform_ctl_addr_t const addr,
+		size_t const length, size_t *off)
+{
+	size_t const s = (addr - sim_def.arch.base) / sp->window;
+	struct sim_pe *pe;
+	if (s >= PLATFORM_NUM_SLOTS) return NULL;
+	pe = (struct sim_pe *)&sp->pe[s];
+	*off = (addr - sim_def.arch.base) % sp->window;
+	return pe->mem && *off + length <= pe->sz ? pe : NULL;
+}
+
+static
+platform_res_t sim_read_ctl(platform_devctx_t const *ctx,
+                            platform_ctl_addr_t const addr,
+                            size_t const length,
+                            void *data,
+                            platform_ctl_flags_t const flags)
+{
+	sim_platform_t const *sp = (sim_platform_t *)ctx->private_data;
+	struct sim_pe *pe;
+	size_t off;
+	DEVLOG(ctx->dev_id, LPLL_CTL, "addr = " PRIctl ", length = %zu", addr, length);
+
+	if (IS_BETWEEN(addr, sim_def.status.base, sim_def.status.high)) {
+		if (addr - sim_def.status.base + length > sim_def.status.size) {
+			DEVERR(ctx->dev_id, "invalid size: %zd", length);
+			return PERR_CTL_INVALID_SIZE;
+		}
+		memcpy(data, sp->status + (addr - sim_def.status.base), length);
+	} else if (IS_BETWEEN(addr, sim_def.arch.base, sim_def.arch.high) &&
+			(pe = sim_slot(sp, addr, length, &off))) {
+		if (pe->kernel && off == REG_CTRL && length == sizeof(uint32_t))
+			*(uint32_t *)data = __atomic_load_n(&pe->busy, __ATOMIC_ACQUIRE);
+		else
+			memcpy(data, pe->mem + off, length);
+	} else {
+		DEVERR(ctx->dev_id, "invalid platform address: " PRIctl, addr);
+		return PERR_CTL_INVALID_ADDRESS;
+	}
+	return PLATFORM_SUCCESS;
+}
+
+static
+platform_res_t sim_write_ctl(platform_devctx_t const *ctx,
+                             platform_ctl_addr_t const addr,
+                             size_t const length,
+                             void const *data,
+                             platform_ctl_flags_t const flags)
+{
+	sim_platform_t const *sp = (sim_platform_t *)ctx->private_data;
+	struct sim_pe *pe;
+	size_t off;
+	DEVLOG(ctx->dev_id, LPLL_CTL, "addr = " PRIctl ", length = %zu", addr, length);
+
+	if (! IS_BETWEEN(addr, sim_def.arch.base, sim_def.arch.high) ||
+			! (pe = sim_slot(sp, addr, length, &off))) {
+		DEVERR(ctx->dev_id, "invalid platform address: " PRIctl, addr);
+		return PERR_CTL_INVALID_ADDRESS;
+	}
+	if (pe->kernel && off == REG_CTRL) {
+		if (*(uint8_t const *)data & 1) sim_start_pe(pe);
+	} else if (! pe->kernel || off != REG_IAR) {
+		// interrupt acks have no effect, completions are not sticky
+		memcpy(pe->mem + off, data, length);
+	}
+	return PLATFORM_SUCCESS;
+}
+/** @} **/
+
+/** Fills in the status core image for the composition. **/
+static
+void sim_status(sim_platform_t *sp, platform_kernel_id_t const *kernel, uint32_t const *memory,
+		uint32_t const compose_ts)
+{
+	uint32_t const magic = TAPASCO_MAGIC_ID, one = 1, version = SIM_VERSION,
+			clk = SIM_DESIGN_CLOCK_MHZ;
+	uint32_t caps0 = PLATFORM_CAP0_DYNAMIC_ADDRESS_MAP;
+	for (platform_slot_id_t s = 0; s < PLATFORM_NUM_SLOTS; ++s) {
+		uint64_t const base = sim_def.arch.base + s * sp->window;
+		if (memory[s]) caps0 |= PLATFORM_CAP0_PE_LOCAL_MEM;
+		memcpy(sp->status + STATUS_KERNEL_ID_START + s * STATUS_SLOT_OFFSET, &kernel[s], sizeof(kernel[s]));
+		memcpy(sp->status + STATUS_LOCAL_MEM_START + s * STATUS_SLOT_OFFSET, &memory[s], sizeof(memory[s]));
+		if (kernel[s] || memory[s])
+			memcpy(sp->status + STATUS_ARCH_BASE_START + s * sizeof(base), &base, sizeof(base));
+	}
+	memcpy(sp->status + STATUS_MAGIC_ID, &magic, sizeof(magic));
+	memcpy(sp->status + STATUS_NUM_INTC, &one, sizeof(one));
+	memcpy(sp->status + STATUS_CAPS0, &caps0, sizeof(caps0));
+	memcpy(sp->status + STATUS_VIVADO_VERSION, &version, sizeof(version));
+	memcpy(sp->status + STATUS_PLATFORM_VERSION, &version, sizeof(version));
+	memcpy(sp->status + STATUS_COMPOSE_TS, &compose_ts, sizeof(compose_ts));
+	memcpy(sp->status + STATUS_HOST_CLOCK, &clk, sizeof(clk));
+	memcpy(sp->status + STATUS_DESIGN_CLOCK, &clk, sizeof(clk));
+	memcpy(sp->status + STATUS_MEMORY_CLOCK, &clk, sizeof(clk));
+}
+
+static
+void sim_stop(sim_platform_t *sp)
+{
+	__atomic_store_n(&sp->stop, 1, __ATOMIC_RELEASE);
+	for (platform_slot_id_t s = 0; s < PLATFORM_NUM_SLOTS; ++s) {
+		struct sim_pe *pe = &sp->pe[s];
+		if (pe->thread) {
+			__atomic_store_n(&pe->busy, 1, __ATOMIC_RELEASE);
+			futex(&pe->busy, FUTEX_WAKE_PRIVATE, 1);
+			pthread_join(pe->thread, NULL);
+		}
+		free(pe->mem);
+	}
+}
+
+platform_res_t sim_init(platform_devctx_t *devctx)
+{
+	platform_kernel_id_t kernel[PLATFORM_NUM_SLOTS] = { 0 };
+	uint32_t memory[PLATFORM_NUM_SLOTS] = { 0 };
+	char const *ms = getenv(SIM_MEM_ENV);
+	char const *comp = getenv(SIM_ENV);
+	platform_res_t res = PLATFORM_SUCCESS;
+	sim_platform_t *sp;
+	int fds[2];
+	assert(devctx);
+	if (strncmp(SIM_CLASS_NAME, devctx->dev_info.name, strlen(SIM_CLASS_NAME))) {
+		DEVLOG(devctx->dev_id, LPLL_DEVICE, "does not match sim platform");
+		return PERR_INCOMPATIBLE_DEVICE;
+	}
+	DEVLOG(devctx->dev_id, LPLL_DEVICE, "matches sim platform");
+	if (! parse_composition(kernel, memory)) {
+		DEVERR(devctx->dev_id, "invalid composition in " SIM_ENV ": '%s'", comp);
+		return PERR_INCOMPATIBLE_BITSTREAM;
+	}
+
+	if (! (sp = (sim_platform_t *)calloc(sizeof(*sp), 1))) return PERR_OUT_OF_MEMORY;
+	sp->devctx = devctx;
+	sp->window = SIM_MIN_WINDOW;
+	for (platform_slot_id_t s = 0; s < PLATFORM_NUM_SLOTS; ++s)
+		while (sp->window < memory[s]) sp->window <<= 1;
+	if (sp->window > SIM_MAX_WINDOW) {
+		DEVERR(devctx->dev_id, "local memories must not exceed %zu bytes", (size_t)SIM_MAX_WINDOW);
+		res = PERR_MEM_ALLOC_INVALID_SIZE;
+		goto err_window;
+	}
+
+	sp->ddr_sz = ms ? strtoul(ms, NULL, 0) : SIM_DEFAULT_MEM_SZ;
+	if (! sp->ddr_sz || sp->ddr_sz > (size_t)UINT32_MAX + 1) sp->ddr_sz = SIM_DEFAULT_MEM_SZ;
+	// pages are only backed once they are touched
+	sp->ddr = (uint8_t *)mmap(NULL, sp->ddr_sz, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (sp->ddr == MAP_FAILED) {
+		DEVERR(devctx->dev_id, "could not map %zu bytes of device memory: %s (%d)",
+				sp->ddr_sz, strerror(errno), errno);
+		res = PERR_OUT_OF_MEMORY;
+		goto err_ddr;
+	}
+	sp->ddr_mem = gen_mem_create(0, sp->ddr_sz);
+	pthread_mutex_init(&sp->ddr_mtx, NULL);
+
+	// a socket instead of a pipe: completions after deinit must not raise SIGPIPE
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds)) {
+		DEVERR(devctx->dev_id, "could not create completion socket: %s (%d)", strerror(errno), errno);
+		res = PERR_OPEN_DEV;
+		goto err_socket;
+	}
+	devctx->fd_ctrl = fds[0];
+	sp->fd_irq      = fds[1];
+
+	sim_status(sp, kernel, memory, fnv1a(comp && strcmp(comp, "1") ? comp : SIM_DEFAULT_COMPOSITION));
+	for (platform_slot_id_t s = 0; s < PLATFORM_NUM_SLOTS; ++s) {
+		struct sim_pe *pe = &sp->pe[s];
+		if (! kernel[s] && ! memory[s]) continue;
+		pe->sp     = sp;
+		pe->slot   = s;
+		pe->kernel = kernel[s];
+		pe->fn     = sim_kernel(kernel[s]);
+		pe->sz     = kernel[s] ? SIM_REGS_SZ : memory[s];
+		pe->xsubi[0] = s;
+		pe->xsubi[1] = devctx->dev_id;
+		pe->xsubi[2] = kernel[s];
+		if (! (pe->mem = (uint8_t *)calloc(pe->sz, 1))) {
+			res = PERR_OUT_OF_MEMORY;
+			goto err_pe;
+		}
+		if (! kernel[s]) continue;
+		if (! parse_latency(kernel[s], &pe->lat)) {
+			DEVERR(devctx->dev_id, "invalid latency in " SIM_LATENCY_ENV ": '%s'",
+					getenv(SIM_LATENCY_ENV));
+			res = PERR_INCOMPATIBLE_BITSTREAM;
+			goto err_pe;
+		}
+		if (pthread_create(&pe->thread, NULL, sim_pe_main, pe)) {
+			DEVERR(devctx->dev_id, "could not start PE thread for slot #" PRIslot, s);
+			res = PERR_PTHREAD_ERROR;
+			goto err_pe;
+		}
+	}
+
+	devctx->private_data	= sp;
+	devctx->platform	= sim_def;
+	devctx->dops.alloc	= sim_alloc;
+	devctx->dops.dealloc	= sim_dealloc;
+	devctx->dops.read_mem	= sim_read_mem;
+	devctx->dops.write_mem	= sim_write_mem;
+	devctx->dops.read_mem_v	= NULL;		// no driver: one segment at a time
+	devctx->dops.write_mem_v = NULL;
+	devctx->dops.read_ctl	= sim_read_ctl;
+	devctx->dops.write_ctl	= sim_write_ctl;
+	DEVLOG(devctx->dev_id, LPLL_DEVICE, "simulating %zu bytes of device memory", sp->ddr_sz);
+	return PLATFORM_SUCCESS;
+
+err_pe:
+	sim_stop(sp);
+	close(fds[0]);
+	close(fds[1]);
+	devctx->fd_ctrl = -1;
+err_socket:
+	pthread_mutex_destroy(&sp->ddr_mtx);
+	free(sp->ddr_mem);
+	munmap(sp->ddr, sp->ddr_sz);
+err_ddr:
+err_window:
+	free(sp);
+	return res;
+}
+
+void sim_deinit(platform_devctx_t *devctx)
+{
+	sim_platform_t *sp = (sim_platform_t *)devctx->private_data;
+	sim_stop(sp);
+	close(sp->fd_irq);
+	pthread_mutex_destroy(&sp->ddr_mtx);
+	free(sp->ddr_mem);
+	munmap(sp->ddr, sp->ddr_sz);
+	free(sp);
+	devctx->private_data = NULL;
+	DEVLOG(devctx->dev_id, LPLL_DEVICE, "sim device released");
+}
@@ -127,16 +127,20 @@ platform_res_t zynq_read_ctl(platform_devctx_t const *ctx,
 {
 
 	volatile void *r;
+	platform_ctl_addr_t high;
 	DEVLOG(ctx->dev_id, LPLL_CTL, "addr = " PRIctl ", length = %zu", addr, length);
 
 	if (IS_BETWEEN(addr, zynq_def.arch.base, zynq_def.arch.high)) {
 		r = (void *) (((uintptr_t) zynq_platform.arch_map) + (addr - zynq_def.arch.base));
+		high = zynq_def.arch.high;
 	}
 	else if (IS_BETWEEN(addr, zynq_def.plat.base, zynq_def.plat.high)) {
 		r = (void *) (((uintptr_t) zynq_platform.plat_map) + (addr - zynq_def.plat.base));
+		high = zynq_def.plat.high;
 	}
 	else if (IS_BETWEEN(addr, zynq_def.status.base, zynq_def.status.high)) {
 		r = (void *) (((uintptr_t) zynq_platform.status_map) + (addr - zynq_def.status.base));
+		high = zynq_def.status.high;
 	}
 	else {
 		DEVERR(ctx->dev_id, "invalid platform address: " PRIctl, addr);
@@ -157,8 +161,13 @@ platform_res_t zynq_read_ctl(platform_devctx_t const *ctx,
 		*((uint64_t*)data) = *((volatile uint64_t*)r);
 		break;
 	default:
-		DEVERR(ctx->dev_id, "invalid size: %zd", length);
-		return PERR_CTL_INVALID_SIZE;
+		// block reads, e.g., of the status core, are copied word by word
+		if (length % sizeof(uint32_t) || addr + length > high) {
+			DEVERR(ctx->dev_id, "invalid size: %zd", length);
+			return PERR_CTL_INVALID_SIZE;
+		}
+		for (size_t i = 0; i < length / sizeof(uint32_t); ++i)
+			((uint32_t *)data)[i] = ((volatile uint32_t *)r)[i];
 	}
 
 	return PLATFORM_SUCCESS;
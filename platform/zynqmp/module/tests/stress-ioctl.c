@@ -110,6 +110,35 @@ static inline void alloc_free(size_t const *lp)
 	} else __atomic_fetch_add(&errors, 1, __ATOMIC_SEQ_CST);
 }
 
+#define MIXED_OUTSTANDING	64
+
+/* keeps many buffers of mixed sizes alive and frees them in random order,
+   exercising all size classes of the DMA region and the address lookup */
+static inline void mixed_alloc_free(void)
+{
+	struct zynqmp_ioctl_cmd_t cmd[MIXED_OUTSTANDING];
+	int n = 0;
+	memset(cmd, 0, sizeof(cmd));
+	for (int i = 0; i < MIXED_OUTSTANDING; ++i) {
+		cmd[n].id = -1;
+		cmd[n].length = (size_t)(rand() % 4096 + 1) << (rand() % 11);
+		if (! ioctl(fd_ioctl, ZYNQ_IOCTL_ALLOC, &cmd[n])) {
+			__atomic_fetch_add(&alloced_bytes, cmd[n].length, __ATOMIC_SEQ_CST);
+			++n;
+		} else __atomic_fetch_add(&errors, 1, __ATOMIC_SEQ_CST);
+	}
+	while (n > 0) {
+		int const i = rand() % n;
+		// free by dma address to go through the lookup
+		cmd[i].id = -1;
+		if (ioctl(fd_ioctl, ZYNQ_IOCTL_FREE, &cmd[i]))
+			__atomic_fetch_add(&errors, 1, __ATOMIC_SEQ_CST);
+		else
+			__atomic_fetch_add(&freed_bytes, cmd[i].length, __ATOMIC_SEQ_CST);
+		cmd[i] = cmd[--n];
+	}
+}
+
 static void *stress(void *p)
 {
 	long const which = (long) p;
@@ -117,6 +146,7 @@ static void *stress(void *p)
 		switch (which) {
 		case 1: alloc_free(NULL); break;
 		case 2: copy_check(NULL); break;
+		case 3: mixed_alloc_free(); break;
 		default: stop = 1; return NULL;
 		}
 		__atomic_fetch_add(&runs, 1, __ATOMIC_SEQ_CST);
@@ -207,15 +237,17 @@ static int menu(long const thrdcnt)
 	const char *const strwelcome = "Welcome to Zynq ioctl Test! Choose Test:";
 	const char *const strc1 = "1) alloc-free (multi-threaded)";
 	const char *const strc2 = "2) copyto-copyfree (multi-threaded)";
+	const char *const strc3 = "3) mixed-size alloc-free (multi-threaded)";
 	const char *const strcq = "--- any other key to exit ---";
 	char strparams[255];
-	const int off = strlen(strc2);
+	const int off = strlen(strc3);
 	getmaxyx(stdscr, rows, cols);
 	r = rows / 3;
 	mvprintw(r++, (cols - strlen(strwelcome)) / 2, strwelcome);
 	r += 2;
 	mvprintw(r++, (cols - off) / 2, strc1);
 	mvprintw(r++, (cols - off) / 2, strc2);
+	mvprintw(r++, (cols - off) / 2, strc3);
 	r += 1;
 	mvprintw(r++, (cols - strlen(strcq)) / 2, strcq);
 
@@ -224,8 +256,8 @@ static int menu(long const thrdcnt)
 	mvprintw(r, (cols - strlen(strparams)) / 2, strparams);
 
 	while ((c = getch()) == ERR);
-	if (c == '1' || c == '2')
-		runtest(c == '1' ? 1 : 2);
+	if (c >= '1' && c <= '3')
+		runtest(c - '0');
 	return c;
 }
 
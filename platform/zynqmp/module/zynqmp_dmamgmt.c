@@ -21,16 +21,26 @@
 //! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.esa.tu-darmstadt.de)
 //!
 #include <linux/dma-mapping.h>
+#include <linux/hashtable.h>
+#include <linux/log2.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
 #include "zynqmp_dmamgmt.h"
 #include "zynqmp_logging.h"
 #include "gen_fixed_size_pool.h"
 
+static uint dmamgmt_region_sz = ZYNQ_DMAMGMT_REGION_SZ;
+module_param(dmamgmt_region_sz, uint, S_IRUGO);
+MODULE_PARM_DESC(dmamgmt_region_sz, "size of the DMA region reserved at load time (bytes, 0 = allocate every buffer directly)");
+
 static inline void init_dma_buf_t(struct dma_buf_t *buf, fsp_idx_t const idx)
 {
 	buf->len = 0;
 	buf->handle = 0;
 	buf->dma_addr = 0;
 	buf->kvirt_addr = NULL;
+	buf->cls = ZYNQ_DMAMGMT_NO_CLASS;
+	INIT_HLIST_NODE(&buf->hnode);
 }
 
 MAKE_FIXED_SIZE_POOL(dmabuf, ZYNQ_DMAMGMT_POOLSZ, struct dma_buf_t,
@@ -38,21 +48,91 @@ MAKE_FIXED_SIZE_POOL(dmabuf, ZYNQ_DMAMGMT_POOLSZ, struct dma_buf_t,
 
 static struct dmabuf_fsp_t _dmabuf;
 
+/* reserved region: blocks are carved from top, freed blocks are kept on a
+ * per-class free list threaded through the blocks themselves */
+static struct {
+	size_t sz;
+	size_t top;
+	void *kvirt_addr;
+	dma_addr_t dma_addr;
+	void *free[ZYNQ_DMAMGMT_CLASSES];
+} _region;
+
+static DEFINE_HASHTABLE(_dmabufs, ZYNQ_DMAMGMT_HASH_BITS);
+static DEFINE_MUTEX(_dmamgmt_mtx);
+
+static inline int size_class(size_t const len)
+{
+	int order;
+	if (! len) return ZYNQ_DMAMGMT_NO_CLASS;
+	order = max_t(int, ilog2(roundup_pow_of_two(len)), ZYNQ_DMAMGMT_MIN_ORDER);
+	return order > ZYNQ_DMAMGMT_MAX_ORDER ? ZYNQ_DMAMGMT_NO_CLASS :
+			order - ZYNQ_DMAMGMT_MIN_ORDER;
+}
+
+static inline size_t class_sz(int const cls)
+{
+	return 1UL << (cls + ZYNQ_DMAMGMT_MIN_ORDER);
+}
+
+/* must hold _dmamgmt_mtx */
+static void *region_get(int const cls, dma_addr_t *dma_addr)
+{
+	void *p = _region.free[cls];
+	if (p) {
+		_region.free[cls] = *(void **)p;
+		memset(p, 0, class_sz(cls));
+	} else if (_region.kvirt_addr && _region.sz - _region.top >= class_sz(cls)) {
+		p = _region.kvirt_addr + _region.top;
+		_region.top += class_sz(cls);
+	} else {
+		return NULL;
+	}
+	*dma_addr = _region.dma_addr + (p - _region.kvirt_addr);
+	return p;
+}
+
+/* must hold _dmamgmt_mtx */
+static void region_put(int const cls, void *p)
+{
+	*(void **)p = _region.free[cls];
+	_region.free[cls] = p;
+}
+
 static inline ssize_t find_dma_addr(dma_addr_t const addr)
 {
-	ssize_t id = 0;
-	while (id < ZYNQ_DMAMGMT_POOLSZ && _dmabuf.elems[id].dma_addr != addr)
-		++id;
-	if (id >= ZYNQ_DMAMGMT_POOLSZ)
+	struct dma_buf_t *b;
+	ssize_t id = -1;
+	mutex_lock(&_dmamgmt_mtx);
+	hash_for_each_possible(_dmabufs, b, hnode, addr) {
+		if (b->dma_addr == addr) {
+			id = b - _dmabuf.elems;
+			break;
+		}
+	}
+	mutex_unlock(&_dmamgmt_mtx);
+	if (id < 0)
 		WRN("dma address not found: 0x%08lx", (long unsigned)addr);
-	return id < ZYNQ_DMAMGMT_POOLSZ ? id : -1;//INVALID_IDX;
+	return id;
 }
 
-int zynqmp_dmamgmt_init(void)
+int zynqmp_dmamgmt_init(struct device *dev)
 {
 	dmabuf_fsp_init(&_dmabuf);
-	LOG(ZYNQ_LL_DMAMGMT, "DMA buffer management initialized: size = %u",
-			ZYNQ_DMAMGMT_POOLSZ);
+	hash_init(_dmabufs);
+	memset(&_region, 0, sizeof(_region));
+	if (dmamgmt_region_sz) {
+		_region.sz = PAGE_ALIGN(dmamgmt_region_sz);
+		_region.kvirt_addr = dma_alloc_coherent(dev, _region.sz,
+				&_region.dma_addr, GFP_KERNEL);
+		if (! _region.kvirt_addr) {
+			WRN("could not reserve DMA region of %zu bytes, "
+					"allocating buffers directly", _region.sz);
+			_region.sz = 0;
+		}
+	}
+	LOG(ZYNQ_LL_DMAMGMT, "DMA buffer management initialized: size = %u, "
+			"region = %zu bytes", ZYNQ_DMAMGMT_POOLSZ, _region.sz);
 	return 0;
 }
 
@@ -65,6 +145,10 @@ void zynqmp_dmamgmt_exit(struct device *dev)
 			zynqmp_dmamgmt_dealloc(dev, i);
 		}
 	}
+	if (_region.kvirt_addr)
+		dma_free_coherent(dev, _region.sz, _region.kvirt_addr,
+				_region.dma_addr);
+	memset(&_region, 0, sizeof(_region));
 	LOG(ZYNQ_LL_DMAMGMT, "DMA buffer management exited");
 }
 
@@ -72,6 +156,7 @@ dma_addr_t zynqmp_dmamgmt_alloc(struct device *dev, size_t const len,
 		unsigned long *hid)
 {
 	fsp_idx_t id;
+	struct dma_buf_t *b;
 	LOG(ZYNQ_LL_DMAMGMT, "len = %zu", len);
 	id = dmabuf_fsp_get(&_dmabuf);
 	LOG(ZYNQ_LL_DMAMGMT, "id = %u", id);
@@ -79,37 +164,54 @@ dma_addr_t zynqmp_dmamgmt_alloc(struct device *dev, size_t const len,
 		WRN("internal pool depleted: could not allocate a buffer!");
 		return 0;
 	}
-	_dmabuf.elems[id].kvirt_addr = dma_alloc_coherent(
-			dev, len, &_dmabuf.elems[id].dma_addr,
-			GFP_KERNEL);
-	if (! _dmabuf.elems[id].kvirt_addr) {
+	b = &_dmabuf.elems[id];
+	b->cls = size_class(len);
+	mutex_lock(&_dmamgmt_mtx);
+	if (b->cls != ZYNQ_DMAMGMT_NO_CLASS)
+		b->kvirt_addr = region_get(b->cls, &b->dma_addr);
+	mutex_unlock(&_dmamgmt_mtx);
+	if (! b->kvirt_addr) {
+		b->cls = ZYNQ_DMAMGMT_NO_CLASS;
+		b->kvirt_addr = dma_alloc_coherent(dev, len, &b->dma_addr,
+				GFP_KERNEL);
+	}
+	if (! b->kvirt_addr) {
 		WRN("could not allocate DMA buffer of size %zu byte!", len);
 		dmabuf_fsp_put(&_dmabuf, id);
 		return 0;
 	}
-	_dmabuf.elems[id].len = len;
-	LOG(ZYNQ_LL_DMAMGMT, "len = %zu, kvirt_addr = 0x%08lx, "
+	b->len = len;
+	mutex_lock(&_dmamgmt_mtx);
+	hash_add(_dmabufs, &b->hnode, b->dma_addr);
+	mutex_unlock(&_dmamgmt_mtx);
+	LOG(ZYNQ_LL_DMAMGMT, "len = %zu, class = %d, kvirt_addr = 0x%08lx, "
 			"dma_addr = 0x%08lx",
-			len, (unsigned long)_dmabuf.elems[id].kvirt_addr,
-			(unsigned long)_dmabuf.elems[id].dma_addr);
+			len, b->cls, (unsigned long)b->kvirt_addr,
+			(unsigned long)b->dma_addr);
 	if (hid) *hid = id;
-	return _dmabuf.elems[id].dma_addr;
+	return b->dma_addr;
 }
 
 int zynqmp_dmamgmt_dealloc(struct device *dev, u32 const id)
 {
+	struct dma_buf_t *b;
 	LOG(ZYNQ_LL_DMAMGMT, "id = %u", id);
 	if (id < ZYNQ_DMAMGMT_POOLSZ && _dmabuf.elems[id].kvirt_addr) {
-		LOG(ZYNQ_LL_DMAMGMT, "id = %u, len = %zd, kvirt_addr = 0x%08lx, "
-				"dma_addr = 0x%08lx", id,
-				_dmabuf.elems[id].len,
-				(unsigned long)_dmabuf.elems[id].kvirt_addr,
-				(unsigned long)_dmabuf.elems[id].dma_addr);
-		dma_free_coherent(dev,
-				_dmabuf.elems[id].len,
-				_dmabuf.elems[id].kvirt_addr,
-				_dmabuf.elems[id].dma_addr);
-		init_dma_buf_t(&_dmabuf.elems[id], id);
+		b = &_dmabuf.elems[id];
+		LOG(ZYNQ_LL_DMAMGMT, "id = %u, len = %zd, class = %d, "
+				"kvirt_addr = 0x%08lx, dma_addr = 0x%08lx", id,
+				b->len, b->cls,
+				(unsigned long)b->kvirt_addr,
+				(unsigned long)b->dma_addr);
+		mutex_lock(&_dmamgmt_mtx);
+		hash_del(&b->hnode);
+		if (b->cls != ZYNQ_DMAMGMT_NO_CLASS)
+			region_put(b->cls, b->kvirt_addr);
+		mutex_unlock(&_dmamgmt_mtx);
+		if (b->cls == ZYNQ_DMAMGMT_NO_CLASS)
+			dma_free_coherent(dev, b->len, b->kvirt_addr,
+					b->dma_addr);
+		init_dma_buf_t(b, id);
 	} else {
 		WRN("illegal id %u, no deallocation", id);
 		return 1;
@@ -24,18 +24,31 @@
 #define ___ZYNQ_DMAMGMT_H__
 
 #include <linux/device.h>
+#include <linux/list.h>
 #include "zynqmp_platform.h"
 
 #define ZYNQ_DMAMGMT_POOLSZ		 ZYNQ_PLATFORM_MAXMEMHANDLES
 
+/* buffers are sub-allocated from a pre-reserved CMA region in power-of-two
+ * size classes from 2^MIN_ORDER to 2^MAX_ORDER bytes; larger buffers, or
+ * all of them if the region could not be reserved, are allocated directly */
+#define ZYNQ_DMAMGMT_REGION_SZ		(32U << 20)
+#define ZYNQ_DMAMGMT_MIN_ORDER		12
+#define ZYNQ_DMAMGMT_MAX_ORDER		22
+#define ZYNQ_DMAMGMT_CLASSES		(ZYNQ_DMAMGMT_MAX_ORDER - ZYNQ_DMAMGMT_MIN_ORDER + 1)
+#define ZYNQ_DMAMGMT_NO_CLASS		(-1)
+#define ZYNQ_DMAMGMT_HASH_BITS		10
+
 struct dma_buf_t {
 	size_t len;
 	u32 handle;
 	dma_addr_t dma_addr;
 	void * kvirt_addr;
+	int cls;			/* size class, ZYNQ_DMAMGMT_NO_CLASS if direct */
+	struct hlist_node hnode;	/* dma_addr -> buffer lookup */
 };
 
-int zynqmp_dmamgmt_init(void);
+int zynqmp_dmamgmt_init(struct device *dev);
 void zynqmp_dmamgmt_exit(struct device *dev);
 dma_addr_t zynqmp_dmamgmt_alloc(struct device *dev, size_t const len,
 		unsigned long *hid);
@@ -45,7 +45,7 @@ static int __init zynqmp_module_init(void)
 		goto exit;
 	}
 
-	retval = zynqmp_dmamgmt_init();
+	retval = zynqmp_dmamgmt_init(zynqmp_ioctl_get_device());
 	if (retval < 0) {
 		ERR("DMA management init failed!");
 		goto err_dmamgmt;
@@ -39,6 +39,7 @@ long tlkm_device_ioctl_info(struct file *fp, unsigned int ioctl,
 	kinfo.dev_id = c->dev_id;
 	kinfo.vendor_id = kdev->vendor_id;
 	kinfo.product_id = kdev->product_id;
+	kinfo.numa_node = kdev->node;
 	strncpy(kinfo.name, kdev->cls->name, TLKM_DEVNAME_SZ);
     kinfo.name[TLKM_DEVNAME_SZ - 1] = '\0';
 	if (copy_to_user((void __user *)info, &kinfo, sizeof(kinfo))) {
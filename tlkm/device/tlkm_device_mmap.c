@@ -2,6 +2,7 @@
 #include "tlkm_logging.h"
 #include "tlkm_bus.h"
 #include "tlkm_control.h"
+#include "tlkm_device_ioctl_cmds.h"
 
 static inline
 struct tlkm_device *device_from_file(struct file *fp)
@@ -11,13 +12,47 @@ struct tlkm_device *device_from_file(struct file *fp)
 	return tlkm_bus_get_device(c->dev_id);
 }
 
+/* write-combining alias of the architecture space, off is relative to its base */
+static
+int tlkm_device_mmap_wc(struct tlkm_device *dp, ulong off, struct vm_area_struct *vm)
+{
+	struct platform const *p = &dp->cls->platform;
+	size_t const sz = vm->vm_end - vm->vm_start;
+	if (off >= p->arch.size || sz > p->arch.size - off) {
+		DEVERR(dp->dev_id, "invalid write-combining mapping: offset = 0x%08lx, size = %zu", off, sz);
+		return -ENXIO;
+	}
+	DEVLOG(dp->dev_id, TLKM_LF_CONTROL,
+			"mapping %zu bytes from physical address 0x%lx write-combined to user space 0x%lx-0x%lx", sz,
+			(ulong)(dp->base_offset + p->arch.base + off), vm->vm_start, vm->vm_end);
+	vm->vm_page_prot = pgprot_writecombine(vm->vm_page_prot);
+	if (io_remap_pfn_range(vm, vm->vm_start, (dp->base_offset + p->arch.base + off) >> PAGE_SHIFT, sz, vm->vm_page_prot)) {
+		DEVWRN(dp->dev_id, "io_remap_pfn_range failed!");
+		return -EAGAIN;
+	}
+	return 0;
+}
+
 int tlkm_device_mmap(struct file *fp, struct vm_area_struct *vm)
 {
 	struct tlkm_device *dp = device_from_file(fp);
 	ssize_t const sz = vm->vm_end - vm->vm_start;
 	ulong const off = vm->vm_pgoff << PAGE_SHIFT;
-	void __iomem *kptr = addr2map(dp, off);
+	void __iomem *kptr;
 	DEVLOG(dp->dev_id, TLKM_LF_CONTROL, "received mmap: offset = 0x%08lx", off);
+	if (off >= TLKM_DEV_STAGING_MMAP_OFFSET)
+		return tlkm_dma_staging_mmap(&dp->dma[0], fp, off - TLKM_DEV_STAGING_MMAP_OFFSET, vm);
+	if (off >= TLKM_DEV_WC_MMAP_OFFSET)
+		return tlkm_device_mmap_wc(dp, off - TLKM_DEV_WC_MMAP_OFFSET, vm);
+	if (off >= TLKM_DEV_DMABUF_MMAP_OFFSET) {
+		if (! dp->cls->mmap) {
+			DEVERR(dp->dev_id, "device buffers cannot be mapped on this platform");
+			return -ENXIO;
+		}
+		return dp->cls->mmap(dp, off - TLKM_DEV_DMABUF_MMAP_OFFSET, vm);
+	}
+
+	kptr = addr2map(dp, off);
 	if (! kptr) {
 		DEVERR(dp->dev_id, "invalid address: 0x%08lx", off);
 		return -ENXIO;
@@ -17,9 +17,14 @@
 // along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
 //
 #include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/pci.h>
+#include <linux/dma-mapping.h>
 #include "tlkm_dma.h"
 #include "tlkm_logging.h"
 #include "tlkm_perfc.h"
+#include "blue_dma_ring.h"
+#include "pcie/pcie_device.h"
 
 /* Register Map and commands */
 #define REG_HOST_ADDR 			0x00 	/* slv_reg0 = PCIe addr */
@@ -31,10 +36,28 @@
 #define REG_READ_REQUESTS 0x48
 #define REG_WRITE_REQUESTS 0x56
 
+/* Descriptor ring registers (only if BLUE_DMA_CAP_SG is set in REG_ID) */
+#define REG_RD_RING_BASE		0x60	/* bus address of read ring */
+#define REG_RD_RING_HEAD		0x68	/* read doorbell: new head */
+#define REG_RD_RING_DONE		0x70	/* read completion counter */
+#define REG_WR_RING_BASE		0x78	/* bus address of write ring */
+#define REG_WR_RING_HEAD		0x80	/* write doorbell: new head */
+#define REG_WR_RING_DONE		0x88	/* write completion counter */
+
 #define CMD_READ			0x10001000 	/* from m64 fpga memory to m64 host memory */
 #define CMD_WRITE			0x10000001 	/* from m64 host memory to m64 fpga memory */
 
 #define BLUE_DMA_ID				 0xE5A0023
+#define BLUE_DMA_CAP_SG			(1ULL << 56)
+
+struct blue_dma_data {
+	struct blue_dma_ring		rd;
+	struct blue_dma_ring		wr;
+	struct blue_dma_desc		*desc;
+	dma_addr_t			desc_handle;
+};
+
+#define BLUE_DMA_RINGS_SZ		(2 * BLUE_DMA_RING_DESCS * sizeof(struct blue_dma_desc))
 
 irqreturn_t blue_dma_intr_handler_read(int irq, void * dev_id)
 {
@@ -52,6 +75,28 @@ irqreturn_t blue_dma_intr_handler_write(int irq, void * dev_id)
 	return IRQ_HANDLED;
 }
 
+static int blue_dma_init_rings(struct dma_engine *dma)
+{
+	struct tlkm_pcie_device *pdev = (struct tlkm_pcie_device *)dma->dev->private_data;
+	struct blue_dma_data *d = kzalloc(sizeof(*d), GFP_KERNEL);
+	if (! d) return -ENOMEM;
+	d->desc = dma_alloc_coherent(&pdev->pdev->dev, BLUE_DMA_RINGS_SZ, &d->desc_handle, GFP_KERNEL);
+	if (! d->desc) {
+		kfree(d);
+		return -ENOMEM;
+	}
+	blue_dma_ring_init(&d->rd, d->desc);
+	blue_dma_ring_init(&d->wr, d->desc + BLUE_DMA_RING_DESCS);
+	// writing the base resets head and completion counter of the engine
+	*(u64 *)(dma->regs + REG_RD_RING_BASE) = (u64)d->desc_handle;
+	*(u64 *)(dma->regs + REG_WR_RING_BASE) = (u64)d->desc_handle +
+			BLUE_DMA_RING_DESCS * sizeof(struct blue_dma_desc);
+	wmb();
+	dma->engine_data = d;
+	dma->sg_depth = BLUE_DMA_RING_DESCS;
+	return 0;
+}
+
 int blue_dma_init(struct dma_engine *dma) {
 
 	u64 id = *(u64 *)(dma->regs + REG_ID);
@@ -61,12 +106,34 @@ int blue_dma_init(struct dma_engine *dma) {
 		DEVLOG(dma->dev_id, TLKM_LF_DMA, "FPGA beats per burst: %u", (uint8_t)(id >> 40));
 		DEVLOG(dma->dev_id, TLKM_LF_DMA, "smallest alignment: %u", (uint8_t)(id >> 48));
 		dma->alignment = (uint8_t)(id >> 48);
+		if (id & BLUE_DMA_CAP_SG) {
+			if (blue_dma_init_rings(dma))
+				DEVWRN(dma->dev_id, "could not allocate descriptor rings, using register mode");
+			else
+				DEVLOG(dma->dev_id, TLKM_LF_DMA, "descriptor ring mode with %d descriptors",
+						BLUE_DMA_RING_DESCS);
+		}
 		return 1;
 	} else {
 		return 0;
 	}
 }
 
+void blue_dma_exit(struct dma_engine *dma)
+{
+	struct blue_dma_data *d = (struct blue_dma_data *)dma->engine_data;
+	if (d) {
+		struct tlkm_pcie_device *pdev = (struct tlkm_pcie_device *)dma->dev->private_data;
+		*(u64 *)(dma->regs + REG_RD_RING_BASE) = 0;
+		*(u64 *)(dma->regs + REG_WR_RING_BASE) = 0;
+		wmb();
+		dma_free_coherent(&pdev->pdev->dev, BLUE_DMA_RINGS_SZ, d->desc, d->desc_handle);
+		kfree(d);
+		dma->engine_data = NULL;
+		dma->sg_depth = 0;
+	}
+}
+
 ssize_t blue_dma_copy_from(struct dma_engine *dma, void *dma_handle, dev_addr_t dev_addr, size_t len)
 {
 	dma_addr_t handle = (dma_addr_t)dma_handle;
@@ -102,3 +169,46 @@ ssize_t blue_dma_copy_to(struct dma_engine *dma, dev_addr_t dev_addr, const void
 	mutex_unlock(&dma->regs_mutex);
 	return atomic64_inc_return(&dma->wq_enqueued);
 }
+
+static ssize_t blue_dma_ring_submit(struct dma_engine *dma, struct blue_dma_ring *ring,
+		off_t reg_head, off_t reg_done, atomic64_t *enqueued,
+		const struct tlkm_dma_sg *sg, size_t n)
+{
+	size_t i;
+	if (! n) return -EINVAL;
+	if (mutex_lock_interruptible(&dma->regs_mutex)) {
+		WRN("got killed while aquiring the mutex");
+		return -ERESTARTSYS;
+	}
+
+	blue_dma_ring_reclaim(ring, (u32)*(u64 *)(dma->regs + reg_done));
+	if (blue_dma_ring_space(ring) < n) {
+		mutex_unlock(&dma->regs_mutex);
+		DEVERR(dma->dev_id, "descriptor ring full, cannot queue chain of %zu", n);
+		return -EAGAIN;
+	}
+
+	for (i = 0; i < n; ++i) {
+		DEVLOG(dma->dev_id, TLKM_LF_DMA, "desc #%u: dev_addr = 0x%px, dma_handle = 0x%p, len: %zu bytes",
+				ring->head, (void *)sg[i].dev_addr, sg[i].dma_handle, sg[i].len);
+		blue_dma_ring_post(ring, (u64)(dma_addr_t)sg[i].dma_handle, sg[i].dev_addr, sg[i].len, i == n - 1);
+	}
+	wmb();
+	*(u64 *)(dma->regs + reg_head)			= ring->head;
+	mutex_unlock(&dma->regs_mutex);
+	return atomic64_inc_return(enqueued);
+}
+
+ssize_t blue_dma_copy_sg_from(struct dma_engine *dma, const struct tlkm_dma_sg *sg, size_t n)
+{
+	struct blue_dma_data *d = (struct blue_dma_data *)dma->engine_data;
+	BUG_ON(! d);
+	return blue_dma_ring_submit(dma, &d->rd, REG_RD_RING_HEAD, REG_RD_RING_DONE, &dma->rq_enqueued, sg, n);
+}
+
+ssize_t blue_dma_copy_sg_to(struct dma_engine *dma, const struct tlkm_dma_sg *sg, size_t n)
+{
+	struct blue_dma_data *d = (struct blue_dma_data *)dma->engine_data;
+	BUG_ON(! d);
+	return blue_dma_ring_submit(dma, &d->wr, REG_WR_RING_HEAD, REG_WR_RING_DONE, &dma->wq_enqueued, sg, n);
+}
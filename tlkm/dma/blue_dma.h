@@ -24,9 +24,12 @@
 #include "tlkm_types.h"
 
 int blue_dma_init(struct dma_engine *dma);
+void blue_dma_exit(struct dma_engine *dma);
 irqreturn_t blue_dma_intr_handler_read(int irq, void * dev_id);
 irqreturn_t blue_dma_intr_handler_write(int irq, void * dev_id);
 ssize_t blue_dma_copy_from(struct dma_engine *dma, void *krn_addr, dev_addr_t dev_addr, size_t len);
 ssize_t blue_dma_copy_to(struct dma_engine *dma, dev_addr_t dev_addr, const void *krn_addr, size_t len);
+ssize_t blue_dma_copy_sg_from(struct dma_engine *dma, const struct tlkm_dma_sg *sg, size_t n);
+ssize_t blue_dma_copy_sg_to(struct dma_engine *dma, const struct tlkm_dma_sg *sg, size_t n);
 
 #endif /* BLUE_DMA_H__ */
@@ -0,0 +1,115 @@
+//
+// Copyright (C) 2017 Jaco A. Hofmann, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	blue_dma_ring.h
+//! @brief	Descriptor ring bookkeeping for the BlueDMA scatter-gather mode.
+//!		The driver posts a chain of descriptors into a ring in coherent
+//!		memory and rings the doorbell once with the new head; the
+//!		engine walks the chain, raises a single interrupt on the
+//!		descriptor flagged with BLUE_DMA_DESC_F_IRQ and publishes its
+//!		free-running completion counter in a register. This header has
+//!		no kernel dependencies, so the ring logic can be exercised
+//!		against a software model of the engine (see tlkm/test).
+//!
+#ifndef BLUE_DMA_RING_H__
+#define BLUE_DMA_RING_H__
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#else
+#include <stdint.h>
+#include <stddef.h>
+typedef uint32_t u32;
+typedef uint64_t u64;
+#endif
+
+/** Number of descriptors per ring (must be a power of two). */
+#define BLUE_DMA_RING_DESCS			64
+#define BLUE_DMA_RING_MASK			(BLUE_DMA_RING_DESCS - 1)
+
+/** Raise completion interrupt after this descriptor (end of chain). */
+#define BLUE_DMA_DESC_F_IRQ			(1U << 0)
+
+/** Hardware descriptor, 32 bytes, as read by the engine. */
+struct blue_dma_desc {
+	u64 host_addr;
+	u64 fpga_addr;
+	u64 btt;
+	u32 flags;
+	u32 reserved;
+};
+
+/** Driver-side view of a descriptor ring; head and tail are free-running. */
+struct blue_dma_ring {
+	struct blue_dma_desc	*desc;
+	u32			head;	/* next descriptor to post */
+	u32			tail;	/* oldest descriptor not yet completed */
+};
+
+static inline
+void blue_dma_ring_init(struct blue_dma_ring *ring, struct blue_dma_desc *desc)
+{
+	ring->desc = desc;
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+static inline
+u32 blue_dma_ring_space(struct blue_dma_ring const *ring)
+{
+	return BLUE_DMA_RING_DESCS - (ring->head - ring->tail);
+}
+
+/**
+ * Releases all descriptors up to the engine's completion counter. Values
+ * outside of [tail, head] are stale or bogus and ignored.
+ * @param ring ring to reclaim.
+ * @param done free-running completion counter read from the engine.
+ * @return number of reclaimed descriptors.
+ **/
+static inline
+u32 blue_dma_ring_reclaim(struct blue_dma_ring *ring, u32 done)
+{
+	u32 const n = done - ring->tail;
+	if (n > ring->head - ring->tail) return 0;
+	ring->tail = done;
+	return n;
+}
+
+/**
+ * Posts a single descriptor at the head of the ring; does not ring the
+ * doorbell. Caller must check for space first.
+ * @return 0 on success, -1 if the ring is full.
+ **/
+static inline
+int blue_dma_ring_post(struct blue_dma_ring *ring, u64 host_addr, u64 fpga_addr,
+		u64 btt, int last)
+{
+	struct blue_dma_desc *d;
+	if (! blue_dma_ring_space(ring)) return -1;
+	d = &ring->desc[ring->head & BLUE_DMA_RING_MASK];
+	d->host_addr = host_addr;
+	d->fpga_addr = fpga_addr;
+	d->btt       = btt;
+	d->flags     = last ? BLUE_DMA_DESC_F_IRQ : 0;
+	d->reserved  = 0;
+	++ring->head;
+	return 0;
+}
+
+#endif /* BLUE_DMA_RING_H__ */
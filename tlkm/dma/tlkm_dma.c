@@ -2,14 +2,41 @@
 #include <linux/uaccess.h>
 #include <linux/slab.h>
 #include <linux/io.h>
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/log2.h>
+#include <linux/overflow.h>
+#include <linux/moduleparam.h>
 #include "tlkm_dma.h"
 #include "tlkm_logging.h"
 #include "tlkm_perfc.h"
 #include "blue_dma.h"
 #include "pcie/pcie_device.h"
+#include "tlkm_ioctl_cmds.h"
+#include "user/tlkm_device_ioctl_cmds.h"
 
 #define DMA_SZ						0x10000
 
+static ulong dma_chunk_sz[TLKM_DEVS_SZ];
+module_param_array(dma_chunk_sz, ulong, NULL, S_IRUGO);
+MODULE_PARM_DESC(dma_chunk_sz, "per device: max. size of DMA bounce buffers in bytes (power of 2, default 2 MiB)");
+
+static ulong dma_chunk_min_sz[TLKM_DEVS_SZ];
+module_param_array(dma_chunk_min_sz, ulong, NULL, S_IRUGO);
+MODULE_PARM_DESC(dma_chunk_min_sz, "per device: min. size of adaptive DMA chunks in bytes (power of 2, default: dma_chunk_sz, i.e., not adaptive)");
+
+static uint dma_chunks[TLKM_DEVS_SZ];
+module_param_array(dma_chunks, uint, NULL, S_IRUGO);
+MODULE_PARM_DESC(dma_chunks, "per device: number of DMA bounce buffers per direction (default 4)");
+
+static int dma_staging_bufs[TLKM_DEVS_SZ] = { [0 ... TLKM_DEVS_SZ - 1] = -1 };
+module_param_array(dma_staging_bufs, int, NULL, S_IRUGO);
+MODULE_PARM_DESC(dma_staging_bufs, "per device: number of user-mappable DMA staging buffers (default 4, 0 disables)");
+
+static ulong dma_staging_sz[TLKM_DEVS_SZ];
+module_param_array(dma_staging_sz, ulong, NULL, S_IRUGO);
+MODULE_PARM_DESC(dma_staging_sz, "per device: size of user-mappable DMA staging buffers in bytes (power of 2, default 2 MiB)");
+
 typedef struct {
 	size_t cpy_sz;
 	ssize_t t_id;
@@ -19,10 +46,13 @@ typedef struct {
 static const struct dma_operations tlkm_dma_ops[] = {
 	{
 		.init            = blue_dma_init,
+		.exit            = blue_dma_exit,
 		.intr_read	= blue_dma_intr_handler_read,
 		.intr_write	= blue_dma_intr_handler_write,
 		.copy_from	= blue_dma_copy_from,
 		.copy_to	= blue_dma_copy_to,
+		.copy_sg_from	= blue_dma_copy_sg_from,
+		.copy_sg_to	= blue_dma_copy_sg_to,
 		.allocate_buffer = pcie_device_dma_allocate_buffer,
 		.free_buffer 	 = pcie_device_dma_free_buffer,
 		.buffer_cpu      = pcie_device_dma_sync_buffer_cpu,
@@ -30,10 +60,13 @@ static const struct dma_operations tlkm_dma_ops[] = {
 	},
 	{
 		.init            = 0,
+		.exit            = 0,
 		.intr_read	= 0,
 		.intr_write	= 0,
 		.copy_from	= 0,
 		.copy_to	= 0,
+		.copy_sg_from	= 0,
+		.copy_sg_to	= 0,
 		.allocate_buffer = 0,
 		.free_buffer 	 = 0,
 		.buffer_cpu      = 0,
@@ -41,6 +74,141 @@ static const struct dma_operations tlkm_dma_ops[] = {
 	}
 };
 
+static void tlkm_dma_configure(struct dma_engine *dma)
+{
+	dev_id_t const dev_id = dma->dev_id;
+	size_t chunk_sz = dev_id < TLKM_DEVS_SZ ? dma_chunk_sz[dev_id] : 0;
+	size_t chunk_min_sz = dev_id < TLKM_DEVS_SZ ? dma_chunk_min_sz[dev_id] : 0;
+	size_t chunks = dev_id < TLKM_DEVS_SZ ? dma_chunks[dev_id] : 0;
+
+	if (! chunk_sz) chunk_sz = TLKM_DMA_CHUNK_SZ;
+	if (! chunks) chunks = TLKM_DMA_CHUNKS;
+
+	if (! is_power_of_2(chunk_sz) || chunk_sz > TLKM_DMA_CHUNK_MAX_SZ) {
+		DEVWRN(dev_id, "invalid dma_chunk_sz %zu, using %zu", chunk_sz, TLKM_DMA_CHUNK_SZ);
+		chunk_sz = TLKM_DMA_CHUNK_SZ;
+	}
+	if (! chunk_min_sz) chunk_min_sz = chunk_sz;
+	if (! is_power_of_2(chunk_min_sz) || chunk_min_sz > chunk_sz) {
+		DEVWRN(dev_id, "invalid dma_chunk_min_sz %zu, using %zu", chunk_min_sz, chunk_sz);
+		chunk_min_sz = chunk_sz;
+	}
+	if (chunks < 2 || chunks > TLKM_DMA_MAX_CHUNKS) {
+		DEVWRN(dev_id, "invalid dma_chunks %zu, using %d", chunks, TLKM_DMA_CHUNKS);
+		chunks = TLKM_DMA_CHUNKS;
+	}
+
+	dma->chunk_sz = chunk_sz;
+	dma->chunk_min_sz = chunk_min_sz;
+	dma->chunks = chunks;
+	DEVLOG(dev_id, TLKM_LF_DMA, "bounce buffers: %zu x %zu bytes, min. chunk size: %zu bytes",
+			chunks, chunk_sz, chunk_min_sz);
+}
+
+static void tlkm_dma_configure_staging(struct dma_engine *dma)
+{
+	dev_id_t const dev_id = dma->dev_id;
+	int bufs = dev_id < TLKM_DEVS_SZ ? dma_staging_bufs[dev_id] : -1;
+	size_t sz = dev_id < TLKM_DEVS_SZ ? dma_staging_sz[dev_id] : 0;
+
+	if (bufs < 0) bufs = TLKM_DMA_STAGING_BUFS;
+	if (! sz) sz = TLKM_DMA_STAGING_SZ;
+
+	if (bufs > TLKM_DMA_MAX_STAGING_BUFS) {
+		DEVWRN(dev_id, "invalid dma_staging_bufs %d, using %d", bufs, TLKM_DMA_MAX_STAGING_BUFS);
+		bufs = TLKM_DMA_MAX_STAGING_BUFS;
+	}
+	if (! is_power_of_2(sz) || sz < PAGE_SIZE || sz > TLKM_DMA_CHUNK_MAX_SZ) {
+		DEVWRN(dev_id, "invalid dma_staging_sz %zu, using %zu", sz, TLKM_DMA_STAGING_SZ);
+		sz = TLKM_DMA_STAGING_SZ;
+	}
+
+	dma->staging_bufs = bufs;
+	dma->staging_sz = sz;
+}
+
+/* Staging buffers are optional: failure to allocate only disables them. */
+static void tlkm_dma_alloc_staging(struct dma_engine *dma)
+{
+	struct tlkm_device *dev = dma->dev;
+	int i;
+	tlkm_dma_configure_staging(dma);
+	spin_lock_init(&dma->staging_lock);
+	for (i = 0; i < dma->staging_bufs; ++i) {
+		memset(&dma->staging_owner[i], 0, sizeof(dma->staging_owner[i]));
+		dma->staging_owner[i].dma = dma;
+		if (dma->ops.allocate_buffer(dev->dev_id, dev, &dma->staging[i], &dma->staging_dev[i], TO_DEV, dma->staging_sz)) {
+			DEVWRN(dma->dev_id, "failed to allocate staging buffer #%d, disabling staging buffers", i);
+			dma->ops.free_buffer(dev->dev_id, dev, &dma->staging[i], &dma->staging_dev[i], TO_DEV, dma->staging_sz);
+			for (i -= 1; i >= 0; --i)
+				dma->ops.free_buffer(dev->dev_id, dev, &dma->staging[i], &dma->staging_dev[i], TO_DEV, dma->staging_sz);
+			dma->staging_bufs = 0;
+			return;
+		}
+	}
+	DEVLOG(dma->dev_id, TLKM_LF_DMA, "staging buffers: %zu x %zu bytes", dma->staging_bufs, dma->staging_sz);
+}
+
+static void tlkm_dma_free_staging(struct dma_engine *dma)
+{
+	struct tlkm_device *dev = dma->dev;
+	int i;
+	for (i = 0; i < dma->staging_bufs; ++i)
+		dma->ops.free_buffer(dev->dev_id, dev, &dma->staging[i], &dma->staging_dev[i], TO_DEV, dma->staging_sz);
+	dma->staging_bufs = 0;
+}
+
+/* Chunk size for a single request: spread the transfer over all buffers. */
+static inline size_t tlkm_dma_request_chunk_sz(struct dma_engine *dma, size_t len)
+{
+	size_t sz = DIV_ROUND_UP(len, dma->chunks);
+	if (sz <= dma->chunk_min_sz) return dma->chunk_min_sz;
+	if (sz >= dma->chunk_sz) return dma->chunk_sz;
+	return roundup_pow_of_two(sz);
+}
+
+/* Position in the segments of a (vectored) copy. */
+struct tlkm_dma_cursor {
+	const struct tlkm_copy_cmd	*segs;
+	size_t				num_segs;
+	size_t				seg;
+	size_t				off;
+};
+
+/* Returns the length of the next piece of at most max bytes, 0 at the end. */
+static inline size_t tlkm_dma_cursor_next(struct tlkm_dma_cursor *c, size_t max, void __user **usr_addr, dev_addr_t *dev_addr)
+{
+	size_t sz;
+	while (c->seg < c->num_segs && c->off >= c->segs[c->seg].length) {
+		++c->seg;
+		c->off = 0;
+	}
+	if (c->seg >= c->num_segs) return 0;
+	sz = c->segs[c->seg].length - c->off;
+	if (sz > max) sz = max;
+	*usr_addr = (void __user *)c->segs[c->seg].user_addr + c->off;
+	*dev_addr = c->segs[c->seg].dev_addr + c->off;
+	c->off += sz;
+	return sz;
+}
+
+/* Checks the alignment of all segments, returns their total length or < 0. */
+static ssize_t tlkm_dma_check_segs(struct dma_engine *dma, const struct tlkm_copy_cmd *segs, size_t num_segs)
+{
+	size_t i, total = 0;
+	for (i = 0; i < num_segs; ++i) {
+		if ((segs[i].dev_addr % dma->alignment) != 0) {
+			DEVERR(dma->dev_id, "Transfer is not properly aligned for dma engine. All transfers have to be aligned to %d bytes.", dma->alignment);
+			return -EAGAIN;
+		}
+		if (check_add_overflow(total, segs[i].length, &total) || total > SSIZE_MAX) {
+			DEVERR(dma->dev_id, "total length of %zu segments is too large", num_segs);
+			return -EINVAL;
+		}
+	}
+	return total;
+}
+
 int tlkm_dma_init(struct tlkm_device *dev, struct dma_engine *dma, u64 dbase)
 {
 	dev_id_t dev_id = dev->dev_id;
@@ -58,6 +226,7 @@ int tlkm_dma_init(struct tlkm_device *dev, struct dma_engine *dma, u64 dbase)
 	dma->dev_id = dev_id;
 	dma->base = base;
 	dma->dev = dev;
+	tlkm_dma_configure(dma);
 
 	DEVLOG(dev_id, TLKM_LF_DMA, "I/O remapping 0x%px - 0x%px...", base, base + DMA_SZ - 1);
 	dma->regs = ioremap_nocache((resource_size_t)base, DMA_SZ);
@@ -82,38 +251,47 @@ int tlkm_dma_init(struct tlkm_device *dev, struct dma_engine *dma, u64 dbase)
 		goto err_unknown_dma;
 	}
 
-	DEVLOG(dev_id, TLKM_LF_DMA, "allocating DMA buffers of 2 x %d x %zd bytes ...", TLKM_DMA_CHUNKS, TLKM_DMA_CHUNK_SZ);
+	DEVLOG(dev_id, TLKM_LF_DMA, "allocating DMA buffers of 2 x %zd x %zd bytes ...", dma->chunks, dma->chunk_sz);
 
-	for (i = 0; i < TLKM_DMA_CHUNKS; ++i) {
-		ret = dma->ops.allocate_buffer(dev->dev_id, dev, &dma->dma_buf_read[i], &dma->dma_buf_read_dev[i], FROM_DEV, TLKM_DMA_CHUNK_SZ);
+	for (i = 0; i < dma->chunks; ++i) {
+		ret = dma->ops.allocate_buffer(dev->dev_id, dev, &dma->dma_buf_read[i], &dma->dma_buf_read_dev[i], FROM_DEV, dma->chunk_sz);
 		if (ret) {
 			ret = PTR_ERR(dma->dma_buf_read[i]);
-			DEVERR(dev_id, "failed to allocate %zd bytes for read direction", TLKM_DMA_CHUNK_SZ);
+			DEVERR(dev_id, "failed to allocate %zd bytes for read direction", dma->chunk_sz);
 			goto err_dma_bufs_read;
 		}
 	}
 
-	for (i = 0; i < TLKM_DMA_CHUNKS; ++i) {
-		ret = dma->ops.allocate_buffer(dev->dev_id, dev, &dma->dma_buf_write[i], &dma->dma_buf_write_dev[i], TO_DEV, TLKM_DMA_CHUNK_SZ);
+	for (i = 0; i < dma->chunks; ++i) {
+		ret = dma->ops.allocate_buffer(dev->dev_id, dev, &dma->dma_buf_write[i], &dma->dma_buf_write_dev[i], TO_DEV, dma->chunk_sz);
 		if (ret) {
 			ret = PTR_ERR(dma->dma_buf_write[i]);
-			DEVERR(dev_id, "failed to allocate %zd bytes for write direction", TLKM_DMA_CHUNK_SZ);
+			DEVERR(dev_id, "failed to allocate %zd bytes for write direction", dma->chunk_sz);
 			goto err_dma_bufs_write;
 		}
 	}
 
-	DEVLOG(dev_id, TLKM_LF_DMA, "DMA engine initialized");
+	tlkm_dma_alloc_staging(dma);
+
+	if (! dma->ops.copy_sg_to || ! dma->ops.copy_sg_from)
+		dma->sg_depth = 0;
+	else if (dma->sg_depth < TLKM_DMA_SG_BATCH(dma))
+		dma->sg_depth = 0;
+
+	DEVLOG(dev_id, TLKM_LF_DMA, "DMA engine initialized%s", dma->sg_depth ? " (scatter-gather)" : "");
 	return 0;
 
 err_dma_bufs_write:
 	for (i -= 1; i >= 0; --i) {
-		dma->ops.free_buffer(dev->dev_id, dev, &dma->dma_buf_write[i], &dma->dma_buf_write_dev[i], TO_DEV, TLKM_DMA_CHUNK_SZ);
+		dma->ops.free_buffer(dev->dev_id, dev, &dma->dma_buf_write[i], &dma->dma_buf_write_dev[i], TO_DEV, dma->chunk_sz);
 	}
-	i = TLKM_DMA_CHUNKS;
+	i = dma->chunks;
 err_dma_bufs_read:
 	for (i -= 1; i >= 0; --i) {
-		dma->ops.free_buffer(dev->dev_id, dev, &dma->dma_buf_read[i], &dma->dma_buf_read_dev[i], FROM_DEV, TLKM_DMA_CHUNK_SZ);
+		dma->ops.free_buffer(dev->dev_id, dev, &dma->dma_buf_read[i], &dma->dma_buf_read_dev[i], FROM_DEV, dma->chunk_sz);
 	}
+	if (dma->ops.exit)
+		dma->ops.exit(dma);
 err_unknown_dma:
 	iounmap(dma->regs);
 	dma->regs = 0;
@@ -127,10 +305,13 @@ void tlkm_dma_exit(struct dma_engine *dma)
 	if (dma->regs != 0 && !IS_ERR(dma->regs)) {
 		struct tlkm_device *dev = dma->dev;
 		DEVLOG(dma->dev_id, TLKM_LF_DMA, "freeing buffers");
-		for (i = 0; i < TLKM_DMA_CHUNKS; ++i) {
-			dma->ops.free_buffer(dev->dev_id, dev, &dma->dma_buf_write[i], &dma->dma_buf_write_dev[i], TO_DEV, TLKM_DMA_CHUNK_SZ);
-			dma->ops.free_buffer(dev->dev_id, dev, &dma->dma_buf_read[i], &dma->dma_buf_read_dev[i], FROM_DEV, TLKM_DMA_CHUNK_SZ);
+		for (i = 0; i < dma->chunks; ++i) {
+			dma->ops.free_buffer(dev->dev_id, dev, &dma->dma_buf_write[i], &dma->dma_buf_write_dev[i], TO_DEV, dma->chunk_sz);
+			dma->ops.free_buffer(dev->dev_id, dev, &dma->dma_buf_read[i], &dma->dma_buf_read_dev[i], FROM_DEV, dma->chunk_sz);
 		}
+		tlkm_dma_free_staging(dma);
+		if (dma->ops.exit)
+			dma->ops.exit(dma);
 		DEVLOG(dma->dev_id, TLKM_LF_DMA, "unmapping IO memory");
 		iounmap(dma->regs);
 		memset(dma, 0, sizeof(*dma));
@@ -138,29 +319,150 @@ void tlkm_dma_exit(struct dma_engine *dma)
 	}
 }
 
-ssize_t tlkm_dma_copy_to(struct dma_engine *dma, dev_addr_t dev_addr, const void __user *usr_addr, size_t len)
+static ssize_t tlkm_dma_copy_to_sg(struct dma_engine *dma, struct tlkm_dma_cursor *cur, size_t len)
 {
 	struct tlkm_device *dev = dma->dev;
-	size_t cpy_sz = len;
-	int i;
-	int current_buffer = 0;
-	ssize_t t_ids[TLKM_DMA_CHUNKS];
-	if ((dev_addr % dma->alignment) != 0) {
-		DEVERR(dma->dev_id, "Transfer is not properly aligned for dma engine. All transfers have to be aligned to %d bytes.", dma->alignment);
+	struct tlkm_dma_sg sg[TLKM_DMA_MAX_CHUNKS / 2];
+	ssize_t t_ids[2] = { 0, 0 };
+	size_t const batch = TLKM_DMA_SG_BATCH(dma);
+	size_t const chunk_sz = tlkm_dma_request_chunk_sz(dma, len);
+	size_t const total = len;
+	size_t cpy_sz, n;
+	void __user *usr_addr;
+	dev_addr_t dev_addr;
+	int b = 0, i;
+
+	while (len > 0) {
+		if (wait_event_interruptible(dma->wq, atomic64_read(&dma->wq_processed) >= t_ids[b])) {
+			DEVWRN(dma->dev_id, "got killed while hanging in waiting queue");
+			return -EACCES;
+		}
+		for (n = 0; n < batch && len > 0; ++n) {
+			int const c = b * batch + n;
+			cpy_sz = tlkm_dma_cursor_next(cur, chunk_sz, &usr_addr, &dev_addr);
+			dma->ops.buffer_cpu(dev->dev_id, dev, &dma->dma_buf_write[c], &dma->dma_buf_write_dev[c], TO_DEV, cpy_sz);
+			if (copy_from_user(dma->dma_buf_write[c], usr_addr, cpy_sz)) {
+				DEVERR(dma->dev_id, "could not copy data from user");
+				return -EAGAIN;
+			}
+			dma->ops.buffer_dev(dev->dev_id, dev, &dma->dma_buf_write[c], &dma->dma_buf_write_dev[c], TO_DEV, cpy_sz);
+			sg[n].dma_handle = dma->dma_buf_write_dev[c];
+			sg[n].dev_addr	 = dev_addr;
+			sg[n].len	 = cpy_sz;
+			len		-= cpy_sz;
+		}
+		DEVLOG(dma->dev_id, TLKM_LF_DMA, "queueing chain of %zu chunks, outstanding bytes: %zd", n, len);
+		t_ids[b] = dma->ops.copy_sg_to(dma, sg, n);
+		if (t_ids[b] < 0) return t_ids[b];
+		b ^= 1;
+	}
+
+	for (i = 0; i < 2; ++i) {
+		if (wait_event_interruptible(dma->wq, atomic64_read(&dma->wq_processed) >= t_ids[i])) {
+			DEVWRN(dma->dev_id, "got killed while hanging in waiting queue");
+			return -EACCES;
+		}
+	}
+
+	tlkm_perfc_dma_writes_add(dma->dev_id, total);
+	return 0;
+}
+
+static int tlkm_dma_chunk_to_user(struct dma_engine *dma, int c, chunk_data_t *chunk)
+{
+	struct tlkm_device *dev = dma->dev;
+	if (chunk->usr_addr == 0) return 0;
+	dma->ops.buffer_cpu(dev->dev_id, dev, &dma->dma_buf_read[c], &dma->dma_buf_read_dev[c], FROM_DEV, chunk->cpy_sz);
+	if (copy_to_user(chunk->usr_addr, dma->dma_buf_read[c], chunk->cpy_sz)) {
+		DEVERR(dma->dev_id, "could not copy data to user");
 		return -EAGAIN;
 	}
-	for (i = 0; i < TLKM_DMA_CHUNKS; ++i) {
+	chunk->usr_addr = 0;
+	return 0;
+}
+
+static ssize_t tlkm_dma_copy_from_sg(struct dma_engine *dma, struct tlkm_dma_cursor *cur, size_t len)
+{
+	struct tlkm_device *dev = dma->dev;
+	struct tlkm_dma_sg sg[TLKM_DMA_MAX_CHUNKS / 2];
+	chunk_data_t chunks[TLKM_DMA_MAX_CHUNKS];
+	ssize_t t_ids[2] = { 0, 0 };
+	size_t const batch = TLKM_DMA_SG_BATCH(dma);
+	size_t const chunk_sz = tlkm_dma_request_chunk_sz(dma, len);
+	size_t const total = len;
+	size_t cpy_sz, n;
+	void __user *usr_addr;
+	dev_addr_t dev_addr;
+	int b = 0, i, r;
+
+	memset(chunks, 0, sizeof(chunks));
+
+	while (len > 0) {
+		if (wait_event_interruptible(dma->rq, atomic64_read(&dma->rq_processed) >= t_ids[b])) {
+			DEVWRN(dma->dev_id, "got killed while hanging in waiting queue");
+			return -EACCES;
+		}
+		for (n = 0; n < batch; ++n)
+			if ((r = tlkm_dma_chunk_to_user(dma, b * batch + n, &chunks[b * batch + n]))) return r;
+		for (n = 0; n < batch && len > 0; ++n) {
+			int const c = b * batch + n;
+			cpy_sz = tlkm_dma_cursor_next(cur, chunk_sz, &usr_addr, &dev_addr);
+			dma->ops.buffer_dev(dev->dev_id, dev, &dma->dma_buf_read[c], &dma->dma_buf_read_dev[c], FROM_DEV, cpy_sz);
+			sg[n].dma_handle   = dma->dma_buf_read_dev[c];
+			sg[n].dev_addr	   = dev_addr;
+			sg[n].len	   = cpy_sz;
+			chunks[c].usr_addr = usr_addr;
+			chunks[c].cpy_sz   = cpy_sz;
+			len		-= cpy_sz;
+		}
+		DEVLOG(dma->dev_id, TLKM_LF_DMA, "queueing chain of %zu chunks, outstanding bytes: %zd", n, len);
+		t_ids[b] = dma->ops.copy_sg_from(dma, sg, n);
+		if (t_ids[b] < 0) return t_ids[b];
+		b ^= 1;
+	}
+
+	for (i = 0; i < 2; ++i) {
+		if (wait_event_interruptible(dma->rq, atomic64_read(&dma->rq_processed) >= t_ids[b])) {
+			DEVWRN(dma->dev_id, "got killed while hanging in waiting queue");
+			return -EACCES;
+		}
+		for (n = 0; n < batch; ++n)
+			if ((r = tlkm_dma_chunk_to_user(dma, b * batch + n, &chunks[b * batch + n]))) return r;
+		b ^= 1;
+	}
+
+	tlkm_perfc_dma_reads_add(dma->dev_id, total);
+	return 0;
+}
+
+ssize_t tlkm_dma_copy_to_v(struct dma_engine *dma, const struct tlkm_copy_cmd *segs, size_t num_segs)
+{
+	struct tlkm_device *dev = dma->dev;
+	struct tlkm_dma_cursor cur = { .segs = segs, .num_segs = num_segs, };
+	ssize_t const total = tlkm_dma_check_segs(dma, segs, num_segs);
+	size_t len = total;
+	size_t const chunk_sz = tlkm_dma_request_chunk_sz(dma, len);
+	size_t cpy_sz;
+	void __user *usr_addr;
+	dev_addr_t dev_addr;
+	int i;
+	int current_buffer = 0;
+	ssize_t t_ids[TLKM_DMA_MAX_CHUNKS];
+	if (total < 0) return total;
+	for (i = 0; i < dma->chunks; ++i) {
 		t_ids[i] = 0;
 	}
 
 	atomic64_set(&dma->wq_enqueued, 0);
 	atomic64_set(&dma->wq_processed, 0);
 
-	while (len > 0) {
+	if (dma->sg_depth)
+		return tlkm_dma_copy_to_sg(dma, &cur, len);
+
+	while ((cpy_sz = tlkm_dma_cursor_next(&cur, chunk_sz, &usr_addr, &dev_addr)) > 0) {
 		DEVLOG(dma->dev_id, TLKM_LF_DMA, "outstanding bytes: %zd - usr_addr = 0x%px, dev_addr = 0x%px",
 		       len, usr_addr, (void *)dev_addr);
 		DEVLOG(dma->dev_id, TLKM_LF_DMA, "using buffer: %d and waiting for t_id == %zd", current_buffer, t_ids[current_buffer]);
-		cpy_sz = len < TLKM_DMA_CHUNK_SZ ? len : TLKM_DMA_CHUNK_SZ;
 		if (wait_event_interruptible(dma->wq, atomic64_read(&dma->wq_processed) >= t_ids[current_buffer])) {
 			DEVWRN(dma->dev_id, "got killed while hanging in waiting queue");
 			return -EACCES;
@@ -174,91 +476,213 @@ ssize_t tlkm_dma_copy_to(struct dma_engine *dma, dev_addr_t dev_addr, const void
 			dma->ops.buffer_dev(dev->dev_id, dev, &dma->dma_buf_write[current_buffer], &dma->dma_buf_write_dev[current_buffer], TO_DEV, cpy_sz);
 			t_ids[current_buffer] = dma->ops.copy_to(dma, dev_addr, dma->dma_buf_write_dev[current_buffer], cpy_sz);
 
-			usr_addr	+= cpy_sz;
-			dev_addr	+= cpy_sz;
 			len		-= cpy_sz;
-			current_buffer = (current_buffer + 1) % TLKM_DMA_CHUNKS;
+			current_buffer = (current_buffer + 1) % dma->chunks;
 		}
 	}
 
-	for (i = 0; i < TLKM_DMA_CHUNKS; ++i) {
+	for (i = 0; i < dma->chunks; ++i) {
 		if (wait_event_interruptible(dma->wq, atomic64_read(&dma->wq_processed) >= t_ids[i])) {
 			DEVWRN(dma->dev_id, "got killed while hanging in waiting queue");
 			return -EACCES;
 		}
 	}
 
-	tlkm_perfc_dma_writes_add(dma->dev_id, len);
+	tlkm_perfc_dma_writes_add(dma->dev_id, total);
 	return len;
 }
 
-ssize_t tlkm_dma_copy_from(struct dma_engine *dma, void __user *usr_addr, dev_addr_t dev_addr, size_t len)
+ssize_t tlkm_dma_copy_to(struct dma_engine *dma, dev_addr_t dev_addr, const void __user *usr_addr, size_t len)
+{
+	struct tlkm_copy_cmd const seg = { .length = len, .user_addr = (void *)usr_addr, .dev_addr = dev_addr, };
+	return tlkm_dma_copy_to_v(dma, &seg, 1);
+}
+
+ssize_t tlkm_dma_copy_from_v(struct dma_engine *dma, const struct tlkm_copy_cmd *segs, size_t num_segs)
 {
 	struct tlkm_device *dev = dma->dev;
-	size_t cpy_sz = len;
-	int i;
-	int current_buffer = 0;
-	chunk_data_t chunks[TLKM_DMA_CHUNKS];
-	if ((dev_addr % dma->alignment) != 0) {
-		DEVERR(dma->dev_id, "Transfer is not properly aligned for dma engine. All transfers have to be aligned to %d bytes.", dma->alignment);
-		return -EAGAIN;
-	}
-	for (i = 0; i < TLKM_DMA_CHUNKS; ++i) {
-		chunks[i].t_id = 0;
-		chunks[i].usr_addr = 0;
-		chunks[i].cpy_sz = 0;
-	}
+	struct tlkm_dma_cursor cur = { .segs = segs, .num_segs = num_segs, };
+	ssize_t const total = tlkm_dma_check_segs(dma, segs, num_segs);
+	size_t len = total;
+	size_t const chunk_sz = tlkm_dma_request_chunk_sz(dma, len);
+	size_t cpy_sz;
+	size_t inflight = 0;
+	void __user *usr_addr;
+	dev_addr_t dev_addr;
+	int issue = 0, drain = 0, r;
+	chunk_data_t chunks[TLKM_DMA_MAX_CHUNKS];
+	if (total < 0) return total;
+	memset(chunks, 0, sizeof(chunks));
 
 	atomic64_set(&dma->rq_enqueued, 0);
 	atomic64_set(&dma->rq_processed, 0);
 
-	while (len > 0) {
-		DEVLOG(dma->dev_id, TLKM_LF_DMA, "outstanding bytes: %zd - usr_addr = 0x%px, dev_addr = 0x%px",
-		       len, usr_addr, (void *)dev_addr);
-		DEVLOG(dma->dev_id, TLKM_LF_DMA, "using buffer: %d and waiting for t_id == %zd", current_buffer, chunks[current_buffer].t_id);
-		if (wait_event_interruptible(dma->rq, atomic64_read(&dma->rq_processed) >= chunks[current_buffer].t_id)) {
+	if (dma->sg_depth)
+		return tlkm_dma_copy_from_sg(dma, &cur, len);
+
+	while (len > 0 || inflight > 0) {
+		// top up the engine before copying anything out, so that the
+		// copy_to_user below overlaps with the queued transfers
+		while (inflight < dma->chunks &&
+				(cpy_sz = tlkm_dma_cursor_next(&cur, chunk_sz, &usr_addr, &dev_addr)) > 0) {
+			DEVLOG(dma->dev_id, TLKM_LF_DMA, "outstanding bytes: %zd - usr_addr = 0x%px, dev_addr = 0x%px, buffer: %d",
+			       len, usr_addr, (void *)dev_addr, issue);
+			dma->ops.buffer_dev(dev->dev_id, dev, &dma->dma_buf_read[issue], &dma->dma_buf_read_dev[issue], FROM_DEV, cpy_sz);
+			chunks[issue].t_id = dma->ops.copy_from(dma, dma->dma_buf_read_dev[issue], dev_addr, cpy_sz);
+			chunks[issue].usr_addr = usr_addr;
+			chunks[issue].cpy_sz = cpy_sz;
+
+			len		-= cpy_sz;
+			issue = (issue + 1) % dma->chunks;
+			++inflight;
+		}
+
+		DEVLOG(dma->dev_id, TLKM_LF_DMA, "draining buffer: %d and waiting for t_id == %zd", drain, chunks[drain].t_id);
+		if (wait_event_interruptible(dma->rq, atomic64_read(&dma->rq_processed) >= chunks[drain].t_id)) {
 			DEVWRN(dma->dev_id, "got killed while hanging in waiting queue");
 			return -EACCES;
 		}
-		if (chunks[current_buffer].usr_addr != 0) {
-			dma->ops.buffer_cpu(dev->dev_id, dev, &dma->dma_buf_read[current_buffer], &dma->dma_buf_read_dev[current_buffer], FROM_DEV, chunks[current_buffer].cpy_sz);
-			if (copy_to_user(chunks[current_buffer].usr_addr, dma->dma_buf_read[current_buffer], chunks[current_buffer].cpy_sz)) {
-				DEVERR(dma->dev_id, "could not copy data to user");
-				return -EAGAIN;
-			}
-			chunks[current_buffer].usr_addr = 0;
-		}
+		if ((r = tlkm_dma_chunk_to_user(dma, drain, &chunks[drain]))) return r;
+		drain = (drain + 1) % dma->chunks;
+		--inflight;
+	}
 
-		cpy_sz = len < TLKM_DMA_CHUNK_SZ ? len : TLKM_DMA_CHUNK_SZ;
-		dma->ops.buffer_dev(dev->dev_id, dev, &dma->dma_buf_read[current_buffer], &dma->dma_buf_read_dev[current_buffer], FROM_DEV, cpy_sz);
-		chunks[current_buffer].t_id = dma->ops.copy_from(dma, dma->dma_buf_read_dev[current_buffer], dev_addr, cpy_sz);
+	tlkm_perfc_dma_reads_add(dma->dev_id, total);
+	return len;
+}
+
+ssize_t tlkm_dma_copy_from(struct dma_engine *dma, void __user *usr_addr, dev_addr_t dev_addr, size_t len)
+{
+	struct tlkm_copy_cmd const seg = { .length = len, .user_addr = usr_addr, .dev_addr = dev_addr, };
+	return tlkm_dma_copy_from_v(dma, &seg, 1);
+}
 
-		chunks[current_buffer].usr_addr = usr_addr;
-		chunks[current_buffer].cpy_sz = cpy_sz;
+static void tlkm_dma_staging_vm_open(struct vm_area_struct *vm)
+{
+	struct tlkm_dma_staging_owner *o = vm->vm_private_data;
+	spin_lock(&o->dma->staging_lock);
+	++o->maps;
+	spin_unlock(&o->dma->staging_lock);
+}
 
-		usr_addr	+= cpy_sz;
-		dev_addr	+= cpy_sz;
-		len		-= cpy_sz;
-		current_buffer = (current_buffer + 1) % TLKM_DMA_CHUNKS;
+/* Drops a reference to a staging buffer; the last one releases the claim. */
+static void tlkm_dma_staging_put(struct tlkm_dma_staging_owner *o)
+{
+	spin_lock(&o->dma->staging_lock);
+	if (! --o->maps) {
+		o->fp = NULL;
+		o->mm = NULL;
 	}
+	spin_unlock(&o->dma->staging_lock);
+}
 
+static void tlkm_dma_staging_vm_close(struct vm_area_struct *vm)
+{
+	tlkm_dma_staging_put(vm->vm_private_data);
+}
 
-	for (i = 0; i < TLKM_DMA_CHUNKS; ++i) {
-		if (wait_event_interruptible(dma->rq, atomic64_read(&dma->rq_processed) >= chunks[i].t_id)) {
-			DEVWRN(dma->dev_id, "got killed while hanging in waiting queue");
-			return -EACCES;
-		}
+static const struct vm_operations_struct tlkm_dma_staging_vm_ops = {
+	.open  = tlkm_dma_staging_vm_open,
+	.close = tlkm_dma_staging_vm_close,
+};
 
-		if (chunks[i].usr_addr != 0) {
-			dma->ops.buffer_cpu(dev->dev_id, dev, &dma->dma_buf_read[i], &dma->dma_buf_read_dev[i], FROM_DEV, chunks[i].cpy_sz);
-			if (copy_to_user(chunks[i].usr_addr, dma->dma_buf_read[i], chunks[i].cpy_sz)) {
-				DEVERR(dma->dev_id, "could not copy data to user");
-				return -EAGAIN;
-			}
-			chunks[i].usr_addr = 0;
-		}
+/* Claims staging buffer idx for file fp; fails if another file owns it. */
+static int tlkm_dma_staging_claim(struct dma_engine *dma, size_t idx, struct file *fp, struct mm_struct *mm)
+{
+	struct tlkm_dma_staging_owner *o = &dma->staging_owner[idx];
+	int ret = 0;
+	spin_lock(&dma->staging_lock);
+	if (! o->fp) {
+		o->fp = fp;
+		o->mm = mm;
+	} else if (o->fp != fp || o->mm != mm) {
+		ret = -EBUSY;
 	}
+	if (! ret) ++o->maps;
+	spin_unlock(&dma->staging_lock);
+	return ret;
+}
 
-	tlkm_perfc_dma_reads_add(dma->dev_id, len);
-	return len;
+int tlkm_dma_staging_mmap(struct dma_engine *dma, struct file *fp, ulong off, struct vm_area_struct *vm)
+{
+	size_t const sz = vm->vm_end - vm->vm_start;
+	size_t idx;
+	int ret;
+	if (! dma->staging_bufs) {
+		DEVWRN(dma->dev_id, "staging buffers are not available");
+		return -ENXIO;
+	}
+	idx = off / dma->staging_sz;
+	if (off % dma->staging_sz || idx >= dma->staging_bufs || sz > dma->staging_sz) {
+		DEVERR(dma->dev_id, "invalid staging buffer mapping: offset = 0x%08lx, size = %zu", off, sz);
+		return -ENXIO;
+	}
+	if ((ret = tlkm_dma_staging_claim(dma, idx, fp, vm->vm_mm))) {
+		DEVWRN(dma->dev_id, "staging buffer #%zu is in use by another file", idx);
+		return ret;
+	}
+	DEVLOG(dma->dev_id, TLKM_LF_DMA, "mapping staging buffer #%zu to user space 0x%lx-0x%lx",
+			idx, vm->vm_start, vm->vm_end);
+	// the owner is identified by its address space, do not pass it on to children
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6,3,0)
+	vm->vm_flags |= VM_DONTCOPY;
+#else
+	vm_flags_set(vm, VM_DONTCOPY);
+#endif
+	vm->vm_private_data = &dma->staging_owner[idx];
+	if (remap_pfn_range(vm, vm->vm_start, virt_to_phys(dma->staging[idx]) >> PAGE_SHIFT, sz, vm->vm_page_prot)) {
+		DEVWRN(dma->dev_id, "remap_pfn_range failed!");
+		tlkm_dma_staging_vm_close(vm);
+		return -EAGAIN;
+	}
+	// set only now: release of the claim on failure is not left to the mm
+	vm->vm_ops = &tlkm_dma_staging_vm_ops;
+	return 0;
+}
+
+ssize_t tlkm_dma_copy_staged(struct dma_engine *dma, size_t buf_idx, size_t offset, dev_addr_t dev_addr, size_t len)
+{
+	struct tlkm_device *dev = dma->dev;
+	struct tlkm_dma_staging_owner *o;
+	dma_addr_t handle;
+	ssize_t t_id;
+	ssize_t ret = 0;
+	if (buf_idx >= dma->staging_bufs || offset > dma->staging_sz || len > dma->staging_sz - offset) {
+		DEVERR(dma->dev_id, "invalid staged copy: buffer #%zu, offset = %zu, length = %zu", buf_idx, offset, len);
+		return -EINVAL;
+	}
+	handle = (dma_addr_t)(uintptr_t)dma->staging_dev[buf_idx] + offset;
+	if ((dev_addr % dma->alignment) != 0 || (handle % dma->alignment) != 0) {
+		DEVERR(dma->dev_id, "Transfer is not properly aligned for dma engine. All transfers have to be aligned to %d bytes.", dma->alignment);
+		return -EAGAIN;
+	}
+	// hold a reference for the copy: the buffer cannot be unmapped and
+	// claimed by another file while the engine reads it
+	o = &dma->staging_owner[buf_idx];
+	spin_lock(&dma->staging_lock);
+	if (! o->maps || o->mm != current->mm) {
+		spin_unlock(&dma->staging_lock);
+		DEVERR(dma->dev_id, "staging buffer #%zu is not mapped by this process", buf_idx);
+		return -EPERM;
+	}
+	++o->maps;
+	spin_unlock(&dma->staging_lock);
+
+	atomic64_set(&dma->wq_enqueued, 0);
+	atomic64_set(&dma->wq_processed, 0);
+
+	DEVLOG(dma->dev_id, TLKM_LF_DMA, "staged copy: buffer #%zu + %zu -> 0x%px, %zu bytes",
+			buf_idx, offset, (void *)dev_addr, len);
+	dma->ops.buffer_dev(dev->dev_id, dev, &dma->staging[buf_idx], &dma->staging_dev[buf_idx], TO_DEV, offset + len);
+	t_id = dma->ops.copy_to(dma, dev_addr, (void *)handle, len);
+	if (t_id < 0) {
+		ret = t_id;
+	} else if (wait_event_interruptible(dma->wq, atomic64_read(&dma->wq_processed) >= t_id)) {
+		DEVWRN(dma->dev_id, "got killed while hanging in waiting queue");
+		ret = -EACCES;
+	} else {
+		tlkm_perfc_dma_writes_add(dma->dev_id, len);
+	}
+	tlkm_dma_staging_put(o);
+	return ret;
 }
@@ -4,18 +4,31 @@
 #include <linux/atomic.h>
 #include <linux/wait.h>
 #include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/fs.h>
 #include <linux/interrupt.h>
 #include <linux/version.h>
 #include "tlkm_types.h"
 
 struct dma_engine;
 struct tlkm_device;
+struct vm_area_struct;
 
 typedef int (*dma_init_fun)(struct dma_engine *);
+typedef void (*dma_exit_fun)(struct dma_engine *);
 typedef irqreturn_t (*dma_intr_handler)(int , void *);
 typedef ssize_t (*dma_copy_to_func_t)(struct dma_engine *, dev_addr_t, const void *, size_t);
 typedef ssize_t (*dma_copy_from_func_t)(struct dma_engine *, void *, dev_addr_t, size_t);
 
+/* single element of a scatter-gather chain */
+struct tlkm_dma_sg {
+    void                *dma_handle;
+    dev_addr_t          dev_addr;
+    size_t              len;
+};
+
+typedef ssize_t (*dma_copy_sg_func_t)(struct dma_engine *, const struct tlkm_dma_sg *, size_t);
+
 typedef enum {
     TO_DEV,
     FROM_DEV
@@ -29,19 +42,39 @@ typedef int (*dma_buffer_dev_func_t)(dev_id_t dev_id, struct tlkm_device *dev, v
 
 struct dma_operations {
     dma_init_fun init;
+    dma_exit_fun exit;
     dma_allocate_buffer_func_t allocate_buffer;
     dma_free_buffer_func_t     free_buffer;
     dma_buffer_cpu_func_t      buffer_cpu;
     dma_buffer_dev_func_t      buffer_dev;
     dma_copy_to_func_t         copy_to;
     dma_copy_from_func_t       copy_from;
+    dma_copy_sg_func_t         copy_sg_to;
+    dma_copy_sg_func_t         copy_sg_from;
     dma_intr_handler           intr_read;
     dma_intr_handler           intr_write;
 };
 
-// Currently any chunk size smaller than 2 MB will result in failures due to missing interrupts
+// Defaults for the bounce buffer pipeline, can be overridden per device via
+// the dma_chunk_sz, dma_chunk_min_sz and dma_chunks module parameters.
+// Note: Older BlueDMA bitstreams lose interrupts for chunks smaller than
+// 2 MiB, so adaptive chunks are off by default (minimum = dma_chunk_sz);
+// set dma_chunk_min_sz (e.g., 65536) only on devices known to handle them.
 #define TLKM_DMA_CHUNK_SZ         (size_t)(2 * 1024 * 1024)   // 2 MiB
+#define TLKM_DMA_CHUNK_MAX_SZ     (size_t)(4 * 1024 * 1024)   // 4 MiB (kmalloc)
 #define TLKM_DMA_CHUNKS           (4)
+#define TLKM_DMA_MAX_CHUNKS       (32)
+// In scatter-gather mode the chunks are submitted in two alternating chains
+#define TLKM_DMA_SG_BATCH(dma)    ((dma)->chunks / 2)
+
+// Staging buffers are mapped into user space (see TLKM_DEV_STAGING_MMAP_OFFSET),
+// applications produce data directly into them and submit copies by index.
+// Can be overridden per device via dma_staging_bufs and dma_staging_sz.
+// Each buffer belongs to the file that mapped it until its last mapping is
+// gone; other files cannot map it and other processes cannot submit it.
+#define TLKM_DMA_STAGING_BUFS     (4)
+#define TLKM_DMA_MAX_STAGING_BUFS (16)
+#define TLKM_DMA_STAGING_SZ       TLKM_DMA_CHUNK_SZ
 
 struct dma_engine {
     dev_id_t            dev_id;
@@ -57,12 +90,28 @@ struct dma_engine {
     struct mutex            wq_mutex;
     atomic64_t          wq_enqueued;
     atomic64_t          wq_processed;
-    void                *dma_buf_read[TLKM_DMA_CHUNKS];
-    void                *dma_buf_read_dev[TLKM_DMA_CHUNKS];
-    void                *dma_buf_write[TLKM_DMA_CHUNKS];
-    void                *dma_buf_write_dev[TLKM_DMA_CHUNKS];
+    size_t              chunk_sz;       // size of each bounce buffer
+    size_t              chunk_min_sz;   // lower bound for adaptive chunks
+    size_t              chunks;         // number of bounce buffers per direction
+    void                *dma_buf_read[TLKM_DMA_MAX_CHUNKS];
+    void                *dma_buf_read_dev[TLKM_DMA_MAX_CHUNKS];
+    void                *dma_buf_write[TLKM_DMA_MAX_CHUNKS];
+    void                *dma_buf_write_dev[TLKM_DMA_MAX_CHUNKS];
+    size_t              staging_sz;     // size of each staging buffer
+    size_t              staging_bufs;   // number of staging buffers, 0 if disabled
+    void                *staging[TLKM_DMA_MAX_STAGING_BUFS];
+    void                *staging_dev[TLKM_DMA_MAX_STAGING_BUFS];
+    struct tlkm_dma_staging_owner {
+        struct dma_engine   *dma;
+        struct file         *fp;        // file that mapped the buffer, NULL if free
+        struct mm_struct    *mm;        // address space of the mapping
+        int                 maps;       // VMAs of the mapping and staged copies in flight
+    } staging_owner[TLKM_DMA_MAX_STAGING_BUFS];
+    spinlock_t          staging_lock;
     struct tlkm_device  *dev;
     int alignment;
+    size_t              sg_depth;       // max. chain length, 0 if unsupported
+    void                *engine_data;
 };
 
 int  tlkm_dma_init(struct tlkm_device *dev, struct dma_engine *dma, u64 base);
@@ -71,4 +120,12 @@ void tlkm_dma_exit(struct dma_engine *dma);
 ssize_t tlkm_dma_copy_to(struct dma_engine *dma, dev_addr_t dev_addr, const void __user *usr_addr, size_t len);
 ssize_t tlkm_dma_copy_from(struct dma_engine *dma, void __user *usr_addr, dev_addr_t dev_addr, size_t len);
 
+struct tlkm_copy_cmd;
+/* Vectored copies: all segments are pipelined through the same bounce buffers. */
+ssize_t tlkm_dma_copy_to_v(struct dma_engine *dma, const struct tlkm_copy_cmd *segs, size_t num_segs);
+ssize_t tlkm_dma_copy_from_v(struct dma_engine *dma, const struct tlkm_copy_cmd *segs, size_t num_segs);
+
+int tlkm_dma_staging_mmap(struct dma_engine *dma, struct file *fp, ulong off, struct vm_area_struct *vm);
+ssize_t tlkm_dma_copy_staged(struct dma_engine *dma, size_t buf_idx, size_t offset, dev_addr_t dev_addr, size_t len);
+
 #endif /* TLKM_DMA_H__ */
@@ -48,6 +48,7 @@
 #include <linux/delay.h>
 #include <linux/pci.h>
 #include <linux/sched.h>
+#include <linux/log2.h>
 
 #include "tlkm/tlkm_device.h"
 #include "tlkm/tlkm_class.h"
@@ -70,8 +71,8 @@ static int hsa_mmap(struct file *, struct vm_area_struct *vma);
 
 /******************************************************************************/
 /* helper functions called for sys-calls */
-static int hsa_alloc_queue(void** p, dma_addr_t *handle);
-static void hsa_free_queue(void *p, dma_addr_t handle);
+static int hsa_alloc_queue(struct hsa_queue *q);
+static void hsa_free_queue(struct hsa_queue *q);
 
 /* file operations for sw-calls as a char device */
 static struct file_operations hsa_fops = {
@@ -84,6 +85,14 @@ static struct file_operations hsa_fops = {
 
 struct priv_data_struct dev;
 
+static uint hsa_queue_length = HSA_QUEUE_LENGTH;
+module_param(hsa_queue_length, uint, S_IRUGO);
+MODULE_PARM_DESC(hsa_queue_length, "number of packets per HSA queue, power of 2 (default: 128)");
+
+static uint hsa_queues = 1;
+module_param(hsa_queues, uint, S_IRUGO);
+MODULE_PARM_DESC(hsa_queues, "number of HSA queues, one minor node each (default: 1)");
+
 struct device* extractDevice(struct tlkm_device *dev) {
 	struct tlkm_pcie_device *pdev = (struct tlkm_pcie_device *)dev->private_data;
 	return &pdev->pdev->dev;
@@ -92,33 +101,51 @@ struct device* extractDevice(struct tlkm_device *dev) {
 /******************************************************************************/
 /* helper functions used by sys-calls */
 
-static void enable_queue_fetcher(uint64_t update_rate) {
-	struct hsa_mmap_space *dma_mem = (struct hsa_mmap_space*)dev.dma_shared_mem;
+static inline uint64_t *queue_arbiter(struct hsa_queue *q) {
+	return dev.arbiter_base + q->idx * HSA_ARBITER_QUEUE_STRIDE;
+}
+
+static inline size_t queue_size(void) {
+	return PAGE_ALIGN(hsa_mmap_space_size(dev.queue_length));
+}
+
+static void enable_queue_fetcher(struct hsa_queue *q, uint64_t update_rate) {
+	uint64_t *arbiter = queue_arbiter(q);
 
-	dev.arbiter_base[HSA_ARBITER_REGISTER_HOST_ADDR] = (uint64_t)&dma_mem->queue;
-	dev.arbiter_base[HSA_ARBITER_REGISTER_READ_INDEX_ADDR] = (uint64_t)&dma_mem->read_index;
-	dev.arbiter_base[HSA_ARBITER_REGISTER_PASID_ADDR] = (uint64_t)&dma_mem->pasids;
-	dev.arbiter_base[HSA_ARBITER_REGISTER_QUEUE_SIZE] = HSA_QUEUE_LENGTH_MOD2;
-	dev.arbiter_base[HSA_ARBITER_REGISTER_FPGA_ADDR] = HSA_MEMORY_BASE_ADDR;
+	arbiter[HSA_ARBITER_REGISTER_HOST_ADDR] = q->dma_shared_mem;
+	arbiter[HSA_ARBITER_REGISTER_READ_INDEX_ADDR] = q->dma_shared_mem + hsa_mmap_read_index_offset(dev.queue_length);
+	arbiter[HSA_ARBITER_REGISTER_PASID_ADDR] = q->dma_shared_mem + hsa_mmap_pasids_offset(dev.queue_length);
+	arbiter[HSA_ARBITER_REGISTER_QUEUE_SIZE] = ilog2(dev.queue_length);
+	arbiter[HSA_ARBITER_REGISTER_FPGA_ADDR] = HSA_MEMORY_BASE_ADDR;
 
-	dev.arbiter_base[HSA_ARBITER_REGISTER_UPDATE_RATE] = update_rate;
+	arbiter[HSA_ARBITER_REGISTER_UPDATE_RATE] = update_rate;
 }
 
-static void disable_queue_fetcher(void) {
-	dev.arbiter_base[HSA_ARBITER_REGISTER_WRITE_INDEX_ADDR] = -1;
-	dev.arbiter_base[HSA_ARBITER_REGISTER_UPDATE_RATE] = 0;
+static void disable_queue_fetcher(struct hsa_queue *q) {
+	uint64_t *arbiter = queue_arbiter(q);
+	arbiter[HSA_ARBITER_REGISTER_WRITE_INDEX_ADDR] = -1;
+	arbiter[HSA_ARBITER_REGISTER_UPDATE_RATE] = 0;
 }
 
-static int hsa_alloc_queue(void** p, dma_addr_t *handle)
+static int hsa_alloc_queue(struct hsa_queue *q)
 {
-	size_t mem_size = sizeof(struct hsa_mmap_space);
+	size_t mem_size = queue_size();
+	size_t i;
 
-	*p = dma_alloc_coherent(extractDevice(dev.dev), mem_size, handle, 0);
-	if (*p == 0) {
-		DEVERR(dev.dev->dev_id, "Couldn't allocate %zu bytes coherent memory for the HSA Queue", mem_size);
+	q->kvirt_shared_mem = dma_alloc_coherent(extractDevice(dev.dev), mem_size, &q->dma_shared_mem, 0);
+	if (q->kvirt_shared_mem == 0) {
+		DEVERR(dev.dev->dev_id, "Couldn't allocate %zu bytes coherent memory for HSA queue #%d", mem_size, q->idx);
 		return -1;
 	}
-	DEVLOG(dev.dev->dev_id, TLKM_LF_HSA,  "Got dma memory at dma address %llx and virtual address %p", *handle, *p);
+	DEVLOG(dev.dev->dev_id, TLKM_LF_HSA,  "Got dma memory for queue #%d at dma address %llx and virtual address %p",
+			q->idx, q->dma_shared_mem, q->kvirt_shared_mem);
+
+	// Invalidate all packages in the queue
+	for (i = 0; i < dev.queue_length; ++i) {
+		((uint8_t *)q->kvirt_shared_mem)[i * HSA_PACKAGE_BYTES] = 1;
+	}
+	*(uint64_t *)(q->kvirt_shared_mem + hsa_mmap_read_index_offset(dev.queue_length)) = 0;
+	memset(q->signal_allocated, 0, sizeof(q->signal_allocated));
 
 	return 0;
 }
@@ -130,11 +157,11 @@ static int hsa_alloc_queue(void** p, dma_addr_t *handle)
  * @param direction Whether writeable or readable
  * @return none
  * */
-static void hsa_free_queue(void *p, dma_addr_t handle)
+static void hsa_free_queue(struct hsa_queue *q)
 {
-	if (p != 0) {
-		size_t mem_size = sizeof(struct hsa_mmap_space);
-		dma_free_coherent(extractDevice(dev.dev), mem_size, p, handle);
+	if (q->kvirt_shared_mem != 0) {
+		dma_free_coherent(extractDevice(dev.dev), queue_size(), q->kvirt_shared_mem, q->dma_shared_mem);
+		q->kvirt_shared_mem = 0;
 	}
 }
 
@@ -164,15 +191,25 @@ static void hsa_dma_free_mem(void *p, dma_addr_t handle, size_t mem_size)
 	}
 }
 
+static void hsa_queue_params(void) {
+	dev.queue_length = hsa_queue_length;
+	if (dev.queue_length < 2 || ! is_power_of_2(dev.queue_length)) {
+		DEVWRN(dev.dev->dev_id, "invalid queue length %u, must be a power of 2, using %u",
+				hsa_queue_length, HSA_QUEUE_LENGTH);
+		dev.queue_length = HSA_QUEUE_LENGTH;
+	}
+	dev.num_queues = clamp_t(size_t, hsa_queues, 1, HSA_QUEUES_MAX);
+	if (dev.num_queues != hsa_queues)
+		DEVWRN(dev.dev->dev_id, "invalid number of queues %u, using %zu", hsa_queues, dev.num_queues);
+}
+
 static int hsa_initialize(void) {
 	int i;
 
-	dev.kvirt_shared_mem = 0;
-
-	dev.dma_shared_mem = 0;
-
-	for (i = 0; i < HSA_SIGNALS; ++i) {
-		dev.signal_allocated[i] = 0;
+	for (i = 0; i < HSA_QUEUES_MAX; ++i) {
+		dev.queues[i].kvirt_shared_mem = 0;
+		dev.queues[i].dma_shared_mem = 0;
+		dev.queues[i].idx = i;
 	}
 
 	dev.signal_base = 0;
@@ -205,29 +242,28 @@ static int hsa_initialize(void) {
 
 	DEVLOG(dev.dev->dev_id, TLKM_LF_HSA,  "Fetcher core and arbiter found");
 
-	if (hsa_alloc_queue((void**)&dev.kvirt_shared_mem, &dev.dma_shared_mem)) {
-		DEVERR(dev.dev->dev_id, "Failed to allocate memory for the queue.");
-		goto signal_find_failed;
+	for (i = 0; i < dev.num_queues; ++i) {
+		if (hsa_alloc_queue(&dev.queues[i])) {
+			DEVERR(dev.dev->dev_id, "Failed to allocate memory for the queue.");
+			goto hsa_queue_failed;
+		}
 	}
 
 	if (hsa_dma_alloc_mem((void**)&dev.dummy_kvirt, &dev.dummy_dma, &dev.dummy_mem_size)) {
 		DEVERR(dev.dev->dev_id, "Failed to allocate dummy memory.");
-		goto hsa_dma_mem_failed;
+		goto hsa_queue_failed;
 	}
 
-	// Invalidate all packages in the queue
-	for (i = 0; i < HSA_QUEUE_LENGTH; ++i) {
-		dev.kvirt_shared_mem->queue[i][0] = 1;
-	}
-	dev.kvirt_shared_mem->read_index = 0;
-
-	enable_queue_fetcher(HSA_UPDATE_RATE);
+	for (i = 0; i < dev.num_queues; ++i)
+		enable_queue_fetcher(&dev.queues[i], HSA_UPDATE_RATE);
+	DEVLOG(dev.dev->dev_id, TLKM_LF_HSA, "%zu queues with %zu packets each registered with arbiter",
+			dev.num_queues, dev.queue_length);
 
 	return 0;
 
-hsa_dma_mem_failed:
-	hsa_free_queue(dev.kvirt_shared_mem, dev.dma_shared_mem);
-	dev.kvirt_shared_mem = 0;
+hsa_queue_failed:
+	for (i = 0; i < dev.num_queues; ++i)
+		hsa_free_queue(&dev.queues[i]);
 signal_find_failed:
 	iounmap(dev.signal_base);
 	dev.signal_base = 0;
@@ -239,10 +275,12 @@ arbiter_map_failed:
 }
 
 static void hsa_deinit(void) {
+	size_t i;
 	DEVLOG(dev.dev->dev_id, TLKM_LF_HSA, "Device not used anymore, removing it.");
-	disable_queue_fetcher();
-	hsa_free_queue(dev.kvirt_shared_mem, dev.dma_shared_mem);
-	dev.kvirt_shared_mem = 0;
+	for (i = 0; i < dev.num_queues; ++i) {
+		disable_queue_fetcher(&dev.queues[i]);
+		hsa_free_queue(&dev.queues[i]);
+	}
 	hsa_dma_free_mem(dev.dummy_kvirt, dev.dummy_dma, dev.dummy_mem_size);
 	dev.dummy_kvirt = 0;
 	iounmap(dev.signal_base);
@@ -263,7 +301,9 @@ static void hsa_deinit(void) {
  * */
 static int hsa_open(struct inode *inode, struct file *filp)
 {
-	filp->private_data = &dev;
+	if (iminor(inode) >= dev.num_queues)
+		return -ENODEV;
+	filp->private_data = &dev.queues[iminor(inode)];
 	atomic64_inc(&dev.device_opened);
 	DEVLOG(dev.dev->dev_id, TLKM_LF_HSA,  "Already %lld files in use.", (long long int)atomic64_read(&dev.device_opened));
 	return 0;
@@ -284,12 +324,18 @@ static int hsa_close(struct inode *inode, struct file *filp)
 
 irqreturn_t intr_handler_hsa_signals(int irq, void * dev_id)
 {
-	struct hsa_mmap_space *dma_mem = (struct hsa_mmap_space*)dev.dma_shared_mem;
-	uint64_t signal = dev.signal_base[HSA_SIGNAL_ADDR];
-	uint64_t *signal_kvirt = (uint64_t*)dev.kvirt_shared_mem->signals;
-	signal -= (uint64_t)dma_mem->signals;
-	signal /= sizeof(uint64_t);
-	--signal_kvirt[signal];
+	uint64_t const signal = dev.signal_base[HSA_SIGNAL_ADDR];
+	size_t const off = hsa_mmap_signals_offset(dev.queue_length);
+	size_t i;
+	// find the queue the signal belongs to
+	for (i = 0; i < dev.num_queues; ++i) {
+		struct hsa_queue *q = &dev.queues[i];
+		uint64_t const base = q->dma_shared_mem + off;
+		if (signal >= base && signal < base + HSA_SIGNALS * sizeof(uint64_t)) {
+			--((uint64_t *)(q->kvirt_shared_mem + off))[(signal - base) / sizeof(uint64_t)];
+			break;
+		}
+	}
 	dev.signal_base[HSA_SIGNAL_ACK] = 1;
 	return IRQ_HANDLED;
 }
@@ -297,13 +343,16 @@ irqreturn_t intr_handler_hsa_signals(int irq, void * dev_id)
 /******************************************************************************/
 /* function for user-space interaction */
 
-void assign_doorbell(int offset) {
-	struct hsa_mmap_space *dma_mem = (struct hsa_mmap_space*)dev.dma_shared_mem;
-	dev.arbiter_base[HSA_ARBITER_REGISTER_WRITE_INDEX_ADDR] = (uint64_t)&dma_mem->signals[offset];
+static inline uint64_t signal_dma_addr(struct hsa_queue *q, int offset) {
+	return q->dma_shared_mem + hsa_mmap_signals_offset(dev.queue_length) + offset * sizeof(uint64_t);
 }
 
-void unassign_doorbell(void) {
-	dev.arbiter_base[HSA_ARBITER_REGISTER_WRITE_INDEX_ADDR] = -1;
+static void assign_doorbell(struct hsa_queue *q, int offset) {
+	queue_arbiter(q)[HSA_ARBITER_REGISTER_WRITE_INDEX_ADDR] = signal_dma_addr(q, offset);
+}
+
+static void unassign_doorbell(struct hsa_queue *q) {
+	queue_arbiter(q)[HSA_ARBITER_REGISTER_WRITE_INDEX_ADDR] = -1;
 }
 
 /**
@@ -312,9 +361,8 @@ static long hsa_ioctl(struct file *filp, unsigned int ioctl_num, unsigned long i
 {
 	int i;
 	int err = 0;
-	struct priv_data_struct * p = (struct priv_data_struct *) filp->private_data;
+	struct hsa_queue *q = (struct hsa_queue *) filp->private_data;
 	struct hsa_ioctl_params params;
-	struct hsa_mmap_space *dma_mem = (struct hsa_mmap_space*)dev.dma_shared_mem;
 	DEVLOG(dev.dev->dev_id, TLKM_LF_HSA,  "Called with number %X for minor %u\n", ioctl_num, 0);
 
 	if (_IOC_SIZE(ioctl_num) != sizeof(struct hsa_ioctl_params)) {
@@ -330,10 +378,10 @@ static long hsa_ioctl(struct file *filp, unsigned int ioctl_num, unsigned long i
 	switch (ioctl_num) {
 	case IOCTL_CMD_HSA_SIGNAL_ALLOC:
 		for (i = 0; i < HSA_SIGNALS; ++i) {
-			if (p->signal_allocated[i] == 0) {
-				params.addr = (void*)&dma_mem->signals[i];
+			if (q->signal_allocated[i] == 0) {
+				params.addr = (void*)signal_dma_addr(q, i);
 				params.offset = i;
-				p->signal_allocated[i] = 1;
+				q->signal_allocated[i] = 1;
 				DEVLOG(dev.dev->dev_id, TLKM_LF_HSA,  "Allocated signal %d at 0x%llx", (int)params.offset, (uint64_t)params.addr);
 				if (copy_to_user((void*)ioctl_param, &params, _IOC_SIZE(ioctl_num))) {
 					DEVERR(dev.dev->dev_id, "Couldn't copy all bytes back to userspace\n");
@@ -350,19 +398,27 @@ static long hsa_ioctl(struct file *filp, unsigned int ioctl_num, unsigned long i
 		}
 		break;
 	case IOCTL_CMD_HSA_SIGNAL_DEALLOC:
-		p->signal_allocated[params.offset] = 0;
+		if (params.offset < 0 || params.offset >= HSA_SIGNALS) {
+			err = -EINVAL;
+			goto err_handler;
+		}
+		q->signal_allocated[params.offset] = 0;
 		DEVLOG(dev.dev->dev_id, TLKM_LF_HSA,  "Deallocated signal %d", (int)params.offset);
 		break;
 	case IOCTL_CMD_HSA_DOORBELL_ASSIGN:
 		DEVLOG(dev.dev->dev_id, TLKM_LF_HSA,  "Assign doorbell to signal %d", (int)params.offset);
-		assign_doorbell(params.offset);
+		if (params.offset < 0 || params.offset >= HSA_SIGNALS) {
+			err = -EINVAL;
+			goto err_handler;
+		}
+		assign_doorbell(q, params.offset);
 		break;
 	case IOCTL_CMD_HSA_DOORBELL_UNASSIGN:
 		DEVLOG(dev.dev->dev_id, TLKM_LF_HSA,  "Unassign doorbell");
-		unassign_doorbell();
+		unassign_doorbell(q);
 		break;
 	case IOCTL_CMD_HSA_DMA_ADDR:
-		params.data = (uint64_t)p->dummy_dma;
+		params.data = (uint64_t)dev.dummy_dma;
 		if (copy_to_user((void*)ioctl_param, &params, _IOC_SIZE(ioctl_num))) {
 			DEVERR(dev.dev->dev_id, "Couldn't copy all bytes back to userspace\n");
 			err = -EACCES;
@@ -370,7 +426,16 @@ static long hsa_ioctl(struct file *filp, unsigned int ioctl_num, unsigned long i
 		}
 		break;
 	case IOCTL_CMD_HSA_DMA_SIZE:
-		params.data = (uint64_t)p->dummy_mem_size;
+		params.data = (uint64_t)dev.dummy_mem_size;
+		if (copy_to_user((void*)ioctl_param, &params, _IOC_SIZE(ioctl_num))) {
+			DEVERR(dev.dev->dev_id, "Couldn't copy all bytes back to userspace\n");
+			err = -EACCES;
+			goto err_handler;
+		}
+		break;
+	case IOCTL_CMD_HSA_QUEUE_INFO:
+		params.offset = q->idx;
+		params.data = (uint64_t)dev.queue_length;
 		if (copy_to_user((void*)ioctl_param, &params, _IOC_SIZE(ioctl_num))) {
 			DEVERR(dev.dev->dev_id, "Couldn't copy all bytes back to userspace\n");
 			err = -EACCES;
@@ -387,12 +452,15 @@ err_handler:
 
 static int hsa_mmap(struct file *filp, struct vm_area_struct *vma)
 {
+	struct hsa_queue *q = (struct hsa_queue *) filp->private_data;
 	int ret = 0;
 	if (vma->vm_pgoff == 0) {
-		if (dev.kvirt_shared_mem == 0)
+		if (q->kvirt_shared_mem == 0)
 			return -EAGAIN;
-		DEVLOG(dev.dev->dev_id, TLKM_LF_HSA,  "MMapping queue memory to user space");
-		ret = dma_mmap_coherent(extractDevice(dev.dev), vma, dev.kvirt_shared_mem, dev.dma_shared_mem, vma->vm_end - vma->vm_start);
+		if (vma->vm_end - vma->vm_start > queue_size())
+			return -EINVAL;
+		DEVLOG(dev.dev->dev_id, TLKM_LF_HSA,  "MMapping memory of queue #%d to user space", q->idx);
+		ret = dma_mmap_coherent(extractDevice(dev.dev), vma, q->kvirt_shared_mem, q->dma_shared_mem, vma->vm_end - vma->vm_start);
 	} else if (vma->vm_pgoff == 1) {
 		if (dev.dummy_kvirt == 0)
 			return -EAGAIN;
@@ -441,13 +509,15 @@ static int hsa_mmap(struct file *filp, struct vm_area_struct *vma)
 int char_hsa_register(struct tlkm_device *tlkm_dev)
 {
 	int err = 0;
+	int i;
 
 	dev.dev = tlkm_dev;
 
 	DEVLOG(dev.dev->dev_id, TLKM_LF_HSA,  "Trying to create chardev for HSA queue handling.");
+	hsa_queue_params();
 
 	/* create device class to register under sysfs */
-	err = register_chrdev_region(MKDEV(TLKM_HSA_MAJOR, 0), 1, TLKM_HSA_NAME);
+	err = register_chrdev_region(MKDEV(TLKM_HSA_MAJOR, 0), dev.num_queues, TLKM_HSA_NAME);
 	if (err != 0) {
 		DEVERR(dev.dev->dev_id, "Failed to create char device");
 		goto error_no_device;
@@ -459,14 +529,17 @@ int char_hsa_register(struct tlkm_device *tlkm_dev)
 		goto class_failed;
 	}
 
-	if (device_create(dev.dev_class, NULL, MKDEV(TLKM_HSA_MAJOR, 0), NULL, TLKM_HSA_NAME"_0") == NULL) {
-		DEVERR(dev.dev->dev_id, "Failed to create device");
-		goto device_create_failed;
+	/* one minor node per queue */
+	for (i = 0; i < dev.num_queues; ++i) {
+		if (device_create(dev.dev_class, NULL, MKDEV(TLKM_HSA_MAJOR, i), NULL, TLKM_HSA_NAME"_%d", i) == NULL) {
+			DEVERR(dev.dev->dev_id, "Failed to create device");
+			goto device_create_failed;
+		}
 	}
 
 	/* initialize char dev with fops to prepare for adding */
 	cdev_init(&dev.cdev, &hsa_fops);
-	if (cdev_add(&dev.cdev, MKDEV(TLKM_HSA_MAJOR, 0), 1) == -1) {
+	if (cdev_add(&dev.cdev, MKDEV(TLKM_HSA_MAJOR, 0), dev.num_queues) == -1) {
 		DEVERR(dev.dev->dev_id, "Failed to add chardev");
 		goto cdev_add_failed;
 	}
@@ -483,11 +556,13 @@ int char_hsa_register(struct tlkm_device *tlkm_dev)
 error_device_create:
 	cdev_del(&dev.cdev);
 cdev_add_failed:
-	device_destroy(dev.dev_class, MKDEV(TLKM_HSA_MAJOR, 0));
+	i = dev.num_queues;
 device_create_failed:
+	while (i--)
+		device_destroy(dev.dev_class, MKDEV(TLKM_HSA_MAJOR, i));
 	class_destroy(dev.dev_class);
 class_failed:
-	unregister_chrdev_region(MKDEV(TLKM_HSA_MAJOR, 0), 1);
+	unregister_chrdev_region(MKDEV(TLKM_HSA_MAJOR, 0), dev.num_queues);
 error_no_device:
 	dev.dev = NULL;
 	return 0;
@@ -500,15 +575,17 @@ error_no_device:
  * */
 void char_hsa_unregister(void)
 {
+	size_t i;
 	if (dev.dev) {
 		hsa_deinit();
 
 		pcie_irqs_release_platform_irq(dev.dev, 2);
 
 		cdev_del(&dev.cdev);
-		device_destroy(dev.dev_class, MKDEV(TLKM_HSA_MAJOR, 0));
+		for (i = 0; i < dev.num_queues; ++i)
+			device_destroy(dev.dev_class, MKDEV(TLKM_HSA_MAJOR, i));
 		class_destroy(dev.dev_class);
-		unregister_chrdev_region(MKDEV(TLKM_HSA_MAJOR, 0), 1);
+		unregister_chrdev_region(MKDEV(TLKM_HSA_MAJOR, 0), dev.num_queues);
 	}
 }
 
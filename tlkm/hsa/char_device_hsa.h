@@ -48,6 +48,9 @@
 #define HSA_ARBITER_REGISTER_WRITE_INDEX_ADDR (72/8)
 
 #define HSA_ARBITER_REGISTER_ID (24/8)
+
+/* register block of queue slot i of the arbiter starts at i * stride */
+#define HSA_ARBITER_QUEUE_STRIDE (0x100/8)
 #define HSA_ARBITER_ID 0xE5A0024
 
 #define HSA_SIGNAL_BASE_ADDR 0x1000
@@ -64,14 +67,24 @@
 
 /******************************************************************************/
 
-/* struct array to hold data over multiple fops-calls */
-struct priv_data_struct {
-    struct hsa_mmap_space * kvirt_shared_mem;
+/* one AQL queue, mapped by minor node HSA_AQL_QUEUE_<idx> */
+struct hsa_queue {
+    void *kvirt_shared_mem;
 
     dma_addr_t dma_shared_mem;
 
     uint8_t signal_allocated[HSA_SIGNALS];
 
+    int idx;
+};
+
+/* struct array to hold data over multiple fops-calls */
+struct priv_data_struct {
+    struct hsa_queue queues[HSA_QUEUES_MAX];
+
+    size_t num_queues;
+    size_t queue_length;
+
     struct tlkm_device *dev;
 
     uint64_t *signal_base;
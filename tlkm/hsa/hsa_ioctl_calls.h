@@ -36,14 +36,17 @@ struct hsa_ioctl_params {
     uint64_t data;
 };
 
+// default number of packets per queue, set by module parameter hsa_queue_length
 #define HSA_QUEUE_LENGTH 128
 #define HSA_QUEUE_LENGTH_MOD2 7
+#define HSA_QUEUES_MAX 8
 #define HSA_SIGNALS 128
 #define HSA_PACKAGE_BYTES 64
 
 // 64 byte dummy package for struct size
 typedef uint8_t hsa_package_t[HSA_PACKAGE_BYTES];
 
+// layout of a queue of default length; use the offsets below for other lengths
 struct hsa_mmap_space {
 	hsa_package_t queue[HSA_QUEUE_LENGTH];
 	uint32_t pasids[HSA_QUEUE_LENGTH];
@@ -51,6 +54,27 @@ struct hsa_mmap_space {
 	uint64_t signals[HSA_SIGNALS];
 };
 
+/* offsets of the members of a queue space with len packets */
+static inline unsigned long hsa_mmap_pasids_offset(unsigned long len)
+{
+	return len * HSA_PACKAGE_BYTES;
+}
+
+static inline unsigned long hsa_mmap_read_index_offset(unsigned long len)
+{
+	return hsa_mmap_pasids_offset(len) + len * sizeof(uint32_t);
+}
+
+static inline unsigned long hsa_mmap_signals_offset(unsigned long len)
+{
+	return hsa_mmap_read_index_offset(len) + sizeof(uint64_t);
+}
+
+static inline unsigned long hsa_mmap_space_size(unsigned long len)
+{
+	return hsa_mmap_signals_offset(len) + HSA_SIGNALS * sizeof(uint64_t);
+}
+
 /* Magic character for unique identification */
 #define HSA_ID_GROUP_BLOCKING 'h'
 
@@ -75,6 +99,9 @@ struct hsa_mmap_space {
 #define HSA_ID_5    5
 #define HSA_SIZE_5  uint8_t[sizeof(struct hsa_ioctl_params)] /*  */
 
+#define HSA_ID_6    6
+#define HSA_SIZE_6  uint8_t[sizeof(struct hsa_ioctl_params)] /* offset: queue index, data: queue length */
+
 /******************************************************************************/
 /* definition of cmds with _IOWR wrapper function to get system-wide unique numbers */
 
@@ -87,6 +114,8 @@ struct hsa_mmap_space {
 #define IOCTL_CMD_HSA_DMA_ADDR _IOR(HSA_ID_GROUP_BLOCKING, HSA_ID_4, HSA_SIZE_4)
 #define IOCTL_CMD_HSA_DMA_SIZE _IOR(HSA_ID_GROUP_BLOCKING, HSA_ID_5, HSA_SIZE_5)
 
+#define IOCTL_CMD_HSA_QUEUE_INFO _IOR(HSA_ID_GROUP_BLOCKING, HSA_ID_6, HSA_SIZE_6)
+
 /******************************************************************************/
 
 #endif
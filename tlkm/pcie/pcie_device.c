@@ -13,6 +13,10 @@
 #include "tlkm_bus.h"
 #include "char_device_hsa.h"
 
+static bool numa_aware = true;
+module_param(numa_aware, bool, S_IRUGO);
+MODULE_PARM_DESC(numa_aware, "allocate DMA buffers on the NUMA node of the device (default: true)");
+
 #define TLKM_DEV_ID(pdev) \
 	(((struct tlkm_pcie_device *)dev_get_drvdata(&(pdev)->dev))->parent->dev_id)
 
@@ -215,6 +219,9 @@ int pcie_device_create(struct tlkm_device *dev, void *data)
 	pdev->parent = dev;
 	pdev->pdev = pci_dev;
 	dev->private_data = pdev;
+	if (numa_aware)
+		dev->node = dev_to_node(&pci_dev->dev);
+	DEVLOG(dev->dev_id, TLKM_LF_PCIE, "NUMA node: %d", dev->node);
 
 	DEVLOG(dev->dev_id, TLKM_LF_PCIE, "claiming PCIe device ...");
 	if ((ret = claim_device(pdev))) {
@@ -289,7 +296,7 @@ int pcie_device_dma_allocate_buffer(dev_id_t dev_id, struct tlkm_device *dev, vo
 	// Should be the same size on most systems, however
 	dma_addr_t *handle = (dma_addr_t*)dev_handle;
 	int err = 0;
-	*buffer = kmalloc(size, 0);
+	*buffer = kmalloc_node(size, 0, dev->node);
 	DEVLOG(dev_id, TLKM_LF_DEVICE, "Allocated %zd bytes at kernel address %p trying to map into DMA space...", size, *buffer);
 	if (*buffer) {
 		memset(*buffer, 0, size);
@@ -1,4 +1,6 @@
 #include <linux/uaccess.h>
+#include <linux/slab.h>
+#include <linux/string.h>
 #include "tlkm_logging.h"
 #include "tlkm_device.h"
 #include "dma/tlkm_dma.h"
@@ -71,6 +73,98 @@ long pcie_ioctl_copyfrom(struct tlkm_device *inst, struct tlkm_copy_cmd *cmd)
 	return r;
 }
 
+static inline
+struct tlkm_copy_cmd *pcie_ioctl_get_segs(struct tlkm_device *inst, struct tlkm_copy_v_cmd *cmd)
+{
+	struct tlkm_copy_cmd *segs;
+	if (! cmd->num_segs || cmd->num_segs > TLKM_COPY_V_MAX_SEGS) {
+		DEVERR(inst->dev_id, "invalid number of segments: %zu", cmd->num_segs);
+		return ERR_PTR(-EINVAL);
+	}
+	segs = memdup_user((void __user *)cmd->segs, cmd->num_segs * sizeof(*segs));
+	if (IS_ERR(segs))
+		DEVERR(inst->dev_id, "could not copy %zu segments from user space", cmd->num_segs);
+	return segs;
+}
+
+static inline
+long pcie_ioctl_copyto_v(struct tlkm_device *inst, struct tlkm_copy_v_cmd *cmd)
+{
+	ssize_t r;
+	size_t i, total = 0;
+	struct tlkm_copy_cmd *segs = pcie_ioctl_get_segs(inst, cmd);
+	if (IS_ERR(segs)) return PTR_ERR(segs);
+	for (i = 0; i < cmd->num_segs; ++i) total += segs[i].length;
+	DEVLOG(inst->dev_id, TLKM_LF_IOCTL, "copyto_v: segs = %zu, len = %zu", cmd->num_segs, total);
+	r = tlkm_dma_copy_to_v(&inst->dma[0], segs, cmd->num_segs);
+	if (! r) {
+		tlkm_perfc_total_usr2dev_transfers_add(inst->dev_id, total);
+	} else {
+		DEVERR(inst->dev_id, "could not copy %zu bytes in %zu segments: %zd", total, cmd->num_segs, r);
+	}
+	kfree(segs);
+	return r;
+}
+
+static inline
+long pcie_ioctl_copyfrom_v(struct tlkm_device *inst, struct tlkm_copy_v_cmd *cmd)
+{
+	ssize_t r;
+	size_t i, total = 0;
+	struct tlkm_copy_cmd *segs = pcie_ioctl_get_segs(inst, cmd);
+	if (IS_ERR(segs)) return PTR_ERR(segs);
+	for (i = 0; i < cmd->num_segs; ++i) total += segs[i].length;
+	DEVLOG(inst->dev_id, TLKM_LF_IOCTL, "copyfrom_v: segs = %zu, len = %zu", cmd->num_segs, total);
+	r = tlkm_dma_copy_from_v(&inst->dma[0], segs, cmd->num_segs);
+	if (! r) {
+		tlkm_perfc_total_dev2usr_transfers_add(inst->dev_id, total);
+	} else {
+		DEVERR(inst->dev_id, "could not copy %zu bytes in %zu segments: %zd", total, cmd->num_segs, r);
+	}
+	kfree(segs);
+	return r;
+}
+
+static inline
+long pcie_ioctl_staging_info(struct tlkm_device *inst, struct tlkm_staging_cmd *cmd)
+{
+	cmd->num_bufs = inst->dma[0].staging_bufs;
+	cmd->buf_sz = inst->dma[0].staging_sz;
+	cmd->mmap_offset = TLKM_DEV_STAGING_MMAP_OFFSET;
+	return 0;
+}
+
+static inline
+long pcie_ioctl_copyto_staged(struct tlkm_device *inst, struct tlkm_staged_copy_cmd *cmd)
+{
+	ssize_t r;
+	DEVLOG(inst->dev_id, TLKM_LF_IOCTL, "copyto_staged: len = %zu, dma = %pad, buf = %zu, offset = %zu",
+			cmd->length, &cmd->dev_addr, cmd->buf_idx, cmd->offset);
+	r = tlkm_dma_copy_staged(&inst->dma[0], cmd->buf_idx, cmd->offset, cmd->dev_addr, cmd->length);
+	if (! r) {
+		tlkm_perfc_total_usr2dev_transfers_add(inst->dev_id, cmd->length);
+	} else {
+		DEVERR(inst->dev_id, "could not copy %zu bytes from staging buffer #%zu -> 0x%px: %zd",
+				cmd->length, cmd->buf_idx, (void *)cmd->dev_addr, r);
+	}
+	return r;
+}
+
+static inline
+long pcie_ioctl_dmabuf_info(struct tlkm_device *inst, struct tlkm_dmabuf_cmd *cmd)
+{
+	// device buffers live in on-board memory, not in host memory
+	DEVLOG(inst->dev_id, TLKM_LF_IOCTL, "device buffers cannot be mapped");
+	return -ENXIO;
+}
+
+static inline
+long pcie_ioctl_sync(struct tlkm_device *inst, struct tlkm_sync_cmd *cmd)
+{
+	// device memory is only accessed via explicit transfers, nothing to do
+	return 0;
+}
+
 static inline
 long pcie_ioctl_read(struct tlkm_device *inst, struct tlkm_copy_cmd *cmd)
 {
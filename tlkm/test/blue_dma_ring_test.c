@@ -0,0 +1,176 @@
+//
+// Copyright (C) 2017 Jaco A. Hofmann, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	blue_dma_ring_test.c
+//! @brief	Unit test for the BlueDMA descriptor ring against a software
+//!		model of the engine: the model walks the ring from its own
+//!		completion counter up to the doorbell, copies between a
+//!		simulated host and FPGA memory and counts interrupts.
+//!
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include "blue_dma_ring.h"
+
+#define HOST_SZ		(1 << 16)
+#define FPGA_SZ		(1 << 16)
+
+typedef enum { MODEL_TO_FPGA, MODEL_FROM_FPGA } model_dir_t;
+
+/* software model of one direction of the engine */
+struct model {
+	struct blue_dma_desc	desc[BLUE_DMA_RING_DESCS];
+	u32			doorbell;
+	u32			done;
+	unsigned		irqs;
+	unsigned char		*host;
+	unsigned char		*fpga;
+	model_dir_t		dir;
+};
+
+static unsigned char host[HOST_SZ];
+static unsigned char fpga[FPGA_SZ];
+
+static void model_init(struct model *m, struct blue_dma_ring *r, model_dir_t dir)
+{
+	memset(m, 0, sizeof(*m));
+	m->host = host;
+	m->fpga = fpga;
+	m->dir = dir;
+	blue_dma_ring_init(r, m->desc);
+}
+
+static void model_doorbell(struct model *m, struct blue_dma_ring const *r)
+{
+	m->doorbell = r->head;
+}
+
+/* processes at most max descriptors, returns number processed */
+static unsigned model_run(struct model *m, unsigned max)
+{
+	unsigned n = 0;
+	while (m->done != m->doorbell && n < max) {
+		struct blue_dma_desc const *d = &m->desc[m->done & BLUE_DMA_RING_MASK];
+		assert(d->host_addr + d->btt <= HOST_SZ);
+		assert(d->fpga_addr + d->btt <= FPGA_SZ);
+		if (m->dir == MODEL_TO_FPGA)
+			memcpy(&m->fpga[d->fpga_addr], &m->host[d->host_addr], d->btt);
+		else
+			memcpy(&m->host[d->host_addr], &m->fpga[d->fpga_addr], d->btt);
+		if (d->flags & BLUE_DMA_DESC_F_IRQ) ++m->irqs;
+		++m->done;
+		++n;
+	}
+	return n;
+}
+
+static void fill(unsigned char *p, size_t len, unsigned seed)
+{
+	for (size_t i = 0; i < len; ++i) p[i] = (unsigned char)(i * 31 + seed);
+}
+
+/* a chain of fragmented descriptors is completed with a single irq */
+static int test_single_chain(void)
+{
+	struct model m;
+	struct blue_dma_ring r;
+	size_t const chunk = 1024;
+	model_init(&m, &r, MODEL_TO_FPGA);
+	fill(host, HOST_SZ, 1);
+	memset(fpga, 0, FPGA_SZ);
+
+	for (int i = 0; i < 8; ++i)
+		assert(! blue_dma_ring_post(&r, (7 - i) * chunk, i * chunk, chunk, i == 7));
+	model_doorbell(&m, &r);
+	assert(model_run(&m, BLUE_DMA_RING_DESCS) == 8);
+	assert(m.irqs == 1);
+	for (int i = 0; i < 8; ++i)
+		assert(! memcmp(&fpga[i * chunk], &host[(7 - i) * chunk], chunk));
+	assert(blue_dma_ring_reclaim(&r, m.done) == 8);
+	assert(blue_dma_ring_space(&r) == BLUE_DMA_RING_DESCS);
+	return 0;
+}
+
+/* ring refuses to overrun, partial completion frees partial space */
+static int test_full_and_partial(void)
+{
+	struct model m;
+	struct blue_dma_ring r;
+	model_init(&m, &r, MODEL_FROM_FPGA);
+	fill(fpga, FPGA_SZ, 7);
+
+	for (int i = 0; i < BLUE_DMA_RING_DESCS; ++i)
+		assert(! blue_dma_ring_post(&r, i * 512, i * 512, 512, i == BLUE_DMA_RING_DESCS - 1));
+	assert(blue_dma_ring_space(&r) == 0);
+	assert(blue_dma_ring_post(&r, 0, 0, 512, 1) == -1);
+	model_doorbell(&m, &r);
+
+	assert(model_run(&m, 10) == 10);
+	assert(m.irqs == 0);
+	assert(blue_dma_ring_reclaim(&r, m.done) == 10);
+	assert(blue_dma_ring_space(&r) == 10);
+	/* stale or bogus completion counters are ignored */
+	assert(blue_dma_ring_reclaim(&r, m.done - 1) == 0);
+	assert(blue_dma_ring_reclaim(&r, r.head + 1) == 0);
+
+	assert(model_run(&m, BLUE_DMA_RING_DESCS) == BLUE_DMA_RING_DESCS - 10);
+	assert(m.irqs == 1);
+	assert(! memcmp(host, fpga, BLUE_DMA_RING_DESCS * 512));
+	return 0;
+}
+
+/* alternating chains as issued by tlkm_dma wrap around the ring */
+static int test_wraparound(void)
+{
+	struct model m;
+	struct blue_dma_ring r;
+	size_t const chunk = 256;
+	unsigned chains = 0;
+	model_init(&m, &r, MODEL_TO_FPGA);
+	fill(host, HOST_SZ, 3);
+	memset(fpga, 0, FPGA_SZ);
+
+	for (size_t off = 0; off < FPGA_SZ; off += 3 * chunk, ++chains) {
+		size_t n = 0;
+		blue_dma_ring_reclaim(&r, m.done);
+		while (n < 3 && off + n * chunk < FPGA_SZ) {
+			size_t const a = off + n * chunk;
+			size_t const len = a + chunk <= FPGA_SZ ? chunk : FPGA_SZ - a;
+			++n;
+			assert(! blue_dma_ring_post(&r, a, a, len, n == 3 || a + len >= FPGA_SZ));
+		}
+		model_doorbell(&m, &r);
+		/* engine lags behind by one chain */
+		if (chains & 1) model_run(&m, BLUE_DMA_RING_DESCS);
+	}
+	model_run(&m, BLUE_DMA_RING_DESCS);
+	assert(m.irqs == chains);
+	assert(r.head > BLUE_DMA_RING_DESCS);
+	assert(! memcmp(host, fpga, FPGA_SZ));
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int r = 0;
+	r |= test_single_chain();
+	r |= test_full_and_partial();
+	r |= test_wraparound();
+	printf("blue_dma_ring_test: %s\n", r ? "FAILED" : "OK");
+	return r;
+}
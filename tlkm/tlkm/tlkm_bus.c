@@ -3,6 +3,7 @@
 #include <linux/gfp.h>
 #include <linux/string.h>
 #include <linux/mutex.h>
+#include <linux/numa.h>
 #include <linux/perf_event.h>
 #include "tlkm_bus.h"
 #include "tlkm_class.h"
@@ -56,6 +57,7 @@ struct tlkm_device *tlkm_bus_new_device(struct tlkm_class *cls, int vendor_id, i
 		dev->vendor_id = vendor_id;
 		dev->product_id = product_id;
 		dev->cls = cls;
+		dev->node = NUMA_NO_NODE;
 		tlkm_bus_add_device(dev);
 		if ((ret = tlkm_device_init(dev, data))) {
 			DEVERR(dev->dev_id, "could not initialize device: %d", ret);
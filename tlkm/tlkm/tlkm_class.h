@@ -9,6 +9,7 @@
 
 struct tlkm_device;
 struct tlkm_class;
+struct vm_area_struct;
 
 typedef int (*tlkm_class_create_f)(struct tlkm_device *, void *data);
 typedef void(*tlkm_class_destroy_f)(struct tlkm_device *);
@@ -21,6 +22,7 @@ typedef void(*tlkm_class_remove_f)(struct tlkm_class *);
 typedef long (*tlkm_device_ioctl_f)(struct tlkm_device *, unsigned int ioctl, unsigned long data);
 typedef int  (*tlkm_device_pirq_f) (struct tlkm_device *, int irq_no, irq_handler_t h, void *data);
 typedef void (*tlkm_device_rirq_f) (struct tlkm_device *, int irq_no);
+typedef int  (*tlkm_device_mmap_f) (struct tlkm_device *, ulong off, struct vm_area_struct *vm);
 
 struct tlkm_class {
 	char 				name[TLKM_CLASS_NAME_LEN];
@@ -33,6 +35,7 @@ struct tlkm_class {
 	tlkm_device_ioctl_f		ioctl;		/* ioctl implementation */
 	tlkm_device_pirq_f		pirq;		/* request platform IRQ */
 	tlkm_device_rirq_f		rirq;		/* release platform IRQ */
+	tlkm_device_mmap_f		mmap;		/* map device buffers (optional) */
 	size_t				npirqs;		/* number of platform interrupts */
 	struct platform			platform;	/* register space definitions */
 	void				*private_data;
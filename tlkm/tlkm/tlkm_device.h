@@ -28,6 +28,7 @@ struct tlkm_device {
 	int 			vendor_id;
 	int 			product_id;
 	dev_addr_t		base_offset;	/* physical base offset of bitstream */
+	int			node;		/* NUMA node of the device */
 	struct platform_mmap 	mmap;		/* I/O remaps of register spaces */
 	struct tlkm_status	status;		/* address map information */
 	struct tlkm_control	*ctrl;		/* main device file */
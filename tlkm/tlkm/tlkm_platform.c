@@ -104,7 +104,15 @@ long tlkm_platform_read(struct tlkm_device *dev, struct tlkm_copy_cmd *cmd)
 		DEVERR(dev->dev_id, "invalid address: %pad", &cmd->dev_addr);
 		return -ENXIO;
 	}
-	buf = kzalloc(cmd->length, GFP_ATOMIC);
+	// block transfers must not cross the end of the mapped region
+	if (! cmd->length || addr2map(dev, cmd->dev_addr + cmd->length - 1) != ptr + cmd->length - 1) {
+		DEVERR(dev->dev_id, "invalid length %zu at %pad", cmd->length, &cmd->dev_addr);
+		return -EINVAL;
+	}
+	if (! (buf = kzalloc(cmd->length, GFP_ATOMIC))) {
+		DEVERR(dev->dev_id, "could not allocate %zu bytes", cmd->length);
+		return -ENOMEM;
+	}
 	memcpy_fromio(buf, ptr, cmd->length);
 	if ((ret = copy_to_user((u32 __user *)cmd->user_addr, buf, cmd->length))) {
 		DEVERR(dev->dev_id, "could not copy all bytes from 0x%px to user space 0x%px: %ld",
@@ -125,7 +133,15 @@ long tlkm_platform_write(struct tlkm_device *dev, struct tlkm_copy_cmd *cmd)
 		DEVERR(dev->dev_id, "invalid address: %pad", &cmd->dev_addr);
 		return -ENXIO;
 	}
-	buf = kzalloc(cmd->length, GFP_ATOMIC);
+	// block transfers must not cross the end of the mapped region
+	if (! cmd->length || addr2map(dev, cmd->dev_addr + cmd->length - 1) != ptr + cmd->length - 1) {
+		DEVERR(dev->dev_id, "invalid length %zu at %pad", cmd->length, &cmd->dev_addr);
+		return -EINVAL;
+	}
+	if (! (buf = kzalloc(cmd->length, GFP_ATOMIC))) {
+		DEVERR(dev->dev_id, "could not allocate %zu bytes", cmd->length);
+		return -ENOMEM;
+	}
 	if ((ret = copy_from_user(buf, (u32 __user *)cmd->user_addr, cmd->length))) {
 		DEVERR(dev->dev_id, "could not copy all bytes from 0x%px to user space 0x%px: %ld",
 				buf, cmd->user_addr, ret);
@@ -32,9 +32,13 @@
 #include <linux/ioctl.h>
 #endif
 
+/** Buffer is mapped cacheable, see TLKM_DEV_IOCTL_SYNC. */
+#define TLKM_MM_FLAGS_CACHEABLE		(1U << 0)
+
 struct tlkm_mm_cmd {
 	size_t			sz;
 	dev_addr_t		dev_addr;
+	u32			flags;
 };
 
 struct tlkm_copy_cmd {
@@ -43,14 +47,65 @@ struct tlkm_copy_cmd {
 	dev_addr_t 		dev_addr;
 };
 
+/** Maximal number of segments of a vectored copy; split longer arrays. */
+#define TLKM_COPY_V_MAX_SEGS		1024
+
+/** Vectored copy: segs points to num_segs copy commands in user space. */
+struct tlkm_copy_v_cmd {
+	size_t			num_segs;
+	struct tlkm_copy_cmd	*segs;
+};
+
 struct tlkm_bulk_cmd {
 	struct tlkm_mm_cmd	mm;
 	struct tlkm_copy_cmd	copy;
 };
 
+/** Staging buffer i is mapped at mmap_offset + i * buf_sz. */
+struct tlkm_staging_cmd {
+	size_t			num_bufs;
+	size_t			buf_sz;
+	uintptr_t		mmap_offset;
+};
+
+struct tlkm_staged_copy_cmd {
+	size_t			buf_idx;
+	size_t			offset;
+	size_t			length;
+	dev_addr_t		dev_addr;
+};
+
+/** Device buffer at dev_addr can be mapped with sz bytes at mmap_offset. */
+struct tlkm_dmabuf_cmd {
+	dev_addr_t		dev_addr;
+	size_t			sz;
+	uintptr_t		mmap_offset;
+	u32			flags;
+};
+
+typedef enum {
+	TLKM_SYNC_FOR_DEVICE = 0,
+	TLKM_SYNC_FOR_CPU,
+} tlkm_sync_dir_t;
+
+/** Cache maintenance for [offset, offset + length) of buffer at dev_addr. */
+struct tlkm_sync_cmd {
+	dev_addr_t		dev_addr;
+	size_t			offset;
+	size_t			length;
+	u32			dir;
+};
+
 #define TLKM_DEV_IOCTL_FN		"tlkm_%02u"
 #define TLKM_DEV_PERFC_FN		"tlkm_perfc_%02u"
 
+/** mmap offsets from here on map device buffers in shared memory (Zynq). */
+#define TLKM_DEV_DMABUF_MMAP_OFFSET	0xD0000000UL
+/** mmap offsets from here on map the architecture space write-combined. */
+#define TLKM_DEV_WC_MMAP_OFFSET		0xE0000000UL
+/** mmap offsets at and above this value refer to DMA staging buffers. */
+#define TLKM_DEV_STAGING_MMAP_OFFSET	0xF0000000UL
+
 #ifdef _TLKM_DEV_IOCTL
 	#undef _TLKM_DEV_IOCTL
 #endif
@@ -61,6 +116,12 @@ struct tlkm_bulk_cmd {
 	_TLKM_DEV_IOCTL(FREE,		free,		0x11,	struct tlkm_mm_cmd) \
 	_TLKM_DEV_IOCTL(COPYTO,		copyto,		0x12,	struct tlkm_copy_cmd) \
 	_TLKM_DEV_IOCTL(COPYFROM,	copyfrom,	0x13,	struct tlkm_copy_cmd) \
+	_TLKM_DEV_IOCTL(STAGING_INFO,	staging_info,	0x14,	struct tlkm_staging_cmd) \
+	_TLKM_DEV_IOCTL(COPYTO_STAGED,	copyto_staged,	0x15,	struct tlkm_staged_copy_cmd) \
+	_TLKM_DEV_IOCTL(DMABUF_INFO,	dmabuf_info,	0x16,	struct tlkm_dmabuf_cmd) \
+	_TLKM_DEV_IOCTL(SYNC,		sync,		0x17,	struct tlkm_sync_cmd) \
+	_TLKM_DEV_IOCTL(COPYTO_V,	copyto_v,	0x18,	struct tlkm_copy_v_cmd) \
+	_TLKM_DEV_IOCTL(COPYFROM_V,	copyfrom_v,	0x19,	struct tlkm_copy_v_cmd) \
 	_TLKM_DEV_IOCTL(ALLOC_COPYTO,	alloc_copyto,	0x20,	struct tlkm_bulk_cmd) \
 	_TLKM_DEV_IOCTL(COPYFROM_FREE,	copyfrom_free,	0x21,	struct tlkm_bulk_cmd) \
 	_TLKM_DEV_IOCTL(READ,		read,		0x30,	struct tlkm_copy_cmd) \
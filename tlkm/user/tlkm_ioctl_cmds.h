@@ -43,6 +43,7 @@ typedef struct tlkm_device_info {
 	u32  			vendor_id;
 	u32  			product_id;
 	char 			name[TLKM_DEVNAME_SZ];
+	s32			numa_node;	/* -1 if unknown */
 } tlkm_device_info_t;
 
 struct tlkm_ioctl_version_cmd {
@@ -19,8 +19,6 @@ struct platform zynq_def = ZYNQ_DEF;
 #include "zynq_ioctl.h"
 #include "zynq_irq.h"
 
-static inline void zynq_remove(struct tlkm_class *cls) {}
-
 static const
 struct tlkm_class zynq_cls = {
 	.name 			= ZYNQ_CLASS_NAME,
@@ -29,10 +27,11 @@ struct tlkm_class zynq_cls = {
 	.init_subsystems	= zynq_device_init_subsystems,
 	.exit_subsystems	= zynq_device_exit_subsystems,
 	.probe			= zynq_device_probe,
-	.remove			= zynq_remove,
+	.remove			= zynq_device_remove,
 	.ioctl			= zynq_ioctl,
 	.pirq			= zynq_irq_request_platform_irq,
 	.rirq			= zynq_irq_release_platform_irq,
+	.mmap			= zynq_device_mmap,
 	.npirqs			= 8,
 	.platform		= ZYNQ_DEF,
 	.private_data		= NULL,
@@ -1,4 +1,5 @@
 #include <linux/of.h>
+#include <linux/dma-mapping.h>
 #include <linux/fs.h>
 #include <linux/io.h>
 #include "tlkm_logging.h"
@@ -47,7 +48,7 @@ void zynq_device_exit(struct tlkm_device *inst)
 int zynq_device_init_subsystems(struct tlkm_device *dev, void *data)
 {
 	int ret = 0;
-	if ((ret = zynq_dmamgmt_init())) {
+	if ((ret = zynq_dmamgmt_init(&_zynq_dev.pdev->dev))) {
 		DEVERR(dev->dev_id, "could not initialize DMA management: %d", ret);
 		goto err_dmamgmt;
 	}
@@ -73,17 +74,42 @@ void zynq_device_exit_subsystems(struct tlkm_device *dev)
 	DEVLOG(dev->dev_id, TLKM_LF_DEVICE, "exited subsystems");
 }
 
+int zynq_device_mmap(struct tlkm_device *dev, ulong off, struct vm_area_struct *vm)
+{
+	DEVLOG(dev->dev_id, TLKM_LF_DEVICE, "mapping device buffer #%lu", off >> PAGE_SHIFT);
+	return zynq_dmamgmt_mmap(off >> PAGE_SHIFT, vm);
+}
+
 int zynq_device_probe(struct tlkm_class *cls)
 {
 	struct tlkm_device *inst;
+	struct device_node *np;
 	LOG(TLKM_LF_DEVICE, "searching for Xilinx Zynq-7000 series devices ...");
-	if (of_find_matching_node(NULL, zynq_ids)) {
+	if ((np = of_find_matching_node(NULL, zynq_ids))) {
 		LOG(TLKM_LF_DEVICE, "found Xilinx Zynq-7000");
+		of_node_put(np);
+		// the root node has no device, register one for the DMA API
+		_zynq_dev.pdev = platform_device_register_simple(ZYNQ_CLASS_NAME, PLATFORM_DEVID_NONE, NULL, 0);
+		if (IS_ERR(_zynq_dev.pdev)) {
+			ERR("could not register platform device: %ld", PTR_ERR(_zynq_dev.pdev));
+			_zynq_dev.pdev = NULL;
+			return -ENODEV;
+		}
+		dma_coerce_mask_and_coherent(&_zynq_dev.pdev->dev, DMA_BIT_MASK(32));
 		inst = tlkm_bus_new_device(cls, 0, 0, NULL);
-		if (! inst)
+		if (! inst) {
+			zynq_device_remove(cls);
 			return -EFAULT;
+		}
 	} else {
 		LOG(TLKM_LF_DEVICE, "no Xilinx Zynq-7000 series device found");
 	}
 	return 0;
 }
+
+void zynq_device_remove(struct tlkm_class *cls)
+{
+	if (_zynq_dev.pdev)
+		platform_device_unregister(_zynq_dev.pdev);
+	_zynq_dev.pdev = NULL;
+}
@@ -1,19 +1,23 @@
 #ifndef ZYNQ_DEVICE_H__
 #define ZYNQ_DEVICE_H__
 
+#include <linux/platform_device.h>
 #include "tlkm_types.h"
 #include "tlkm_class.h"
 #include "tlkm_device.h"
 
 struct zynq_device {
 	struct tlkm_device	*parent;
+	struct platform_device	*pdev;		// for the DMA API
 };
 
 int  zynq_device_init(struct tlkm_device *dev, void *data);
 void zynq_device_exit(struct tlkm_device *dev);
 int  zynq_device_init_subsystems(struct tlkm_device *dev, void *data);
 void zynq_device_exit_subsystems(struct tlkm_device *dev);
+int  zynq_device_mmap(struct tlkm_device *dev, ulong off, struct vm_area_struct *vm);
 
-int zynq_device_probe(struct tlkm_class *cls);
+int  zynq_device_probe(struct tlkm_class *cls);
+void zynq_device_remove(struct tlkm_class *cls);
 
 #endif /* ZYNQ_DEVICE_H__ */
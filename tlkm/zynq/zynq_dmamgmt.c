@@ -21,36 +21,122 @@
 //! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.esa.tu-darmstadt.de)
 //!
 #include <linux/dma-mapping.h>
+#include <linux/hashtable.h>
+#include <linux/log2.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/mm.h>
 #include "tlkm_logging.h"
 #include "zynq_dmamgmt.h"
 #include "gen_fixed_size_pool.h"
 
+static uint dmamgmt_region_sz = ZYNQ_DMAMGMT_REGION_SZ;
+module_param(dmamgmt_region_sz, uint, S_IRUGO);
+MODULE_PARM_DESC(dmamgmt_region_sz, "size of the DMA region reserved at load time (bytes, 0 = allocate every buffer directly)");
+
 static inline void init_dma_buf_t(struct dma_buf_t *buf, fsp_idx_t const idx)
 {
 	buf->len = 0;
 	buf->handle = 0;
 	buf->dma_addr = 0;
 	buf->kvirt_addr = NULL;
+	buf->cls = ZYNQ_DMAMGMT_NO_CLASS;
+	buf->cached = 0;
+	buf->mapcount = 0;
+	buf->orphaned = 0;
+	INIT_HLIST_NODE(&buf->hnode);
 }
 
 MAKE_FIXED_SIZE_POOL(dmabuf, ZYNQ_DMAMGMT_POOLSZ, struct dma_buf_t, init_dma_buf_t)
 
 static struct dmabuf_fsp_t _dmabuf;
 
+/* reserved region: blocks are carved from top, freed blocks are kept on a
+ * per-class free list threaded through the blocks themselves */
+static struct {
+	size_t sz;
+	size_t top;
+	void *kvirt_addr;
+	dma_addr_t dma_addr;
+	void *free[ZYNQ_DMAMGMT_CLASSES];
+} _region;
+
+/* device all buffers are mapped for, i.e., the Zynq platform device */
+static struct device *_dev;
+
+static DEFINE_HASHTABLE(_dmabufs, ZYNQ_DMAMGMT_HASH_BITS);
+static DEFINE_MUTEX(_dmamgmt_mtx);
+
+static inline int size_class(size_t const len)
+{
+	int order;
+	if (! len) return ZYNQ_DMAMGMT_NO_CLASS;
+	order = max_t(int, ilog2(roundup_pow_of_two(len)), ZYNQ_DMAMGMT_MIN_ORDER);
+	return order > ZYNQ_DMAMGMT_MAX_ORDER ? ZYNQ_DMAMGMT_NO_CLASS : order - ZYNQ_DMAMGMT_MIN_ORDER;
+}
+
+static inline size_t class_sz(int const cls)
+{
+	return 1UL << (cls + ZYNQ_DMAMGMT_MIN_ORDER);
+}
+
+/* must hold _dmamgmt_mtx; recycled blocks must be zeroed by the caller */
+static void *region_get(int const cls, dma_addr_t *dma_addr, int *recycled)
+{
+	void *p = _region.free[cls];
+	*recycled = p != NULL;
+	if (p) {
+		_region.free[cls] = *(void **)p;
+	} else if (_region.kvirt_addr && _region.sz - _region.top >= class_sz(cls)) {
+		p = _region.kvirt_addr + _region.top;
+		_region.top += class_sz(cls);
+	} else {
+		return NULL;
+	}
+	*dma_addr = _region.dma_addr + (p - _region.kvirt_addr);
+	return p;
+}
+
+/* must hold _dmamgmt_mtx */
+static void region_put(int const cls, void *p)
+{
+	*(void **)p = _region.free[cls];
+	_region.free[cls] = p;
+}
+
 static inline ssize_t find_dma_addr(dma_addr_t const addr)
 {
-	ssize_t id = 0;
-	while (id < ZYNQ_DMAMGMT_POOLSZ && _dmabuf.elems[id].dma_addr != addr)
-		++id;
-	if (id >= ZYNQ_DMAMGMT_POOLSZ)
+	struct dma_buf_t *b;
+	ssize_t id = -1;
+	mutex_lock(&_dmamgmt_mtx);
+	hash_for_each_possible(_dmabufs, b, hnode, addr) {
+		if (b->dma_addr == addr) {
+			id = b - _dmabuf.elems;
+			break;
+		}
+	}
+	mutex_unlock(&_dmamgmt_mtx);
+	if (id < 0)
 		WRN("dma address not found: 0x%08lx", (long unsigned)addr);
-	return id < ZYNQ_DMAMGMT_POOLSZ ? id : -1;
+	return id;
 }
 
-int zynq_dmamgmt_init(void)
+int zynq_dmamgmt_init(struct device *dev)
 {
+	_dev = dev;
 	dmabuf_fsp_init(&_dmabuf);
-	LOG(TLKM_LF_DMAMGMT, "DMA buffer management initialized: size = %u", ZYNQ_DMAMGMT_POOLSZ);
+	hash_init(_dmabufs);
+	memset(&_region, 0, sizeof(_region));
+	if (dmamgmt_region_sz) {
+		_region.sz = PAGE_ALIGN(dmamgmt_region_sz);
+		_region.kvirt_addr = dma_alloc_coherent(_dev, _region.sz, &_region.dma_addr, GFP_KERNEL);
+		if (! _region.kvirt_addr) {
+			WRN("could not reserve DMA region of %zu bytes, allocating buffers directly", _region.sz);
+			_region.sz = 0;
+		}
+	}
+	LOG(TLKM_LF_DMAMGMT, "DMA buffer management initialized: size = %u, region = %zu bytes",
+			ZYNQ_DMAMGMT_POOLSZ, _region.sz);
 	return 0;
 }
 
@@ -63,51 +149,108 @@ void zynq_dmamgmt_exit()
 			zynq_dmamgmt_dealloc(i);
 		}
 	}
+	if (_region.kvirt_addr)
+		dma_free_coherent(_dev, _region.sz, _region.kvirt_addr, _region.dma_addr);
+	memset(&_region, 0, sizeof(_region));
 	LOG(TLKM_LF_DMAMGMT, "DMA buffer management exited");
 }
 
-dma_addr_t zynq_dmamgmt_alloc(size_t const len, handle_t *hid)
+/* cacheable buffers are regular pages mapped for streaming DMA */
+static void *alloc_cached(size_t const len, dma_addr_t *dma_addr)
+{
+	void *p = alloc_pages_exact(PAGE_ALIGN(len), GFP_KERNEL | __GFP_ZERO);
+	if (! p) return NULL;
+	*dma_addr = dma_map_single(_dev, p, PAGE_ALIGN(len), DMA_BIDIRECTIONAL);
+	if (dma_mapping_error(_dev, *dma_addr)) {
+		free_pages_exact(p, PAGE_ALIGN(len));
+		return NULL;
+	}
+	return p;
+}
+
+dma_addr_t zynq_dmamgmt_alloc(size_t const len, handle_t *hid, int const cached)
 {
 	fsp_idx_t id;
+	struct dma_buf_t *b;
+	int recycled = 0;
 	id = dmabuf_fsp_get(&_dmabuf);
 	LOG(TLKM_LF_DMAMGMT, "len = %zu, id = %u", len, id);
 	if (id == INVALID_IDX) {
 		WRN("internal pool depleted: could not allocate a buffer!");
 		return 0;
 	}
-	_dmabuf.elems[id].kvirt_addr = dma_alloc_coherent(
-			NULL, len, &_dmabuf.elems[id].dma_addr,
-			GFP_KERNEL | __GFP_MEMALLOC);
-	if (! _dmabuf.elems[id].kvirt_addr) {
+	b = &_dmabuf.elems[id];
+	b->cls = cached ? ZYNQ_DMAMGMT_NO_CLASS : size_class(len);
+	b->cached = cached;
+	if (cached)
+		b->kvirt_addr = alloc_cached(len, &b->dma_addr);
+	mutex_lock(&_dmamgmt_mtx);
+	if (b->cls != ZYNQ_DMAMGMT_NO_CLASS)
+		b->kvirt_addr = region_get(b->cls, &b->dma_addr, &recycled);
+	mutex_unlock(&_dmamgmt_mtx);
+	// the block is ours already, zero it without holding up other allocs
+	if (recycled)
+		memset(b->kvirt_addr, 0, class_sz(b->cls));
+	if (! b->kvirt_addr && ! cached) {
+		b->cls = ZYNQ_DMAMGMT_NO_CLASS;
+		b->kvirt_addr = dma_alloc_coherent(_dev, len, &b->dma_addr,
+				GFP_KERNEL | __GFP_MEMALLOC);
+	}
+	if (! b->kvirt_addr) {
 		WRN("could not allocate DMA buffer of size %zu byte!", len);
+		init_dma_buf_t(b, id);
 		dmabuf_fsp_put(&_dmabuf, id);
 		return 0;
 	}
-	_dmabuf.elems[id].len = len;
-	LOG(TLKM_LF_DMAMGMT, "len = %zu, kvirt_addr = 0x%08lx, dma_addr = 0x%08lx",
-			len, (unsigned long)_dmabuf.elems[id].kvirt_addr,
-			(unsigned long)_dmabuf.elems[id].dma_addr);
+	b->len = len;
+	mutex_lock(&_dmamgmt_mtx);
+	hash_add(_dmabufs, &b->hnode, b->dma_addr);
+	mutex_unlock(&_dmamgmt_mtx);
+	LOG(TLKM_LF_DMAMGMT, "len = %zu, class = %d, cached = %d, kvirt_addr = 0x%08lx, dma_addr = 0x%08lx",
+			len, b->cls, b->cached, (unsigned long)b->kvirt_addr,
+			(unsigned long)b->dma_addr);
 	if (hid) *hid = id;
-	return _dmabuf.elems[id].dma_addr;
+	return b->dma_addr;
 }
 
-int zynq_dmamgmt_dealloc(handle_t const id)
+/* must hold _dmamgmt_mtx */
+static void dmabuf_release(handle_t const id)
 {
-	if (id < ZYNQ_DMAMGMT_POOLSZ && _dmabuf.elems[id].kvirt_addr) {
-		LOG(TLKM_LF_DMAMGMT, "id = %llu, len = %zd, kvirt_addr = 0x%08lx, dma_addr = 0x%08lx",
-				id, _dmabuf.elems[id].len,
-				(unsigned long)_dmabuf.elems[id].kvirt_addr,
-				(unsigned long)_dmabuf.elems[id].dma_addr);
-		dma_free_coherent(NULL,
-				_dmabuf.elems[id].len,
-				_dmabuf.elems[id].kvirt_addr,
-				_dmabuf.elems[id].dma_addr);
-		init_dma_buf_t(&_dmabuf.elems[id], id);
+	struct dma_buf_t *b = &_dmabuf.elems[id];
+	if (b->cached) {
+		dma_unmap_single(_dev, b->dma_addr, PAGE_ALIGN(b->len), DMA_BIDIRECTIONAL);
+		free_pages_exact(b->kvirt_addr, PAGE_ALIGN(b->len));
+	} else if (b->cls != ZYNQ_DMAMGMT_NO_CLASS) {
+		region_put(b->cls, b->kvirt_addr);
 	} else {
+		dma_free_coherent(_dev, b->len, b->kvirt_addr, b->dma_addr);
+	}
+	init_dma_buf_t(b, id);
+	dmabuf_fsp_put(&_dmabuf, id);
+}
+
+int zynq_dmamgmt_dealloc(handle_t const id)
+{
+	struct dma_buf_t *b;
+	if (id >= ZYNQ_DMAMGMT_POOLSZ || ! _dmabuf.elems[id].kvirt_addr) {
 		WRN("illegal id %llu, no deallocation", id);
 		return 1;
 	}
-	dmabuf_fsp_put(&_dmabuf, id);
+	b = &_dmabuf.elems[id];
+	LOG(TLKM_LF_DMAMGMT, "id = %llu, len = %zd, class = %d, kvirt_addr = 0x%08lx, dma_addr = 0x%08lx",
+			id, b->len, b->cls,
+			(unsigned long)b->kvirt_addr,
+			(unsigned long)b->dma_addr);
+	mutex_lock(&_dmamgmt_mtx);
+	hash_del(&b->hnode);
+	if (b->mapcount) {
+		// still mapped in user space, release on last unmap
+		LOG(TLKM_LF_DMAMGMT, "id = %llu still mapped %d times, deferring release", id, b->mapcount);
+		b->orphaned = 1;
+	} else {
+		dmabuf_release(id);
+	}
+	mutex_unlock(&_dmamgmt_mtx);
 	return 0;
 }
 
@@ -127,3 +270,77 @@ ssize_t zynq_dmamgmt_get_id(dma_addr_t const addr)
 {
 	return find_dma_addr(addr);
 }
+
+static void dmabuf_vm_open(struct vm_area_struct *vm)
+{
+	struct dma_buf_t *b = vm->vm_private_data;
+	mutex_lock(&_dmamgmt_mtx);
+	++b->mapcount;
+	mutex_unlock(&_dmamgmt_mtx);
+}
+
+static void dmabuf_vm_close(struct vm_area_struct *vm)
+{
+	struct dma_buf_t *b = vm->vm_private_data;
+	mutex_lock(&_dmamgmt_mtx);
+	if (! --b->mapcount && b->orphaned)
+		dmabuf_release(b - _dmabuf.elems);
+	mutex_unlock(&_dmamgmt_mtx);
+}
+
+static const struct vm_operations_struct dmabuf_vm_ops = {
+	.open  = dmabuf_vm_open,
+	.close = dmabuf_vm_close,
+};
+
+int zynq_dmamgmt_mmap(handle_t const id, struct vm_area_struct *vm)
+{
+	struct dma_buf_t *b;
+	size_t const sz = vm->vm_end - vm->vm_start;
+	int ret = -EINVAL;
+	if (id >= ZYNQ_DMAMGMT_POOLSZ) {
+		WRN("illegal id %llu, cannot map", id);
+		return -EINVAL;
+	}
+	b = &_dmabuf.elems[id];
+	mutex_lock(&_dmamgmt_mtx);
+	if (! b->kvirt_addr || b->orphaned || sz > PAGE_ALIGN(b->len)) {
+		WRN("cannot map %zu bytes of buffer %llu", sz, id);
+		goto out;
+	}
+	// the offset only selects the buffer, mapping always starts at its beginning
+	vm->vm_pgoff = 0;
+	if (b->cached)
+		ret = remap_pfn_range(vm, vm->vm_start, virt_to_phys(b->kvirt_addr) >> PAGE_SHIFT,
+				sz, vm->vm_page_prot);
+	else
+		ret = dma_mmap_coherent(_dev, vm, b->kvirt_addr, b->dma_addr,
+				b->cls != ZYNQ_DMAMGMT_NO_CLASS ? class_sz(b->cls) : PAGE_ALIGN(b->len));
+	if (ret) {
+		WRN("could not map buffer %llu: %d", id, ret);
+		goto out;
+	}
+	vm->vm_private_data = b;
+	vm->vm_ops = &dmabuf_vm_ops;
+	++b->mapcount;
+	LOG(TLKM_LF_DMAMGMT, "mapped %zu bytes of buffer %llu, dma_addr = 0x%08lx to user space 0x%lx",
+			sz, id, (unsigned long)b->dma_addr, vm->vm_start);
+out:
+	mutex_unlock(&_dmamgmt_mtx);
+	return ret;
+}
+
+int zynq_dmamgmt_sync(struct dma_buf_t *b, size_t const off, size_t const len, int const for_device)
+{
+	if (off > b->len || len > b->len - off) {
+		WRN("invalid sync range: offset = %zu, len = %zu, buffer size = %zu", off, len, b->len);
+		return -EINVAL;
+	}
+	// coherent buffers are mapped uncached
+	if (! b->cached || ! len) return 0;
+	if (for_device)
+		dma_sync_single_range_for_device(_dev, b->dma_addr, off, len, DMA_BIDIRECTIONAL);
+	else
+		dma_sync_single_range_for_cpu(_dev, b->dma_addr, off, len, DMA_BIDIRECTIONAL);
+	return 0;
+}
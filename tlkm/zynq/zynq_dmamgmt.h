@@ -23,10 +23,23 @@
 #ifndef ZYNQ_DMAMGMT_H__
 #define ZYNQ_DMAMGMT_H__
 
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/mm_types.h>
 #include "tlkm_types.h"
 
 #define ZYNQ_DMAMGMT_POOLSZ		 	1024U
 
+/* buffers are sub-allocated from a pre-reserved CMA region in power-of-two
+ * size classes from 2^MIN_ORDER to 2^MAX_ORDER bytes; larger buffers, or
+ * all of them if the region could not be reserved, are allocated directly */
+#define ZYNQ_DMAMGMT_REGION_SZ			(32U << 20)
+#define ZYNQ_DMAMGMT_MIN_ORDER			12
+#define ZYNQ_DMAMGMT_MAX_ORDER			22
+#define ZYNQ_DMAMGMT_CLASSES			(ZYNQ_DMAMGMT_MAX_ORDER - ZYNQ_DMAMGMT_MIN_ORDER + 1)
+#define ZYNQ_DMAMGMT_NO_CLASS			(-1)
+#define ZYNQ_DMAMGMT_HASH_BITS			10
+
 typedef u64 handle_t;
 
 struct dma_buf_t {
@@ -34,14 +47,21 @@ struct dma_buf_t {
 	unsigned long handle;
 	dma_addr_t dma_addr;
 	void * kvirt_addr;
+	int cls;			/* size class, ZYNQ_DMAMGMT_NO_CLASS if direct */
+	int cached;			/* cacheable, needs explicit maintenance */
+	int mapcount;			/* number of user space mappings */
+	int orphaned;			/* freed while mapped, release on unmap */
+	struct hlist_node hnode;	/* dma_addr -> buffer lookup */
 };
 
-int zynq_dmamgmt_init(void);
+int zynq_dmamgmt_init(struct device *dev);
 void zynq_dmamgmt_exit(void);
-dma_addr_t zynq_dmamgmt_alloc(size_t const len, handle_t *hid);
+dma_addr_t zynq_dmamgmt_alloc(size_t const len, handle_t *hid, int const cached);
 int zynq_dmamgmt_dealloc(handle_t const id);
 int zynq_dmamgmt_dealloc_dma(dma_addr_t const addr);
 struct dma_buf_t *zynq_dmamgmt_get(handle_t const id);
 ssize_t zynq_dmamgmt_get_id(dma_addr_t const addr);
+int zynq_dmamgmt_mmap(handle_t const id, struct vm_area_struct *vm);
+int zynq_dmamgmt_sync(struct dma_buf_t *b, size_t const off, size_t const len, int const for_device);
 
 #endif /* ZYNQ_DMAMGMT_H__ */
@@ -25,6 +25,7 @@
 #include <linux/io.h>
 #include <linux/slab.h>
 #include <linux/gfp.h>
+#include <linux/string.h>
 
 #include "tlkm_logging.h"
 #include "tlkm_device.h"
@@ -53,7 +54,7 @@ long zynq_ioctl_alloc(struct tlkm_device *inst, struct tlkm_mm_cmd *cmd)
 		return -EINVAL;
 	}
 
-	dma_addr = zynq_dmamgmt_alloc(cmd->sz, NULL);
+	dma_addr = zynq_dmamgmt_alloc(cmd->sz, NULL, !! (cmd->flags & TLKM_MM_FLAGS_CACHEABLE));
 	if (! dma_addr) {
 		DEVWRN(inst->dev_id, "allocation failed: len = %zu", cmd->sz);
 		return -ENOMEM;
@@ -80,11 +81,11 @@ static inline
 long zynq_ioctl_copyto(struct tlkm_device *inst, struct tlkm_copy_cmd *cmd)
 {
 	struct dma_buf_t *dmab;
+	long ret;
 	DEVLOG(inst->dev_id, TLKM_LF_IOCTL, "copyto: len = %zu, dma = %pad, p = 0x%px",
 			cmd->length, &cmd->dev_addr, cmd->user_addr);
 	// allocate, if necessary
 	if (cmd->dev_addr < 0 || ! (dmab = zynq_dmamgmt_get(zynq_dmamgmt_get_id(cmd->dev_addr)))) {
-		int ret;
 		struct tlkm_mm_cmd mm_cmd = { .sz = cmd->length, };
 		mm_cmd.dev_addr = -1;
 		DEVLOG(inst->dev_id, TLKM_LF_IOCTL, "allocating %zu bytes for transfer", cmd->length);
@@ -100,10 +101,18 @@ long zynq_ioctl_copyto(struct tlkm_device *inst, struct tlkm_copy_cmd *cmd)
 	}
 	DEVLOG(inst->dev_id, TLKM_LF_IOCTL, "dmab->kvirt_addr = 0x%px, dmab->dma_addr = %pad",
 			dmab->kvirt_addr, &dmab->dma_addr);
+	if (cmd->length > dmab->len) {
+		DEVERR(inst->dev_id, "copy of %zu bytes exceeds buffer of %zu bytes", cmd->length, dmab->len);
+		return -EINVAL;
+	}
 	if (copy_from_user(dmab->kvirt_addr, (void __user *) cmd->user_addr, cmd->length)) {
 		DEVWRN(inst->dev_id, "could not copy all bytes from user space");
 		return -EACCES;
 	}
+	if ((ret = zynq_dmamgmt_sync(dmab, 0, cmd->length, 1))) {
+		DEVERR(inst->dev_id, "could not sync buffer for device: %ld", ret);
+		return ret;
+	}
 	DEVLOG(inst->dev_id, TLKM_LF_IOCTL, "copyto finished successfully");
 	tlkm_perfc_total_usr2dev_transfers_add(inst->dev_id, cmd->length);
 	return 0;
@@ -113,6 +122,7 @@ static inline
 long zynq_ioctl_copyfrom(struct tlkm_device *inst, struct tlkm_copy_cmd *cmd)
 {
 	struct dma_buf_t *dmab;
+	long ret;
 	DEVLOG(inst->dev_id, TLKM_LF_DEVICE, "copyfrom: len = %zu, dma = %pad, p = 0x%px",
 			cmd->length, &cmd->dev_addr, cmd->user_addr);
 	dmab = zynq_dmamgmt_get(zynq_dmamgmt_get_id(cmd->dev_addr));
@@ -120,6 +130,14 @@ long zynq_ioctl_copyfrom(struct tlkm_device *inst, struct tlkm_copy_cmd *cmd)
 		DEVERR(inst->dev_id, "could not get dma buffer with dma = %pad", &cmd->dev_addr);
 			return -EINVAL;
 	}
+	if (cmd->length > dmab->len) {
+		DEVERR(inst->dev_id, "copy of %zu bytes exceeds buffer of %zu bytes", cmd->length, dmab->len);
+		return -EINVAL;
+	}
+	if ((ret = zynq_dmamgmt_sync(dmab, 0, cmd->length, 0))) {
+		DEVERR(inst->dev_id, "could not sync buffer for cpu: %ld", ret);
+		return ret;
+	}
 	if (copy_to_user((void __user *) cmd->user_addr, dmab->kvirt_addr, cmd->length)) {
 		DEVWRN(inst->dev_id, "could not copy all bytes from user space");
 		return -EACCES;
@@ -129,6 +147,41 @@ long zynq_ioctl_copyfrom(struct tlkm_device *inst, struct tlkm_copy_cmd *cmd)
 	return 0;
 }
 
+static inline
+long zynq_ioctl_copy_v(struct tlkm_device *inst, struct tlkm_copy_v_cmd *cmd,
+		long (*copy)(struct tlkm_device *, struct tlkm_copy_cmd *))
+{
+	long ret = 0;
+	size_t i;
+	struct tlkm_copy_cmd *segs;
+	if (! cmd->num_segs || cmd->num_segs > TLKM_COPY_V_MAX_SEGS) {
+		DEVERR(inst->dev_id, "invalid number of segments: %zu", cmd->num_segs);
+		return -EINVAL;
+	}
+	segs = memdup_user((void __user *)cmd->segs, cmd->num_segs * sizeof(*segs));
+	if (IS_ERR(segs)) {
+		DEVERR(inst->dev_id, "could not copy %zu segments from user space", cmd->num_segs);
+		return PTR_ERR(segs);
+	}
+	// no DMA engine: each segment is a memcpy from/to its own buffer
+	for (i = 0; i < cmd->num_segs && ! ret; ++i)
+		ret = copy(inst, &segs[i]);
+	kfree(segs);
+	return ret;
+}
+
+static inline
+long zynq_ioctl_copyto_v(struct tlkm_device *inst, struct tlkm_copy_v_cmd *cmd)
+{
+	return zynq_ioctl_copy_v(inst, cmd, zynq_ioctl_copyto);
+}
+
+static inline
+long zynq_ioctl_copyfrom_v(struct tlkm_device *inst, struct tlkm_copy_v_cmd *cmd)
+{
+	return zynq_ioctl_copy_v(inst, cmd, zynq_ioctl_copyfrom);
+}
+
 static inline
 long zynq_ioctl_alloc_copyto(struct tlkm_device *inst, struct tlkm_bulk_cmd *cmd)
 {
@@ -162,6 +215,54 @@ long zynq_ioctl_copyfrom_free(struct tlkm_device *inst, struct tlkm_bulk_cmd *cm
 	return 0;
 }
 
+static inline
+long zynq_ioctl_staging_info(struct tlkm_device *inst, struct tlkm_staging_cmd *cmd)
+{
+	// no staging buffers: there is no DMA engine and copies are memcpys anyway
+	cmd->num_bufs = 0;
+	cmd->buf_sz = 0;
+	cmd->mmap_offset = TLKM_DEV_STAGING_MMAP_OFFSET;
+	return 0;
+}
+
+static inline
+long zynq_ioctl_copyto_staged(struct tlkm_device *inst, struct tlkm_staged_copy_cmd *cmd)
+{
+	DEVERR(inst->dev_id, "staging buffers are not supported");
+	return -ENXIO;
+}
+
+static inline
+long zynq_ioctl_dmabuf_info(struct tlkm_device *inst, struct tlkm_dmabuf_cmd *cmd)
+{
+	struct dma_buf_t *dmab;
+	ssize_t const id = zynq_dmamgmt_get_id(cmd->dev_addr);
+	if (id < 0 || ! (dmab = zynq_dmamgmt_get(id))) {
+		DEVERR(inst->dev_id, "could not get dma buffer with dma = %pad", &cmd->dev_addr);
+		return -EINVAL;
+	}
+	cmd->sz = PAGE_ALIGN(dmab->len);
+	cmd->flags = dmab->cached ? TLKM_MM_FLAGS_CACHEABLE : 0;
+	cmd->mmap_offset = TLKM_DEV_DMABUF_MMAP_OFFSET + ((uintptr_t)id << PAGE_SHIFT);
+	DEVLOG(inst->dev_id, TLKM_LF_IOCTL, "dmabuf_info: dma = %pad, sz = %zu, mmap_offset = 0x%08lx",
+			&cmd->dev_addr, cmd->sz, (ulong)cmd->mmap_offset);
+	return 0;
+}
+
+static inline
+long zynq_ioctl_sync(struct tlkm_device *inst, struct tlkm_sync_cmd *cmd)
+{
+	struct dma_buf_t *dmab;
+	ssize_t const id = zynq_dmamgmt_get_id(cmd->dev_addr);
+	if (id < 0 || ! (dmab = zynq_dmamgmt_get(id))) {
+		DEVERR(inst->dev_id, "could not get dma buffer with dma = %pad", &cmd->dev_addr);
+		return -EINVAL;
+	}
+	DEVLOG(inst->dev_id, TLKM_LF_IOCTL, "sync: dma = %pad, offset = %zu, len = %zu, dir = %u",
+			&cmd->dev_addr, cmd->offset, cmd->length, cmd->dir);
+	return zynq_dmamgmt_sync(dmab, cmd->offset, cmd->length, cmd->dir == TLKM_SYNC_FOR_DEVICE);
+}
+
 static inline
 long zynq_ioctl_read(struct tlkm_device *inst, struct tlkm_copy_cmd *cmd)
 {